@@ -77,12 +77,29 @@ HEADERS += \
     methods/faf/faf_charts.h \
     methods/faf/faf_association.h \
     methods/faf/includes/view_renderer.h \
+    methods/faf/includes/faf_kernels.h \
     methods/faf/faf_optimization.h \
     methods/faf/faf_smoothing.h \
     methods/faf/faf_various.h \
     GUI/managers/fafmanager.h \
     GUI/managers/fafsegmentationmanager.h \
+    GUI/drawables/shareddrawablemesh.h \
+    GUI/drawables/meshlod.h \
     methods/faf/faf_split.h \
+    methods/faf/faf_planeclip.h \
+    methods/faf/faf_heightmap.h \
+    methods/faf/faf_simulation.h \
+    methods/faf/faf_maxflow.h \
+    methods/faf/faf_dynamicgraphcut.h \
+    methods/faf/faf_metrics.h \
+    methods/faf/faf_allocations.h \
+    methods/faf/faf_meshbuilder.h \
+    methods/faf/faf_meshview.h \
+    methods/faf/faf_depthraster.h \
+    methods/faf/faf_accessibility.h \
+    methods/faf/faf_arena.h \
+    methods/faf/faf_meshloader.h \
+    methods/faf/faf_incremental.h \
 
 SOURCES += \
     main.cpp \
@@ -102,7 +119,23 @@ SOURCES += \
     methods/faf/faf_various.cpp \
     GUI/managers/fafmanager.cpp \
     GUI/managers/fafsegmentationmanager.cpp \
+    GUI/drawables/shareddrawablemesh.cpp \
+    GUI/drawables/meshlod.cpp \
     methods/faf/faf_split.cpp \
+    methods/faf/faf_planeclip.cpp \
+    methods/faf/faf_heightmap.cpp \
+    methods/faf/faf_simulation.cpp \
+    methods/faf/faf_maxflow.cpp \
+    methods/faf/faf_dynamicgraphcut.cpp \
+    methods/faf/faf_metrics.cpp \
+    methods/faf/faf_allocations.cpp \
+    methods/faf/faf_meshbuilder.cpp \
+    methods/faf/faf_meshview.cpp \
+    methods/faf/faf_depthraster.cpp \
+    methods/faf/faf_accessibility.cpp \
+    methods/faf/faf_arena.cpp \
+    methods/faf/faf_meshloader.cpp \
+    methods/faf/faf_incremental.cpp \
 
 
 FORMS += \
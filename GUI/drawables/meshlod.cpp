@@ -0,0 +1,314 @@
+#include "meshlod.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <unordered_map>
+
+#define LOD_FINEST_SUBDIVISION 512
+#define LOD_MIN_REDUCTION 0.5
+
+namespace internal {
+
+void clusterVertices(
+        const std::vector<float>& vertices,
+        const std::vector<unsigned int>& faces,
+        const double minX,
+        const double minY,
+        const double minZ,
+        const double cellSize,
+        MeshLODLevel& level);
+
+}
+
+
+/* ----- LOD CONSTRUCTION ----- */
+
+/**
+ * @brief Build the levels of detail of a mesh by vertex clustering on grids
+ * of decreasing resolution. Every level keeps, for each face of the input mesh,
+ * the face in which it has been collapsed, or a close face if it has degenerated.
+ * It does not use OpenGL, so it can be safely called in a background thread.
+ * @param[in] vertices Vertex coordinates of the mesh (x, y, z for each vertex)
+ * @param[in] faces Faces of the mesh (three vertex indices for each face)
+ * @param[in] minFaces Minimum number of faces of a level
+ * @param[in] geometryVersion Version of the geometry used for the levels
+ * @returns Levels of detail, from the finest to the coarsest
+ */
+std::shared_ptr<MeshLOD> buildMeshLOD(
+        const std::vector<float>& vertices,
+        const std::vector<unsigned int>& faces,
+        const unsigned int minFaces,
+        const unsigned long long int geometryVersion)
+{
+    std::shared_ptr<MeshLOD> lod = std::make_shared<MeshLOD>();
+    lod->geometryVersion = geometryVersion;
+
+    if (vertices.empty())
+        return lod;
+
+    //Bounding box
+    std::array<double, 3> minCoord = {{vertices[0], vertices[1], vertices[2]}};
+    std::array<double, 3> maxCoord = minCoord;
+    for (size_t i = 0; i < vertices.size(); i += 3) {
+        for (unsigned int k = 0; k < 3; k++) {
+            minCoord[k] = std::min(minCoord[k], static_cast<double>(vertices[i + k]));
+            maxCoord[k] = std::max(maxCoord[k], static_cast<double>(vertices[i + k]));
+        }
+    }
+    const double diagonal = std::sqrt(
+                (maxCoord[0] - minCoord[0]) * (maxCoord[0] - minCoord[0]) +
+                (maxCoord[1] - minCoord[1]) * (maxCoord[1] - minCoord[1]) +
+                (maxCoord[2] - minCoord[2]) * (maxCoord[2] - minCoord[2]));
+
+    if (diagonal == 0)
+        return lod;
+
+    size_t previousNumberFaces = faces.size() / 3;
+
+    for (unsigned int subdivision = LOD_FINEST_SUBDIVISION; subdivision >= 2 && previousNumberFaces > minFaces; subdivision /= 2) {
+        MeshLODLevel level;
+        internal::clusterVertices(
+                    vertices, faces,
+                    minCoord[0], minCoord[1], minCoord[2],
+                    diagonal / subdivision,
+                    level);
+
+        const size_t numberFaces = level.faces.size() / 3;
+
+        //Skip the levels which do not reduce enough the previous one
+        if (numberFaces > previousNumberFaces * LOD_MIN_REDUCTION)
+            continue;
+
+        previousNumberFaces = numberFaces;
+        lod->levels.push_back(std::move(level));
+    }
+
+    return lod;
+}
+
+/**
+ * @brief Compute the face colors of a level of detail: each face takes the
+ * color of the majority of the input faces which have been collapsed in it
+ * @param[in] level Level of detail
+ * @param[in] faceColors Colors of the faces of the input mesh
+ * @param[out] levelFaceColors Colors of the faces of the level
+ */
+void computeLODFaceColors(
+        const MeshLODLevel& level,
+        const std::vector<cg3::Color>& faceColors,
+        std::vector<cg3::Color>& levelFaceColors)
+{
+    const size_t numberFaces = level.faces.size() / 3;
+
+    levelFaceColors.assign(numberFaces, cg3::Color(128,128,128));
+
+    //Pairs of level face and packed color, sorted to count the votes
+    std::vector<std::pair<int, unsigned int>> votes;
+    votes.reserve(faceColors.size());
+
+    for (size_t fId = 0; fId < faceColors.size() && fId < level.faceMap.size(); fId++) {
+        if (level.faceMap[fId] < 0)
+            continue;
+
+        const cg3::Color& color = faceColors[fId];
+        const unsigned int packedColor =
+                (static_cast<unsigned int>(color.red()) << 16) |
+                (static_cast<unsigned int>(color.green()) << 8) |
+                static_cast<unsigned int>(color.blue());
+
+        votes.push_back(std::make_pair(level.faceMap[fId], packedColor));
+    }
+
+    std::sort(votes.begin(), votes.end());
+
+    size_t i = 0;
+    while (i < votes.size()) {
+        const int levelFace = votes[i].first;
+
+        unsigned int bestColor = votes[i].second;
+        size_t bestCount = 0;
+
+        while (i < votes.size() && votes[i].first == levelFace) {
+            const unsigned int currentColor = votes[i].second;
+
+            size_t count = 0;
+            while (i < votes.size() && votes[i].first == levelFace && votes[i].second == currentColor) {
+                count++;
+                i++;
+            }
+
+            if (count > bestCount) {
+                bestCount = count;
+                bestColor = currentColor;
+            }
+        }
+
+        levelFaceColors[levelFace] = cg3::Color(
+                    static_cast<int>((bestColor >> 16) & 255),
+                    static_cast<int>((bestColor >> 8) & 255),
+                    static_cast<int>(bestColor & 255));
+    }
+}
+
+/**
+ * @brief Select the coarsest level of detail whose cells, projected on the screen,
+ * are not bigger than the max error
+ * @param[in] lod Levels of detail
+ * @param[in] pixelsPerUnit Pixels covered by a unit length on the screen
+ * @param[in] maxPixelError Max error in pixels
+ * @returns Index of the level plus one, 0 if the full resolution mesh is needed
+ */
+unsigned int selectLODLevel(
+        const MeshLOD& lod,
+        const double pixelsPerUnit,
+        const double maxPixelError)
+{
+    for (size_t i = lod.levels.size(); i > 0; i--) {
+        if (lod.levels[i-1].cellSize * pixelsPerUnit <= maxPixelError) {
+            return static_cast<unsigned int>(i);
+        }
+    }
+
+    return 0;
+}
+
+
+namespace internal {
+
+/**
+ * @brief Collapse the vertices of a mesh which lie in the same cell of a grid
+ * in their mean point. The faces which have collapsed in the same triangle
+ * are merged, the degenerate ones are removed and mapped on a face
+ * incident to one of their clusters.
+ * @param[in] vertices Vertex coordinates of the mesh
+ * @param[in] faces Faces of the mesh
+ * @param[in] minX Min x-coordinate of the grid
+ * @param[in] minY Min y-coordinate of the grid
+ * @param[in] minZ Min z-coordinate of the grid
+ * @param[in] cellSize Size of the cells of the grid
+ * @param[out] level Resulting level of detail
+ */
+void clusterVertices(
+        const std::vector<float>& vertices,
+        const std::vector<unsigned int>& faces,
+        const double minX,
+        const double minY,
+        const double minZ,
+        const double cellSize,
+        MeshLODLevel& level)
+{
+    const size_t numberVertices = vertices.size() / 3;
+    const size_t numberFaces = faces.size() / 3;
+
+    level.cellSize = cellSize;
+    level.vertices.clear();
+    level.faces.clear();
+    level.faceNormals.clear();
+    level.faceMap.assign(numberFaces, -1);
+
+    //Cluster of each vertex
+    std::unordered_map<unsigned long long int, unsigned int> cellCluster;
+    std::vector<unsigned int> vertexCluster(numberVertices);
+    std::vector<double> clusterSum;
+    std::vector<unsigned int> clusterCount;
+
+    for (size_t vId = 0; vId < numberVertices; vId++) {
+        const unsigned long long int i = static_cast<unsigned long long int>((vertices[vId*3] - minX) / cellSize);
+        const unsigned long long int j = static_cast<unsigned long long int>((vertices[vId*3+1] - minY) / cellSize);
+        const unsigned long long int k = static_cast<unsigned long long int>((vertices[vId*3+2] - minZ) / cellSize);
+        const unsigned long long int key = (i << 42) | (j << 21) | k;
+
+        std::unordered_map<unsigned long long int, unsigned int>::iterator it = cellCluster.find(key);
+        if (it == cellCluster.end()) {
+            it = cellCluster.insert(std::make_pair(key, static_cast<unsigned int>(clusterCount.size()))).first;
+            clusterSum.insert(clusterSum.end(), 3, 0.0);
+            clusterCount.push_back(0);
+        }
+
+        const unsigned int cluster = it->second;
+        vertexCluster[vId] = cluster;
+        clusterSum[cluster*3] += vertices[vId*3];
+        clusterSum[cluster*3+1] += vertices[vId*3+1];
+        clusterSum[cluster*3+2] += vertices[vId*3+2];
+        clusterCount[cluster]++;
+    }
+
+    level.vertices.resize(clusterSum.size());
+    for (size_t c = 0; c < clusterCount.size(); c++) {
+        for (unsigned int k = 0; k < 3; k++) {
+            level.vertices[c*3+k] = static_cast<float>(clusterSum[c*3+k] / clusterCount[c]);
+        }
+    }
+
+    //Non-degenerate faces, sorted by their (unordered) clusters to merge the duplicates
+    std::vector<std::pair<std::array<unsigned int, 3>, unsigned int>> clusterFaces;
+    clusterFaces.reserve(numberFaces);
+
+    for (size_t fId = 0; fId < numberFaces; fId++) {
+        std::array<unsigned int, 3> key = {{
+            vertexCluster[faces[fId*3]],
+            vertexCluster[faces[fId*3+1]],
+            vertexCluster[faces[fId*3+2]]
+        }};
+
+        if (key[0] == key[1] || key[1] == key[2] || key[0] == key[2])
+            continue;
+
+        std::sort(key.begin(), key.end());
+        clusterFaces.push_back(std::make_pair(key, static_cast<unsigned int>(fId)));
+    }
+
+    std::sort(clusterFaces.begin(), clusterFaces.end());
+
+    for (size_t i = 0; i < clusterFaces.size(); i++) {
+        if (i == 0 || clusterFaces[i].first != clusterFaces[i-1].first) {
+            //The first face keeps its orientation
+            const unsigned int fId = clusterFaces[i].second;
+            const unsigned int a = vertexCluster[faces[fId*3]];
+            const unsigned int b = vertexCluster[faces[fId*3+1]];
+            const unsigned int c = vertexCluster[faces[fId*3+2]];
+
+            level.faces.push_back(a);
+            level.faces.push_back(b);
+            level.faces.push_back(c);
+
+            //Face normal
+            const double ux = level.vertices[b*3] - level.vertices[a*3];
+            const double uy = level.vertices[b*3+1] - level.vertices[a*3+1];
+            const double uz = level.vertices[b*3+2] - level.vertices[a*3+2];
+            const double vx = level.vertices[c*3] - level.vertices[a*3];
+            const double vy = level.vertices[c*3+1] - level.vertices[a*3+1];
+            const double vz = level.vertices[c*3+2] - level.vertices[a*3+2];
+            double nx = uy * vz - uz * vy;
+            double ny = uz * vx - ux * vz;
+            double nz = ux * vy - uy * vx;
+            const double norm = std::sqrt(nx*nx + ny*ny + nz*nz);
+            if (norm > 0) {
+                nx /= norm;
+                ny /= norm;
+                nz /= norm;
+            }
+
+            level.faceNormals.push_back(static_cast<float>(nx));
+            level.faceNormals.push_back(static_cast<float>(ny));
+            level.faceNormals.push_back(static_cast<float>(nz));
+        }
+
+        level.faceMap[clusterFaces[i].second] = static_cast<int>(level.faces.size() / 3 - 1);
+    }
+
+    //Degenerate faces are assigned to a face incident to the cluster of their first vertex
+    std::vector<int> clusterFace(clusterCount.size(), -1);
+    for (size_t fId = 0; fId < level.faces.size(); fId++) {
+        clusterFace[level.faces[fId]] = static_cast<int>(fId / 3);
+    }
+
+    for (size_t fId = 0; fId < numberFaces; fId++) {
+        if (level.faceMap[fId] < 0) {
+            level.faceMap[fId] = clusterFace[vertexCluster[faces[fId*3]]];
+        }
+    }
+}
+
+}
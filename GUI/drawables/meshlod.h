@@ -0,0 +1,42 @@
+#ifndef MESHLOD_H
+#define MESHLOD_H
+
+#include <vector>
+#include <memory>
+
+#include <cg3/utilities/color.h>
+
+/* Level of detail of a mesh, obtained by vertex clustering */
+
+struct MeshLODLevel {
+    double cellSize;
+    std::vector<float> vertices;
+    std::vector<unsigned int> faces;
+    std::vector<float> faceNormals;
+    std::vector<int> faceMap;
+};
+
+/* Hierarchy of levels of detail, from the finest to the coarsest */
+
+struct MeshLOD {
+    unsigned long long int geometryVersion;
+    std::vector<MeshLODLevel> levels;
+};
+
+std::shared_ptr<MeshLOD> buildMeshLOD(
+        const std::vector<float>& vertices,
+        const std::vector<unsigned int>& faces,
+        const unsigned int minFaces,
+        const unsigned long long int geometryVersion);
+
+void computeLODFaceColors(
+        const MeshLODLevel& level,
+        const std::vector<cg3::Color>& faceColors,
+        std::vector<cg3::Color>& levelFaceColors);
+
+unsigned int selectLODLevel(
+        const MeshLOD& lod,
+        const double pixelsPerUnit,
+        const double maxPixelError);
+
+#endif // MESHLOD_H
@@ -0,0 +1,640 @@
+#include "shareddrawablemesh.h"
+
+#ifdef __APPLE__
+#include <gl.h>
+#else
+#include <GL/gl.h>
+#endif
+
+#include <chrono>
+
+#define LOD_MIN_FACES 500000
+#define LOD_MIN_LEVEL_FACES 20000
+#define LOD_MAX_PIXEL_ERROR 1.5
+
+//Mesh color definition
+const cg3::Color defaultColor(128,128,128);
+
+//Called when the camera moves
+std::function<void()> SharedDrawableMesh::motionCallback;
+
+
+/* ----- CONSTRUCTORS/DESTRUCTOR ------ */
+
+/**
+ * @brief Default constructor, no mesh is shared
+ */
+SharedDrawableMesh::SharedDrawableMesh() :
+    sharedMesh(nullptr),
+    flatShading(false),
+    viewRotation(Eigen::Matrix3d::Identity()),
+    currentGeometryVersion(0),
+    currentColorVersion(0),
+    displayList(0),
+    compiledGeometryVersion(0),
+    compiledColorVersion(0),
+    compiledNumberFaces(0)
+{
+    lastModelview.fill(0);
+}
+
+/**
+ * @brief Constructor which shares the geometry of a mesh. The mesh is not copied:
+ * it must outlive the drawable or be detached with clear().
+ * @param[in] mesh Shared mesh
+ */
+SharedDrawableMesh::SharedDrawableMesh(const cg3::EigenMesh& mesh) :
+    SharedDrawableMesh()
+{
+    setMesh(mesh);
+}
+
+/**
+ * @brief Copy constructor. The display lists are not shared, they will be
+ * compiled again at the next draw. The levels of detail are shared.
+ * @param[in] other Drawable to be copied
+ */
+SharedDrawableMesh::SharedDrawableMesh(const SharedDrawableMesh& other) :
+    cg3::DrawableObject(other),
+    sharedMesh(other.sharedMesh),
+    faceColors(other.faceColors),
+    flatShading(other.flatShading),
+    viewRotation(other.viewRotation),
+    currentGeometryVersion(other.currentGeometryVersion + 1),
+    currentColorVersion(other.currentColorVersion),
+    displayList(0),
+    compiledGeometryVersion(0),
+    compiledColorVersion(0),
+    compiledNumberFaces(0),
+    lod(other.lod),
+    lastModelview(other.lastModelview)
+{
+}
+
+/**
+ * @brief Move constructor, the display lists are moved
+ * @param[in] other Drawable to be moved
+ */
+SharedDrawableMesh::SharedDrawableMesh(SharedDrawableMesh&& other) :
+    cg3::DrawableObject(other),
+    sharedMesh(other.sharedMesh),
+    faceColors(std::move(other.faceColors)),
+    flatShading(other.flatShading),
+    viewRotation(other.viewRotation),
+    currentGeometryVersion(other.currentGeometryVersion),
+    currentColorVersion(other.currentColorVersion),
+    displayList(other.displayList),
+    compiledGeometryVersion(other.compiledGeometryVersion),
+    compiledColorVersion(other.compiledColorVersion),
+    compiledNumberFaces(other.compiledNumberFaces),
+    lod(std::move(other.lod)),
+    lodFuture(std::move(other.lodFuture)),
+    levelDisplayLists(std::move(other.levelDisplayLists)),
+    levelCompiledColorVersions(std::move(other.levelCompiledColorVersions)),
+    lastModelview(other.lastModelview)
+{
+    other.sharedMesh = nullptr;
+    other.displayList = 0;
+    other.levelDisplayLists.clear();
+}
+
+/**
+ * @brief Destructor
+ */
+SharedDrawableMesh::~SharedDrawableMesh()
+{
+    releaseDisplayList();
+}
+
+/**
+ * @brief Copy assignment operator
+ * @param[in] other Drawable to be copied
+ * @returns This drawable
+ */
+SharedDrawableMesh& SharedDrawableMesh::operator=(const SharedDrawableMesh& other)
+{
+    if (this != &other) {
+        cg3::DrawableObject::operator=(other);
+        sharedMesh = other.sharedMesh;
+        faceColors = other.faceColors;
+        flatShading = other.flatShading;
+        viewRotation = other.viewRotation;
+        currentGeometryVersion++;
+        currentColorVersion++;
+        lod = other.lod;
+    }
+    return *this;
+}
+
+/**
+ * @brief Move assignment operator
+ * @param[in] other Drawable to be moved
+ * @returns This drawable
+ */
+SharedDrawableMesh& SharedDrawableMesh::operator=(SharedDrawableMesh&& other)
+{
+    if (this != &other) {
+        releaseDisplayList();
+
+        cg3::DrawableObject::operator=(other);
+        sharedMesh = other.sharedMesh;
+        faceColors = std::move(other.faceColors);
+        flatShading = other.flatShading;
+        viewRotation = other.viewRotation;
+        currentGeometryVersion = other.currentGeometryVersion;
+        currentColorVersion = other.currentColorVersion;
+        displayList = other.displayList;
+        compiledGeometryVersion = other.compiledGeometryVersion;
+        compiledColorVersion = other.compiledColorVersion;
+        compiledNumberFaces = other.compiledNumberFaces;
+        lod = std::move(other.lod);
+        lodFuture = std::move(other.lodFuture);
+        levelDisplayLists = std::move(other.levelDisplayLists);
+        levelCompiledColorVersions = std::move(other.levelCompiledColorVersions);
+        lastModelview = other.lastModelview;
+
+        other.sharedMesh = nullptr;
+        other.displayList = 0;
+        other.levelDisplayLists.clear();
+    }
+    return *this;
+}
+
+
+
+
+/* ----- SHARED GEOMETRY ------ */
+
+/**
+ * @brief Share the geometry of a mesh. The face colors are initialized
+ * with the ones of the mesh.
+ * @param[in] mesh Shared mesh
+ */
+void SharedDrawableMesh::setMesh(const cg3::EigenMesh& mesh)
+{
+    sharedMesh = &mesh;
+    viewRotation = Eigen::Matrix3d::Identity();
+    update();
+}
+
+/**
+ * @brief Get the shared mesh
+ * @returns Pointer to the shared mesh, nullptr if no mesh is shared
+ */
+const cg3::EigenMesh* SharedDrawableMesh::mesh() const
+{
+    return sharedMesh;
+}
+
+/**
+ * @brief Notify that the shared mesh has changed: the face colors are read
+ * again from the mesh and the geometry will be uploaded at the next draw.
+ */
+void SharedDrawableMesh::update()
+{
+    faceColors.resize(numberFaces());
+    for (unsigned int fId = 0; fId < faceColors.size(); fId++) {
+        faceColors[fId] = sharedMesh->faceColor(fId);
+    }
+
+    currentGeometryVersion++;
+    currentColorVersion++;
+}
+
+/**
+ * @brief Detach the shared mesh
+ */
+void SharedDrawableMesh::clear()
+{
+    sharedMesh = nullptr;
+    faceColors.clear();
+    viewRotation = Eigen::Matrix3d::Identity();
+
+    currentGeometryVersion++;
+    currentColorVersion++;
+}
+
+/**
+ * @brief Number of faces of the shared mesh
+ * @returns Number of faces
+ */
+unsigned int SharedDrawableMesh::numberFaces() const
+{
+    return sharedMesh == nullptr ? 0 : sharedMesh->numberFaces();
+}
+
+/**
+ * @brief Version of the geometry, incremented at each change
+ * @returns Geometry version
+ */
+unsigned long long int SharedDrawableMesh::geometryVersion() const
+{
+    return currentGeometryVersion;
+}
+
+/**
+ * @brief Version of the colors, incremented at each change
+ * @returns Color version
+ */
+unsigned long long int SharedDrawableMesh::colorVersion() const
+{
+    return currentColorVersion;
+}
+
+
+
+
+/* ----- VISUALIZATION ------ */
+
+/**
+ * @brief Set the color of all the faces
+ * @param[in] color Color
+ */
+void SharedDrawableMesh::setFaceColor(const cg3::Color& color)
+{
+    faceColors.assign(numberFaces(), color);
+    currentColorVersion++;
+}
+
+/**
+ * @brief Set the color of a face
+ * @param[in] color Color
+ * @param[in] faceId Face id
+ */
+void SharedDrawableMesh::setFaceColor(const cg3::Color& color, const unsigned int faceId)
+{
+    if (faceColors.size() != numberFaces())
+        faceColors.resize(numberFaces(), defaultColor);
+
+    faceColors[faceId] = color;
+    currentColorVersion++;
+}
+
+/**
+ * @brief Get the color of a face
+ * @param[in] faceId Face id
+ * @returns Color of the face
+ */
+const cg3::Color& SharedDrawableMesh::faceColor(const unsigned int faceId) const
+{
+    return faceColors[faceId];
+}
+
+/**
+ * @brief Use the face normals for shading
+ */
+void SharedDrawableMesh::setFlatShading()
+{
+    if (!flatShading) {
+        flatShading = true;
+        currentColorVersion++;
+    }
+}
+
+/**
+ * @brief Use the vertex normals for shading
+ */
+void SharedDrawableMesh::setSmoothShading()
+{
+    if (flatShading) {
+        flatShading = false;
+        currentColorVersion++;
+    }
+}
+
+/**
+ * @brief Rotate the drawable for visualization: the shared mesh is not modified
+ * @param[in] rotationMatrix Rotation matrix
+ */
+void SharedDrawableMesh::rotate(const Eigen::Matrix3d& rotationMatrix)
+{
+    viewRotation = rotationMatrix * viewRotation;
+}
+
+/**
+ * @brief Save the shared mesh with the face colors of the drawable
+ * @param[in] filename Output filename
+ * @returns True if the mesh has been saved
+ */
+bool SharedDrawableMesh::saveOnObj(const std::string& filename) const
+{
+    if (sharedMesh == nullptr)
+        return false;
+
+    cg3::EigenMesh coloredMesh = *sharedMesh;
+    coloredMesh.rotate(viewRotation);
+    for (unsigned int fId = 0; fId < faceColors.size(); fId++) {
+        coloredMesh.setFaceColor(faceColors[fId], fId);
+    }
+
+    return coloredMesh.saveOnObj(filename);
+}
+
+/**
+ * @brief Set the function called when a drawable detects a camera motion,
+ * which is expected to redraw the scene when the camera is still again:
+ * the full resolution meshes are drawn only when the camera does not move.
+ * @param[in] callback Callback function
+ */
+void SharedDrawableMesh::setMotionCallback(const std::function<void()>& callback)
+{
+    motionCallback = callback;
+}
+
+
+
+
+/* ----- DRAWABLE OBJECT INTERFACE ------ */
+
+/**
+ * @brief Draw the shared mesh. The display list is compiled again only if the
+ * geometry or the colors have changed since the last draw. During camera motion,
+ * large meshes are drawn with the coarsest level of detail whose error on the
+ * screen is not visible.
+ */
+void SharedDrawableMesh::draw() const
+{
+    if (sharedMesh == nullptr || !isVisible())
+        return;
+
+    const unsigned int level = selectLevel();
+
+    if (level > 0) {
+        compileLevel(level);
+    }
+    else if (displayList == 0 ||
+            compiledGeometryVersion != currentGeometryVersion ||
+            compiledColorVersion != currentColorVersion ||
+            compiledNumberFaces != sharedMesh->numberFaces())
+    {
+        compile();
+    }
+
+    const bool isRotated = !viewRotation.isIdentity();
+
+    if (isRotated) {
+        GLdouble matrix[16] = {
+            viewRotation(0,0), viewRotation(1,0), viewRotation(2,0), 0,
+            viewRotation(0,1), viewRotation(1,1), viewRotation(2,1), 0,
+            viewRotation(0,2), viewRotation(1,2), viewRotation(2,2), 0,
+            0, 0, 0, 1
+        };
+
+        glPushMatrix();
+        glMultMatrixd(matrix);
+    }
+
+    glCallList(level > 0 ? levelDisplayLists[level-1] : displayList);
+
+    if (isRotated) {
+        glPopMatrix();
+    }
+}
+
+/**
+ * @brief Center of the shared mesh
+ * @returns Scene center
+ */
+cg3::Point3d SharedDrawableMesh::sceneCenter() const
+{
+    if (sharedMesh == nullptr)
+        return cg3::Point3d(0,0,0);
+
+    const cg3::Point3d center = sharedMesh->boundingBox().center();
+    const Eigen::Vector3d rotatedCenter = viewRotation * Eigen::Vector3d(center.x(), center.y(), center.z());
+    return cg3::Point3d(rotatedCenter.x(), rotatedCenter.y(), rotatedCenter.z());
+}
+
+/**
+ * @brief Radius of the shared mesh
+ * @returns Scene radius
+ */
+double SharedDrawableMesh::sceneRadius() const
+{
+    if (sharedMesh == nullptr)
+        return -1;
+
+    return sharedMesh->boundingBox().diag() / 2;
+}
+
+
+
+
+/* ----- PRIVATE METHODS ------ */
+
+/**
+ * @brief Compile the display list from the shared mesh and the face colors
+ */
+void SharedDrawableMesh::compile() const
+{
+    if (displayList == 0) {
+        displayList = glGenLists(1);
+    }
+
+    const cg3::EigenMesh& mesh = *sharedMesh;
+    const unsigned int nFaces = mesh.numberFaces();
+    const bool hasColors = faceColors.size() == nFaces;
+
+    glNewList(displayList, GL_COMPILE);
+
+    glEnable(GL_LIGHTING);
+    glEnable(GL_COLOR_MATERIAL);
+    glColorMaterial(GL_FRONT_AND_BACK, GL_AMBIENT_AND_DIFFUSE);
+
+    glBegin(GL_TRIANGLES);
+    for (unsigned int fId = 0; fId < nFaces; fId++) {
+        const cg3::Point3i face = mesh.face(fId);
+        const cg3::Color& color = hasColors ? faceColors[fId] : defaultColor;
+
+        glColor3f(color.redF(), color.greenF(), color.blueF());
+
+        if (flatShading) {
+            const cg3::Vec3d normal = mesh.faceNormal(fId);
+            glNormal3d(normal.x(), normal.y(), normal.z());
+        }
+
+        for (unsigned int k = 0; k < 3; k++) {
+            const unsigned int vId = face[k];
+            if (!flatShading) {
+                const cg3::Vec3d normal = mesh.vertexNormal(vId);
+                glNormal3d(normal.x(), normal.y(), normal.z());
+            }
+
+            const cg3::Point3d& vertex = mesh.vertex(vId);
+            glVertex3d(vertex.x(), vertex.y(), vertex.z());
+        }
+    }
+    glEnd();
+
+    glEndList();
+
+    compiledGeometryVersion = currentGeometryVersion;
+    compiledColorVersion = currentColorVersion;
+    compiledNumberFaces = nFaces;
+}
+
+/**
+ * @brief Compile the display list of a level of detail, with the colors of
+ * the majority of the collapsed faces
+ * @param[in] level Index of the level plus one
+ */
+void SharedDrawableMesh::compileLevel(const unsigned int level) const
+{
+    //Levels shared by a copy of the drawable
+    if (levelDisplayLists.size() != lod->levels.size()) {
+        for (unsigned int& list : levelDisplayLists) {
+            if (list != 0)
+                glDeleteLists(list, 1);
+        }
+        levelDisplayLists.assign(lod->levels.size(), 0);
+        levelCompiledColorVersions.assign(lod->levels.size(), 0);
+    }
+
+    if (levelDisplayLists[level-1] != 0 && levelCompiledColorVersions[level-1] == currentColorVersion)
+        return;
+
+    if (levelDisplayLists[level-1] == 0) {
+        levelDisplayLists[level-1] = glGenLists(1);
+    }
+
+    const MeshLODLevel& lodLevel = lod->levels[level-1];
+
+    std::vector<cg3::Color> levelFaceColors;
+    computeLODFaceColors(lodLevel, faceColors, levelFaceColors);
+
+    glNewList(levelDisplayLists[level-1], GL_COMPILE);
+
+    glEnable(GL_LIGHTING);
+    glEnable(GL_COLOR_MATERIAL);
+    glColorMaterial(GL_FRONT_AND_BACK, GL_AMBIENT_AND_DIFFUSE);
+
+    glBegin(GL_TRIANGLES);
+    for (size_t fId = 0; fId < levelFaceColors.size(); fId++) {
+        const cg3::Color& color = levelFaceColors[fId];
+        glColor3f(color.redF(), color.greenF(), color.blueF());
+        glNormal3fv(&lodLevel.faceNormals[fId*3]);
+
+        for (unsigned int k = 0; k < 3; k++) {
+            glVertex3fv(&lodLevel.vertices[lodLevel.faces[fId*3+k]*3]);
+        }
+    }
+    glEnd();
+
+    glEndList();
+
+    levelCompiledColorVersions[level-1] = currentColorVersion;
+}
+
+/**
+ * @brief Collect the levels of detail built in background and start a new
+ * build if they do not match the current geometry. The geometry is copied
+ * in single precision for the background thread, which never reads the shared mesh.
+ */
+void SharedDrawableMesh::updateLOD() const
+{
+    //Levels of detail ready
+    if (lodFuture.valid() && lodFuture.wait_for(std::chrono::seconds(0)) == std::future_status::ready) {
+        for (unsigned int& list : levelDisplayLists) {
+            if (list != 0)
+                glDeleteLists(list, 1);
+        }
+
+        lod = lodFuture.get();
+        levelDisplayLists.assign(lod->levels.size(), 0);
+        levelCompiledColorVersions.assign(lod->levels.size(), 0);
+    }
+
+    if (lodFuture.valid() || (lod != nullptr && lod->geometryVersion == currentGeometryVersion))
+        return;
+
+    const cg3::EigenMesh& mesh = *sharedMesh;
+
+    std::vector<float> vertices(mesh.numberVertices() * 3);
+    for (unsigned int vId = 0; vId < mesh.numberVertices(); vId++) {
+        const cg3::Point3d& vertex = mesh.vertex(vId);
+        vertices[vId*3] = static_cast<float>(vertex.x());
+        vertices[vId*3+1] = static_cast<float>(vertex.y());
+        vertices[vId*3+2] = static_cast<float>(vertex.z());
+    }
+
+    std::vector<unsigned int> faces(mesh.numberFaces() * 3);
+    for (unsigned int fId = 0; fId < mesh.numberFaces(); fId++) {
+        const cg3::Point3i face = mesh.face(fId);
+        faces[fId*3] = static_cast<unsigned int>(face.x());
+        faces[fId*3+1] = static_cast<unsigned int>(face.y());
+        faces[fId*3+2] = static_cast<unsigned int>(face.z());
+    }
+
+    const unsigned long long int version = currentGeometryVersion;
+
+    lodFuture = std::async(std::launch::async, [vertices, faces, version]() {
+        return buildMeshLOD(vertices, faces, LOD_MIN_LEVEL_FACES, version);
+    });
+}
+
+/**
+ * @brief Select the level of detail to be drawn. The full resolution is used
+ * for small meshes, when the camera is still or when the levels are not ready.
+ * @returns Index of the level plus one, 0 for the full resolution
+ */
+unsigned int SharedDrawableMesh::selectLevel() const
+{
+    if (sharedMesh->numberFaces() < LOD_MIN_FACES)
+        return 0;
+
+    updateLOD();
+
+    //Camera motion
+    std::array<double, 16> modelview;
+    glGetDoublev(GL_MODELVIEW_MATRIX, modelview.data());
+
+    const bool isMoving = modelview != lastModelview;
+    lastModelview = modelview;
+
+    if (!isMoving)
+        return 0;
+
+    if (motionCallback)
+        motionCallback();
+
+    if (lod == nullptr || lod->geometryVersion != currentGeometryVersion || lod->levels.empty() || faceColors.size() != sharedMesh->numberFaces())
+        return 0;
+
+    //Pixels covered by a unit length at the center of the mesh
+    GLdouble projection[16];
+    GLint viewport[4];
+    glGetDoublev(GL_PROJECTION_MATRIX, projection);
+    glGetIntegerv(GL_VIEWPORT, viewport);
+
+    double pixelsPerUnit = projection[5] * viewport[3] / 2;
+
+    //Perspective projection
+    if (projection[15] == 0) {
+        const cg3::Point3d center = sceneCenter();
+        const double depth = -(modelview[2] * center.x() + modelview[6] * center.y() + modelview[10] * center.z() + modelview[14]);
+        if (depth <= 0)
+            return 0;
+
+        pixelsPerUnit /= depth;
+    }
+
+    return selectLODLevel(*lod, pixelsPerUnit, LOD_MAX_PIXEL_ERROR);
+}
+
+/**
+ * @brief Release the display lists
+ */
+void SharedDrawableMesh::releaseDisplayList() const
+{
+    if (displayList != 0) {
+        glDeleteLists(displayList, 1);
+        displayList = 0;
+    }
+
+    for (unsigned int& list : levelDisplayLists) {
+        if (list != 0) {
+            glDeleteLists(list, 1);
+            list = 0;
+        }
+    }
+}
@@ -0,0 +1,103 @@
+#ifndef SHAREDDRAWABLEMESH_H
+#define SHAREDDRAWABLEMESH_H
+
+#include <vector>
+#include <string>
+#include <array>
+#include <memory>
+#include <future>
+#include <functional>
+
+#include <cg3/viewer/interfaces/drawable_object.h>
+
+#include <cg3/meshes/eigenmesh/eigenmesh.h>
+#include <cg3/utilities/color.h>
+
+#include "meshlod.h"
+
+/* Drawable which shares the geometry of a mesh it does not own */
+
+class SharedDrawableMesh : public cg3::DrawableObject
+{
+
+public:
+
+    /* Constructors/Destructor */
+
+    SharedDrawableMesh();
+    explicit SharedDrawableMesh(const cg3::EigenMesh& mesh);
+    SharedDrawableMesh(const SharedDrawableMesh& other);
+    SharedDrawableMesh(SharedDrawableMesh&& other);
+    ~SharedDrawableMesh();
+
+    SharedDrawableMesh& operator=(const SharedDrawableMesh& other);
+    SharedDrawableMesh& operator=(SharedDrawableMesh&& other);
+
+
+    /* Shared geometry */
+
+    void setMesh(const cg3::EigenMesh& mesh);
+    const cg3::EigenMesh* mesh() const;
+    void update();
+    void clear();
+
+    unsigned int numberFaces() const;
+    unsigned long long int geometryVersion() const;
+    unsigned long long int colorVersion() const;
+
+
+    /* Visualization */
+
+    void setFaceColor(const cg3::Color& color);
+    void setFaceColor(const cg3::Color& color, const unsigned int faceId);
+    const cg3::Color& faceColor(const unsigned int faceId) const;
+
+    void setFlatShading();
+    void setSmoothShading();
+
+    void rotate(const Eigen::Matrix3d& rotationMatrix);
+
+    bool saveOnObj(const std::string& filename) const;
+
+    static void setMotionCallback(const std::function<void()>& callback);
+
+
+    /* DrawableObject interface */
+
+    void draw() const;
+    cg3::Point3d sceneCenter() const;
+    double sceneRadius() const;
+
+
+private:
+
+    void compile() const;
+    void compileLevel(const unsigned int level) const;
+    void updateLOD() const;
+    unsigned int selectLevel() const;
+    void releaseDisplayList() const;
+
+    const cg3::EigenMesh* sharedMesh;
+
+    std::vector<cg3::Color> faceColors;
+    bool flatShading;
+    Eigen::Matrix3d viewRotation;
+
+    unsigned long long int currentGeometryVersion;
+    unsigned long long int currentColorVersion;
+
+    mutable unsigned int displayList;
+    mutable unsigned long long int compiledGeometryVersion;
+    mutable unsigned long long int compiledColorVersion;
+    mutable unsigned int compiledNumberFaces;
+
+    mutable std::shared_ptr<MeshLOD> lod;
+    mutable std::future<std::shared_ptr<MeshLOD>> lodFuture;
+    mutable std::vector<unsigned int> levelDisplayLists;
+    mutable std::vector<unsigned long long int> levelCompiledColorVersions;
+    mutable std::array<double, 16> lastModelview;
+
+    static std::function<void()> motionCallback;
+};
+
+#endif // SHAREDDRAWABLEMESH_H
@@ -25,6 +25,7 @@ const cg3::Color defaultColor(128,128,128);
 const cg3::Color minColor(200,60,60);
 const cg3::Color maxColor(60,60,200);
 const cg3::Color nonVisibleColor(20,20,20);
+const cg3::Color occluderColor(230,150,30);
 const int scatterColorSat(static_cast<int>(255 * 0.45));
 const int scatterColorVal(static_cast<int>(255 * 0.9));
 const int scatterColorMaxHue(240);
@@ -51,6 +52,7 @@ FAFManager::FAFManager(QWidget *parent) :
  * @brief Destructor
  */
 FAFManager::~FAFManager(){
+    SharedDrawableMesh::setMotionCallback(nullptr);
     delete ui;
 }
 
@@ -73,6 +75,12 @@ void FAFManager::initialize() {
             this, SLOT(facePicked(const cg3::PickableObject*, unsigned int)));
     mainWindow.canvas.setMouseBinding(Qt::ControlModifier, Qt::LeftButton, cg3::viewer::GLCanvas::SELECT);
 
+    //Large meshes are drawn at full resolution when the camera is still
+    lodRefreshTimer.setSingleShot(true);
+    lodRefreshTimer.setInterval(300);
+    QObject::connect(&lodRefreshTimer, SIGNAL(timeout()), &mainWindow.canvas, SLOT(update()));
+    SharedDrawableMesh::setMotionCallback([this]() { lodRefreshTimer.start(); });
+
     clearData();
 
     updateUI();
@@ -437,7 +445,8 @@ void FAFManager::checkVisibility() {
                     heightfieldAngle,
                     includeXDirections,
                     data,
-                    checkMode);
+                    checkMode,
+                    true);
 
         t.stopAndPrint();
 
@@ -469,6 +478,10 @@ void FAFManager::getAssociation() {
                     detailMultiplier,
                     compactness,
                     fixExtremes,
+                    false,
+                    0,
+                    false,
+                    0,
                     data);
 
         t.stopAndPrint();
@@ -674,7 +687,7 @@ void FAFManager::extractResults() {
  */
 void FAFManager::addDrawableMesh() {
     //Add drawable meshes to the canvas
-    drawableOriginalMesh = cg3::DrawableEigenMesh(data.mesh);
+    drawableOriginalMesh.setMesh(data.mesh);
     drawableOriginalMesh.setFlatShading();
 
     mainWindow.pushDrawableObject(&drawableOriginalMesh, "Mesh", true);
@@ -684,7 +697,7 @@ void FAFManager::addDrawableMesh() {
  * @brief Add drawable stock
  */
 void FAFManager::addDrawableStock() {
-    drawableStock = cg3::DrawableEigenMesh(data.stock);
+    drawableStock.setMesh(data.stock);
     drawableStock.setFlatShading();
 
     mainWindow.pushDrawableObject(&drawableStock, "Stock");
@@ -710,7 +723,7 @@ void FAFManager::addDrawableDetailMesh() {
  * @brief Add drawable smoothed mesh
  */
 void FAFManager::addDrawableSmoothedMesh() {
-    drawableSmoothedMesh = cg3::DrawableEigenMesh(data.smoothedMesh);
+    drawableSmoothedMesh.setMesh(data.smoothedMesh);
     drawableSmoothedMesh.setFlatShading();
 
     mainWindow.pushDrawableObject(&drawableSmoothedMesh, "Smoothed mesh");
@@ -728,7 +741,7 @@ void FAFManager::addDrawableRestoredMesh() {
     mainWindow.setDrawableObjectVisibility(&drawableSmoothedMesh, false);
 
     //Create drawable meshes
-    drawableRestoredMesh = cg3::DrawableEigenMesh(data.restoredMesh);
+    drawableRestoredMesh.setMesh(data.restoredMesh);
     drawableRestoredMesh.setFlatShading();
 
     //Push in the canvas
@@ -744,17 +757,17 @@ void FAFManager::addDrawableCutComponents() {
     mainWindow.setDrawableObjectVisibility(&drawableRestoredMesh, false);
 
     //Create drawable meshes and push in the canvas
-    drawableFourAxisComponent = cg3::DrawableEigenMesh(data.fourAxisComponent);
+    drawableFourAxisComponent.setMesh(data.fourAxisComponent);
     drawableFourAxisComponent.setFlatShading();
     mainWindow.pushDrawableObject(&drawableFourAxisComponent, "4-axis component");
 
     if (data.minComponent.numberFaces() > 0) {
-        drawableMinComponent = cg3::DrawableEigenMesh(data.minComponent);
+        drawableMinComponent.setMesh(data.minComponent);
         drawableMinComponent.setFlatShading();
         mainWindow.pushDrawableObject(&drawableMinComponent, "Min component");
     }
     if (data.maxComponent.numberFaces() > 0) {
-        drawableMaxComponent = cg3::DrawableEigenMesh(data.maxComponent);
+        drawableMaxComponent.setMesh(data.maxComponent);
         drawableMaxComponent.setFlatShading();
         mainWindow.pushDrawableObject(&drawableMaxComponent, "Max component");
     }
@@ -773,7 +786,7 @@ void FAFManager::addDrawableResults() {
     drawableBoxes.clear();
     drawableBoxes.resize(data.boxes.size());
     for (size_t i = 0; i < data.boxes.size(); i++) {
-        drawableBoxes[i] = cg3::DrawableEigenMesh(data.boxes[i]);
+        drawableBoxes[i].setMesh(data.boxes[i]);
         drawableBoxes[i].setFlatShading();
 
         mainWindow.pushDrawableObject(&drawableBoxes[i], "Box " + std::to_string(i), false);
@@ -783,7 +796,7 @@ void FAFManager::addDrawableResults() {
     drawableStocks.clear();
     drawableStocks.resize(data.stocks.size());
     for (size_t i = 0; i < data.stocks.size(); i++) {
-        drawableStocks[i] = cg3::DrawableEigenMesh(data.stocks[i]);
+        drawableStocks[i].setMesh(data.stocks[i]);
         drawableStocks[i].setFlatShading();
 
         mainWindow.pushDrawableObject(&drawableStocks[i], "Stock " + std::to_string(i), false);
@@ -793,28 +806,28 @@ void FAFManager::addDrawableResults() {
     drawableResults.clear();
     drawableResults.resize(data.results.size());
     for (size_t i = 0; i < data.results.size(); i++) {
-        drawableResults[i] = cg3::DrawableEigenMesh(data.results[i]);
+        drawableResults[i].setMesh(data.results[i]);
         drawableResults[i].setFlatShading();
 
         mainWindow.pushDrawableObject(&drawableResults[i], "Result " + std::to_string(i), (i == 0 ? true : false));
     }
 
     if (data.minResult.numberFaces() > 0) {
-        drawableMinResult = cg3::DrawableEigenMesh(data.minResult);
+        drawableMinResult.setMesh(data.minResult);
         drawableMinResult.setFlatShading();
         mainWindow.pushDrawableObject(&drawableMinResult, "Min result", false);
     }
     if (data.maxResult.numberFaces() > 0) {
-        drawableMaxResult = cg3::DrawableEigenMesh(data.maxResult);
+        drawableMaxResult.setMesh(data.maxResult);
         drawableMaxResult.setFlatShading();
         mainWindow.pushDrawableObject(&drawableMaxResult, "Max result", false);
     }
 
     //Draw supports
-    drawableMinSupport = cg3::DrawableEigenMesh(data.minSupport);
+    drawableMinSupport.setMesh(data.minSupport);
     drawableMinSupport.setFlatShading();
     mainWindow.pushDrawableObject(&drawableMinSupport, "Min support", false);
-    drawableMaxSupport = cg3::DrawableEigenMesh(data.maxSupport);
+    drawableMaxSupport.setMesh(data.maxSupport);
     drawableMaxSupport.setFlatShading();
     mainWindow.pushDrawableObject(&drawableMaxSupport, "Max support", false);
 }
@@ -823,39 +836,24 @@ void FAFManager::addDrawableResults() {
  * @brief Update drawable meshes
  */
 void FAFManager::updateDrawableMesh() {
-    //Update drawable meshes (already in the canvas)
-    bool meshOriginalVisibility = drawableOriginalMesh.isVisible();
-
-    drawableOriginalMesh = cg3::DrawableEigenMesh(data.mesh);
-    drawableOriginalMesh.setFlatShading();
-
-    mainWindow.setDrawableObjectVisibility(&drawableOriginalMesh, meshOriginalVisibility);
+    //Update drawable meshes (already in the canvas): the geometry is shared
+    drawableOriginalMesh.update();
 }
 
 /**
  * @brief Update smoothed meshes
  */
 void FAFManager::updateDrawableSmoothedMesh() {
-    //Update drawable meshes (already in the canvas)
-    bool smoothVisibility = drawableSmoothedMesh.isVisible();
-
-    drawableSmoothedMesh = cg3::DrawableEigenMesh(data.smoothedMesh);
-    drawableSmoothedMesh.setFlatShading();
-
-    mainWindow.setDrawableObjectVisibility(&drawableSmoothedMesh, smoothVisibility);
+    //Update drawable meshes (already in the canvas): the geometry is shared
+    drawableSmoothedMesh.update();
 }
 
 /**
  * @brief Update drawable meshes
  */
 void FAFManager::updateDrawableRestoredMesh() {
-    //Update drawable meshes (already in the canvas)
-    bool restoredVisibility = drawableRestoredMesh.isVisible();
-
-    drawableRestoredMesh = cg3::DrawableEigenMesh(data.restoredMesh);
-    drawableRestoredMesh.setFlatShading();
-
-    mainWindow.setDrawableObjectVisibility(&drawableRestoredMesh, restoredVisibility);
+    //Update drawable meshes (already in the canvas): the geometry is shared
+    drawableRestoredMesh.update();
 }
 
 /**
@@ -904,20 +902,20 @@ void FAFManager::deleteDrawableObjects() {
 
     if (data.areResultsExtracted) {
         //Delete boxes
-        for (cg3::DrawableEigenMesh& box : drawableBoxes) {
+        for (SharedDrawableMesh& box : drawableBoxes) {
             mainWindow.deleteDrawableObject(&box);
         }
         drawableBoxes.clear();
 
         //Delete stocks
-        for (cg3::DrawableEigenMesh& st : drawableStocks) {
+        for (SharedDrawableMesh& st : drawableStocks) {
             mainWindow.deleteDrawableObject(&st);
         }
         drawableStocks.clear();
 
         //Delete results
 
-        for (cg3::DrawableEigenMesh& res : drawableResults) {
+        for (SharedDrawableMesh& res : drawableResults) {
             mainWindow.deleteDrawableObject(&res);
         }
         drawableResults.clear();
@@ -1175,10 +1173,23 @@ void FAFManager::colorizeVisibility() {
             }
         }
 
+        //Color the faces which occlude the others from that direction
+        size_t nOccluded = 0;
+        if (static_cast<size_t>(chosenDirectionIndex) < data.occluders.size()) {
+            const FourAxisFabrication::OccluderList& occluders = data.occluders[chosenDirectionIndex];
+            for (const std::pair<unsigned int, unsigned int>& occluder : occluders) {
+                drawableSmoothedMesh.setFaceColor(occluderColor, occluder.second);
+            }
+            nOccluded = occluders.size();
+        }
+
         std::stringstream ss;
 
         //Description
         ss << "Direction " << data.directions[chosenDirectionIndex];
+        if (!data.occluders.empty()) {
+            ss << " - Occluded faces: " << nOccluded;
+        }
 
         //Update description label
         std::string description = ss.str();
@@ -1243,7 +1254,7 @@ void FAFManager::colorizeAssociation() {
  * @param targetDirections Target directions
  */
 void FAFManager::colorizeAssociation(
-        cg3::DrawableEigenMesh& drawableMesh,
+        SharedDrawableMesh& drawableMesh,
         const std::vector<int>& association,
         const std::vector<unsigned int>& targetDirections,
         const std::vector<unsigned int>& nonVisibleFaces)
@@ -1849,6 +1860,9 @@ void FAFManager::on_centerOnOriginButton_clicked() {
         //Translation of the mesh
         data.mesh.translate(-data.mesh.boundingBox().center());
 
+        //Upload the shared geometry
+        updateDrawableMesh();
+
         //Update canvas and fit the scene
         mainWindow.canvas.update();
         mainWindow.canvas.fitScene();
@@ -1860,6 +1874,9 @@ void FAFManager::on_plusXButton_clicked() {
         //Translation of the mesh
         data.mesh.translate(cg3::Point3d(ui->stepSpinBox->value(), 0, 0));
 
+        //Upload the shared geometry
+        updateDrawableMesh();
+
         //Update canvas and fit the scene
         mainWindow.canvas.update();
         mainWindow.canvas.fitScene();
@@ -1871,6 +1888,9 @@ void FAFManager::on_minusXButton_clicked() {
         //Translation of the mesh
         data.mesh.translate(cg3::Point3d(-ui->stepSpinBox->value(), 0, 0));
 
+        //Upload the shared geometry
+        updateDrawableMesh();
+
         //Update canvas and fit the scene
         mainWindow.canvas.update();
         mainWindow.canvas.fitScene();
@@ -1882,6 +1902,9 @@ void FAFManager::on_plusYButton_clicked() {
         //Translation of the mesh
         data.mesh.translate(cg3::Point3d(0, ui->stepSpinBox->value(), 0));
 
+        //Upload the shared geometry
+        updateDrawableMesh();
+
         //Update canvas and fit the scene
         mainWindow.canvas.update();
         mainWindow.canvas.fitScene();
@@ -1893,6 +1916,9 @@ void FAFManager::on_minusYButton_clicked() {
         //Translation of the mesh
         data.mesh.translate(cg3::Point3d(0, -ui->stepSpinBox->value(), 0));
 
+        //Upload the shared geometry
+        updateDrawableMesh();
+
         //Update canvas and fit the scene
         mainWindow.canvas.update();
         mainWindow.canvas.fitScene();
@@ -1904,6 +1930,9 @@ void FAFManager::on_plusZButton_clicked() {
         //Translation of the mesh
         data.mesh.translate(cg3::Point3d(0, 0, ui->stepSpinBox->value()));
 
+        //Upload the shared geometry
+        updateDrawableMesh();
+
         //Update canvas and fit the scene
         mainWindow.canvas.update();
         mainWindow.canvas.fitScene();
@@ -1915,6 +1944,9 @@ void FAFManager::on_minusZButton_clicked() {
         //Translation of the mesh
         data.mesh.translate(cg3::Point3d(0, 0, -ui->stepSpinBox->value()));
 
+        //Upload the shared geometry
+        updateDrawableMesh();
+
         //Update canvas and fit the scene
         mainWindow.canvas.update();
         mainWindow.canvas.fitScene();
@@ -1932,6 +1964,9 @@ void FAFManager::on_rotateButton_clicked() {
 
         data.mesh.rotate(m);
 
+        //Upload the shared geometry
+        updateDrawableMesh();
+
         //Update canvas and fit the scene
         mainWindow.canvas.update();
         mainWindow.canvas.fitScene();
@@ -1945,6 +1980,9 @@ void FAFManager::on_scaleButton_clicked() {
 
         data.mesh.scale(scaleFactor);
 
+        //Upload the shared geometry
+        updateDrawableMesh();
+
         //Update canvas and fit the scene
         mainWindow.canvas.update();
         mainWindow.canvas.fitScene();
@@ -1958,6 +1996,9 @@ void FAFManager::on_inverseScaleButton_clicked() {
 
         data.mesh.scale(scaleFactor);
 
+        //Upload the shared geometry
+        updateDrawableMesh();
+
         //Update canvas and fit the scene
         mainWindow.canvas.update();
         mainWindow.canvas.fitScene();
@@ -2047,7 +2088,7 @@ void FAFManager::on_visualizationSlider_valueChanged(int value) {
                 setCameraDirection(-currentDirection);
             }
 
-            for (cg3::DrawableEigenMesh& res : drawableResults) {
+            for (SharedDrawableMesh& res : drawableResults) {
                 mainWindow.setDrawableObjectVisibility(&res, false);
             }
             mainWindow.setDrawableObjectVisibility(&drawableResults[sliderValue], true);
@@ -23,9 +23,12 @@
 #include <QStatusBar>
 #include <QDebug>
 #include <QFrame>
+#include <QTimer>
 
 #include "../methods/fouraxisfabrication.h"
 
+#include "../drawables/shareddrawablemesh.h"
+
 namespace Ui {
 class FAFManager;
 }
@@ -49,31 +52,33 @@ private:
     FourAxisFabrication::Data data;
 
 
-    /* Drawable objects */
+    /* Drawable objects (sharing the geometry of the data meshes) */
 
-    cg3::DrawableEigenMesh drawableOriginalMesh;
+    SharedDrawableMesh drawableOriginalMesh;
 
     cg3::PickableEigenMesh drawableDetailMesh;
 //    cg3::libigl::HeatGeodesicsData detailMeshGeodesicsData;
 
-    cg3::DrawableEigenMesh drawableSmoothedMesh;
-    cg3::DrawableEigenMesh drawableStock;
+    SharedDrawableMesh drawableSmoothedMesh;
+    SharedDrawableMesh drawableStock;
+
+    SharedDrawableMesh drawableRestoredMesh;
 
-    cg3::DrawableEigenMesh drawableRestoredMesh;
+    SharedDrawableMesh drawableMinComponent;
+    SharedDrawableMesh drawableMaxComponent;
+    SharedDrawableMesh drawableFourAxisComponent;
 
-    cg3::DrawableEigenMesh drawableMinComponent;
-    cg3::DrawableEigenMesh drawableMaxComponent;
-    cg3::DrawableEigenMesh drawableFourAxisComponent;
+    SharedDrawableMesh drawableMinResult;
+    SharedDrawableMesh drawableMaxResult;
 
-    cg3::DrawableEigenMesh drawableMinResult;
-    cg3::DrawableEigenMesh drawableMaxResult;
+    std::vector<SharedDrawableMesh> drawableBoxes;
+    std::vector<SharedDrawableMesh> drawableStocks;
+    std::vector<SharedDrawableMesh> drawableResults;
 
-    std::vector<cg3::DrawableEigenMesh> drawableBoxes;
-    std::vector<cg3::DrawableEigenMesh> drawableStocks;
-    std::vector<cg3::DrawableEigenMesh> drawableResults;
+    SharedDrawableMesh drawableMinSupport;
+    SharedDrawableMesh drawableMaxSupport;
 
-    cg3::DrawableEigenMesh drawableMinSupport;
-    cg3::DrawableEigenMesh drawableMaxSupport;
+    QTimer lodRefreshTimer;
 
 
     /* UI Fields */
@@ -134,7 +139,7 @@ private:
     void colorizeVisibility();
     void colorizeAssociation();
     void colorizeAssociation(
-            cg3::DrawableEigenMesh& drawableMesh,
+            SharedDrawableMesh& drawableMesh,
             const std::vector<int>& association,
             const std::vector<unsigned int>& targetDirections,
             const std::vector<unsigned int>& nonVisibleFaces);
@@ -0,0 +1,155 @@
+#include "faf_parameters.h"
+
+#include <array>
+#include <stdexcept>
+
+bool parseFlag(
+		const cg3::CommandLineArgumentManager& clArguments,
+		const std::string& name);
+
+/**
+ * Fills the parameters with the values given in the command line arguments.
+ * Each parameter is looked up with the given prefix before its name.
+ * The flags are switched on by their name, or set by a 0/1 value (e.g. --max_first=0).
+ * Throws a std::runtime_error if some value is invalid.
+ */
+void parseParameters(
+		const cg3::CommandLineArgumentManager& clArguments,
+		FAFParameters& params,
+		const std::string& prefix)
+{
+	const std::array<std::string, 25> strParams = {
+		"model_height",
+		"stock_length",
+		"stock_diameter",
+		"dont_scale_model",
+		"prefiltering_smooth_iters",
+		"n_best_axis_dirs",
+		"n_visibility_dirs",
+		"saliency_factor",
+		"compactness_term",
+		"wall_angle",
+		"max_first",
+		"just_segmentation",
+		"saliency_mode",
+		"simulate",
+		"simulation_max_gouge",
+		"label_preselection",
+		"dynamic_graph_cut",
+		"perf_counters",
+		"allocation_tracking",
+		"visibility_margins",
+		"depth_rasters",
+		"tool_radius",
+		"save_checkpoint",
+		"incremental",
+		"visibility_angle"
+	};
+
+	if (clArguments.exists(prefix + strParams[0])){
+		params.modelLength = std::stod(clArguments[prefix + strParams[0]]);
+	}
+	if (clArguments.exists(prefix + strParams[1])){
+		params.stockLength = std::stod(clArguments[prefix + strParams[1]]);
+	}
+	if (clArguments.exists(prefix + strParams[2])){
+		params.stockDiameter = std::stod(clArguments[prefix + strParams[2]]);
+	}
+	if (clArguments.exists(prefix + strParams[3])){
+		params.scaleModel = !parseFlag(clArguments, prefix + strParams[3]);
+	}
+	if (clArguments.exists(prefix + strParams[4])){
+		params.smoothIterations = std::stoi(clArguments[prefix + strParams[4]]);
+	}
+	if (clArguments.exists(prefix + strParams[5])){
+		params.nOrientations = std::stoi(clArguments[prefix + strParams[5]]);
+	}
+	if (clArguments.exists(prefix + strParams[6])){
+		params.nVisibilityDirections = std::stoi(clArguments[prefix + strParams[6]]);
+	}
+	if (clArguments.exists(prefix + strParams[7])){
+		params.detailMultiplier = std::stod(clArguments[prefix + strParams[7]]);
+	}
+	if (clArguments.exists(prefix + strParams[8])){
+		params.compactness = std::stod(clArguments[prefix + strParams[8]]);
+	}
+	if (clArguments.exists(prefix + strParams[9])){
+		params.firstLayerAngle = std::stod(clArguments[prefix + strParams[9]]);
+	}
+	if (clArguments.exists(prefix + strParams[10])){
+		params.minFirst = !parseFlag(clArguments, prefix + strParams[10]);
+	}
+	if (clArguments.exists(prefix + strParams[11])){
+		params.justSegmentation = parseFlag(clArguments, prefix + strParams[11]);
+	}
+	if (clArguments.exists(prefix + strParams[12])){
+		params.saliencyMode = clArguments[prefix + strParams[12]];
+		if (params.saliencyMode != "full" && params.saliencyMode != "proxy" && params.saliencyMode != "compare"){
+			throw std::runtime_error(
+				"Error: unknown saliency mode \"" + params.saliencyMode + "\".\n"
+				"Known saliency modes: full, proxy, compare.");
+		}
+	}
+	if (clArguments.exists(prefix + strParams[13])){
+		params.simulate = parseFlag(clArguments, prefix + strParams[13]);
+	}
+	if (clArguments.exists(prefix + strParams[14])){
+		params.simulationMaxGouge = std::stod(clArguments[prefix + strParams[14]]);
+	}
+	if (clArguments.exists(prefix + strParams[15])){
+		params.labelPreselection = parseFlag(clArguments, prefix + strParams[15]);
+	}
+	if (clArguments.exists(prefix + strParams[16])){
+		params.dynamicGraphCut = parseFlag(clArguments, prefix + strParams[16]);
+	}
+	if (clArguments.exists(prefix + strParams[17])){
+		params.perfCounters = parseFlag(clArguments, prefix + strParams[17]);
+	}
+	if (clArguments.exists(prefix + strParams[18])){
+		params.allocationTracking = parseFlag(clArguments, prefix + strParams[18]);
+	}
+	if (clArguments.exists(prefix + strParams[19])){
+		params.visibilityMargins = parseFlag(clArguments, prefix + strParams[19]);
+	}
+	if (clArguments.exists(prefix + strParams[20])){
+		params.depthRasterCellSize = std::stod(clArguments[prefix + strParams[20]]);
+	}
+	if (clArguments.exists(prefix + strParams[21])){
+		params.toolRadius = std::stod(clArguments[prefix + strParams[21]]);
+	}
+	if (clArguments.exists(prefix + strParams[22])){
+		params.saveCheckpoint = parseFlag(clArguments, prefix + strParams[22]);
+	}
+	if (clArguments.exists(prefix + strParams[23])){
+		params.incrementalCheckpoint = clArguments[prefix + strParams[23]];
+	}
+	if (clArguments.exists(prefix + strParams[24])){
+		params.visibilityAngle = std::stod(clArguments[prefix + strParams[24]]);
+	}
+
+	if (params.visibilityAngle <= 0 || params.visibilityAngle > 90){
+		throw std::runtime_error("Error: the visibility angle must be in (0, 90].");
+	}
+	if (params.visibilityAngle < 90 && !params.visibilityMargins){
+		throw std::runtime_error("Error: a visibility angle lower than 90 is derived from the visibility margins, which need visibility_margins.");
+	}
+}
+
+/**
+ * Returns the value of a flag given in the command line arguments:
+ * true if it has no value, otherwise its value (0/1 or false/true).
+ * Throws a std::runtime_error if the value is invalid.
+ */
+bool parseFlag(
+		const cg3::CommandLineArgumentManager& clArguments,
+		const std::string& name)
+{
+	const std::string value = clArguments[name];
+	if (value.empty() || value == "1" || value == "true"){
+		return true;
+	}
+	if (value == "0" || value == "false"){
+		return false;
+	}
+	throw std::runtime_error("Error: invalid value \"" + value + "\" of " + name + ", expected 0 or 1.");
+}
@@ -2,6 +2,9 @@
 #define FAF_PARAMETERS_H
 
 #include <iostream>
+#include <string>
+
+#include <cg3/utilities/command_line_argument_manager.h>
 
 struct FAFParameters {
 	bool scaleModel;
@@ -13,9 +16,22 @@ struct FAFParameters {
 	unsigned int nVisibilityDirections;
 	double detailMultiplier;
 	double compactness;
+	std::string saliencyMode;
 	double firstLayerAngle;
 	bool minFirst;
 	bool justSegmentation;
+	bool simulate;
+	double simulationMaxGouge;
+	bool labelPreselection;
+	bool dynamicGraphCut;
+	bool visibilityMargins;
+	double visibilityAngle;
+	double toolRadius;
+	double depthRasterCellSize;
+	bool perfCounters;
+	bool allocationTracking;
+	bool saveCheckpoint;
+	std::string incrementalCheckpoint;
 	std::string filename;
 	std::string outputDir;
 
@@ -29,9 +45,21 @@ struct FAFParameters {
 		nVisibilityDirections(120),
 		detailMultiplier(25.0),
 		compactness(30.0),
+		saliencyMode("full"),
 		firstLayerAngle(25.0),
 		minFirst(true),
-		justSegmentation(false)
+		justSegmentation(false),
+		simulate(false),
+		simulationMaxGouge(0.01),
+		labelPreselection(false),
+		dynamicGraphCut(false),
+		visibilityMargins(false),
+		visibilityAngle(90.0),
+		toolRadius(0.0),
+		depthRasterCellSize(0.0),
+		perfCounters(false),
+		allocationTracking(false),
+		saveCheckpoint(false)
 	{
 	}
 
@@ -46,11 +74,29 @@ struct FAFParameters {
 		std::cout << "Number of visibility directions to check: " << nVisibilityDirections << "\n";
 		std::cout << "Saliency factor: " << detailMultiplier << "\n";
 		std::cout << "Compactness term: " << compactness << "\n";
+		std::cout << "Saliency mode: " << saliencyMode << "\n";
 		std::cout << "Walls angle: " << firstLayerAngle << "\n";
 		std::cout << "Scale input mesh to stock: " << (scaleModel ? "true" : "false") << "\n";
 		std::cout << "Use -X as first block: " << (minFirst ? "true" : "false") << "\n";
 		std::cout << "Compute just segmentation: " << (justSegmentation ? "true" : "false") << "\n";
+		std::cout << "Simulate material removal: " << (simulate ? "true" : "false") << "\n";
+		std::cout << "Max gouged volume fraction: " << simulationMaxGouge << "\n";
+		std::cout << "Label preselection: " << (labelPreselection ? "true" : "false") << "\n";
+		std::cout << "Dynamic graph-cut: " << (dynamicGraphCut ? "true" : "false") << "\n";
+		std::cout << "Visibility margins: " << (visibilityMargins ? "true" : "false") << "\n";
+		std::cout << "Visibility angle: " << visibilityAngle << "\n";
+		std::cout << "Tool radius: " << toolRadius << "\n";
+		std::cout << "Depth rasters cell size: " << depthRasterCellSize << "\n";
+		std::cout << "Hardware performance counters: " << (perfCounters ? "true" : "false") << "\n";
+		std::cout << "Allocation tracking: " << (allocationTracking ? "true" : "false") << "\n";
+		std::cout << "Save checkpoint: " << (saveCheckpoint ? "true" : "false") << "\n";
+		std::cout << "Incremental run from checkpoint: " << (incrementalCheckpoint.empty() ? "none" : incrementalCheckpoint) << "\n";
 	}
 };
 
+void parseParameters(
+		const cg3::CommandLineArgumentManager& clArguments,
+		FAFParameters& params,
+		const std::string& prefix = "");
+
 #endif // FAF_PARAMETERS_H
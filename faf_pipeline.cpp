@@ -1,7 +1,10 @@
 #include "faf_pipeline.h"
 
+#include <map>
+#include <sstream>
+#include <iomanip>
+
 #include <cg3/libigl/mesh_distance.h>
-#include <cg3/utilities/timer.h>
 
 #include "methods/faf/faf_various.h"
 
@@ -10,11 +13,16 @@
 #include "methods/faf/faf_optimalrotation.h"
 #include "methods/faf/faf_extremes.h"
 #include "methods/faf/faf_visibilitycheck.h"
+#include "methods/faf/faf_accessibility.h"
 #include "methods/faf/faf_association.h"
 #include "methods/faf/faf_optimization.h"
 #include "methods/faf/faf_smoothlines.h"
 #include "methods/faf/faf_frequencies.h"
 #include "methods/faf/faf_extraction.h"
+#include "methods/faf/faf_simulation.h"
+#include "methods/faf/faf_depthraster.h"
+#include "methods/faf/faf_metrics.h"
+#include "methods/faf/faf_incremental.h"
 
 //other default values
 const double heightfieldAngle = 90.0 / 180.0 * M_PI;
@@ -27,6 +35,7 @@ unsigned int nScales = 5;
 double eps = 0.003;
 unsigned int maxIterations = 5;
 unsigned int laplacianIterations = 20;
+double curvatureDisplacementWeight = 0.5;
 
 //smoothing
 float lambda = 0.9;
@@ -41,10 +50,14 @@ const bool deterministic = true;
 const unsigned int resolution = 16384;
 const bool includeXDirections = false;
 const FourAxisFabrication::CheckMode checkMode = FourAxisFabrication::PROJECTION;
+const bool recordOccluders = false;
+const double accessibilityResolution = 0.1;
 
 //get association
 const double dataSigma = 1.0;
 const bool fixExtremes = true;
+const unsigned int labelPreselectionSlack = 1;
+const size_t graphCutMemoryBudget = 1024 * 1024 * 1024;
 
 //optimize association
 const bool relaxHoles = false;
@@ -80,6 +93,13 @@ const bool secondLayerSideSubdivision = false;
 const bool rotateResults = true;
 const bool xDirectionsAfter = true;
 
+//simulation
+const double simulationResolution = 0.5;
+
+//incremental pipeline
+const double incrementalTolerance = 1e-4;
+const unsigned int incrementalBandRings = 8;
+
 
 void FAFPipeline::scaleAndStock(
 		FourAxisFabrication::Data& data,
@@ -89,7 +109,7 @@ void FAFPipeline::scaleAndStock(
 		double stockDiameter)
 {
 	std::cout << "Scale and stock generation...\n";
-	cg3::Timer t(std::string("Scale and stock generation"));
+	FourAxisFabrication::MetricsZone zone("Scale and stock generation");
 	FourAxisFabrication::centerAndScale(
 				data,
 				scaleModel,
@@ -99,25 +119,63 @@ void FAFPipeline::scaleAndStock(
 				data,
 				stockLength,
 				stockDiameter);
-	t.stopAndPrint();
+	zone.stopAndPrint();
 	data.isMeshScaledAndStockGenerated = true;
 }
 
 void FAFPipeline::saliency(
-		FourAxisFabrication::Data& data)
+		FourAxisFabrication::Data& data,
+		const std::string& saliencyMode)
 {
-	std::cout << "Saliency details...\n";
-	cg3::Timer t(std::string("Saliency details"));
-	FourAxisFabrication::findDetails(
-				data,
-				unitScale,
-				nRing,
-				nScales,
-				eps,
-				computeBySaliency,
-				maxIterations,
-				laplacianIterations);
-	t.stopAndPrint();
+	std::vector<double> curvatureFaceSaliency;
+
+	if (saliencyMode == "proxy" || saliencyMode == "compare") {
+		std::cout << "Curvature details...\n";
+		FourAxisFabrication::MetricsZone zone("Curvature details");
+		FourAxisFabrication::findDetailsByCurvature(
+					data,
+					curvatureDisplacementWeight);
+		zone.stopAndPrint();
+		curvatureFaceSaliency = data.faceSaliency;
+	}
+	if (saliencyMode != "proxy") {
+		std::cout << "Saliency details...\n";
+		FourAxisFabrication::MetricsZone zone("Saliency details");
+		FourAxisFabrication::findDetails(
+					data,
+					unitScale,
+					nRing,
+					nScales,
+					eps,
+					computeBySaliency,
+					maxIterations,
+					laplacianIterations);
+		zone.stopAndPrint();
+	}
+	if (saliencyMode == "compare") {
+		//Pearson correlation between the face details of the two estimators
+		const size_t n = data.faceSaliency.size();
+		double meanC = 0, meanS = 0;
+		for (size_t fId = 0; fId < n; fId++) {
+			meanC += curvatureFaceSaliency[fId];
+			meanS += data.faceSaliency[fId];
+		}
+		meanC /= std::max(n, (size_t) 1);
+		meanS /= std::max(n, (size_t) 1);
+
+		double cov = 0, varC = 0, varS = 0, maxDifference = 0;
+		for (size_t fId = 0; fId < n; fId++) {
+			double dc = curvatureFaceSaliency[fId] - meanC;
+			double ds = data.faceSaliency[fId] - meanS;
+			cov += dc * ds;
+			varC += dc * dc;
+			varS += ds * ds;
+			maxDifference = std::max(maxDifference, std::fabs(curvatureFaceSaliency[fId] - data.faceSaliency[fId]));
+		}
+		double correlation = (varC > 0 && varS > 0) ? cov / std::sqrt(varC * varS) : 0.0;
+		std::cout << "Curvature vs saliency details -> correlation: " << correlation <<
+					 " (max difference: " << maxDifference << ")" << std::endl;
+	}
 	data.isSaliencyComputed = true;
 }
 
@@ -126,13 +184,13 @@ void FAFPipeline::smoothing(
 		unsigned int iterations)
 {
 	std::cout << "Prefiltering...\n";
-	cg3::Timer t(std::string("Prefiltering"));
+	FourAxisFabrication::MetricsZone zone("Prefiltering");
 	FourAxisFabrication::smoothing(
 				data,
 				iterations,
 				lambda,
 				mu);
-	t.stopAndPrint();
+	zone.stopAndPrint();
 	data.isMeshSmoothed = true;
 }
 
@@ -143,7 +201,7 @@ void FAFPipeline::optimalOrientation(
 		unsigned int nOrientations)
 {
 	std::cout << "Finding best axis...\n";
-	cg3::Timer t(std::string("Finding best axis"));
+	FourAxisFabrication::MetricsZone zone("Finding best axis");
 	data.isMeshOriented = FourAxisFabrication::rotateToOptimalOrientation(
 				data.mesh,
 				data.smoothedMesh,
@@ -153,7 +211,7 @@ void FAFPipeline::optimalOrientation(
 				extremeWeight,
 				BBWeight,
 				deterministic);
-	t.stopAndPrint();
+	zone.stopAndPrint();
 	if (!data.isMeshOriented) {
 		throw std::runtime_error("Error: model cannot fit on stock!");
 	}
@@ -163,18 +221,44 @@ void FAFPipeline::selectExtremes(
 		FourAxisFabrication::Data& data)
 {
 	std::cout << "Select extremes...\n";
-	cg3::Timer t(std::string("Select extremes"));
+	FourAxisFabrication::MetricsZone zone("Select extremes");
 	FourAxisFabrication::selectExtremesOnXAxis(data.smoothedMesh, heightfieldAngle, data);
-	t.stopAndPrint();
+	zone.stopAndPrint();
 	data.areExtremesSelected = true;
 }
 
+/**
+ * Restricts the checked visibility to the faces accessible by the tool and,
+ * with the visibility margins, to the faces within the visibility angle.
+ * Throws a std::runtime_error if the margins do not match the visibility.
+ */
+void restrictVisibility(
+		FourAxisFabrication::Data& data,
+		bool visibilityMargins,
+		double visibilityAngle,
+		double toolRadius)
+{
+	if (toolRadius > 0) {
+		FourAxisFabrication::checkAccessibility(data.smoothedMesh, toolRadius, accessibilityResolution, data);
+	}
+	if (visibilityMargins) {
+		FourAxisFabrication::computeVisibilityMargins(data.smoothedMesh, data);
+		if (visibilityAngle < 90.0 && !FourAxisFabrication::getVisibilityFromMargins(data.smoothedMesh, visibilityAngle / 180.0 * M_PI, data)) {
+			throw std::runtime_error("Error: the visibility margins do not match the visibility!");
+		}
+	}
+}
+
 void FAFPipeline::checkVisibility(
 		FourAxisFabrication::Data& data,
-		unsigned int nDirections)
+		unsigned int nDirections,
+		bool visibilityMargins,
+		double visibilityAngle,
+		double toolRadius,
+		cg3::Array2D<int>* checkedVisibility)
 {
 	std::cout << "Visibility check...\n";
-	cg3::Timer t(std::string("Visibility check"));
+	FourAxisFabrication::MetricsZone zone("Visibility check");
 	FourAxisFabrication::getVisibility(
 				data.smoothedMesh,
 				nDirections,
@@ -182,8 +266,13 @@ void FAFPipeline::checkVisibility(
 				heightfieldAngle,
 				includeXDirections,
 				data,
-				checkMode);
-	t.stopAndPrint();
+				checkMode,
+				recordOccluders);
+	if (checkedVisibility != nullptr) {
+		*checkedVisibility = data.visibility;
+	}
+	restrictVisibility(data, visibilityMargins, visibilityAngle, toolRadius);
+	zone.stopAndPrint();
 	data.isVisibilityChecked = true;
 	std::cout << "Non-visible triangles: " << data.nonVisibleFaces.size() << std::endl;
 }
@@ -191,18 +280,24 @@ void FAFPipeline::checkVisibility(
 void FAFPipeline::getAssociation(
 		FourAxisFabrication::Data& data,
 		double detailMultiplier,
-		double compactness)
+		double compactness,
+		bool labelPreselection,
+		bool dynamicGraphCut)
 {
 	std::cout << "Computing Segmentation...\n";
-	cg3::Timer t(std::string("Computing Segmentation"));
+	FourAxisFabrication::MetricsZone zone("Computing Segmentation");
 	FourAxisFabrication::getAssociation(
 				data.smoothedMesh,
 				dataSigma,
 				detailMultiplier,
 				compactness,
 				fixExtremes,
+				labelPreselection,
+				labelPreselectionSlack,
+				dynamicGraphCut,
+				graphCutMemoryBudget,
 				data);
-	t.stopAndPrint();
+	zone.stopAndPrint();
 	data.isAssociationComputed = true;
 }
 
@@ -210,14 +305,14 @@ void FAFPipeline::optimizeAssociation(
 		FourAxisFabrication::Data& data)
 {
 	std::cout << "Charts optimization...\n";
-	cg3::Timer t(std::string("Charts optimization"));
+	FourAxisFabrication::MetricsZone zone("Charts optimization");
 	FourAxisFabrication::optimization(
 				data.smoothedMesh,
 				relaxHoles,
 				loseHoles,
 				minChartArea,
 				data);
-	t.stopAndPrint();
+	zone.stopAndPrint();
 	data.isAssociationOptimized = true;
 }
 
@@ -225,12 +320,12 @@ void FAFPipeline::smoothLines(
 		FourAxisFabrication::Data& data)
 {
 	std::cout << "Boundary smoothing...\n";
-	cg3::Timer t(std::string("Boundary smoothing"));
+	FourAxisFabrication::MetricsZone zone("Boundary smoothing");
 	FourAxisFabrication::smoothLines(
 				data.smoothedMesh,
 				smoothEdgeLines,
 				data);
-	t.stopAndPrint();
+	zone.stopAndPrint();
 	data.isLineSmoothed = true;
 }
 
@@ -243,18 +338,18 @@ void FAFPipeline::restoreFrequencies(
 	std::cout << "Smoothed -> Haussdorff distance: " << haussDistance << " (w.r.t. bounding box: " << haussDistanceBB << ")" << std::endl;
 
 	std::cout << "Detail recovery...\n";
-	cg3::Timer t(std::string("Detail recovery"));
+	FourAxisFabrication::MetricsZone zone("Detail recovery");
 	FourAxisFabrication::restoreFrequencies(nIterations, heightfieldAngle, data.mesh, data.smoothedMesh, data);
-	t.stopAndPrint();
+	zone.stopAndPrint();
 
 	haussDistance = cg3::libigl::hausdorffDistance(data.mesh, data.restoredMesh);
 	originalMeshBB = data.mesh.boundingBox();
 	haussDistanceBB = haussDistance/originalMeshBB.diag();
 	std::cout << "Restored -> Haussdorff distance: " << haussDistance << " (w.r.t. bounding box: " << haussDistanceBB << ")" << std::endl;
 
-	cg3::Timer tCheck("Recheck visibility after detail recovery");
+	FourAxisFabrication::MetricsZone zoneCheck("Recheck visibility after detail recovery");
 	FourAxisFabrication::recheckVisibilityAfterRestore(recheck, resolution, heightfieldAngle, includeXDirections, reassign, data, checkMode);
-	tCheck.stopAndPrint();
+	zoneCheck.stopAndPrint();
 	std::cout << "Non-visible triangles after recheck: " << data.restoredMeshNonVisibleFaces.size() << std::endl;
 	data.areFrequenciesRestored = true;
 }
@@ -308,18 +403,19 @@ void FAFPipeline::cutComponents(
 	data.areComponentsCut = true;
 }
 
-void FAFPipeline::extractResults(
+unsigned int FAFPipeline::extractResults(
 		FourAxisFabrication::Data& data,
 		double firstLayerAngle,
 		bool minFirst,
 		double stockLength,
-		double stockDiameter)
+		double stockDiameter,
+		const FourAxisFabrication::Data* previousData)
 {
 	firstLayerAngle = firstLayerAngle  / 180.0 * M_PI;
 
 	std::cout << "Generating the fabrication sequence...\n";
-	cg3::Timer t(std::string("Generating the fabrication sequence"));
-	FourAxisFabrication::extractResults(
+	FourAxisFabrication::MetricsZone zone("Generating the fabrication sequence");
+	unsigned int nReusedBoxes = FourAxisFabrication::extractResults(
 				data,
 				stockLength,
 				stockDiameter,
@@ -333,28 +429,308 @@ void FAFPipeline::extractResults(
 				heightfieldAngle,
 				xDirectionsAfter,
 				minFirst,
-				rotateResults);
-	t.stopAndPrint();
+				rotateResults,
+				previousData,
+				incrementalTolerance * data.mesh.boundingBox().diag());
+	zone.stopAndPrint();
 	data.areResultsExtracted = true;
+	return nReusedBoxes;
 }
 
-void FAFPipeline::pipeline(
+void FAFPipeline::exportDepthRasters(
+		const FourAxisFabrication::Data& data,
+		double stockLength,
+		double stockDiameter,
+		double cellSize,
+		const std::string& outputDir)
+{
+	std::cout << "Exporting the depth rasters...\n";
+	FourAxisFabrication::MetricsZone zone("Exporting the depth rasters");
+	std::vector<FourAxisFabrication::DepthRaster> rasters;
+	FourAxisFabrication::computeDepthRasters(
+				data,
+				stockLength,
+				stockDiameter,
+				cellSize,
+				rotateResults,
+				rasters);
+	for (size_t i = 0; i < rasters.size(); i++) {
+		const std::string name = outputDir + "/depth_" + std::to_string(i);
+		if (!FourAxisFabrication::saveDepthRaster(rasters[i], name + ".bin", name + ".json")) {
+			std::cerr << "Cannot save the depth raster " << name << "\n";
+		}
+	}
+	zone.stopAndPrint();
+}
+
+void FAFPipeline::simulate(
 		FourAxisFabrication::Data& data,
+		double stockLength,
+		double stockDiameter,
+		FourAxisFabrication::SimulationReport& report)
+{
+	std::cout << "Simulating the material removal...\n";
+	FourAxisFabrication::MetricsZone zone("Simulating the material removal");
+	FourAxisFabrication::simulateFabrication(
+				data,
+				stockLength,
+				stockDiameter,
+				simulationResolution,
+				rotateResults,
+				report);
+	zone.stopAndPrint();
+
+	std::cout << "Dexels: " << report.nDexels << " (resolution " << report.resolution << ")\n";
+	for (size_t i = 0; i < report.removedVolumes.size(); i++) {
+		std::cout << "Result " << i << " > Removed volume: " << report.removedVolumes[i] << "\n";
+	}
+	std::cout << "Stock volume: " << report.stockVolume << "\n";
+	std::cout << "Target volume: " << report.targetVolume << "\n";
+	std::cout << "Final volume: " << report.finalVolume << "\n";
+	std::cout << "Leftover volume: " << report.leftoverVolume << " (w.r.t. target volume: " << report.leftoverVolume / report.targetVolume << ")\n";
+	std::cout << "Gouged volume: " << report.gougedVolume << " (w.r.t. target volume: " << report.gougedVolume / report.targetVolume << ")\n";
+}
+
+/**
+ * Returns the parameters which affect the stage outputs, by their command line name,
+ * as stored in the checkpoints. An incremental run needs the same values.
+ */
+std::map<std::string, std::string> checkpointParameters(
 		const FAFParameters& params)
 {
-	scaleAndStock(data, params.scaleModel, params.modelLength, params.stockLength, params.stockDiameter);
-	saliency(data);
-	smoothing(data, params.smoothIterations);
-	optimalOrientation(data, params.stockLength, params.stockDiameter, params.nOrientations);
+	auto toString = [] (double value) {
+		std::ostringstream stream;
+		stream << std::setprecision(17) << value;
+		return stream.str();
+	};
+
+	std::map<std::string, std::string> parameters;
+	parameters["dont_scale_model"] = params.scaleModel ? "0" : "1";
+	parameters["model_height"] = toString(params.modelLength);
+	parameters["stock_length"] = toString(params.stockLength);
+	parameters["stock_diameter"] = toString(params.stockDiameter);
+	parameters["prefiltering_smooth_iters"] = std::to_string(params.smoothIterations);
+	parameters["n_best_axis_dirs"] = std::to_string(params.nOrientations);
+	parameters["n_visibility_dirs"] = std::to_string(params.nVisibilityDirections);
+	parameters["saliency_factor"] = toString(params.detailMultiplier);
+	parameters["compactness_term"] = toString(params.compactness);
+	parameters["saliency_mode"] = params.saliencyMode;
+	parameters["wall_angle"] = toString(params.firstLayerAngle);
+	parameters["max_first"] = params.minFirst ? "0" : "1";
+	parameters["label_preselection"] = params.labelPreselection ? "1" : "0";
+	parameters["dynamic_graph_cut"] = params.dynamicGraphCut ? "1" : "0";
+	parameters["visibility_margins"] = params.visibilityMargins ? "1" : "0";
+	parameters["visibility_angle"] = toString(params.visibilityAngle);
+	parameters["tool_radius"] = toString(params.toolRadius);
+	return parameters;
+}
+
+/**
+ * Returns the stages of the pipeline, in order, for the given data and parameters.
+ * The stages keep references to data, params and checkpoint, which must outlive them.
+ * The checkpoint, if given, receives the outputs overwritten by the next stages;
+ * the final data is stored by pipeline.
+ */
+std::vector<FAFPipeline::Stage> FAFPipeline::pipelineStages(
+		FourAxisFabrication::Data& data,
+		const FAFParameters& params,
+		FourAxisFabrication::Checkpoint* checkpoint)
+{
+	std::vector<Stage> stages;
+	stages.push_back({"Scale and stock", [&data, &params] () {
+		scaleAndStock(data, params.scaleModel, params.modelLength, params.stockLength, params.stockDiameter);
+	}});
+	const Stage saliencyStage = {"Saliency", [&data, &params] () { saliency(data, params.saliencyMode); }};
+	const Stage smoothingStage = {"Smoothing", [&data, &params] () { smoothing(data, params.smoothIterations); }};
+	if (params.saliencyMode == "full") {
+		stages.push_back(saliencyStage);
+		stages.push_back(smoothingStage);
+	}
+	else {
+		//curvature details are computed from the smoothed mesh
+		stages.push_back(smoothingStage);
+		stages.push_back(saliencyStage);
+	}
+	stages.push_back({"Optimal orientation", [&data, &params] () {
+		optimalOrientation(data, params.stockLength, params.stockDiameter, params.nOrientations);
+	}});
+	stages.push_back({"Extremes", [&data] () { selectExtremes(data); }});
+	stages.push_back({"Visibility", [&data, &params, checkpoint] () {
+		checkVisibility(data, params.nVisibilityDirections, params.visibilityMargins, params.visibilityAngle, params.toolRadius, checkpoint != nullptr ? &checkpoint->visibility : nullptr);
+		if (checkpoint != nullptr) {
+			checkpoint->associationVisibility = data.visibility;
+		}
+	}});
+	stages.push_back({"Association", [&data, &params, checkpoint] () {
+		getAssociation(data, params.detailMultiplier, params.compactness, params.labelPreselection, params.dynamicGraphCut);
+		if (checkpoint != nullptr) {
+			//outputs overwritten by the next stages
+			checkpoint->smoothedMesh = data.smoothedMesh;
+			checkpoint->association = data.association;
+		}
+	}});
+	stages.push_back({"Charts optimization", [&data] () { optimizeAssociation(data); }});
+	stages.push_back({"Smooth lines", [&data] () { smoothLines(data); }});
+	stages.push_back({"Restore frequencies", [&data] () { restoreFrequencies(data); }});
+	stages.push_back({"Colorize", [&data] () { colorizeAssociation(data); }});
+	if (!params.justSegmentation){
+		stages.push_back({"Cut components", [&data] () { cutComponents(data); }});
+		stages.push_back({"Extract results", [&data, &params] () {
+			extractResults(data, params.firstLayerAngle, params.minFirst, params.stockLength, params.stockDiameter);
+		}});
+	}
+	return stages;
+}
+
+void FAFPipeline::pipeline(
+		FourAxisFabrication::Data& data,
+		const FAFParameters& params,
+		FourAxisFabrication::Checkpoint* checkpoint)
+{
+	for (const Stage& stage : pipelineStages(data, params, checkpoint)) {
+		stage.run();
+	}
+	if (checkpoint != nullptr) {
+		checkpoint->data = data;
+		checkpoint->parameters = checkpointParameters(params);
+	}
+}
+
+void FAFPipeline::incrementalPipeline(
+		FourAxisFabrication::Data& data,
+		const FAFParameters& params,
+		const FourAxisFabrication::Checkpoint& previous,
+		FourAxisFabrication::Checkpoint* checkpoint)
+{
+	FourAxisFabrication::IncrementalReport report = {};
+	FourAxisFabrication::MeshEdit edit;
+
+	std::string differentParameters;
+	for (const std::pair<const std::string, std::string>& parameter : checkpointParameters(params)) {
+		std::map<std::string, std::string>::const_iterator it = previous.parameters.find(parameter.first);
+		if (it == previous.parameters.end() || it->second != parameter.second) {
+			differentParameters += (differentParameters.empty() ? "" : ", ") + parameter.first;
+		}
+	}
+	if (!differentParameters.empty()) {
+		throw std::runtime_error("Error: the checkpoint has been computed with different parameters (" + differentParameters + ")!");
+	}
+	if (previous.data.directions.size() != (params.nVisibilityDirections / 2) * 2 + 2 || previous.association.empty()) {
+		throw std::runtime_error("Error: the checkpoint has been computed with different parameters!");
+	}
+
+	std::cout << "Finding the mesh edit...\n";
+	FourAxisFabrication::MetricsZone zoneEdit("Finding the mesh edit");
+	bool isChanged = FourAxisFabrication::findMeshEdit(previous.data.originalMesh, data.originalMesh, edit);
+	zoneEdit.stopAndPrint();
+	report.nChangedFaces = edit.changedFaces.size();
+	report.nRemovedFaces = edit.previousChangedFaces.size();
+	std::cout << "Changed faces: " << report.nChangedFaces << " (removed: " << report.nRemovedFaces << ")" << std::endl;
+
+	if (!isChanged) {
+		std::cout << "The mesh has not been changed: all the stage outputs are reused.\n";
+		data = previous.data;
+		if (checkpoint != nullptr) {
+			*checkpoint = previous;
+		}
+		return;
+	}
+
+	//scale, stock and orientation of the checkpoint
+	FourAxisFabrication::placeInCheckpointFrame(previous, edit, data.mesh);
+	data.stock = previous.data.stock;
+	data.isMeshScaledAndStockGenerated = true;
+	data.isMeshOriented = true;
+
+	if (params.saliencyMode == "full") {
+		saliency(data, params.saliencyMode);
+		smoothing(data, params.smoothIterations);
+	}
+	else {
+		//curvature details are computed from the smoothed mesh
+		smoothing(data, params.smoothIterations);
+		saliency(data, params.saliencyMode);
+	}
+
+	//vertices far from the edit are smoothed as in the checkpoint, up to the tolerance
+	const double tolerance = incrementalTolerance * data.mesh.boundingBox().diag();
+	FourAxisFabrication::snapSmoothedMesh(previous, tolerance, data.smoothedMesh, edit);
+	report.nSmoothedChangedFaces = edit.changedFaces.size();
+
 	selectExtremes(data);
-	checkVisibility(data, params.nVisibilityDirections);
-	getAssociation(data, params.detailMultiplier, params.compactness);
+
+	std::cout << "Incremental visibility check...\n";
+	FourAxisFabrication::MetricsZone zoneVisibility("Incremental visibility check");
+	FourAxisFabrication::getIncrementalVisibility(
+				previous,
+				data.smoothedMesh,
+				edit,
+				heightfieldAngle,
+				checkMode,
+				tolerance,
+				data,
+				report);
+	const cg3::Array2D<int> checkedVisibility = data.visibility;
+	restrictVisibility(data, params.visibilityMargins, params.visibilityAngle, params.toolRadius);
+	zoneVisibility.stopAndPrint();
+	data.isVisibilityChecked = true;
+	std::cout << "Non-visible triangles: " << data.nonVisibleFaces.size() << std::endl;
+
+	std::cout << "Incremental segmentation...\n";
+	FourAxisFabrication::MetricsZone zoneAssociation("Incremental segmentation");
+	std::vector<unsigned int> bandFaces;
+	FourAxisFabrication::selectAssociationBand(
+				previous,
+				data.smoothedMesh,
+				edit,
+				incrementalBandRings,
+				checkedVisibility,
+				data,
+				bandFaces);
+	FourAxisFabrication::getAssociationInBand(
+				data.smoothedMesh,
+				dataSigma,
+				params.detailMultiplier,
+				params.compactness,
+				fixExtremes,
+				bandFaces,
+				data);
+	zoneAssociation.stopAndPrint();
+	data.isAssociationComputed = true;
+	report.nBandFaces = bandFaces.size();
+	if (checkpoint != nullptr) {
+		checkpoint->smoothedMesh = data.smoothedMesh;
+		checkpoint->visibility = checkedVisibility;
+		checkpoint->associationVisibility = data.visibility;
+		checkpoint->association = data.association;
+	}
+
 	optimizeAssociation(data);
 	smoothLines(data);
 	restoreFrequencies(data);
 	colorizeAssociation(data);
 	if (!params.justSegmentation){
 		cutComponents(data);
-		extractResults(data, params.firstLayerAngle, params.minFirst, params.stockLength, params.stockDiameter);
+		report.nReusedBoxes = extractResults(data, params.firstLayerAngle, params.minFirst, params.stockLength, params.stockDiameter, &previous.data);
+		report.nBoxes = data.chartBoxes.size();
+	}
+	if (checkpoint != nullptr) {
+		checkpoint->data = data;
+		checkpoint->parameters = checkpointParameters(params);
+	}
+
+	const unsigned int nFaces = data.smoothedMesh.numberFaces();
+	std::cout << "\n--- Incremental run: ---\n\n";
+	std::cout << "Changed faces: " << report.nChangedFaces << " (removed: " << report.nRemovedFaces << ", after smoothing: " << report.nSmoothedChangedFaces << " of " << nFaces << ")\n";
+	std::cout << "Scale, stock and orientation: reused\n";
+	std::cout << "Saliency and smoothing: recomputed (smoothed mesh snapped to the checkpoint)\n";
+	std::cout << "Extremes: recomputed\n";
+	std::cout << "Visibility: slab [" << report.slabMinX << ", " << report.slabMaxX << "] (" << report.nSlabFaces << " faces, " <<
+				 report.nOccluderFaces << " checked), " << report.nRecomputedVisibility << " entries recomputed, " <<
+				 report.nReusedVisibility << " reused\n";
+	std::cout << "Segmentation: band of " << report.nBandFaces << " faces, " << nFaces - report.nBandFaces << " reused\n";
+	std::cout << "Optimization, boundary smoothing, detail recovery and components: recomputed\n";
+	if (!params.justSegmentation) {
+		std::cout << "Boxes: " << report.nReusedBoxes << " of " << report.nBoxes << " reused\n";
 	}
 }
@@ -1,7 +1,13 @@
 #ifndef FAF_PIPELINE_H
 #define FAF_PIPELINE_H
 
+#include <functional>
+#include <string>
+#include <vector>
+
 #include "methods/faf/faf_data.h"
+#include "methods/faf/faf_simulation.h"
+#include "methods/faf/faf_incremental.h"
 #include "faf_parameters.h"
 
 namespace FAFPipeline {
@@ -14,7 +20,8 @@ void scaleAndStock(
 		double stockDiameter);
 
 void saliency(
-		FourAxisFabrication::Data& data);
+		FourAxisFabrication::Data& data,
+		const std::string& saliencyMode);
 
 void smoothing(
 		FourAxisFabrication::Data& data,
@@ -31,12 +38,18 @@ void selectExtremes(
 
 void checkVisibility(
 		FourAxisFabrication::Data& data,
-		unsigned int nDirections);
+		unsigned int nDirections,
+		bool visibilityMargins,
+		double visibilityAngle,
+		double toolRadius,
+		cg3::Array2D<int>* checkedVisibility = nullptr);
 
 void getAssociation(
 		FourAxisFabrication::Data& data,
 		double detailMultiplier,
-		double compactness);
+		double compactness,
+		bool labelPreselection,
+		bool dynamicGraphCut);
 
 void optimizeAssociation(
 		FourAxisFabrication::Data& data);
@@ -53,16 +66,47 @@ void colorizeAssociation(
 void cutComponents(
 		FourAxisFabrication::Data& data);
 
-void extractResults(
+unsigned int extractResults(
 		FourAxisFabrication::Data& data,
 		double firstLayerAngle,
 		bool minFirst,
 		double stockLength,
-		double stockDiameter);
+		double stockDiameter,
+		const FourAxisFabrication::Data* previousData = nullptr);
+
+void exportDepthRasters(
+		const FourAxisFabrication::Data& data,
+		double stockLength,
+		double stockDiameter,
+		double cellSize,
+		const std::string& outputDir);
+
+void simulate(
+		FourAxisFabrication::Data& data,
+		double stockLength,
+		double stockDiameter,
+		FourAxisFabrication::SimulationReport& report);
+
+struct Stage {
+	std::string name;
+	std::function<void()> run;
+};
+
+std::vector<Stage> pipelineStages(
+		FourAxisFabrication::Data& data,
+		const FAFParameters& params,
+		FourAxisFabrication::Checkpoint* checkpoint = nullptr);
 
 void pipeline(
 		FourAxisFabrication::Data& data,
-		const FAFParameters& parmas);
+		const FAFParameters& parmas,
+		FourAxisFabrication::Checkpoint* checkpoint = nullptr);
+
+void incrementalPipeline(
+		FourAxisFabrication::Data& data,
+		const FAFParameters& params,
+		const FourAxisFabrication::Checkpoint& previous,
+		FourAxisFabrication::Checkpoint* checkpoint = nullptr);
 
 }
 
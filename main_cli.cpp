@@ -9,6 +9,9 @@
 #include <cg3/utilities/string.h>
 
 #include <methods/faf/faf_data.h>
+#include <methods/faf/faf_metrics.h>
+#include <methods/faf/faf_meshloader.h>
+#include <methods/faf/faf_incremental.h>
 
 #include "faf_pipeline.h"
 
@@ -64,17 +67,57 @@ int main(int argc, char *argv[]) {
 		}
 	}
 
+	if (params.perfCounters) {
+		FourAxisFabrication::enableHardwareCounters(true);
+	}
+	if (params.allocationTracking) {
+		FourAxisFabrication::enableAllocationTracking(true);
+	}
+
 	std::cout << "\n################ BEGIN ################\n\n\n";
 	std::cout << "Starting algorithm for " <<
 				 cg3::filenameWithExtension(params.filename) << "\n";
 
 	//run the algorithm...
-	FAFPipeline::pipeline(data, params);
+	FourAxisFabrication::Checkpoint checkpoint;
+	FourAxisFabrication::Checkpoint* checkpointPtr = params.saveCheckpoint ? &checkpoint : nullptr;
+	try {
+		if (!params.incrementalCheckpoint.empty()) {
+			FourAxisFabrication::Checkpoint previous;
+			if (!FourAxisFabrication::loadCheckpoint(params.incrementalCheckpoint, previous)) {
+				std::cerr << "Cannot load the checkpoint " << params.incrementalCheckpoint << "\n";
+				return -1;
+			}
+			FAFPipeline::incrementalPipeline(data, params, previous, checkpointPtr);
+		}
+		else {
+			FAFPipeline::pipeline(data, params, checkpointPtr);
+		}
+	}
+	catch (const std::runtime_error& e) {
+		std::cerr << e.what() << "\n";
+		return -1;
+	}
+
+	//quality gate on the fabrication sequence
+	bool simulationFailed = false;
+	if (params.simulate && !params.justSegmentation) {
+		FourAxisFabrication::SimulationReport report;
+		FAFPipeline::simulate(data, params.stockLength, params.stockDiameter, report);
+		if (report.gougedVolume > params.simulationMaxGouge * report.targetVolume) {
+			std::cerr << "Simulation failed: gouged volume exceeds " << params.simulationMaxGouge << " of the target volume.\n";
+			simulationFailed = true;
+		}
+	}
 
 	std::cout << "\nAlgorithm terminated. Saving results for " <<
 				 cg3::filenameWithExtension(params.filename) << "\n";
 	std::cout << "\n################ END ################\n\n\n";
 
+	if (params.perfCounters || params.allocationTracking) {
+		FourAxisFabrication::printMetrics();
+	}
+
 	data.restoredMesh.saveOnPly(outputDir + "/segmentation.ply");
 	if (!params.justSegmentation) {
 		unsigned int i = 0;
@@ -85,9 +128,17 @@ int main(int argc, char *argv[]) {
 		for (const cg3::EigenMesh& s : data.results){
 			s.saveOnPly(outputDir + "/result_" + std::to_string(i++) + ".ply");
 		}
+		if (params.depthRasterCellSize > 0) {
+			FAFPipeline::exportDepthRasters(data, params.stockLength, params.stockDiameter, params.depthRasterCellSize, outputDir);
+		}
+	}
+	if (params.saveCheckpoint) {
+		if (!FourAxisFabrication::saveCheckpoint(checkpoint, outputDir + "/checkpoint.faf")) {
+			std::cerr << "Cannot save the checkpoint in " << outputDir << "\n";
+		}
 	}
 
-	return 0;
+	return simulationFailed ? 1 : 0;
 }
 
 /**
@@ -115,68 +166,18 @@ FourAxisFabrication::Data getDataFromArguments(
 		throw std::runtime_error("Error: Input file not specified.\n" + help);
 	}
 
-	data.isMeshLoaded = data.originalMesh.loadFromFile(inputFile);
+	data.isMeshLoaded = FourAxisFabrication::loadMesh(inputFile, data.originalMesh);
 	params.filename = inputFile;
 	if (!data.isMeshLoaded){
 		throw std::runtime_error(
 			"Error: impossible to load input file.\n"
-			"Known input formats: OBJ, PLY.");
+			"Known input formats: OBJ, PLY (also gzip/zstd compressed).");
 	}
 
 	data.mesh = data.originalMesh;
 
 	//manage other parameters
-	const std::array<std::string, 12> strParams = {
-		"model_height",
-		"stock_length",
-		"stock_diameter",
-		"dont_scale_model",
-		"prefiltering_smooth_iters",
-		"n_best_axis_dirs",
-		"n_visibility_dirs",
-		"saliency_factor",
-		"compactness_term",
-		"wall_angle",
-		"max_first",
-		"just_segmentation"
-	};
-
-	if (clArguments.exists(strParams[0])){
-		params.modelLength = std::stod(clArguments[strParams[0]]);
-	}
-	if (clArguments.exists(strParams[1])){
-		params.stockLength = std::stod(clArguments[strParams[1]]);
-	}
-	if (clArguments.exists(strParams[2])){
-		params.stockDiameter = std::stod(clArguments[strParams[2]]);
-	}
-	if (clArguments.exists(strParams[3])){
-		params.scaleModel = false;
-	}
-	if (clArguments.exists(strParams[4])){
-		params.smoothIterations = std::stoi(clArguments[strParams[4]]);
-	}
-	if (clArguments.exists(strParams[5])){
-		params.nOrientations = std::stoi(clArguments[strParams[5]]);
-	}
-	if (clArguments.exists(strParams[6])){
-		params.nVisibilityDirections = std::stoi(clArguments[strParams[6]]);
-	}
-	if (clArguments.exists(strParams[7])){
-		params.detailMultiplier = std::stod(clArguments[strParams[7]]);
-	}
-	if (clArguments.exists(strParams[8])){
-		params.compactness = std::stod(clArguments[strParams[8]]);
-	}
-	if (clArguments.exists(strParams[9])){
-		params.firstLayerAngle = std::stod(clArguments[strParams[9]]);
-	}
-	if (clArguments.exists(strParams[10])){
-		params.minFirst = false;
-	}
-	if (clArguments.exists(strParams[11])){
-		params.justSegmentation = true;
-	}
+	parseParameters(clArguments, params);
 
 	return data;
 }
@@ -0,0 +1,262 @@
+#include "faf_accessibility.h"
+
+#include "faf_various.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#define ACCESSIBILITY_TOLERANCE_CELLS 1.0
+
+namespace FourAxisFabrication {
+
+namespace internal {
+
+void filterLine(
+        const std::vector<float>& line,
+        const unsigned int radius,
+        const bool isDilation,
+        std::vector<float>& padded,
+        std::vector<float>& prefix,
+        std::vector<float>& suffix,
+        std::vector<float>& result);
+
+void filterHeights(
+        const unsigned int sizeX,
+        const unsigned int sizeY,
+        const unsigned int radius,
+        const bool isDilation,
+        std::vector<float>& heights);
+
+}
+
+
+/* ----- ACCESSIBILITY ----- */
+
+/**
+ * @brief Restrict the visibility to the faces which are accessible by the tool.
+ * For each direction, the heightmap of the mesh is computed in the frame in which
+ * the direction is the z-axis, and it is closed by the section of the tool
+ * (see computeToolEnvelope). A visible face is not accessible if the envelope lies
+ * above the surface in the cell of its barycenter: the tool cannot go down to it.
+ * The non-visible faces are updated. The directions are processed in parallel.
+ * @param[in] mesh Input mesh
+ * @param[in] toolRadius Radius of the tool
+ * @param[in] cellSize Size of the cells of the heightmaps
+ * @param[out] data Four axis fabrication data
+ */
+void checkAccessibility(
+        const cg3::EigenMesh& mesh,
+        const double toolRadius,
+        const double cellSize,
+        Data& data)
+{
+    cg3::Array2D<int>& visibility = data.visibility;
+
+    const unsigned int nFaces = mesh.numberFaces();
+    const unsigned int nDirections = data.directions.size();
+    const unsigned int toolCells = static_cast<unsigned int>(std::ceil(toolRadius / cellSize));
+    const double tolerance = ACCESSIBILITY_TOLERANCE_CELLS * cellSize;
+
+    const cg3::BoundingBox3& boundingBox = mesh.boundingBox();
+
+    #pragma omp parallel for schedule(dynamic)
+    for (int dirIndex = 0; dirIndex < static_cast<int>(nDirections); dirIndex++) {
+        Eigen::Matrix3d rotationMatrix;
+        getDirectionRotationMatrix(data, dirIndex, rotationMatrix);
+
+        //Extents of the mesh in the frame of the direction, plus the tool radius
+        double minX = std::numeric_limits<double>::max(), maxX = -std::numeric_limits<double>::max();
+        double minY = std::numeric_limits<double>::max(), maxY = -std::numeric_limits<double>::max();
+        for (unsigned int c = 0; c < 8; c++) {
+            const Eigen::Vector3d corner(
+                        c & 1 ? boundingBox.maxX() : boundingBox.minX(),
+                        c & 2 ? boundingBox.maxY() : boundingBox.minY(),
+                        c & 4 ? boundingBox.maxZ() : boundingBox.minZ());
+            const Eigen::Vector3d rotatedCorner = rotationMatrix * corner;
+            minX = std::min(minX, rotatedCorner.x());
+            maxX = std::max(maxX, rotatedCorner.x());
+            minY = std::min(minY, rotatedCorner.y());
+            maxY = std::max(maxY, rotatedCorner.y());
+        }
+        minX -= toolRadius;
+        minY -= toolRadius;
+
+        const unsigned int sizeX = static_cast<unsigned int>(std::ceil((maxX + toolRadius - minX) / cellSize));
+        const unsigned int sizeY = static_cast<unsigned int>(std::ceil((maxY + toolRadius - minY) / cellSize));
+
+        Heightmap heightmap;
+        computeHeightmap(mesh, rotationMatrix, minX, minY, cellSize, sizeX, sizeY, heightmap);
+
+        std::vector<float> envelope;
+        computeToolEnvelope(heightmap, toolCells, envelope);
+
+        for (unsigned int fId = 0; fId < nFaces; fId++) {
+            if (visibility(dirIndex, fId) != 1)
+                continue;
+
+            const cg3::Point3i face = mesh.face(fId);
+            const cg3::Point3d barycenter = (mesh.vertex(face.x()) + mesh.vertex(face.y()) + mesh.vertex(face.z())) / 3;
+            const Eigen::Vector3d rotatedBarycenter = rotationMatrix * Eigen::Vector3d(barycenter.x(), barycenter.y(), barycenter.z());
+
+            const int i = static_cast<int>(std::floor((rotatedBarycenter.x() - minX) / cellSize));
+            const int j = static_cast<int>(std::floor((rotatedBarycenter.y() - minY) / cellSize));
+            if (i < 0 || j < 0 || i >= static_cast<int>(sizeX) || j >= static_cast<int>(sizeY) || heightmap.isEmpty(i, j))
+                continue;
+
+            if (envelope[static_cast<size_t>(j) * sizeX + i] - heightmap.height(i, j) > tolerance) {
+                visibility(dirIndex, fId) = 0;
+            }
+        }
+    }
+
+    //Detect non-visible faces
+    std::vector<unsigned int>& nonVisibleFaces = data.nonVisibleFaces;
+    nonVisibleFaces.clear();
+    for (unsigned int fId = 0; fId < nFaces; fId++) {
+        bool found = false;
+        for (unsigned int dirIndex = 0; dirIndex < nDirections && !found; dirIndex++) {
+            if (visibility(dirIndex, fId) == 1) {
+                found = true;
+            }
+        }
+
+        if (!found)
+            nonVisibleFaces.push_back(fId);
+    }
+}
+
+/**
+ * @brief Compute the envelope of the tool on a heightmap: the lowest height
+ * reached by a tool with a square section of half-size toolCells, coming from above.
+ * It is the grey-scale closing of the heightmap (dilation followed by erosion),
+ * computed with separable van Herk/Gil-Werman filters: the cost does not depend
+ * on the size of the tool. Planes and steps are kept, while the grooves narrower
+ * than the tool are filled. The empty cells are free for the tool.
+ * @param[in] heightmap Input heightmap
+ * @param[in] toolCells Half-size of the tool section, in cells
+ * @param[out] envelope Height of the envelope of each cell
+ */
+void computeToolEnvelope(
+        const Heightmap& heightmap,
+        const unsigned int toolCells,
+        std::vector<float>& envelope)
+{
+    envelope = heightmap.heights;
+
+    if (toolCells == 0)
+        return;
+
+    internal::filterHeights(heightmap.sizeX, heightmap.sizeY, toolCells, true, envelope);
+    internal::filterHeights(heightmap.sizeX, heightmap.sizeY, toolCells, false, envelope);
+}
+
+
+
+/* ----- INTERNAL FUNCTION DEFINITION ----- */
+
+namespace internal {
+
+/**
+ * @brief Max (dilation) or min (erosion) filter of a line with a window
+ * of 2*radius+1 samples, by the van Herk/Gil-Werman algorithm: the line is
+ * split in blocks of the window size, and each result is the combination of
+ * a suffix of a block and a prefix of the following one.
+ * The samples out of the line are -infinity (empty).
+ * @param[in] line Input line
+ * @param[in] radius Radius of the window
+ * @param[in] isDilation True for the max filter, false for the min filter
+ * @param padded Buffer for the padded line
+ * @param prefix Buffer for the prefixes of the blocks
+ * @param suffix Buffer for the suffixes of the blocks
+ * @param[out] result Filtered line
+ */
+void filterLine(
+        const std::vector<float>& line,
+        const unsigned int radius,
+        const bool isDilation,
+        std::vector<float>& padded,
+        std::vector<float>& prefix,
+        std::vector<float>& suffix,
+        std::vector<float>& result)
+{
+    const size_t n = line.size();
+    const size_t windowSize = 2 * radius + 1;
+    const size_t paddedSize = ((n + 2 * radius + windowSize - 1) / windowSize) * windowSize;
+
+    padded.assign(paddedSize, -std::numeric_limits<float>::infinity());
+    std::copy(line.begin(), line.end(), padded.begin() + radius);
+
+    prefix.resize(paddedSize);
+    suffix.resize(paddedSize);
+
+    for (size_t k = 0; k < paddedSize; k++) {
+        if (k % windowSize == 0)
+            prefix[k] = padded[k];
+        else
+            prefix[k] = isDilation ? std::max(prefix[k-1], padded[k]) : std::min(prefix[k-1], padded[k]);
+    }
+    for (size_t k = paddedSize; k-- > 0; ) {
+        if (k % windowSize == windowSize - 1)
+            suffix[k] = padded[k];
+        else
+            suffix[k] = isDilation ? std::max(suffix[k+1], padded[k]) : std::min(suffix[k+1], padded[k]);
+    }
+
+    //Window [k, k + 2*radius] of the padded line
+    result.resize(n);
+    for (size_t k = 0; k < n; k++) {
+        result[k] = isDilation ?
+                    std::max(suffix[k], prefix[k + 2 * radius]) :
+                    std::min(suffix[k], prefix[k + 2 * radius]);
+    }
+}
+
+/**
+ * @brief Separable max (dilation) or min (erosion) filter of a grid of heights
+ * with a square window of 2*radius+1 cells. Rows and columns are filtered in parallel.
+ * @param[in] sizeX Number of cells along x
+ * @param[in] sizeY Number of cells along y
+ * @param[in] radius Radius of the window
+ * @param[in] isDilation True for the max filter, false for the min filter
+ * @param[out] heights Heights to be filtered, row-major
+ */
+void filterHeights(
+        const unsigned int sizeX,
+        const unsigned int sizeY,
+        const unsigned int radius,
+        const bool isDilation,
+        std::vector<float>& heights)
+{
+    #pragma omp parallel
+    {
+        std::vector<float> line, padded, prefix, suffix, result;
+
+        //Rows
+        #pragma omp for
+        for (int j = 0; j < static_cast<int>(sizeY); j++) {
+            float* row = heights.data() + static_cast<size_t>(j) * sizeX;
+
+            line.assign(row, row + sizeX);
+            filterLine(line, radius, isDilation, padded, prefix, suffix, result);
+            std::copy(result.begin(), result.end(), row);
+        }
+
+        //Columns
+        #pragma omp for
+        for (int i = 0; i < static_cast<int>(sizeX); i++) {
+            line.resize(sizeY);
+            for (unsigned int j = 0; j < sizeY; j++) {
+                line[j] = heights[static_cast<size_t>(j) * sizeX + i];
+            }
+            filterLine(line, radius, isDilation, padded, prefix, suffix, result);
+            for (unsigned int j = 0; j < sizeY; j++) {
+                heights[static_cast<size_t>(j) * sizeX + i] = result[j];
+            }
+        }
+    }
+}
+
+}
+
+}
@@ -0,0 +1,28 @@
+#ifndef FAF_ACCESSIBILITY_H
+#define FAF_ACCESSIBILITY_H
+
+#include <vector>
+
+#include <cg3/meshes/eigenmesh/eigenmesh.h>
+
+#include "faf_data.h"
+#include "faf_heightmap.h"
+
+namespace FourAxisFabrication {
+
+/* Accessibility of the visible faces by a tool */
+
+void checkAccessibility(
+        const cg3::EigenMesh& mesh,
+        const double toolRadius,
+        const double cellSize,
+        Data& data);
+
+void computeToolEnvelope(
+        const Heightmap& heightmap,
+        const unsigned int toolCells,
+        std::vector<float>& envelope);
+
+}
+
+#endif // FAF_ACCESSIBILITY_H
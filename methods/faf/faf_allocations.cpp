@@ -0,0 +1,460 @@
+#include "faf_allocations.h"
+
+#include <iostream>
+#include <sstream>
+#include <algorithm>
+
+#ifdef FAF_ALLOCATION_TRACKING
+
+#include <new>
+#include <atomic>
+#include <cstdlib>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <dlfcn.h>
+#include <cxxabi.h>
+#define FAF_ALLOCATION_SITE_NAMES
+#endif
+
+#if defined(__GNUC__) || defined(__clang__)
+#define FAF_RETURN_ADDRESS() __builtin_return_address(0)
+#else
+#define FAF_RETURN_ADDRESS() nullptr
+#endif
+
+//Size of the header storing the size of each block (keeps the alignment of malloc)
+#define ALLOCATION_HEADER_SIZE alignof(std::max_align_t)
+//Maximum number of threads with their own counters
+#define MAX_TRACKED_THREADS 128
+//Size of the call site table of each thread (power of 2)
+#define SITE_TABLE_SIZE 4096
+//Maximum number of probes in the call site table
+#define SITE_TABLE_PROBES 16
+
+#endif
+
+namespace FourAxisFabrication {
+
+#ifdef FAF_ALLOCATION_TRACKING
+
+namespace internal {
+
+/* Counters of each thread: they are written only by their thread */
+
+struct ThreadAllocations {
+    std::atomic<uint64_t> allocations;
+    std::atomic<uint64_t> bytes;
+    std::atomic<uintptr_t> siteAddresses[SITE_TABLE_SIZE];
+    std::atomic<uint64_t> siteAllocations[SITE_TABLE_SIZE];
+    std::atomic<uint64_t> siteBytes[SITE_TABLE_SIZE];
+};
+
+ThreadAllocations threadAllocations[MAX_TRACKED_THREADS];
+std::atomic<int> nTrackedThreads(0);
+
+//Counters of the threads exceeding the maximum number (without call sites)
+std::atomic<uint64_t> otherAllocations(0);
+std::atomic<uint64_t> otherBytes(0);
+
+std::atomic<int64_t> liveBytes(0);
+std::atomic<int64_t> peakLiveBytes(0);
+
+std::atomic<bool> trackingEnabled(false);
+
+thread_local int threadIndex = -1;
+thread_local bool isTrackingSuspended = false;
+
+void* trackedAllocate(
+        const std::size_t size,
+        const void* site,
+        const bool isNoThrow);
+
+void trackedDeallocate(void* pointer);
+
+void recordAllocation(
+        const std::size_t size,
+        const void* site);
+
+void increment(
+        std::atomic<uint64_t>& counter,
+        const uint64_t value);
+
+}
+
+#endif
+
+
+/* ----- ALLOCATION TRACKING ----- */
+
+/**
+ * @brief Check if the allocation tracking has been compiled (FAF_ALLOCATION_TRACKING)
+ * @returns True if the global operator new/delete are tracked
+ */
+bool isAllocationTrackingAvailable()
+{
+#ifdef FAF_ALLOCATION_TRACKING
+    return true;
+#else
+    return false;
+#endif
+}
+
+/**
+ * @brief Enable the report of the allocations in the metrics zones. The allocations
+ * are always counted when the tracking has been compiled, the call sites are
+ * recorded only when the tracking is enabled.
+ * @param[in] enable Enable or disable the tracking
+ * @returns True if the tracking is enabled
+ */
+bool enableAllocationTracking(const bool enable)
+{
+#ifdef FAF_ALLOCATION_TRACKING
+    internal::trackingEnabled = enable;
+    return enable;
+#else
+    if (enable) {
+        std::cout << "Allocation tracking is not available: build with FAF_ALLOCATION_TRACKING defined." << std::endl;
+    }
+    return false;
+#endif
+}
+
+/**
+ * @brief Check if the allocation tracking is enabled
+ * @returns True if the tracking is enabled
+ */
+bool isAllocationTrackingEnabled()
+{
+#ifdef FAF_ALLOCATION_TRACKING
+    return internal::trackingEnabled;
+#else
+    return false;
+#endif
+}
+
+/**
+ * @brief Get the number of allocations and the allocated bytes of the calling
+ * thread, or of all the threads
+ * @param[in] acrossThreads Sum the counters of all the threads
+ * @param[out] counters Allocation counters
+ */
+void getAllocationCounters(
+        const bool acrossThreads,
+        AllocationCounters& counters)
+{
+    counters.allocations = 0;
+    counters.bytes = 0;
+
+#ifdef FAF_ALLOCATION_TRACKING
+    if (acrossThreads) {
+        const int nThreads = std::min(internal::nTrackedThreads.load(), MAX_TRACKED_THREADS);
+        for (int i = 0; i < nThreads; i++) {
+            counters.allocations += internal::threadAllocations[i].allocations.load(std::memory_order_relaxed);
+            counters.bytes += internal::threadAllocations[i].bytes.load(std::memory_order_relaxed);
+        }
+        counters.allocations += internal::otherAllocations.load(std::memory_order_relaxed);
+        counters.bytes += internal::otherBytes.load(std::memory_order_relaxed);
+    }
+    else if (internal::threadIndex >= 0 && internal::threadIndex < MAX_TRACKED_THREADS) {
+        counters.allocations = internal::threadAllocations[internal::threadIndex].allocations.load(std::memory_order_relaxed);
+        counters.bytes = internal::threadAllocations[internal::threadIndex].bytes.load(std::memory_order_relaxed);
+    }
+#else
+    (void) acrossThreads;
+#endif
+}
+
+/**
+ * @brief Get the call sites of the allocations of all the threads
+ * @param[out] sites Call sites, sorted by address
+ */
+void getAllocationSites(std::vector<AllocationSite>& sites)
+{
+    sites.clear();
+
+#ifdef FAF_ALLOCATION_TRACKING
+    internal::isTrackingSuspended = true;
+
+    const int nThreads = std::min(internal::nTrackedThreads.load(), MAX_TRACKED_THREADS);
+    for (int i = 0; i < nThreads; i++) {
+        const internal::ThreadAllocations& thread = internal::threadAllocations[i];
+        for (unsigned int s = 0; s < SITE_TABLE_SIZE; s++) {
+            const uintptr_t address = thread.siteAddresses[s].load(std::memory_order_relaxed);
+            if (address != 0) {
+                AllocationSite site = {
+                    reinterpret_cast<const void*>(address),
+                    thread.siteAllocations[s].load(std::memory_order_relaxed),
+                    thread.siteBytes[s].load(std::memory_order_relaxed)
+                };
+                sites.push_back(site);
+            }
+        }
+    }
+
+    //Merge the sites of the threads
+    std::sort(sites.begin(), sites.end(), [] (const AllocationSite& a, const AllocationSite& b) {
+        return a.address < b.address;
+    });
+
+    size_t nSites = 0;
+    for (size_t i = 0; i < sites.size(); i++) {
+        if (nSites > 0 && sites[nSites - 1].address == sites[i].address) {
+            sites[nSites - 1].allocations += sites[i].allocations;
+            sites[nSites - 1].bytes += sites[i].bytes;
+        }
+        else {
+            sites[nSites++] = sites[i];
+        }
+    }
+    sites.resize(nSites);
+
+    internal::isTrackingSuspended = false;
+#endif
+}
+
+/**
+ * @brief Start measuring the peak of the live bytes
+ * @returns Peak measured until now, to be passed to endPeakLiveBytes
+ */
+size_t beginPeakLiveBytes()
+{
+#ifdef FAF_ALLOCATION_TRACKING
+    return static_cast<size_t>(internal::peakLiveBytes.exchange(internal::liveBytes.load()));
+#else
+    return 0;
+#endif
+}
+
+/**
+ * @brief Stop measuring the peak of the live bytes. The measures can be nested.
+ * @param[in] previousPeak Peak returned by beginPeakLiveBytes
+ * @returns Peak of the live bytes since beginPeakLiveBytes
+ */
+size_t endPeakLiveBytes(const size_t previousPeak)
+{
+#ifdef FAF_ALLOCATION_TRACKING
+    const int64_t peak = internal::peakLiveBytes.load();
+
+    int64_t currentPeak = peak;
+    while (currentPeak < static_cast<int64_t>(previousPeak) &&
+           !internal::peakLiveBytes.compare_exchange_weak(currentPeak, static_cast<int64_t>(previousPeak)));
+
+    return static_cast<size_t>(std::max(peak, static_cast<int64_t>(0)));
+#else
+    (void) previousPeak;
+    return 0;
+#endif
+}
+
+/**
+ * @brief Get the name of a call site (function and offset, or module and offset).
+ * The functions are named only if their symbols are exported (-rdynamic).
+ * @param[in] address Address of the call site
+ * @returns Name of the call site
+ */
+std::string getAllocationSiteName(const void* address)
+{
+    std::ostringstream ss;
+
+#ifdef FAF_ALLOCATION_SITE_NAMES
+    internal::isTrackingSuspended = true;
+
+    Dl_info info;
+    const bool isFound = dladdr(address, &info) != 0;
+    if (isFound && info.dli_sname != nullptr) {
+        int status = 0;
+        char* demangled = abi::__cxa_demangle(info.dli_sname, nullptr, nullptr, &status);
+        ss << (status == 0 && demangled != nullptr ? demangled : info.dli_sname) << "+0x" << std::hex <<
+              (reinterpret_cast<uintptr_t>(address) - reinterpret_cast<uintptr_t>(info.dli_saddr));
+        std::free(demangled);
+    }
+    else if (isFound && info.dli_fname != nullptr) {
+        ss << info.dli_fname << "+0x" << std::hex <<
+              (reinterpret_cast<uintptr_t>(address) - reinterpret_cast<uintptr_t>(info.dli_fbase));
+    }
+    else {
+        ss << address;
+    }
+
+    internal::isTrackingSuspended = false;
+#else
+    ss << address;
+#endif
+
+    return ss.str();
+}
+
+
+#ifdef FAF_ALLOCATION_TRACKING
+
+namespace internal {
+
+/**
+ * @brief Allocate a block, storing its size in a header
+ * @param[in] size Size requested
+ * @param[in] site Call site of the allocation
+ * @param[in] isNoThrow Return nullptr instead of throwing std::bad_alloc
+ * @returns Allocated block
+ */
+void* trackedAllocate(
+        const std::size_t size,
+        const void* site,
+        const bool isNoThrow)
+{
+    void* block = std::malloc(size + ALLOCATION_HEADER_SIZE);
+    while (block == nullptr) {
+        std::new_handler handler = std::get_new_handler();
+        if (handler == nullptr) {
+            if (isNoThrow)
+                return nullptr;
+            throw std::bad_alloc();
+        }
+        handler();
+        block = std::malloc(size + ALLOCATION_HEADER_SIZE);
+    }
+
+    *static_cast<std::size_t*>(block) = size;
+
+    //Live bytes and peak
+    const int64_t live = liveBytes.fetch_add(static_cast<int64_t>(size), std::memory_order_relaxed) + static_cast<int64_t>(size);
+    int64_t peak = peakLiveBytes.load(std::memory_order_relaxed);
+    while (live > peak && !peakLiveBytes.compare_exchange_weak(peak, live, std::memory_order_relaxed));
+
+    if (!isTrackingSuspended)
+        recordAllocation(size, site);
+
+    return static_cast<char*>(block) + ALLOCATION_HEADER_SIZE;
+}
+
+/**
+ * @brief Deallocate a block allocated by trackedAllocate
+ * @param[in] pointer Pointer to the block
+ */
+void trackedDeallocate(void* pointer)
+{
+    if (pointer == nullptr)
+        return;
+
+    void* block = static_cast<char*>(pointer) - ALLOCATION_HEADER_SIZE;
+    liveBytes.fetch_sub(static_cast<int64_t>(*static_cast<std::size_t*>(block)), std::memory_order_relaxed);
+
+    std::free(block);
+}
+
+/**
+ * @brief Add an allocation to the counters of the calling thread
+ * @param[in] size Size of the allocation
+ * @param[in] site Call site of the allocation
+ */
+void recordAllocation(
+        const std::size_t size,
+        const void* site)
+{
+    if (threadIndex < 0) {
+        threadIndex = nTrackedThreads.fetch_add(1);
+    }
+
+    if (threadIndex >= MAX_TRACKED_THREADS) {
+        otherAllocations.fetch_add(1, std::memory_order_relaxed);
+        otherBytes.fetch_add(size, std::memory_order_relaxed);
+        return;
+    }
+
+    ThreadAllocations& thread = threadAllocations[threadIndex];
+    increment(thread.allocations, 1);
+    increment(thread.bytes, size);
+
+    if (site == nullptr || !trackingEnabled.load(std::memory_order_relaxed))
+        return;
+
+    //Open addressing on the call sites
+    const uintptr_t address = reinterpret_cast<uintptr_t>(site);
+    size_t s = static_cast<size_t>((static_cast<uint64_t>(address >> 2) * 0x9E3779B97F4A7C15ULL) >> 40) & (SITE_TABLE_SIZE - 1);
+    for (unsigned int p = 0; p < SITE_TABLE_PROBES; p++) {
+        const uintptr_t siteAddress = thread.siteAddresses[s].load(std::memory_order_relaxed);
+        if (siteAddress == 0) {
+            thread.siteAddresses[s].store(address, std::memory_order_relaxed);
+        }
+        if (siteAddress == 0 || siteAddress == address) {
+            increment(thread.siteAllocations[s], 1);
+            increment(thread.siteBytes[s], size);
+            return;
+        }
+        s = (s + 1) & (SITE_TABLE_SIZE - 1);
+    }
+}
+
+/**
+ * @brief Increment a counter written only by the calling thread
+ * @param[in] counter Counter
+ * @param[in] value Value to be added
+ */
+void increment(
+        std::atomic<uint64_t>& counter,
+        const uint64_t value)
+{
+    counter.store(counter.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+}
+
+}
+
+#endif
+
+}
+
+
+#ifdef FAF_ALLOCATION_TRACKING
+
+/* ----- GLOBAL OPERATOR NEW/DELETE ----- */
+
+void* operator new(std::size_t size)
+{
+    return FourAxisFabrication::internal::trackedAllocate(size, FAF_RETURN_ADDRESS(), false);
+}
+
+void* operator new[](std::size_t size)
+{
+    return FourAxisFabrication::internal::trackedAllocate(size, FAF_RETURN_ADDRESS(), false);
+}
+
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept
+{
+    return FourAxisFabrication::internal::trackedAllocate(size, FAF_RETURN_ADDRESS(), true);
+}
+
+void* operator new[](std::size_t size, const std::nothrow_t&) noexcept
+{
+    return FourAxisFabrication::internal::trackedAllocate(size, FAF_RETURN_ADDRESS(), true);
+}
+
+void operator delete(void* pointer) noexcept
+{
+    FourAxisFabrication::internal::trackedDeallocate(pointer);
+}
+
+void operator delete[](void* pointer) noexcept
+{
+    FourAxisFabrication::internal::trackedDeallocate(pointer);
+}
+
+void operator delete(void* pointer, std::size_t) noexcept
+{
+    FourAxisFabrication::internal::trackedDeallocate(pointer);
+}
+
+void operator delete[](void* pointer, std::size_t) noexcept
+{
+    FourAxisFabrication::internal::trackedDeallocate(pointer);
+}
+
+void operator delete(void* pointer, const std::nothrow_t&) noexcept
+{
+    FourAxisFabrication::internal::trackedDeallocate(pointer);
+}
+
+void operator delete[](void* pointer, const std::nothrow_t&) noexcept
+{
+    FourAxisFabrication::internal::trackedDeallocate(pointer);
+}
+
+#endif
@@ -0,0 +1,41 @@
+#ifndef FAF_ALLOCATIONS_H
+#define FAF_ALLOCATIONS_H
+
+#include <string>
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+
+namespace FourAxisFabrication {
+
+/* Allocation counters */
+
+struct AllocationCounters {
+    uint64_t allocations;
+    uint64_t bytes;
+};
+
+struct AllocationSite {
+    const void* address;
+    uint64_t allocations;
+    uint64_t bytes;
+};
+
+bool isAllocationTrackingAvailable();
+bool enableAllocationTracking(const bool enable);
+bool isAllocationTrackingEnabled();
+
+void getAllocationCounters(
+        const bool acrossThreads,
+        AllocationCounters& counters);
+
+void getAllocationSites(std::vector<AllocationSite>& sites);
+
+size_t beginPeakLiveBytes();
+size_t endPeakLiveBytes(const size_t previousPeak);
+
+std::string getAllocationSiteName(const void* address);
+
+}
+
+#endif // FAF_ALLOCATIONS_H
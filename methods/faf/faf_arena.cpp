@@ -0,0 +1,87 @@
+#include "faf_arena.h"
+
+#include <algorithm>
+#include <new>
+
+#define ARENA_MAX_BLOCK_SIZE (16 * 1024 * 1024)
+
+namespace FourAxisFabrication {
+
+/* ----- STAGE ARENA ----- */
+
+/**
+ * @brief Monotonic arena for the short-lived containers of a stage: the memory
+ * is taken from blocks of growing size by moving a pointer, it is never freed
+ * by the containers, and all the blocks are released at once by release() or when
+ * the arena is destroyed. An arena is not thread-safe: each thread of a parallel
+ * stage must use its own arena. The containers must not outlive their arena.
+ * @param[in] initialBlockSize Size of the first block
+ */
+StageArena::StageArena(const size_t initialBlockSize) :
+    blocks(nullptr),
+    current(nullptr),
+    end(nullptr),
+    nextBlockSize(initialBlockSize),
+    totalBytes(0)
+{
+
+}
+
+StageArena::~StageArena()
+{
+    release();
+}
+
+/**
+ * @brief Release all the blocks of the arena. The containers allocated on the
+ * arena must have been destroyed.
+ */
+void StageArena::release()
+{
+    while (blocks != nullptr) {
+        Block* next = blocks->next;
+        ::operator delete(blocks);
+        blocks = next;
+    }
+
+    current = nullptr;
+    end = nullptr;
+    totalBytes = 0;
+}
+
+/**
+ * @brief Get the memory reserved by the arena
+ * @returns Bytes of the blocks
+ */
+size_t StageArena::reservedBytes() const
+{
+    return totalBytes;
+}
+
+/**
+ * @brief Allocate a new block, large enough for the requested memory,
+ * and take the memory from it
+ * @param[in] bytes Requested bytes
+ * @param[in] alignment Requested alignment
+ * @returns Pointer to the memory
+ */
+void* StageArena::allocateBlock(const size_t bytes, const size_t alignment)
+{
+    const size_t headerSize = (sizeof(Block) + alignof(std::max_align_t) - 1) & ~(alignof(std::max_align_t) - 1);
+    const size_t blockSize = std::max(nextBlockSize, headerSize + bytes + alignment);
+
+    Block* block = static_cast<Block*>(::operator new(blockSize));
+    block->next = blocks;
+    block->size = blockSize;
+    blocks = block;
+
+    current = reinterpret_cast<char*>(block) + headerSize;
+    end = reinterpret_cast<char*>(block) + blockSize;
+    totalBytes += blockSize;
+
+    nextBlockSize = std::min(nextBlockSize * 2, static_cast<size_t>(ARENA_MAX_BLOCK_SIZE));
+
+    return allocate(bytes, alignment);
+}
+
+}
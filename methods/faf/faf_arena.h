@@ -0,0 +1,99 @@
+#ifndef FAF_ARENA_H
+#define FAF_ARENA_H
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <list>
+#include <map>
+#include <set>
+#include <vector>
+
+namespace FourAxisFabrication {
+
+/* Monotonic arena of a stage */
+
+class StageArena {
+
+public:
+
+    StageArena(const size_t initialBlockSize = 64 * 1024);
+    ~StageArena();
+
+    StageArena(const StageArena& other) = delete;
+    StageArena& operator=(const StageArena& other) = delete;
+
+    inline void* allocate(const size_t bytes, const size_t alignment) {
+        const uintptr_t address = (reinterpret_cast<uintptr_t>(current) + alignment - 1) & ~(static_cast<uintptr_t>(alignment) - 1);
+        if (current != nullptr && address + bytes <= reinterpret_cast<uintptr_t>(end)) {
+            current = reinterpret_cast<char*>(address + bytes);
+            return reinterpret_cast<void*>(address);
+        }
+        return allocateBlock(bytes, alignment);
+    }
+
+    void release();
+    size_t reservedBytes() const;
+
+private:
+
+    struct Block {
+        Block* next;
+        size_t size;
+    };
+
+    void* allocateBlock(const size_t bytes, const size_t alignment);
+
+    Block* blocks;
+    char* current;
+    char* end;
+    size_t nextBlockSize;
+    size_t totalBytes;
+};
+
+
+/* Allocator of the containers on an arena: the memory is released with the arena */
+
+template<class T>
+class ArenaAllocator {
+
+public:
+
+    typedef T value_type;
+
+    ArenaAllocator(StageArena& arena) : arena(&arena) {}
+    template<class U>
+    ArenaAllocator(const ArenaAllocator<U>& other) : arena(other.arena) {}
+
+    inline T* allocate(const size_t n) {
+        return static_cast<T*>(arena->allocate(n * sizeof(T), alignof(T)));
+    }
+    inline void deallocate(T*, const size_t) {}
+
+    template<class U>
+    inline bool operator==(const ArenaAllocator<U>& other) const { return arena == other.arena; }
+    template<class U>
+    inline bool operator!=(const ArenaAllocator<U>& other) const { return arena != other.arena; }
+
+private:
+
+    template<class U> friend class ArenaAllocator;
+
+    StageArena* arena;
+};
+
+template<class T>
+using ArenaVector = std::vector<T, ArenaAllocator<T>>;
+
+template<class T>
+using ArenaList = std::list<T, ArenaAllocator<T>>;
+
+template<class T, class Compare = std::less<T>>
+using ArenaSet = std::set<T, Compare, ArenaAllocator<T>>;
+
+template<class K, class V, class Compare = std::less<K>>
+using ArenaMap = std::map<K, V, Compare, ArenaAllocator<std::pair<const K, V>>>;
+
+}
+
+#endif // FAF_ARENA_H
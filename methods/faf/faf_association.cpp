@@ -3,16 +3,22 @@
  * @author Alessandro Muntoni
  */
 #include "faf_association.h"
+#include "includes/faf_kernels.h"
 
 #if defined(CG3_LIBIGL_DEFINED) && defined(MULTI_LABEL_OPTIMIZATION_INCLUDED)
 
 #include "../lib/MultiLabelOptimization/GCoptimization.h"
 
 #include "faf_charts.h"
+#include "faf_dynamicgraphcut.h"
+#include "faf_metrics.h"
 
 #include <cg3/libigl/mesh_adjacencies.h>
 
 #include <unordered_set>
+#include <queue>
+#include <limits>
+#include <algorithm>
 
 #define MAXCOST GCO_MAX_ENERGYTERM
 
@@ -20,12 +26,32 @@ namespace FourAxisFabrication {
 
 namespace internal {
 
-struct SmoothData {
-    const cg3::EigenMesh& mesh;
-    std::vector<double>& faceSaliency;
-    double detailMultiplier;
-    double compactness;
-};
+bool preselectLabels(
+        const cg3::EigenMesh& mesh,
+        const unsigned int preselectionSlack,
+        const Data& data,
+        std::vector<unsigned int>& targetLabels);
+
+void computeGraphCut(
+        const cg3::EigenMesh& mesh,
+        const std::vector<std::vector<int>>& ffAdj,
+        const std::vector<unsigned int>& targetLabels,
+        const double dataSigma,
+        const double detailMultiplier,
+        const double compactness,
+        const bool fixExtremes,
+        const bool dynamicGraphCut,
+        const size_t graphCutMemoryBudget,
+        Data& data,
+        std::vector<int>& association);
+
+unsigned int countNonVisibleAssignedFaces(
+        const std::vector<int>& association,
+        const Data& data);
+
+void updateTargetDirections(
+        const unsigned int nFaces,
+        Data& data);
 
 void setupDataCost(
         const cg3::EigenMesh& mesh,
@@ -35,14 +61,27 @@ void setupDataCost(
         const Data& data,
         std::vector<float>& dataCost);
 
+void setupFaceDataCost(
+        const cg3::EigenMesh& mesh,
+        const unsigned int faceId,
+        const std::vector<unsigned int>& targetLabels,
+        const double dataSigma,
+        const bool isFixedExtreme,
+        const Data& data,
+        float* faceDataCost);
+
 //void setupSmoothCost(
 //        const std::vector<unsigned int> targetLabels,
 //        const double compactness,
 //        std::vector<float>& smoothCost);
 
+struct BandSmoothData {
+    SmoothData* smoothData;
+    const std::vector<unsigned int>* bandFaces;
+};
 
-float getSmoothTerm(
-        int f1, int f2,
+float getBandSmoothTerm(
+        int s1, int s2,
         int l1, int l2,
         void *extra_data);
 
@@ -51,11 +90,21 @@ float getSmoothTerm(
 /* Get optimal association for each face */
 
 /**
- * @brief Associate each face of the mesh to a direction using a graph-cut algorithm
+ * @brief Associate each face of the mesh to a direction using a graph-cut algorithm.
+ * If label preselection is enabled, the graph-cut is computed only on a small set
+ * of directions which covers the visible faces (plus some adjacent directions as slack).
+ * The full set of directions is used if the preselected set does not cover all
+ * the visible faces, or if the resulting association has more non-visible faces.
+ * The dynamic graph-cut keeps a graph for each pair of directions, reusing
+ * flows and search trees between the cycles of the swap and skipping the unchanged pairs.
  * @param[in] Input mesh
  * @param[in] dataSigma Sigma of the gaussian function for calculating data term
  * @param[in] compactness Compactness
  * @param[in] fixExtremes Fix extremes on the given directions
+ * @param[in] labelPreselection Compute the graph-cut on a preselected set of directions
+ * @param[in] preselectionSlack Number of adjacent directions added for each preselected one
+ * @param[in] dynamicGraphCut Use the dynamic graph-cut instead of the GCO swap
+ * @param[in] graphCutMemoryBudget Max bytes of the graphs kept by the dynamic graph-cut (0 for no limit)
  * @param[out] data Four axis fabrication data
  */
 void getAssociation(
@@ -64,16 +113,17 @@ void getAssociation(
         const double detailMultiplier,
         const double compactness,
         const bool fixExtremes,
+        const bool labelPreselection,
+        const unsigned int preselectionSlack,
+        const bool dynamicGraphCut,
+        const size_t graphCutMemoryBudget,
         Data& data)
 {
     //Get fabrication data
     const std::vector<cg3::Vec3d>& directions = data.directions;
     const std::vector<unsigned int>& nonVisibleFaces = data.nonVisibleFaces;
-    std::vector<unsigned int>& targetDirections = data.targetDirections;
     std::vector<int>& association = data.association;
     std::vector<unsigned int>& associationNonVisibleFaces = data.associationNonVisibleFaces;
-    std::vector<unsigned int>& minExtremes = data.minExtremes;
-    std::vector<unsigned int>& maxExtremes = data.maxExtremes;
 
     //Setting target directions
     std::vector<unsigned int> targetLabels(directions.size());
@@ -86,77 +136,166 @@ void getAssociation(
     std::fill(association.begin(), association.end(), -1);
 
     const unsigned int nFaces = mesh.numberFaces();
-    const unsigned int nLabels = targetLabels.size();
 
     //Get mesh adjacencies
     std::vector<std::vector<int>> ffAdj = cg3::libigl::faceToFaceAdjacencies(mesh);
 
-    //Creating cost data arrays
-    std::vector<float> dataCost(nFaces * nLabels);
-    //Get the costs
-    internal::setupDataCost(mesh, targetLabels, dataSigma, fixExtremes, data, dataCost);
-
-    //Fixed compactness cost
-//    std::vector<float> smoothCost(nLabels * nLabels);
-//    internal::setupSmoothCost(targetLabels, compactness, smoothCost);
-
     try {
-        GCoptimizationGeneralGraph* gc = new GCoptimizationGeneralGraph(nFaces, nLabels);
-
-        gc->setDataCost(dataCost.data());
-        //Set smooth cost
-        internal::SmoothData smoothData = {mesh, data.faceSaliency, detailMultiplier, compactness};
-        gc->setSmoothCost(internal::getSmoothTerm, (void*) &smoothData);
-
-        //Set adjacencies
-        std::vector<bool> visited(nFaces, false);
-        for (unsigned int f = 0; f < nFaces; f++) {
-            visited[f] = true;
-            for (int i = 0; i < 3; ++i) {
-                int nid = ffAdj[f][i];
-                if (!visited[nid])
-                    gc->setNeighbors(f, nid);
-            }
-        }
+        bool computed = false;
 
-        //Compute graph cut
-        gc->swap(-1); // -1 => run until convergence [convergence is guaranteed]
+        //Graph-cut on the preselected directions
+        if (labelPreselection) {
+            std::vector<unsigned int> preselectedLabels;
 
-        //Set associations
-        for (unsigned int fId = 0; fId < nFaces; fId++){
-            int associatedDirectionIndex = gc->whatLabel(fId);
+            if (internal::preselectLabels(mesh, preselectionSlack, data, preselectedLabels)) {
+                std::cout << "Label preselection: " << preselectedLabels.size() << " of " << targetLabels.size() << " directions." << std::endl;
+
+                internal::computeGraphCut(mesh, ffAdj, preselectedLabels, dataSigma, detailMultiplier, compactness, fixExtremes, dynamicGraphCut, graphCutMemoryBudget, data, association);
 
-            association[fId] = targetLabels[associatedDirectionIndex];
+                if (internal::countNonVisibleAssignedFaces(association, data) <= nonVisibleFaces.size()) {
+                    computed = true;
+                }
+                else {
+                    std::cout << "Label preselection left faces unassigned: using all the directions." << std::endl;
+                }
+            }
+            else {
+                std::cout << "Label preselection does not cover the visible faces: using all the directions." << std::endl;
+            }
         }
 
-        //Delete data
-        delete gc;
+        //Graph-cut on all the directions
+        if (!computed) {
+            internal::computeGraphCut(mesh, ffAdj, targetLabels, dataSigma, detailMultiplier, compactness, fixExtremes, dynamicGraphCut, graphCutMemoryBudget, data, association);
+        }
 
         //Set non-visible faces for association
         associationNonVisibleFaces = nonVisibleFaces;
 
         //The remaining directions are the new target directions
-        std::vector<bool> usedDirections(directions.size(), false);
-        for (unsigned int fId = 0; fId < nFaces; fId++){
-            usedDirections[association[fId]] = true;
-        }
-        //Set target directions
-        for (unsigned int lId = 0; lId < directions.size(); ++lId) {
-            if (usedDirections[lId]) {
-                targetDirections.push_back(lId);
+        internal::updateTargetDirections(nFaces, data);
+    }
+    catch (GCException e) {
+        std::cerr << "\n\n!!!GRAPH-CUT EXCEPTION!!!\nCheck logfile\n\n" << std::endl;
+        e.Report();
+    }
+}
+
+/**
+ * @brief Associate the faces of a band to a direction using a graph-cut,
+ * keeping the association of the other faces fixed. The graph-cut is computed
+ * only on the faces of the band: their data cost is the only one computed, the
+ * smooth cost towards the adjacent fixed faces is added to it, and the swap
+ * starts from the current association.
+ * It is used to update the association around a local edit of the mesh.
+ * @param[in] Input mesh
+ * @param[in] dataSigma Sigma of the gaussian function for calculating data term
+ * @param[in] compactness Compactness
+ * @param[in] fixExtremes Fix extremes on the given directions
+ * @param[in] bandFaces Faces to be associated
+ * @param[out] data Four axis fabrication data, with the association of all the faces
+ */
+void getAssociationInBand(
+        const cg3::EigenMesh& mesh,
+        const double dataSigma,
+        const double detailMultiplier,
+        const double compactness,
+        const bool fixExtremes,
+        const std::vector<unsigned int>& bandFaces,
+        Data& data)
+{
+    const std::vector<cg3::Vec3d>& directions = data.directions;
+    std::vector<int>& association = data.association;
+
+    const unsigned int nFaces = mesh.numberFaces();
+    const unsigned int nLabels = directions.size();
+    const unsigned int nBandFaces = bandFaces.size();
+
+    //All the directions are target labels
+    std::vector<unsigned int> targetLabels(nLabels);
+    for (size_t i = 0; i < targetLabels.size(); i++)
+        targetLabels[i] = i;
+
+    //Position of the faces in the band, -1 for the fixed faces
+    std::vector<int> bandPosition(nFaces, -1);
+    for (unsigned int i = 0; i < nBandFaces; i++) {
+        bandPosition[bandFaces[i]] = static_cast<int>(i);
+    }
+
+    //Get mesh adjacencies
+    std::vector<std::vector<int>> ffAdj = cg3::libigl::faceToFaceAdjacencies(mesh);
+
+    try {
+        if (nBandFaces > 0) {
+            MetricsZone dataCostZone("Data cost");
+
+            //Extremes fixed on the +x and -x
+            std::vector<bool> isExtreme(nFaces, false);
+            if (fixExtremes) {
+                for (const unsigned int fId : data.minExtremes)
+                    isExtreme[fId] = true;
+                for (const unsigned int fId : data.maxExtremes)
+                    isExtreme[fId] = true;
             }
-        }
 
-        int minLabel = targetDirections[targetDirections.size()-2];
-        int maxLabel = targetDirections[targetDirections.size()-1];
-        minExtremes.clear();
-        maxExtremes.clear();
-        for (size_t fId = 0; fId < nFaces; fId++) {
-            if (association[fId] == minLabel)
-                minExtremes.push_back(fId);
-            else if (association[fId] == maxLabel)
-                maxExtremes.push_back(fId);
+            internal::SmoothData smoothData = {mesh, data.faceSaliency, detailMultiplier, compactness};
+            internal::BandSmoothData bandSmoothData = {&smoothData, &bandFaces};
+
+            //Data cost of the band, plus the smooth cost towards the fixed faces
+            std::vector<float> bandDataCost(nBandFaces * nLabels);
+            #pragma omp parallel for
+            for (int i = 0; i < static_cast<int>(nBandFaces); i++) {
+                const unsigned int fId = bandFaces[i];
+
+                internal::setupFaceDataCost(mesh, fId, targetLabels, dataSigma, isExtreme[fId], data, &bandDataCost[i * nLabels]);
+
+                for (const int adjId : ffAdj[fId]) {
+                    if (bandPosition[adjId] < 0) {
+                        for (unsigned int label = 0; label < nLabels; ++label) {
+                            bandDataCost[i * nLabels + label] +=
+                                    internal::getSmoothTerm(fId, adjId, label, association[adjId], (void*) &smoothData);
+                        }
+                    }
+                }
+            }
+            dataCostZone.stop();
+
+            MetricsZone graphCutZone("Graph-cut");
+
+            GCoptimizationGeneralGraph* gc = new GCoptimizationGeneralGraph(nBandFaces, nLabels);
+
+            gc->setDataCost(bandDataCost.data());
+            gc->setSmoothCost(internal::getBandSmoothTerm, (void*) &bandSmoothData);
+
+            //Set adjacencies inside the band
+            for (unsigned int i = 0; i < nBandFaces; i++) {
+                for (const int adjId : ffAdj[bandFaces[i]]) {
+                    if (bandPosition[adjId] > static_cast<int>(i))
+                        gc->setNeighbors(i, bandPosition[adjId]);
+                }
+            }
+
+            //Start from the current association
+            for (unsigned int i = 0; i < nBandFaces; i++) {
+                gc->setLabel(i, association[bandFaces[i]]);
+            }
+
+            //Compute graph cut
+            gc->swap(-1);
+
+            //Set associations
+            for (unsigned int i = 0; i < nBandFaces; i++) {
+                association[bandFaces[i]] = gc->whatLabel(i);
+            }
+
+            delete gc;
         }
+
+        //Set non-visible faces for association
+        data.associationNonVisibleFaces = data.nonVisibleFaces;
+
+        //The remaining directions are the new target directions
+        internal::updateTargetDirections(nFaces, data);
     }
     catch (GCException e) {
         std::cerr << "\n\n!!!GRAPH-CUT EXCEPTION!!!\nCheck logfile\n\n" << std::endl;
@@ -166,6 +305,257 @@ void getAssociation(
 
 namespace internal {
 
+/**
+ * @brief Preselect the directions for the graph-cut: a greedy weighted set cover
+ * of the visible faces, where each face is weighted by the alignment of its normal
+ * with the direction. The min and max extremes directions are always selected,
+ * and for each selected direction the adjacent ones are added as slack.
+ * The gains are evaluated lazily, since they can only decrease.
+ * @param[in] mesh Input mesh
+ * @param[in] preselectionSlack Number of adjacent directions added on each side
+ * @param[in] data Four axis fabrication data
+ * @param[out] targetLabels Preselected directions, with the extremes as last ones
+ * @returns True if the preselected directions cover all the visible faces
+ */
+bool preselectLabels(
+        const cg3::EigenMesh& mesh,
+        const unsigned int preselectionSlack,
+        const Data& data,
+        std::vector<unsigned int>& targetLabels)
+{
+    const std::vector<cg3::Vec3d>& directions = data.directions;
+    const cg3::Array2D<int>& visibility = data.visibility;
+
+    const int nFaces = static_cast<int>(mesh.numberFaces());
+    const unsigned int nDirections = static_cast<unsigned int>(directions.size() - 2);
+    const unsigned int minIndex = nDirections;
+    const unsigned int maxIndex = nDirections + 1;
+
+    //Faces covered by the extremes
+    std::vector<char> isCovered(nFaces, false);
+    #pragma omp parallel for
+    for (int fId = 0; fId < nFaces; fId++) {
+        isCovered[fId] = visibility(minIndex, fId) == 1 || visibility(maxIndex, fId) == 1;
+    }
+
+    std::vector<bool> isSelected(nDirections, false);
+
+    //Max-heap of the (possibly outdated) gains
+    std::priority_queue<std::pair<double, unsigned int>> gains;
+    for (unsigned int dId = 0; dId < nDirections; dId++) {
+        gains.push(std::make_pair(std::numeric_limits<double>::max(), dId));
+    }
+
+    while (!gains.empty()) {
+        const unsigned int dId = gains.top().second;
+        gains.pop();
+
+        //Updated gain of the direction
+        double gain = 0;
+        #pragma omp parallel for reduction(+:gain)
+        for (int fId = 0; fId < nFaces; fId++) {
+            if (!isCovered[fId] && visibility(dId, fId) == 1) {
+                gain += std::max(0.0, mesh.faceNormal(fId).dot(directions[dId]));
+            }
+        }
+
+        if (gain <= 0)
+            continue;
+
+        //Select the direction if its gain is still the best one
+        if (gains.empty() || gain >= gains.top().first) {
+            isSelected[dId] = true;
+
+            for (int fId = 0; fId < nFaces; fId++) {
+                if (visibility(dId, fId) == 1) {
+                    isCovered[fId] = true;
+                }
+            }
+        }
+        else {
+            gains.push(std::make_pair(gain, dId));
+        }
+    }
+
+    //Check the coverage of the visible faces
+    for (int fId = 0; fId < nFaces; fId++) {
+        if (!isCovered[fId]) {
+            for (unsigned int dId = 0; dId < nDirections; dId++) {
+                if (visibility(dId, fId) == 1) {
+                    return false;
+                }
+            }
+        }
+    }
+
+    //Slack directions
+    std::vector<bool> isTarget = isSelected;
+    for (unsigned int dId = 0; dId < nDirections; dId++) {
+        if (isSelected[dId]) {
+            for (unsigned int k = 1; k <= preselectionSlack; k++) {
+                isTarget[(dId + k) % nDirections] = true;
+                isTarget[(dId + nDirections - (k % nDirections)) % nDirections] = true;
+            }
+        }
+    }
+
+    targetLabels.clear();
+    for (unsigned int dId = 0; dId < nDirections; dId++) {
+        if (isTarget[dId]) {
+            targetLabels.push_back(dId);
+        }
+    }
+    targetLabels.push_back(minIndex);
+    targetLabels.push_back(maxIndex);
+
+    return true;
+}
+
+/**
+ * @brief Compute the graph-cut on a set of directions
+ * @param[in] mesh Input mesh
+ * @param[in] ffAdj Face-face adjacencies of the mesh
+ * @param[in] targetLabels Directions used as labels, with the extremes as last ones
+ * @param[in] dataSigma Sigma of the gaussian function for calculating data term
+ * @param[in] detailMultiplier Multiplier of the saliency in the smooth term
+ * @param[in] compactness Compactness
+ * @param[in] fixExtremes Fix extremes on the given directions
+ * @param[in] dynamicGraphCut Use the dynamic graph-cut instead of the GCO swap
+ * @param[in] graphCutMemoryBudget Max bytes of the graphs kept by the dynamic graph-cut (0 for no limit)
+ * @param[in] data Four axis fabrication data
+ * @param[out] association Direction associated to each face
+ */
+void computeGraphCut(
+        const cg3::EigenMesh& mesh,
+        const std::vector<std::vector<int>>& ffAdj,
+        const std::vector<unsigned int>& targetLabels,
+        const double dataSigma,
+        const double detailMultiplier,
+        const double compactness,
+        const bool fixExtremes,
+        const bool dynamicGraphCut,
+        const size_t graphCutMemoryBudget,
+        Data& data,
+        std::vector<int>& association)
+{
+    const unsigned int nFaces = mesh.numberFaces();
+    const unsigned int nLabels = targetLabels.size();
+
+    //Creating cost data arrays
+    MetricsZone dataCostZone("Data cost");
+    std::vector<float> dataCost(nFaces * nLabels);
+    //Get the costs
+    setupDataCost(mesh, targetLabels, dataSigma, fixExtremes, data, dataCost);
+    dataCostZone.stop();
+
+    MetricsZone graphCutZone("Graph-cut");
+
+    SmoothData smoothData = {mesh, data.faceSaliency, detailMultiplier, compactness};
+
+    //Dynamic graph-cut
+    if (dynamicGraphCut) {
+        std::vector<int> labeling;
+        dynamicAlphaBetaSwap(ffAdj, nLabels, dataCost, getSmoothTerm, (void*) &smoothData, graphCutMemoryBudget, labeling);
+
+        //Set associations
+        for (unsigned int fId = 0; fId < nFaces; fId++){
+            association[fId] = targetLabels[labeling[fId]];
+        }
+
+        return;
+    }
+
+    GCoptimizationGeneralGraph* gc = new GCoptimizationGeneralGraph(nFaces, nLabels);
+
+    gc->setDataCost(dataCost.data());
+    //Set smooth cost
+    gc->setSmoothCost(getSmoothTerm, (void*) &smoothData);
+
+    //Set adjacencies
+    std::vector<bool> visited(nFaces, false);
+    for (unsigned int f = 0; f < nFaces; f++) {
+        visited[f] = true;
+        for (int i = 0; i < 3; ++i) {
+            int nid = ffAdj[f][i];
+            if (!visited[nid])
+                gc->setNeighbors(f, nid);
+        }
+    }
+
+    //Compute graph cut
+    gc->swap(-1); // -1 => run until convergence [convergence is guaranteed]
+
+    //Set associations
+    for (unsigned int fId = 0; fId < nFaces; fId++){
+        int associatedDirectionIndex = gc->whatLabel(fId);
+
+        association[fId] = targetLabels[associatedDirectionIndex];
+    }
+
+    //Delete data
+    delete gc;
+}
+
+/**
+ * @brief Count the faces associated to a direction from which they are not visible
+ * @param[in] association Direction associated to each face
+ * @param[in] data Four axis fabrication data
+ * @returns Number of non-visible associated faces
+ */
+unsigned int countNonVisibleAssignedFaces(
+        const std::vector<int>& association,
+        const Data& data)
+{
+    unsigned int count = 0;
+    for (size_t fId = 0; fId < association.size(); fId++) {
+        if (data.visibility(association[fId], fId) != 1) {
+            count++;
+        }
+    }
+    return count;
+}
+
+/**
+ * @brief Set the target directions as the directions used by the association
+ * (the extremes directions are the last ones), and the min and max extremes
+ * as the faces associated to them
+ * @param[in] nFaces Number of faces of the mesh
+ * @param[out] data Four axis fabrication data
+ */
+void updateTargetDirections(
+        const unsigned int nFaces,
+        Data& data)
+{
+    const std::vector<cg3::Vec3d>& directions = data.directions;
+    const std::vector<int>& association = data.association;
+    std::vector<unsigned int>& targetDirections = data.targetDirections;
+    std::vector<unsigned int>& minExtremes = data.minExtremes;
+    std::vector<unsigned int>& maxExtremes = data.maxExtremes;
+
+    std::vector<bool> usedDirections(directions.size(), false);
+    for (unsigned int fId = 0; fId < nFaces; fId++){
+        usedDirections[association[fId]] = true;
+    }
+    //Set target directions
+    targetDirections.clear();
+    for (unsigned int lId = 0; lId < directions.size(); ++lId) {
+        if (usedDirections[lId]) {
+            targetDirections.push_back(lId);
+        }
+    }
+
+    int minLabel = targetDirections[targetDirections.size()-2];
+    int maxLabel = targetDirections[targetDirections.size()-1];
+    minExtremes.clear();
+    maxExtremes.clear();
+    for (size_t fId = 0; fId < nFaces; fId++) {
+        if (association[fId] == minLabel)
+            minExtremes.push_back(fId);
+        else if (association[fId] == maxLabel)
+            maxExtremes.push_back(fId);
+    }
+}
+
 /**
  * @brief Setup data cost
  * @param[in] Input mesh
@@ -183,8 +573,6 @@ void setupDataCost(
         const Data& data,
         std::vector<float>& dataCost)
 {
-    const std::vector<cg3::Vec3d>& directions = data.directions;
-    const cg3::Array2D<int>& visibility = data.visibility;
     const std::vector<unsigned int>& minExtremes = data.minExtremes;
     const std::vector<unsigned int>& maxExtremes = data.maxExtremes;
 
@@ -250,26 +638,7 @@ void setupDataCost(
 
     #pragma omp parallel for
     for (unsigned int faceId = 0; faceId < nFaces; faceId++){
-        for (unsigned int label = 0; label < nLabels; ++label) {
-            const unsigned int& directionIndex = targetLabels[label];
-            const cg3::Vec3d& labelNormal = directions[directionIndex];
-
-            double cost;
-
-            const cg3::Vec3d faceNormal = mesh.faceNormal(faceId);
-            double dot = faceNormal.dot(labelNormal);
-
-            //Visible
-            if (visibility(directionIndex, faceId) == 1) {
-                cost = pow(1.f - dot, dataSigma);
-            }
-            //Not visibile
-            else {
-                cost = MAXCOST;
-            }
-
-            dataCost[faceId * nLabels + label] = cost;
-        }
+        setupFaceDataCost(mesh, faceId, targetLabels, dataSigma, false, data, &dataCost[faceId * nLabels]);
     }
 
     //Fix extremes on the +x and -x
@@ -291,6 +660,58 @@ void setupDataCost(
     }
 }
 
+/**
+ * @brief Setup the data cost of a face
+ * @param[in] Input mesh
+ * @param[in] faceId Id of the face
+ * @param[in] targetLabel Target labels
+ * @param[in] dataSigma Sigma of the gaussian function for calculating data term
+ * @param[in] isFixedExtreme Fix the face on the extremes directions (the last two labels)
+ * @param[in] data Four axis fabrication data
+ * @param[out] faceDataCost Data cost of the face for each label
+ */
+void setupFaceDataCost(
+        const cg3::EigenMesh& mesh,
+        const unsigned int faceId,
+        const std::vector<unsigned int>& targetLabels,
+        const double dataSigma,
+        const bool isFixedExtreme,
+        const Data& data,
+        float* faceDataCost)
+{
+    const std::vector<cg3::Vec3d>& directions = data.directions;
+    const cg3::Array2D<int>& visibility = data.visibility;
+
+    const unsigned int nLabels = targetLabels.size();
+
+    const cg3::Vec3d faceNormal = mesh.faceNormal(faceId);
+
+    for (unsigned int label = 0; label < nLabels; ++label) {
+        const unsigned int& directionIndex = targetLabels[label];
+        const cg3::Vec3d& labelNormal = directions[directionIndex];
+
+        double cost;
+
+        double dot = faceNormal.dot(labelNormal);
+
+        //Visible
+        if (visibility(directionIndex, faceId) == 1) {
+            cost = pow(1.f - dot, dataSigma);
+        }
+        //Not visibile
+        else {
+            cost = MAXCOST;
+        }
+
+        //Fix extremes on the +x and -x
+        if (isFixedExtreme && label < nLabels-2) {
+            cost = MAXCOST;
+        }
+
+        faceDataCost[label] = cost;
+    }
+}
+
 ///**
 // * @brief Setup smooth cost
 // * @param[in] targetLabel Target labels
@@ -388,6 +809,18 @@ float getSmoothTerm(
 //    float smoothTerm = compactness + (directionCost * detailMultiplier);
 }
 
+float getBandSmoothTerm(
+        int s1, int s2,
+        int l1, int l2,
+        void *extra_data)
+{
+    BandSmoothData* bandSmoothData = (BandSmoothData*) extra_data;
+    const std::vector<unsigned int>& bandFaces = *bandSmoothData->bandFaces;
+
+    //Sites of the graph-cut are the positions of the faces in the band
+    return getSmoothTerm(bandFaces[s1], bandFaces[s2], l1, l2, (void*) bandSmoothData->smoothData);
+}
+
 }
 
 } //namespace cg3
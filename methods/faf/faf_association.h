@@ -19,8 +19,20 @@ void getAssociation(
         const double smoothSigma,
         const double compactness,
         const bool fixExtremes,
+        const bool labelPreselection,
+        const unsigned int preselectionSlack,
+        const bool dynamicGraphCut,
+        const size_t graphCutMemoryBudget,
         Data& data);
 
+void getAssociationInBand(
+        const cg3::EigenMesh& mesh,
+        const double dataSigma,
+        const double detailMultiplier,
+        const double compactness,
+        const bool fixExtremes,
+        const std::vector<unsigned int>& bandFaces,
+        Data& data);
 
 }
 
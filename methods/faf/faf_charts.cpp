@@ -5,6 +5,7 @@
 #include <cg3/libigl/mesh_adjacencies.h>
 
 #include <cg3/meshes/dcel/dcel.h>
+#include "faf_metrics.h"
 
 #include <unordered_map>
 #include <unordered_set>
@@ -46,6 +47,8 @@ ChartData getChartData(
     typedef cg3::Dcel::HalfEdge HalfEdge;
     typedef cg3::Dcel::Vertex Vertex;
 
+    MetricsZone zone("Chart data");
+
     //Create Dcel from mesh used for navigation
     Dcel dcel(targetMesh);
 
@@ -47,6 +47,8 @@ void Data::clear() {
     visibility.clear();
 
     nonVisibleFaces.clear();
+    occluders.clear();
+    visibilityMargins.clear();
 
     targetDirections.clear();
 
@@ -74,6 +76,10 @@ void Data::clear() {
     results.clear();
     resultsAssociation.clear();
 
+    chartSurfaces.clear();
+    chartBoxes.clear();
+    chartBoxesAssociation.clear();
+
     minSupport.clear();
     maxSupport.clear();
 }
@@ -184,6 +190,12 @@ void Data::deserialize(std::ifstream &binaryFile)
                 resultsAssociation,
                 minSupport,
                 maxSupport);
+
+    //Occluders and boxes of the charts are not serialized
+    occluders.clear();
+    chartSurfaces.clear();
+    chartBoxes.clear();
+    chartBoxesAssociation.clear();
 }
 
 }
@@ -6,6 +6,7 @@
 #define FAF_DATA_H
 
 #include <vector>
+#include <utility>
 
 #include <cg3/data_structures/arrays/array2d.h>
 
@@ -21,6 +22,10 @@ namespace FourAxisFabrication {
 
 enum CheckMode { PROJECTION, RAYSHOOTING, OPENGL };
 
+/* Occluders from a direction: pairs of non-visible face and first face found occluding it, sorted by face */
+
+typedef std::vector<std::pair<unsigned int, unsigned int>> OccluderList;
+
 
 
 /* Data for four axis fabrication */
@@ -73,6 +78,12 @@ public:
 
     cg3::Array2D<int> visibility;
     std::vector<unsigned int> nonVisibleFaces;
+    std::vector<OccluderList> occluders;
+
+    /* Visibility margins: quantized dot product between the normal and the direction
+     * of the visible faces, to derive the visibility for a stricter heightfield angle */
+
+    cg3::Array2D<signed char> visibilityMargins;
 
     /* Target directions */
 
@@ -111,6 +122,13 @@ public:
     std::vector<cg3::EigenMesh> results;
     std::vector<unsigned int> resultsAssociation;
 
+    /* Boxes of the charts before the union with the component, and the surfaces of the
+     * charts they have been built on (kept for the incremental extraction, not serialized) */
+
+    std::vector<cg3::EigenMesh> chartSurfaces;
+    std::vector<cg3::EigenMesh> chartBoxes;
+    std::vector<unsigned int> chartBoxesAssociation;
+
 
     /* Supports */
 
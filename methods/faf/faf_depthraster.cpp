@@ -0,0 +1,198 @@
+#include "faf_depthraster.h"
+
+#include "faf_various.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <fstream>
+#include <iomanip>
+#include <limits>
+
+#define DEPTHRASTER_TILE_SIZE 64
+
+namespace FourAxisFabrication {
+
+namespace internal {
+
+bool isLittleEndian();
+
+}
+
+
+/* ----- DEPTH RASTERS ----- */
+
+/**
+ * @brief Compute, for each target direction, the depth raster of the results
+ * associated to it: the heightmap in the frame in which the direction is the
+ * z-axis, sampled on the extents of the stock (as in the material removal simulation).
+ * The cells which are not covered by the results have -infinity depth.
+ * The rows of each raster are rasterized in parallel.
+ * @param[in] data Four axis fabrication data
+ * @param[in] stockLength Length of the stock
+ * @param[in] stockDiameter Diameter of the stock
+ * @param[in] cellSize Size of the raster cells
+ * @param[in] resultsRotated True if the results have been rotated in the frame of their direction
+ * @param[out] rasters Depth raster of each target direction
+ */
+void computeDepthRasters(
+        const Data& data,
+        const double stockLength,
+        const double stockDiameter,
+        const double cellSize,
+        const bool resultsRotated,
+        std::vector<DepthRaster>& rasters)
+{
+    const double radius = stockDiameter / 2;
+    const double halfLength = stockLength / 2;
+
+    rasters.clear();
+    rasters.resize(data.targetDirections.size());
+
+    for (size_t i = 0; i < data.targetDirections.size(); i++) {
+        DepthRaster& raster = rasters[i];
+        raster.directionIndex = data.targetDirections[i];
+        getDirectionRotationMatrix(data, raster.directionIndex, raster.rotationMatrix);
+
+        //Extents of the stock in the frame of the direction
+        double minX = std::numeric_limits<double>::max(), maxX = -std::numeric_limits<double>::max();
+        double minY = std::numeric_limits<double>::max(), maxY = -std::numeric_limits<double>::max();
+        for (unsigned int c = 0; c < 8; c++) {
+            const Eigen::Vector3d corner(
+                        c & 1 ? halfLength : -halfLength,
+                        c & 2 ? radius : -radius,
+                        c & 4 ? radius : -radius);
+            const Eigen::Vector3d rotatedCorner = raster.rotationMatrix * corner;
+            minX = std::min(minX, rotatedCorner.x());
+            maxX = std::max(maxX, rotatedCorner.x());
+            minY = std::min(minY, rotatedCorner.y());
+            maxY = std::max(maxY, rotatedCorner.y());
+        }
+
+        const unsigned int sizeX = static_cast<unsigned int>(std::ceil((maxX - minX) / cellSize));
+        const unsigned int sizeY = static_cast<unsigned int>(std::ceil((maxY - minY) / cellSize));
+
+        Heightmap& heightmap = raster.heightmap;
+        heightmap.minX = minX;
+        heightmap.minY = minY;
+        heightmap.cellSize = cellSize;
+        heightmap.sizeX = sizeX;
+        heightmap.sizeY = sizeY;
+        heightmap.heights.assign(static_cast<size_t>(sizeX) * sizeY, -std::numeric_limits<float>::infinity());
+
+        //Max depth of the results associated to the direction
+        for (size_t rId = 0; rId < data.results.size(); rId++) {
+            if (data.resultsAssociation[rId] != raster.directionIndex)
+                continue;
+
+            Heightmap resultHeightmap;
+            computeHeightmap(
+                        data.results[rId],
+                        resultsRotated ? Eigen::Matrix3d::Identity() : raster.rotationMatrix,
+                        minX, minY, cellSize, sizeX, sizeY,
+                        resultHeightmap);
+
+            for (size_t k = 0; k < heightmap.heights.size(); k++) {
+                heightmap.heights[k] = std::max(heightmap.heights[k], resultHeightmap.heights[k]);
+            }
+        }
+    }
+}
+
+/**
+ * @brief Save a depth raster: a binary file of float32 depths split in square
+ * tiles (row-major tiles, row-major cells in each tile, the tiles on the border
+ * are padded with -infinity), and a JSON header with the grid and the frame transform.
+ * @param[in] raster Depth raster
+ * @param[in] binaryFilename Name of the binary file
+ * @param[in] headerFilename Name of the JSON header
+ * @returns True if the files have been saved
+ */
+bool saveDepthRaster(
+        const DepthRaster& raster,
+        const std::string& binaryFilename,
+        const std::string& headerFilename)
+{
+    const Heightmap& heightmap = raster.heightmap;
+
+    const unsigned int tileSize = DEPTHRASTER_TILE_SIZE;
+    const unsigned int nTilesX = (heightmap.sizeX + tileSize - 1) / tileSize;
+    const unsigned int nTilesY = (heightmap.sizeY + tileSize - 1) / tileSize;
+
+    std::ofstream binaryFile(binaryFilename, std::ios::out | std::ios::binary);
+    if (!binaryFile.is_open())
+        return false;
+
+    std::vector<float> tile(static_cast<size_t>(tileSize) * tileSize);
+    for (unsigned int tileY = 0; tileY < nTilesY; tileY++) {
+        for (unsigned int tileX = 0; tileX < nTilesX; tileX++) {
+            std::fill(tile.begin(), tile.end(), -std::numeric_limits<float>::infinity());
+
+            for (unsigned int j = 0; j < tileSize && tileY * tileSize + j < heightmap.sizeY; j++) {
+                for (unsigned int i = 0; i < tileSize && tileX * tileSize + i < heightmap.sizeX; i++) {
+                    tile[j * tileSize + i] = heightmap.height(tileX * tileSize + i, tileY * tileSize + j);
+                }
+            }
+
+            binaryFile.write(reinterpret_cast<const char*>(tile.data()), tile.size() * sizeof(float));
+        }
+    }
+
+    binaryFile.close();
+    if (binaryFile.fail())
+        return false;
+
+    std::ofstream headerFile(headerFilename);
+    if (!headerFile.is_open())
+        return false;
+
+    const Eigen::Matrix3d& r = raster.rotationMatrix;
+
+    //Binary file name relative to the header
+    const std::string::size_type separator = binaryFilename.find_last_of("/\\");
+    const std::string binaryName = separator == std::string::npos ? binaryFilename : binaryFilename.substr(separator + 1);
+
+    headerFile << std::setprecision(17);
+    headerFile << "{\n";
+    headerFile << "    \"data\": \"" << binaryName << "\",\n";
+    headerFile << "    \"type\": \"float32\",\n";
+    headerFile << "    \"byteOrder\": \"" << (internal::isLittleEndian() ? "little" : "big") << "\",\n";
+    headerFile << "    \"emptyValue\": \"-inf\",\n";
+    headerFile << "    \"direction\": " << raster.directionIndex << ",\n";
+    headerFile << "    \"rotation\": [["
+               << r(0,0) << ", " << r(0,1) << ", " << r(0,2) << "], ["
+               << r(1,0) << ", " << r(1,1) << ", " << r(1,2) << "], ["
+               << r(2,0) << ", " << r(2,1) << ", " << r(2,2) << "]],\n";
+    headerFile << "    \"minX\": " << heightmap.minX << ",\n";
+    headerFile << "    \"minY\": " << heightmap.minY << ",\n";
+    headerFile << "    \"cellSize\": " << heightmap.cellSize << ",\n";
+    headerFile << "    \"sizeX\": " << heightmap.sizeX << ",\n";
+    headerFile << "    \"sizeY\": " << heightmap.sizeY << ",\n";
+    headerFile << "    \"tileSize\": " << tileSize << ",\n";
+    headerFile << "    \"tilesX\": " << nTilesX << ",\n";
+    headerFile << "    \"tilesY\": " << nTilesY << "\n";
+    headerFile << "}\n";
+
+    headerFile.close();
+    return !headerFile.fail();
+}
+
+
+
+/* ----- INTERNAL FUNCTION DEFINITION ----- */
+
+namespace internal {
+
+/**
+ * @brief Check the byte order of the machine
+ * @returns True if the machine is little endian
+ */
+bool isLittleEndian()
+{
+    const uint16_t value = 1;
+    return *reinterpret_cast<const unsigned char*>(&value) == 1;
+}
+
+}
+
+}
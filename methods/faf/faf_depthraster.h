@@ -0,0 +1,37 @@
+#ifndef FAF_DEPTHRASTER_H
+#define FAF_DEPTHRASTER_H
+
+#include <vector>
+#include <string>
+
+#include <Eigen/Core>
+
+#include "faf_data.h"
+#include "faf_heightmap.h"
+
+namespace FourAxisFabrication {
+
+/* Depth raster of the results from a target direction */
+
+struct DepthRaster {
+    unsigned int directionIndex;
+    Eigen::Matrix3d rotationMatrix;
+    Heightmap heightmap;
+};
+
+void computeDepthRasters(
+        const Data& data,
+        const double stockLength,
+        const double stockDiameter,
+        const double cellSize,
+        const bool resultsRotated,
+        std::vector<DepthRaster>& rasters);
+
+bool saveDepthRaster(
+        const DepthRaster& raster,
+        const std::string& binaryFilename,
+        const std::string& headerFilename);
+
+}
+
+#endif // FAF_DEPTHRASTER_H
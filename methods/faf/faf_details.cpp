@@ -1,5 +1,10 @@
 #include "faf_details.h"
 
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <stdexcept>
+
 #include <cg3/algorithms/mesh_function_smoothing.h>
 #include <cg3/algorithms/laplacian_smoothing.h>
 
@@ -77,4 +82,105 @@ void findDetails(
     }
 }
 
+/**
+ * @brief Cheap alternative to the multi-scale saliency. The detail of each vertex
+ * is estimated from the displacement between the mesh and the smoothed mesh along
+ * the smoothed normal, and from a single-scale mean curvature (uniform laplacian).
+ * Both quantities are computed in a single parallel pass over the vertices, then
+ * normalized in [0,1] and blended.
+ * The smoothed mesh must be already computed and must have the same vertices of the mesh.
+ * @param[out] data Four axis fabrication data
+ * @param[in] displacementWeight Weight of the displacement term (the curvature term
+ * has weight 1 - displacementWeight)
+ * @param[in] normalizationPercentile Percentile of the values used for normalization,
+ * higher values are clamped to 1
+ */
+void findDetailsByCurvature(
+        Data& data,
+        const double displacementWeight,
+        const double normalizationPercentile)
+{
+    const cg3::EigenMesh& mesh = data.mesh;
+    cg3::EigenMesh& smoothedMesh = data.smoothedMesh;
+
+    if (smoothedMesh.numberVertices() != mesh.numberVertices()) {
+        throw std::runtime_error("Error: curvature details need the smoothed mesh to be computed.");
+    }
+
+    data.faceSaliency.clear();
+    data.faceSaliency.resize(mesh.numberFaces(), 0.0);
+    data.saliency.clear();
+    data.saliency.resize(mesh.numberVertices(), 0.0);
+
+    if (mesh.numberVertices() == 0)
+        return;
+
+    smoothedMesh.updateFacesAndVerticesNormals();
+
+    //Compute vertex-vertex adjacencies
+    const std::vector<std::vector<int>> vvAdj = cg3::libigl::vertexToVertexAdjacencies(mesh);
+
+    const int nVertices = static_cast<int>(mesh.numberVertices());
+
+    std::vector<double> displacement(nVertices, 0.0);
+    std::vector<double> curvature(nVertices, 0.0);
+
+    //Single pass: normal displacement and mean curvature
+    #pragma omp parallel for
+    for (int vId = 0; vId < nVertices; vId++) {
+        const cg3::Point3d& p = mesh.vertex(vId);
+        const cg3::Vec3d& normal = smoothedMesh.vertexNormal(vId);
+
+        displacement[vId] = std::fabs((p - smoothedMesh.vertex(vId)).dot(normal));
+
+        const std::vector<int>& adj = vvAdj[vId];
+        if (adj.empty())
+            continue;
+
+        cg3::Point3d centroid(0,0,0);
+        double squaredEdgeLength = 0.0;
+        for (const int& adjId : adj) {
+            const cg3::Point3d& q = mesh.vertex(adjId);
+            centroid += q;
+            squaredEdgeLength += (q - p).dot(q - p);
+        }
+        centroid /= adj.size();
+        squaredEdgeLength /= adj.size();
+
+        //Uniform laplacian along the normal: |L.n| ~ e^2 * H / 2
+        if (squaredEdgeLength > std::numeric_limits<double>::epsilon()) {
+            curvature[vId] = 2.0 * std::fabs((centroid - p).dot(normal)) / squaredEdgeLength;
+        }
+    }
+
+    //Normalization values (robust to outliers)
+    const size_t percentileIndex = std::min(
+                static_cast<size_t>(normalizationPercentile * (nVertices - 1)),
+                static_cast<size_t>(nVertices - 1));
+
+    std::vector<double> sortedValues = displacement;
+    std::nth_element(sortedValues.begin(), sortedValues.begin() + percentileIndex, sortedValues.end());
+    const double maxDisplacement = sortedValues[percentileIndex];
+
+    sortedValues = curvature;
+    std::nth_element(sortedValues.begin(), sortedValues.begin() + percentileIndex, sortedValues.end());
+    const double maxCurvature = sortedValues[percentileIndex];
+
+    #pragma omp parallel for
+    for (int vId = 0; vId < nVertices; vId++) {
+        double d = maxDisplacement > 0 ? std::min(displacement[vId] / maxDisplacement, 1.0) : 0.0;
+        double c = maxCurvature > 0 ? std::min(curvature[vId] / maxCurvature, 1.0) : 0.0;
+
+        data.saliency[vId] = displacementWeight * d + (1.0 - displacementWeight) * c;
+    }
+
+    for (size_t fId = 0; fId < mesh.numberFaces(); fId++) {
+        data.faceSaliency[fId] = (
+            data.saliency[mesh.face(fId).x()] +
+            data.saliency[mesh.face(fId).y()] +
+            data.saliency[mesh.face(fId).z()]
+        ) / 3;
+    }
+}
+
 }
@@ -18,6 +18,11 @@ void findDetails(
         const double maxSmoothingIterations = 5,
         const double laplacianSmoothingIterations = 20);
 
+void findDetailsByCurvature(
+        Data& data,
+        const double displacementWeight = 0.5,
+        const double normalizationPercentile = 0.99);
+
 }
 
 
@@ -0,0 +1,488 @@
+#include "faf_dynamicgraphcut.h"
+
+#include "faf_maxflow.h"
+
+#include <memory>
+#include <algorithm>
+#include <limits>
+#include <iostream>
+
+#define DYNAMIC_GRAPHCUT_EPSILON 1e-6
+
+namespace FourAxisFabrication {
+
+namespace internal {
+
+struct PairGraph {
+    MaxFlowGraph graph;
+    std::vector<int> nodeFaces;
+    std::vector<double> sourceCaps;
+    std::vector<double> sinkCaps;
+    unsigned long long int lastUse;
+};
+
+struct SwapContext {
+    const std::vector<std::vector<int>>& ffAdj;
+    const unsigned int nLabels;
+    const std::vector<float>& dataCost;
+    SmoothTermFunction smoothTerm;
+    void* smoothData;
+};
+
+void computeUnaryCaps(
+        const SwapContext& context,
+        const int face,
+        const int alpha,
+        const int beta,
+        const std::vector<int>& labeling,
+        double& sourceCap,
+        double& sinkCap);
+
+void buildPairGraph(
+        const SwapContext& context,
+        const int alpha,
+        const int beta,
+        const std::vector<int>& labeling,
+        const std::vector<int>& nodeIndex,
+        PairGraph& pairGraph);
+
+double computeMoveDelta(
+        const SwapContext& context,
+        const std::vector<int>& changedFaces,
+        const std::vector<int>& labeling,
+        const std::vector<int>& proposedLabeling);
+
+double computeEnergy(
+        const SwapContext& context,
+        const std::vector<int>& labeling);
+
+size_t pairGraphMemoryUsage(const PairGraph& pairGraph);
+
+}
+
+
+/* ----- DYNAMIC ALPHA-BETA SWAP ----- */
+
+/**
+ * @brief Alpha-beta swap with dynamic graph cuts. A graph is kept for each
+ * pair of labels: if its nodes (the faces labeled alpha or beta) have not changed
+ * since the last cut, only the terminal capacities are updated, and the max-flow
+ * is computed again reusing the residual flow and the search trees.
+ * A pair is cut again only if one of its labels, or the label of a face adjacent
+ * to them, has changed after its last cut: the unchanged pairs are skipped,
+ * and the optimization ends when no pair has to be cut again.
+ * The least recently used graphs are released when they exceed the memory budget.
+ * @param[in] ffAdj Face-face adjacencies
+ * @param[in] nLabels Number of labels
+ * @param[in] dataCost Data cost of each face for each label (face-major)
+ * @param[in] smoothTerm Smooth term between two adjacent faces
+ * @param[in] smoothData Data passed to the smooth term
+ * @param[in] memoryBudget Max bytes of the stored graphs (0 for no limit)
+ * @param[out] labeling Label of each face. If it has a label for each face
+ * it is used as starting labeling, otherwise the labels of min data cost are used.
+ * @returns Energy of the labeling
+ */
+double dynamicAlphaBetaSwap(
+        const std::vector<std::vector<int>>& ffAdj,
+        const unsigned int nLabels,
+        const std::vector<float>& dataCost,
+        SmoothTermFunction smoothTerm,
+        void* smoothData,
+        const size_t memoryBudget,
+        std::vector<int>& labeling)
+{
+    const unsigned int nFaces = ffAdj.size();
+
+    internal::SwapContext context = {ffAdj, nLabels, dataCost, smoothTerm, smoothData};
+
+    //Starting labeling: min data cost
+    if (labeling.size() != nFaces) {
+        labeling.resize(nFaces);
+        for (unsigned int fId = 0; fId < nFaces; fId++) {
+            const float* faceCost = dataCost.data() + static_cast<size_t>(fId) * nLabels;
+            labeling[fId] = static_cast<int>(std::min_element(faceCost, faceCost + nLabels) - faceCost);
+        }
+    }
+
+    //Faces of each label, and position of each face in its list
+    std::vector<std::vector<int>> labelFaces(nLabels);
+    std::vector<size_t> facePosition(nFaces);
+    for (unsigned int fId = 0; fId < nFaces; fId++) {
+        facePosition[fId] = labelFaces[labeling[fId]].size();
+        labelFaces[labeling[fId]].push_back(fId);
+    }
+
+    //Stamps of the last change of each label and of the last cut of each pair
+    unsigned long long int clock = 1;
+    std::vector<unsigned long long int> labelStamp(nLabels, clock);
+    std::vector<unsigned long long int> pairStamp(nLabels * nLabels, 0);
+
+    std::vector<std::unique_ptr<internal::PairGraph>> pairGraphs(nLabels * nLabels);
+    size_t storedBytes = 0;
+
+    std::vector<int> nodeIndex(nFaces, -1);
+    std::vector<int> proposedLabeling = labeling;
+    std::vector<int> nodeFaces;
+    std::vector<int> changedFaces;
+
+    unsigned long long int useCounter = 0;
+    unsigned int nCycles = 0;
+    unsigned int nCuts = 0;
+    unsigned int nReusedCuts = 0;
+    unsigned int nSkippedPairs = 0;
+
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        nCycles++;
+
+        for (unsigned int alpha = 0; alpha < nLabels; alpha++) {
+            for (unsigned int beta = alpha + 1; beta < nLabels; beta++) {
+                const unsigned int pairId = alpha * nLabels + beta;
+
+                //Nothing has changed since the last cut
+                if (pairStamp[pairId] >= std::max(labelStamp[alpha], labelStamp[beta])) {
+                    nSkippedPairs++;
+                    continue;
+                }
+
+                //Nodes of the pair: faces labeled alpha or beta
+                nodeFaces.clear();
+                nodeFaces.insert(nodeFaces.end(), labelFaces[alpha].begin(), labelFaces[alpha].end());
+                nodeFaces.insert(nodeFaces.end(), labelFaces[beta].begin(), labelFaces[beta].end());
+
+                if (nodeFaces.empty()) {
+                    pairStamp[pairId] = clock;
+                    continue;
+                }
+
+                std::sort(nodeFaces.begin(), nodeFaces.end());
+
+                for (size_t i = 0; i < nodeFaces.size(); i++)
+                    nodeIndex[nodeFaces[i]] = static_cast<int>(i);
+
+                std::unique_ptr<internal::PairGraph>& pairGraph = pairGraphs[pairId];
+                bool reuseTrees = false;
+
+                if (pairGraph && pairGraph->nodeFaces == nodeFaces) {
+                    //Same nodes: update the terminal capacities
+                    reuseTrees = true;
+
+                    for (size_t i = 0; i < nodeFaces.size(); i++) {
+                        double sourceCap, sinkCap;
+                        internal::computeUnaryCaps(context, nodeFaces[i], alpha, beta, labeling, sourceCap, sinkCap);
+
+                        const double deltaSource = sourceCap - pairGraph->sourceCaps[i];
+                        const double deltaSink = sinkCap - pairGraph->sinkCaps[i];
+
+                        if (deltaSource != 0 || deltaSink != 0) {
+                            pairGraph->graph.addTerminalWeights(static_cast<int>(i), deltaSource, deltaSink);
+                            pairGraph->graph.markNode(static_cast<int>(i));
+                            pairGraph->sourceCaps[i] = sourceCap;
+                            pairGraph->sinkCaps[i] = sinkCap;
+                        }
+                    }
+                }
+                else {
+                    //New nodes: build the graph
+                    if (pairGraph) {
+                        storedBytes -= internal::pairGraphMemoryUsage(*pairGraph);
+                    }
+                    else {
+                        pairGraph.reset(new internal::PairGraph());
+                    }
+
+                    pairGraph->nodeFaces.swap(nodeFaces);
+                    internal::buildPairGraph(context, alpha, beta, labeling, nodeIndex, *pairGraph);
+
+                    storedBytes += internal::pairGraphMemoryUsage(*pairGraph);
+                }
+
+                pairGraph->graph.maxflow(reuseTrees);
+                pairGraph->lastUse = ++useCounter;
+
+                nCuts++;
+                if (reuseTrees)
+                    nReusedCuts++;
+
+                //Proposed move: source nodes take alpha, sink nodes take beta
+                const std::vector<int>& pairFaces = pairGraph->nodeFaces;
+                changedFaces.clear();
+                for (size_t i = 0; i < pairFaces.size(); i++) {
+                    const int fId = pairFaces[i];
+                    const int newLabel = pairGraph->graph.segment(static_cast<int>(i)) == MaxFlowGraph::SOURCE ? alpha : beta;
+
+                    if (newLabel != labeling[fId]) {
+                        proposedLabeling[fId] = newLabel;
+                        changedFaces.push_back(fId);
+                    }
+
+                    nodeIndex[fId] = -1;
+                }
+
+                //Accept the move only if it decreases the energy
+                if (!changedFaces.empty() &&
+                        internal::computeMoveDelta(context, changedFaces, labeling, proposedLabeling) < -DYNAMIC_GRAPHCUT_EPSILON)
+                {
+                    clock++;
+                    labelStamp[alpha] = clock;
+                    labelStamp[beta] = clock;
+
+                    for (const int fId : changedFaces) {
+                        //Move the face in the list of its new label
+                        const int oldLabel = labeling[fId];
+                        const int newLabel = proposedLabeling[fId];
+
+                        std::vector<int>& oldFaces = labelFaces[oldLabel];
+                        const int lastFace = oldFaces.back();
+                        oldFaces[facePosition[fId]] = lastFace;
+                        facePosition[lastFace] = facePosition[fId];
+                        oldFaces.pop_back();
+
+                        facePosition[fId] = labelFaces[newLabel].size();
+                        labelFaces[newLabel].push_back(fId);
+
+                        labeling[fId] = newLabel;
+                    }
+
+                    //The labels of the adjacent faces have new neighbors
+                    for (const int fId : changedFaces) {
+                        for (const int adjId : ffAdj[fId]) {
+                            if (adjId >= 0)
+                                labelStamp[labeling[adjId]] = clock;
+                        }
+                    }
+
+                    changed = true;
+                }
+                else {
+                    for (const int fId : changedFaces)
+                        proposedLabeling[fId] = labeling[fId];
+                }
+
+                pairStamp[pairId] = clock;
+
+                //Release the least recently used graphs
+                while (memoryBudget > 0 && storedBytes > memoryBudget) {
+                    size_t lruPair = pairGraphs.size();
+                    for (size_t p = 0; p < pairGraphs.size(); p++) {
+                        if (p != pairId && pairGraphs[p] &&
+                                (lruPair == pairGraphs.size() || pairGraphs[p]->lastUse < pairGraphs[lruPair]->lastUse))
+                        {
+                            lruPair = p;
+                        }
+                    }
+
+                    if (lruPair == pairGraphs.size())
+                        break;
+
+                    storedBytes -= internal::pairGraphMemoryUsage(*pairGraphs[lruPair]);
+                    pairGraphs[lruPair].reset();
+                }
+            }
+        }
+    }
+
+    const double energy = internal::computeEnergy(context, labeling);
+
+    std::cout << "Dynamic graph-cut: " << nCycles << " cycles, " <<
+                 nCuts << " cuts (" << nReusedCuts << " reusing the search trees), " <<
+                 nSkippedPairs << " unchanged pairs skipped. Energy: " << energy << std::endl;
+
+    return energy;
+}
+
+
+namespace internal {
+
+/**
+ * @brief Compute the terminal capacities of a face for an alpha-beta swap:
+ * its data cost and the smooth cost with the adjacent faces which are not
+ * labeled alpha or beta. The face takes alpha if it is in the source segment.
+ * @param[in] context Swap context
+ * @param[in] face Face
+ * @param[in] alpha Alpha label
+ * @param[in] beta Beta label
+ * @param[in] labeling Current labeling
+ * @param[out] sourceCap Capacity from the source (cost of beta)
+ * @param[out] sinkCap Capacity to the sink (cost of alpha)
+ */
+void computeUnaryCaps(
+        const SwapContext& context,
+        const int face,
+        const int alpha,
+        const int beta,
+        const std::vector<int>& labeling,
+        double& sourceCap,
+        double& sinkCap)
+{
+    const size_t faceOffset = static_cast<size_t>(face) * context.nLabels;
+
+    sinkCap = context.dataCost[faceOffset + alpha];
+    sourceCap = context.dataCost[faceOffset + beta];
+
+    for (const int adjId : context.ffAdj[face]) {
+        if (adjId < 0)
+            continue;
+
+        const int adjLabel = labeling[adjId];
+        if (adjLabel != alpha && adjLabel != beta) {
+            sinkCap += context.smoothTerm(face, adjId, alpha, adjLabel, context.smoothData);
+            sourceCap += context.smoothTerm(face, adjId, beta, adjLabel, context.smoothData);
+        }
+    }
+}
+
+/**
+ * @brief Build the graph of an alpha-beta swap on the nodes of the pair.
+ * The smooth terms between two nodes are represented with an edge and
+ * the terminal capacities of the nodes (Kolmogorov and Zabih construction).
+ * @param[in] context Swap context
+ * @param[in] alpha Alpha label
+ * @param[in] beta Beta label
+ * @param[in] labeling Current labeling
+ * @param[in] nodeIndex Node of each face, -1 if it is not a node
+ * @param[out] pairGraph Graph of the pair, with its nodes already set
+ */
+void buildPairGraph(
+        const SwapContext& context,
+        const int alpha,
+        const int beta,
+        const std::vector<int>& labeling,
+        const std::vector<int>& nodeIndex,
+        PairGraph& pairGraph)
+{
+    const std::vector<int>& nodeFaces = pairGraph.nodeFaces;
+    const unsigned int nNodes = nodeFaces.size();
+
+    MaxFlowGraph& graph = pairGraph.graph;
+    graph.clear();
+    graph.reserve(nNodes, nNodes * 3 / 2);
+    graph.addNodes(nNodes);
+
+    pairGraph.sourceCaps.resize(nNodes);
+    pairGraph.sinkCaps.resize(nNodes);
+
+    for (unsigned int i = 0; i < nNodes; i++) {
+        const int fId = nodeFaces[i];
+
+        computeUnaryCaps(context, fId, alpha, beta, labeling, pairGraph.sourceCaps[i], pairGraph.sinkCaps[i]);
+        graph.addTerminalWeights(i, pairGraph.sourceCaps[i], pairGraph.sinkCaps[i]);
+
+        for (const int adjId : context.ffAdj[fId]) {
+            if (adjId <= fId || nodeIndex[adjId] < 0)
+                continue;
+
+            const int j = nodeIndex[adjId];
+
+            const double a = context.smoothTerm(fId, adjId, alpha, alpha, context.smoothData);
+            double b = context.smoothTerm(fId, adjId, alpha, beta, context.smoothData);
+            double c = context.smoothTerm(fId, adjId, beta, alpha, context.smoothData);
+            const double d = context.smoothTerm(fId, adjId, beta, beta, context.smoothData);
+
+            graph.addTerminalWeights(i, d, a);
+            b -= a;
+            c -= d;
+
+            //Non-regular terms are truncated
+            if (b + c < 0) {
+                if (b < 0)
+                    c = -b;
+                else
+                    b = -c;
+            }
+
+            if (b < 0) {
+                graph.addTerminalWeights(i, 0, b);
+                graph.addTerminalWeights(j, 0, -b);
+                graph.addEdge(i, j, 0, b + c);
+            }
+            else if (c < 0) {
+                graph.addTerminalWeights(i, 0, -c);
+                graph.addTerminalWeights(j, 0, c);
+                graph.addEdge(i, j, b + c, 0);
+            }
+            else {
+                graph.addEdge(i, j, b, c);
+            }
+        }
+    }
+}
+
+/**
+ * @brief Compute the energy variation of a move
+ * @param[in] context Swap context
+ * @param[in] changedFaces Faces whose label is changed by the move
+ * @param[in] labeling Current labeling
+ * @param[in] proposedLabeling Labeling after the move
+ * @returns Energy variation
+ */
+double computeMoveDelta(
+        const SwapContext& context,
+        const std::vector<int>& changedFaces,
+        const std::vector<int>& labeling,
+        const std::vector<int>& proposedLabeling)
+{
+    double delta = 0;
+
+    for (const int fId : changedFaces) {
+        const size_t faceOffset = static_cast<size_t>(fId) * context.nLabels;
+
+        delta += context.dataCost[faceOffset + proposedLabeling[fId]];
+        delta -= context.dataCost[faceOffset + labeling[fId]];
+
+        for (const int adjId : context.ffAdj[fId]) {
+            if (adjId < 0)
+                continue;
+
+            //Edges between two changed faces are counted once
+            if (adjId < fId && proposedLabeling[adjId] != labeling[adjId])
+                continue;
+
+            delta += context.smoothTerm(fId, adjId, proposedLabeling[fId], proposedLabeling[adjId], context.smoothData);
+            delta -= context.smoothTerm(fId, adjId, labeling[fId], labeling[adjId], context.smoothData);
+        }
+    }
+
+    return delta;
+}
+
+/**
+ * @brief Compute the energy of a labeling
+ * @param[in] context Swap context
+ * @param[in] labeling Labeling
+ * @returns Energy
+ */
+double computeEnergy(
+        const SwapContext& context,
+        const std::vector<int>& labeling)
+{
+    double energy = 0;
+
+    for (size_t fId = 0; fId < labeling.size(); fId++) {
+        energy += context.dataCost[fId * context.nLabels + labeling[fId]];
+
+        for (const int adjId : context.ffAdj[fId]) {
+            if (adjId > static_cast<int>(fId))
+                energy += context.smoothTerm(fId, adjId, labeling[fId], labeling[adjId], context.smoothData);
+        }
+    }
+
+    return energy;
+}
+
+/**
+ * @brief Get the memory used by the graph of a pair
+ * @param[in] pairGraph Graph of the pair
+ * @returns Bytes used
+ */
+size_t pairGraphMemoryUsage(const PairGraph& pairGraph)
+{
+    return pairGraph.graph.memoryUsage() +
+            pairGraph.nodeFaces.capacity() * sizeof(int) +
+            (pairGraph.sourceCaps.capacity() + pairGraph.sinkCaps.capacity()) * sizeof(double);
+}
+
+}
+
+}
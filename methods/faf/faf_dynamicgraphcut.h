@@ -0,0 +1,26 @@
+#ifndef FAF_DYNAMICGRAPHCUT_H
+#define FAF_DYNAMICGRAPHCUT_H
+
+#include <vector>
+#include <cstddef>
+
+namespace FourAxisFabrication {
+
+/* Smooth term between two adjacent faces with the given labels */
+
+typedef float (*SmoothTermFunction)(int f1, int f2, int l1, int l2, void* extraData);
+
+/* Alpha-beta swap with dynamic graph cuts */
+
+double dynamicAlphaBetaSwap(
+        const std::vector<std::vector<int>>& ffAdj,
+        const unsigned int nLabels,
+        const std::vector<float>& dataCost,
+        SmoothTermFunction smoothTerm,
+        void* smoothData,
+        const size_t memoryBudget,
+        std::vector<int>& labeling);
+
+}
+
+#endif // FAF_DYNAMICGRAPHCUT_H
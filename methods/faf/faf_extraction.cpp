@@ -5,6 +5,10 @@
 #include "faf_extraction.h"
 #include "faf_charts.h"
 #include "faf_various.h"
+#include "faf_planeclip.h"
+#include "faf_meshbuilder.h"
+#include "faf_arena.h"
+#include "includes/faf_kernels.h"
 
 #include <cg3/utilities/utils.h>
 
@@ -29,7 +33,6 @@ namespace FourAxisFabrication {
 
 namespace internal {
 
-std::vector<cg3::Point2d> offsetPolygon(std::vector<cg3::Point2d>& polygon, const double offset);
 void getFabricationOrder(
         const std::vector<unsigned int>& association,
         const cg3::Array2D<double>& costMatrix,
@@ -46,6 +49,29 @@ std::vector<cg3::Point2d> createSquare(
         const cg3::Point3d& minCoord,
         const cg3::Point3d& maxCoord);
 
+const std::vector<std::array<unsigned int, 3>>& getSquareAnnulusPattern(
+        const unsigned int nInnerSideVertex,
+        const unsigned int nOuterSideVertex,
+        std::map<std::pair<unsigned int, unsigned int>, std::vector<std::array<unsigned int, 3>>>& patterns);
+
+bool isSquareStrictlyInside(
+        const cg3::Point2d& innerMin,
+        const cg3::Point2d& innerMax,
+        const cg3::Point2d& outerMin,
+        const cg3::Point2d& outerMax);
+
+bool getStockPrism(
+        const cg3::EigenMesh& stock,
+        double& radius,
+        double& halfLength,
+        unsigned int& subdivisions,
+        double& phase);
+
+bool isSameChartSurface(
+        const cg3::EigenMesh& surface1,
+        const cg3::EigenMesh& surface2,
+        const double tolerance);
+
 } //namespace internal
 
 
@@ -62,8 +88,12 @@ std::vector<cg3::Point2d> createSquare(
  * @param[in] heightfieldAngle Limit angle with triangles normal in order to be a heightfield
  * @param[in] xDirectionsAfter xDirections are fabricated at the end. If false they are fabricated before.
  * @param[in] rotateMeshes Rotate resulting meshes on the given direction
+ * @param[in] previousData Data of a previous extraction with the same parameters: the boxes
+ * of the non-extreme charts whose surface has not changed are reused (nullptr to build all the boxes)
+ * @param[in] reuseTolerance Maximum distance of the vertices of a chart surface to be considered unchanged
+ * @returns Number of reused boxes
  */
-void extractResults(
+unsigned int extractResults(
         Data& data,
         const double stockLength,
         const double stockDiameter,
@@ -77,7 +107,9 @@ void extractResults(
         const double heightfieldAngle,
         const bool xDirectionsAfter,
         const bool minFirst,
-        const bool rotateResults)
+        const bool rotateResults,
+        const Data* previousData,
+        const double reuseTolerance)
 {
     typedef cg3::libigl::CSGTree CSGTree;
 
@@ -106,6 +138,10 @@ void extractResults(
     cg3::EigenMesh& minSupport = data.minSupport;
     cg3::EigenMesh& maxSupport = data.maxSupport;
 
+    std::vector<cg3::EigenMesh>& chartSurfaces = data.chartSurfaces;
+    std::vector<cg3::EigenMesh>& chartBoxes = data.chartBoxes;
+    std::vector<unsigned int>& chartBoxesAssociation = data.chartBoxesAssociation;
+
     //Common values
     unsigned int minLabel = data.targetDirections[targetDirections.size()-2];
     unsigned int maxLabel = data.targetDirections[targetDirections.size()-1];
@@ -147,63 +183,82 @@ void extractResults(
 
     /* ----- ADD SURFACE OF THE CHARTS TO THE RESULTS ----- */
 
-    std::vector<cg3::EigenMesh> tmpResults;
+    std::vector<MeshBuilder> resultBuilders;
     std::vector<unsigned int> tmpResultsAssociation;
     std::vector<std::vector<unsigned int>> chartExternalBorders;
 
+    //Boxes of the previous extraction reused for the results (-1 if the box has to be built)
+    std::vector<int> reusedBoxes;
+    unsigned int nReusedBoxes = 0;
+
+    chartSurfaces.clear();
+
+    //Map from the mesh vertices to the vertices of the current result (-1 if not in the chart)
+    std::vector<int> meshVertexToResultVertex(fourAxisComponent.numberVertices(), -1);
+
     //Initialize results with the chart data
     int rId = 0;
-    std::vector<std::unordered_map<size_t, size_t>> resultFacesToMeshFaces; //Map to the mesh face
     for (const Chart& chart : fourAxisChartData.charts) {
         if (chart.label >= 0) {
-            cg3::EigenMesh chartResult;
-
-            std::unordered_map<size_t, size_t> resultFaceToMeshFaceMap;
-
-            std::unordered_map<unsigned int, unsigned int> meshVertexToResultVertexMap;
+            MeshBuilder chartResult;
+            chartResult.reserve(chart.vertices.size(), chart.faces.size());
 
             for (unsigned int vId : chart.vertices) {
-                unsigned int newID = chartResult.addVertex(fourAxisComponent.vertex(vId));
-                meshVertexToResultVertexMap.insert(std::make_pair(vId, newID));
+                meshVertexToResultVertex[vId] = static_cast<int>(chartResult.addVertex(fourAxisComponent.vertex(vId)));
             }
 
             for (unsigned int fId : chart.faces) {
                 cg3::Point3i f = fourAxisComponent.face(fId);
-                unsigned int newFaceId = chartResult.addFace(
-                            meshVertexToResultVertexMap.at(static_cast<unsigned int>(f.x())),
-                            meshVertexToResultVertexMap.at(static_cast<unsigned int>(f.y())),
-                            meshVertexToResultVertexMap.at(static_cast<unsigned int>(f.z())));
-                resultFaceToMeshFaceMap.insert(std::make_pair(newFaceId, fId));
+                chartResult.addFace(
+                            static_cast<unsigned int>(meshVertexToResultVertex[f.x()]),
+                            static_cast<unsigned int>(meshVertexToResultVertex[f.y()]),
+                            static_cast<unsigned int>(meshVertexToResultVertex[f.z()]));
             }
 
-            chartResult.updateFacesAndVerticesNormals();
-            chartResult.updateBoundingBox();
-
-            tmpResults.push_back(chartResult);
-            tmpResultsAssociation.push_back(static_cast<unsigned int>(chart.label));
-
-
-            chartResult.setFaceColor(colorMap[static_cast<size_t>(chart.label)]);
-
-            chartToResult.push_back(rId);
-            resultToChart.push_back(chart.id);
-
-            resultFacesToMeshFaces.push_back(resultFaceToMeshFaceMap);
+            //Surface of the chart, compared with the previous extraction
+            chartSurfaces.push_back(chartResult.build());
+
+            int reusedBox = -1;
+            if (previousData != nullptr && !fourAxisChartData.isExtreme.at(chart.id)) {
+                for (size_t i = 0; i < previousData->chartBoxesAssociation.size() && reusedBox < 0; i++) {
+                    if (previousData->chartBoxesAssociation[i] == static_cast<unsigned int>(chart.label) &&
+                            i < previousData->chartSurfaces.size() &&
+                            internal::isSameChartSurface(chartSurfaces.back(), previousData->chartSurfaces[i], reuseTolerance))
+                    {
+                        reusedBox = static_cast<int>(i);
+                    }
+                }
+            }
+            if (reusedBox >= 0) {
+                nReusedBoxes++;
+            }
+            reusedBoxes.push_back(reusedBox);
 
             std::vector<unsigned int> externalBorders(chart.borderVertices.size());
             for (size_t i = 0; i < chart.borderVertices.size(); i++) {
                 unsigned int borderVertexId = chart.borderVertices[i];
-                externalBorders[i] = meshVertexToResultVertexMap.at(borderVertexId);
+                externalBorders[i] = static_cast<unsigned int>(meshVertexToResultVertex[borderVertexId]);
             }
             chartExternalBorders.push_back(externalBorders);
 
+            //Reset the map for the next chart
+            for (unsigned int vId : chart.vertices) {
+                meshVertexToResultVertex[vId] = -1;
+            }
+
+            resultBuilders.push_back(std::move(chartResult));
+            tmpResultsAssociation.push_back(static_cast<unsigned int>(chart.label));
+
+            chartToResult.push_back(rId);
+            resultToChart.push_back(chart.id);
+
             rId++;
         }
         else {
             chartToResult.push_back(-1);
         }
     }
-    size_t nResults = tmpResults.size();
+    size_t nResults = resultBuilders.size();
 
 
     /* ----- SUPPORTS ----- */
@@ -220,17 +275,21 @@ void extractResults(
     cg3::BoundingBox3 minBB = bbSupport;
     minBB.setMaxX(minLevelSetX);
 
-    //Min support
-    cg3::EigenMesh minBBMesh = cg3::EigenMeshAlgorithms::makeBox(minBB);
-    minSupport = cg3::libigl::difference(minBBMesh, fourAxisComponent);
+    //Min support (plane clip if possible, general boolean otherwise)
+    if (!boxDifferenceOnXPlane(minBB, fourAxisComponent, minSupport)) {
+        cg3::EigenMesh minBBMesh = cg3::EigenMeshAlgorithms::makeBox(minBB);
+        minSupport = cg3::libigl::difference(minBBMesh, fourAxisComponent);
+    }
 
     //Set max extremes bounding box
     cg3::BoundingBox3 maxBB = bbSupport;
     maxBB.setMinX(maxLevelSetX);
 
-    //Max support
-    cg3::EigenMesh maxBBMesh = cg3::EigenMeshAlgorithms::makeBox(maxBB);
-    maxSupport = cg3::libigl::difference(maxBBMesh, fourAxisComponent);
+    //Max support (plane clip if possible, general boolean otherwise)
+    if (!boxDifferenceOnXPlane(maxBB, fourAxisComponent, maxSupport)) {
+        cg3::EigenMesh maxBBMesh = cg3::EigenMeshAlgorithms::makeBox(maxBB);
+        maxSupport = cg3::libigl::difference(maxBBMesh, fourAxisComponent);
+    }
 
 
 
@@ -242,9 +301,16 @@ void extractResults(
     const double boxWidth = stockLength*2;
     const double boxHeight = stockDiameter*2;
 
+    std::vector<cg3::EigenMesh> tmpResults(nResults);
     for (size_t rId = 0; rId < nResults; rId++) {
+        //The box of an unchanged chart is taken from the previous extraction
+        if (reusedBoxes[rId] >= 0) {
+            resultBuilders[rId].clear();
+            continue;
+        }
+
         //Copying the surface and getting its label
-        cg3::EigenMesh& result = tmpResults[rId];
+        MeshBuilder& result = resultBuilders[rId];
         unsigned int targetLabel = tmpResultsAssociation[rId];
 
         //Get projection matrix and its inverse for 2D projection
@@ -415,6 +481,9 @@ void extractResults(
             }
         }
 
+        //Each step of the border-offset triangulation adds a face
+        result.reserve(result.numberVertices() + nOffsetVertices, result.numberFaces() + nBorderVertices + nOffsetVertices);
+
         //Create offset vertices in the mesh
         std::vector<unsigned int> offsetVertices(nOffsetVertices);
         for (size_t i = 0; i < nOffsetVertices; i++) {
@@ -582,9 +651,20 @@ void extractResults(
 
         /* ------- SECOND LAYER POLYGON ------- */
 
+        //Maps of the layer points, allocated on the arena of the result
+        StageArena layerArena;
+        const ArenaAllocator<std::pair<const cg3::Point2d, unsigned int>> layerAllocator(layerArena);
+
         //New layer vertices and map (used by CGAL)
         std::vector<cg3::Point2d> currentSecondLayerPoints2D(nOffsetVertices);
-        std::map<cg3::Point2d, unsigned int> currentSecondLayerPoints2DMap;
+        ArenaMap<cg3::Point2d, unsigned int> currentSecondLayerPoints2DMap(layerAllocator);
+        std::vector<unsigned int> currentSecondLayerVertices = offsetVertices;
+
+        //After the first step the layer polygon is a square: the annuli between squares
+        //are built by index patterns, cached for the number of vertices per side
+        unsigned int currentSquareSideVertex = 0;
+        cg3::Point2d currentSquareMin, currentSquareMax;
+        std::map<std::pair<unsigned int, unsigned int>, std::vector<std::array<unsigned int, 3>>> annulusPatterns;
 
         //Min coord of the new points inserted
         cg3::Point3d minCoord(std::numeric_limits<double>::max(),std::numeric_limits<double>::max(),std::numeric_limits<double>::max());
@@ -627,7 +707,7 @@ void extractResults(
             }
 
             //Create new 2D square (down)
-            std::map<cg3::Point2d, unsigned int> downPoints2DMap;
+            ArenaMap<cg3::Point2d, unsigned int> downPoints2DMap(layerAllocator);
             std::vector<cg3::Point2d> squarePoints2D = FourAxisFabrication::internal::createSquare(nSideSubdivision, minCoord, maxCoord);
 
             size_t newVerticesNumber = squarePoints2D.size();
@@ -646,43 +726,63 @@ void extractResults(
                 downPoints2DMap[p2D] = vId;
             }
 
-            //Delaunay triangulation between second layer polygon and new square
-            std::vector<std::array<cg3::Point2d, 3>> triangulation;
-            std::vector<std::vector<cg3::Point2d>> holes;
-
-            holes.resize(1);
-            holes[0] = currentSecondLayerPoints2D;
-            triangulation = cg3::cgal::triangulate2(squarePoints2D, holes);
-
-            //Add triangulation to result
-            for (std::array<cg3::Point2d, 3>& triangle : triangulation) {
-                bool isThereNewVertex = false; //Flag to check if a new point has been created (flipped triangles on projection)
-
-                unsigned int v[3];
-
-                for (unsigned int i = 0; i < 3 && !isThereNewVertex; i++) {
-                    if (currentSecondLayerPoints2DMap.find(triangle[i]) != currentSecondLayerPoints2DMap.end()) {
-                        v[i] = currentSecondLayerPoints2DMap.at(triangle[i]);
+            const cg3::Point2d squareMin(minCoord.x(), minCoord.y());
+            const cg3::Point2d squareMax(maxCoord.x(), maxCoord.y());
+
+            if (currentSquareSideVertex > 0 &&
+                    FourAxisFabrication::internal::isSquareStrictlyInside(currentSquareMin, currentSquareMax, squareMin, squareMax))
+            {
+                //Annulus between squares
+                const std::vector<std::array<unsigned int, 3>>& pattern =
+                        FourAxisFabrication::internal::getSquareAnnulusPattern(currentSquareSideVertex, nSideSubdivision, annulusPatterns);
+
+                const unsigned int nInnerVertices = currentSecondLayerVertices.size();
+                for (const std::array<unsigned int, 3>& triangle : pattern) {
+                    unsigned int v[3];
+                    for (unsigned int i = 0; i < 3; i++) {
+                        v[i] = triangle[i] < nInnerVertices ? currentSecondLayerVertices[triangle[i]] : downVertices[triangle[i] - nInnerVertices];
                     }
-                    else if (downPoints2DMap.find(triangle[i]) != downPoints2DMap.end()) {
-                        v[i] = downPoints2DMap.at(triangle[i]);
+                    result.addFace(v[0], v[1], v[2]);
+                }
+            }
+            else {
+                //Delaunay triangulation between second layer polygon and new square
+                std::vector<std::array<cg3::Point2d, 3>> triangulation;
+                std::vector<std::vector<cg3::Point2d>> holes;
+
+                holes.resize(1);
+                holes[0] = currentSecondLayerPoints2D;
+                triangulation = cg3::cgal::triangulate2(squarePoints2D, holes);
+
+                //Add triangulation to result
+                for (std::array<cg3::Point2d, 3>& triangle : triangulation) {
+                    bool isThereNewVertex = false; //Flag to check if a new point has been created (flipped triangles on projection)
+
+                    unsigned int v[3];
+
+                    for (unsigned int i = 0; i < 3 && !isThereNewVertex; i++) {
+                        if (currentSecondLayerPoints2DMap.find(triangle[i]) != currentSecondLayerPoints2DMap.end()) {
+                            v[i] = currentSecondLayerPoints2DMap.at(triangle[i]);
+                        }
+                        else if (downPoints2DMap.find(triangle[i]) != downPoints2DMap.end()) {
+                            v[i] = downPoints2DMap.at(triangle[i]);
+                        }
+                        //If the vertex is not among the existing vertices
+                        else {
+                            isThereNewVertex = true;
+                        }
                     }
-                    //If the vertex is not among the existing vertices
-                    else {
-                        isThereNewVertex = true;
+                    if (!isThereNewVertex) {
+                        result.addFace(v[0], v[1], v[2]);
                     }
                 }
-                if (!isThereNewVertex) {
-                    result.addFace(v[0], v[1], v[2]);
-                }
             }
 
-
             totalHeight += secondLayerStepHeight;
             totalHeight = std::min(totalHeight, boxHeight);
 
             //Create new 2D square (up)
-            std::map<cg3::Point2d, unsigned int> upPoints2DMap;
+            ArenaMap<cg3::Point2d, unsigned int> upPoints2DMap(layerAllocator);
 
             //Adding up square vertices
             std::vector<unsigned int> upVertices(newVerticesNumber);
@@ -706,13 +806,18 @@ void extractResults(
 
             currentSecondLayerPoints2D = squarePoints2D;
             currentSecondLayerPoints2DMap = upPoints2DMap;
+            currentSecondLayerVertices = upVertices;
+
+            currentSquareSideVertex = nSideSubdivision;
+            currentSquareMin = squareMin;
+            currentSquareMax = squareMax;
         }
 
 
         /* ----- BOX ----- */
 
         //Create new 2D square
-        std::map<cg3::Point2d, unsigned int> boxUpperPoints2DMap;
+        ArenaMap<cg3::Point2d, unsigned int> boxUpperPoints2DMap(layerAllocator);
         std::vector<cg3::Point2d> boxUpperPoints2D(4);
         boxUpperPoints2D[0] = cg3::Point2d(-boxWidth, -boxHeight);
         boxUpperPoints2D[1] = cg3::Point2d(+boxWidth, -boxHeight);
@@ -734,35 +839,53 @@ void extractResults(
             boxUpperPoints2DMap[p2D] = vid;
         }
 
-        //Delaunay triangulation between second layer polygon and square polygon
-        std::vector<std::array<cg3::Point2d, 3>> triangulation;
-        std::vector<std::vector<cg3::Point2d>> holes;
+        if (currentSquareSideVertex > 0 &&
+                FourAxisFabrication::internal::isSquareStrictlyInside(currentSquareMin, currentSquareMax, boxUpperPoints2D[0], boxUpperPoints2D[2]))
+        {
+            //Annulus between the last square and the box
+            const std::vector<std::array<unsigned int, 3>>& pattern =
+                    FourAxisFabrication::internal::getSquareAnnulusPattern(currentSquareSideVertex, 1, annulusPatterns);
+
+            const unsigned int nInnerVertices = currentSecondLayerVertices.size();
+            for (const std::array<unsigned int, 3>& triangle : pattern) {
+                unsigned int v[3];
+                for (unsigned int i = 0; i < 3; i++) {
+                    v[i] = triangle[i] < nInnerVertices ? currentSecondLayerVertices[triangle[i]] : squareVertices[triangle[i] - nInnerVertices];
+                }
+                result.addFace(v[0], v[1], v[2]);
+            }
+        }
+        else {
+            //Delaunay triangulation between second layer polygon and square polygon
+            std::vector<std::array<cg3::Point2d, 3>> triangulation;
+            std::vector<std::vector<cg3::Point2d>> holes;
 
-        holes.resize(1);
-        holes[0] = currentSecondLayerPoints2D;
-        triangulation = cg3::cgal::triangulate2(boxUpperPoints2D, holes);
+            holes.resize(1);
+            holes[0] = currentSecondLayerPoints2D;
+            triangulation = cg3::cgal::triangulate2(boxUpperPoints2D, holes);
 
-        //Add triangulation to result
-        for (std::array<cg3::Point2d, 3>& triangle : triangulation) {
-            bool isThereNewVertex = false; //Flag to check if a new point has been created (flipped triangles on projection)
+            //Add triangulation to result
+            for (std::array<cg3::Point2d, 3>& triangle : triangulation) {
+                bool isThereNewVertex = false; //Flag to check if a new point has been created (flipped triangles on projection)
 
-            unsigned int v[3];
+                unsigned int v[3];
 
-            for (unsigned int i = 0; i < 3 && !isThereNewVertex; i++) {
-                if (currentSecondLayerPoints2DMap.find(triangle[i]) != currentSecondLayerPoints2DMap.end()) {
-                    v[i] = currentSecondLayerPoints2DMap.at(triangle[i]);
-                }
-                else if (boxUpperPoints2DMap.find(triangle[i]) != boxUpperPoints2DMap.end()) {
-                    v[i] = boxUpperPoints2DMap.at(triangle[i]);
-                }
-                //If the vertex is not among the existing vertices
-                else {
-                    isThereNewVertex = true;
+                for (unsigned int i = 0; i < 3 && !isThereNewVertex; i++) {
+                    if (currentSecondLayerPoints2DMap.find(triangle[i]) != currentSecondLayerPoints2DMap.end()) {
+                        v[i] = currentSecondLayerPoints2DMap.at(triangle[i]);
+                    }
+                    else if (boxUpperPoints2DMap.find(triangle[i]) != boxUpperPoints2DMap.end()) {
+                        v[i] = boxUpperPoints2DMap.at(triangle[i]);
+                    }
+                    //If the vertex is not among the existing vertices
+                    else {
+                        isThereNewVertex = true;
+                    }
                 }
-            }
 
-            if (!isThereNewVertex) {
-                result.addFace(v[0], v[1], v[2]);
+                if (!isThereNewVertex) {
+                    result.addFace(v[0], v[1], v[2]);
+                }
             }
         }
 
@@ -809,6 +932,10 @@ void extractResults(
 
         result.addFace(boxVertices[7], boxVertices[3], boxVertices[2]);
         result.addFace(boxVertices[7], boxVertices[2], boxVertices[6]);
+
+        //Build the mesh in a single step
+        tmpResults[rId] = result.build();
+        result.clear();
     }
 
     /* ----- HOLE FILLING ----- */
@@ -816,6 +943,9 @@ void extractResults(
     std::cout << std::endl <<  "----- HOLE FILLING ----- " << std::endl << std::endl;
 
     for (size_t rId = 0; rId < nResults; rId++) {
+        if (reusedBoxes[rId] >= 0)
+            continue;
+
         //Copying the surface and getting its label
         cg3::EigenMesh& result = tmpResults[rId];
 
@@ -829,7 +959,7 @@ void extractResults(
     std::cout << std::endl <<  "----- CLEANING ----- " << std::endl << std::endl;
 
     for (size_t rId = 0; rId < nResults; rId++) {
-        if (fourAxisChartData.isExtreme.at(resultToChart.at(rId))) {
+        if (reusedBoxes[rId] < 0 && fourAxisChartData.isExtreme.at(resultToChart.at(rId))) {
             //Copying the surface and getting its label
             cg3::EigenMesh& result = tmpResults[rId];
             unsigned int targetLabel = tmpResultsAssociation[rId];
@@ -841,6 +971,20 @@ void extractResults(
         }
     }
 
+    //Reused boxes
+    for (size_t rId = 0; rId < nResults; rId++) {
+        if (reusedBoxes[rId] >= 0) {
+            tmpResults[rId] = previousData->chartBoxes.at(static_cast<size_t>(reusedBoxes[rId]));
+        }
+    }
+    if (previousData != nullptr) {
+        std::cout << "Reused boxes: " << nReusedBoxes << " of " << nResults << "." << std::endl;
+    }
+
+    //Keep the boxes for the next extraction
+    chartBoxes = tmpResults;
+    chartBoxesAssociation = tmpResultsAssociation;
+
 
     /* ----- UNION WITH THE ORIGINAL MESH ----- */
 
@@ -1018,8 +1162,20 @@ void extractResults(
         //Copying the surface and getting its label
         cg3::EigenMesh& result = results[rId];
 
-        //Intersection with the stock
-        result = cg3::libigl::intersection(currentStock, result);
+        //Intersection with the stock: the first result is clipped with the
+        //prism of the stock mesh, the next ones are inside it by construction
+        double stockRadius, stockHalfLength, stockPhase;
+        unsigned int stockSubdivisions;
+        cg3::EigenMesh clippedResult;
+        if (rId == 0 &&
+                internal::getStockPrism(currentStock, stockRadius, stockHalfLength, stockSubdivisions, stockPhase) &&
+                clipWithCylinder(result, stockRadius, stockHalfLength, stockSubdivisions, stockPhase, clippedResult))
+        {
+            result = clippedResult;
+        }
+        else {
+            result = cg3::libigl::intersection(currentStock, result);
+        }
 
         //Add stock
         stocks[rId] = currentStock;
@@ -1126,6 +1282,8 @@ void extractResults(
     minResult.updateFacesAndVerticesNormals();
     maxResult.updateBoundingBox();
     maxResult.updateFacesAndVerticesNormals();
+
+    return nReusedBoxes;
 }
 
 
@@ -1274,6 +1432,191 @@ std::vector<cg3::Point2d> createSquare(
     return squarePoints2D;
 }
 
+/**
+ * @brief Get the triangles of the annulus between two nested axis-aligned squares,
+ * created by createSquare (counterclockwise, starting from the min corner). The
+ * vertices of each side are zipped by their parameter along the side, hence the
+ * pattern depends only on the number of vertices per side.
+ * Indices smaller than 4*nInnerSideVertex refer to the inner square, the others
+ * to the outer square (shifted by 4*nInnerSideVertex). The triangles are
+ * counterclockwise.
+ * @param[in] nInnerSideVertex Number of vertices per side of the inner square
+ * @param[in] nOuterSideVertex Number of vertices per side of the outer square
+ * @param[out] patterns Cache of the patterns
+ * @returns Triangles of the annulus
+ */
+const std::vector<std::array<unsigned int, 3>>& getSquareAnnulusPattern(
+        const unsigned int nInnerSideVertex,
+        const unsigned int nOuterSideVertex,
+        std::map<std::pair<unsigned int, unsigned int>, std::vector<std::array<unsigned int, 3>>>& patterns)
+{
+    const std::pair<unsigned int, unsigned int> key(nInnerSideVertex, nOuterSideVertex);
+
+    std::map<std::pair<unsigned int, unsigned int>, std::vector<std::array<unsigned int, 3>>>::iterator it = patterns.find(key);
+    if (it != patterns.end())
+        return it->second;
+
+    const unsigned int nInner = nInnerSideVertex * 4;
+    const unsigned int nOuter = nOuterSideVertex * 4;
+
+    std::vector<std::array<unsigned int, 3>> pattern;
+    pattern.reserve(nInner + nOuter);
+
+    for (unsigned int side = 0; side < 4; side++) {
+        auto inner = [&] (const unsigned int i) {
+            return (side * nInnerSideVertex + i) % nInner;
+        };
+        auto outer = [&] (const unsigned int k) {
+            return nInner + (side * nOuterSideVertex + k) % nOuter;
+        };
+
+        unsigned int i = 0;
+        unsigned int k = 0;
+        while (i < nInnerSideVertex || k < nOuterSideVertex) {
+            //Advance on the side whose next vertex has the lower parameter
+            if (k < nOuterSideVertex && (i == nInnerSideVertex || (k + 1) * nInnerSideVertex <= (i + 1) * nOuterSideVertex)) {
+                pattern.push_back({{inner(i), outer(k), outer(k + 1)}});
+                k++;
+            }
+            else {
+                pattern.push_back({{inner(i), outer(k), inner(i + 1)}});
+                i++;
+            }
+        }
+    }
+
+    return patterns.insert(std::make_pair(key, pattern)).first->second;
+}
+
+/**
+ * @brief Check if an axis-aligned square is strictly inside another one
+ * @param[in] innerMin Min coordinates of the inner square
+ * @param[in] innerMax Max coordinates of the inner square
+ * @param[in] outerMin Min coordinates of the outer square
+ * @param[in] outerMax Max coordinates of the outer square
+ * @returns True if the inner square is strictly inside
+ */
+bool isSquareStrictlyInside(
+        const cg3::Point2d& innerMin,
+        const cg3::Point2d& innerMax,
+        const cg3::Point2d& outerMin,
+        const cg3::Point2d& outerMax)
+{
+    return outerMin.x() < innerMin.x() && outerMin.y() < innerMin.y() &&
+            innerMax.x() < outerMax.x() && innerMax.y() < outerMax.y();
+}
+
+/**
+ * @brief Get the prism of a stock mesh: the stock must be a cylinder
+ * centered in the origin, having the x-axis as axis, with its lateral
+ * vertices at regular angles on the two bases
+ * @param[in] stock Stock mesh
+ * @param[out] radius Radius of the lateral vertices
+ * @param[out] halfLength Half of the length of the stock
+ * @param[out] subdivisions Number of lateral vertices on each base
+ * @param[out] phase Angle of the first lateral vertex, in [0, 2*pi/subdivisions)
+ * @returns True if the stock is such a prism
+ */
+bool getStockPrism(
+        const cg3::EigenMesh& stock,
+        double& radius,
+        double& halfLength,
+        unsigned int& subdivisions,
+        double& phase)
+{
+    radius = 0;
+    halfLength = 0;
+    for (unsigned int vId = 0; vId < stock.numberVertices(); vId++) {
+        const cg3::Point3d p = stock.vertex(vId);
+        radius = std::max(radius, std::sqrt(p.y()*p.y() + p.z()*p.z()));
+        halfLength = std::max(halfLength, std::fabs(p.x()));
+    }
+    if (radius <= 0 || halfLength <= 0)
+        return false;
+
+    const double eps = 1e-5 * (radius + halfLength);
+
+    //Angles of the lateral vertices on the max base (the centers of the bases are skipped)
+    std::vector<double> angles;
+    for (unsigned int vId = 0; vId < stock.numberVertices(); vId++) {
+        const cg3::Point3d p = stock.vertex(vId);
+        const double r = std::sqrt(p.y()*p.y() + p.z()*p.z());
+
+        if (r < eps)
+            continue;
+        if (std::fabs(r - radius) > eps || std::fabs(std::fabs(p.x()) - halfLength) > eps)
+            return false;
+
+        if (p.x() > 0)
+            angles.push_back(std::atan2(p.z(), p.y()));
+    }
+    const double angleEps = eps / radius;
+
+    //Duplicated vertices (e.g. on the seam) are counted once
+    std::sort(angles.begin(), angles.end());
+    std::vector<double> uniqueAngles;
+    for (const double angle : angles) {
+        if (uniqueAngles.empty() || angle - uniqueAngles.back() > angleEps)
+            uniqueAngles.push_back(angle);
+    }
+    if (uniqueAngles.size() > 1 && uniqueAngles.front() + 2 * M_PI - uniqueAngles.back() <= angleEps)
+        uniqueAngles.pop_back();
+    angles = uniqueAngles;
+
+    if (angles.size() < 3)
+        return false;
+
+    subdivisions = static_cast<unsigned int>(angles.size());
+    const double step = 2 * M_PI / subdivisions;
+
+    phase = std::fmod(angles[0], step);
+    if (phase < 0)
+        phase += step;
+
+    //All the lateral vertices must be on the regular tessellation
+    for (const double angle : angles) {
+        double offset = std::fmod(angle - phase, step);
+        if (offset < 0)
+            offset += step;
+        if (std::min(offset, step - offset) > angleEps)
+            return false;
+    }
+
+    return true;
+}
+
+/**
+ * @brief Check if two chart surfaces are the same: they must have the same
+ * faces, and the corresponding vertices must be within the tolerance
+ * @param[in] surface1 First surface
+ * @param[in] surface2 Second surface
+ * @param[in] tolerance Maximum distance of the vertices
+ * @returns True if the surfaces are the same
+ */
+bool isSameChartSurface(
+        const cg3::EigenMesh& surface1,
+        const cg3::EigenMesh& surface2,
+        const double tolerance)
+{
+    if (surface1.numberVertices() != surface2.numberVertices() ||
+            surface1.numberFaces() != surface2.numberFaces())
+        return false;
+
+    for (unsigned int fId = 0; fId < surface1.numberFaces(); fId++) {
+        const cg3::Point3i f1 = surface1.face(fId);
+        const cg3::Point3i f2 = surface2.face(fId);
+        if (f1.x() != f2.x() || f1.y() != f2.y() || f1.z() != f2.z())
+            return false;
+    }
+
+    for (unsigned int vId = 0; vId < surface1.numberVertices(); vId++) {
+        if ((surface1.vertex(vId) - surface2.vertex(vId)).length() > tolerance)
+            return false;
+    }
+
+    return true;
+}
+
 
 } //namespace internal
 
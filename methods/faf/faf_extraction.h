@@ -13,7 +13,7 @@
 
 namespace FourAxisFabrication {
 
-void extractResults(
+unsigned int extractResults(
         Data& data,
         const double stockLength,
         const double stockDiameter,
@@ -27,7 +27,9 @@ void extractResults(
         const double heightfieldAngle,
         const bool xDirectionsAfter,
         const bool minFirst,
-        const bool rotateResults);
+        const bool rotateResults,
+        const Data* previousData = nullptr,
+        const double reuseTolerance = 0.0);
 
 }
 
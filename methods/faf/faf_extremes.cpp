@@ -39,16 +39,16 @@ void selectExtremesOnXAxis(
  * @brief Get min and max extremes of the mesh along the x direction.
  * The algorithm stops when the current triangle is not visible
  * by related the direction (-x for min and +x for max).
- * @param[in] mesh Input mesh
+ * @param[in] mesh Input mesh (or view of a transformed mesh)
  * @param[in] heightFieldAngle Height field angle
  * @param[in] ffAdj Face-face adjacencies of the mesh
  * @param[out] minExtremes Min extremes
  * @param[out] maxExtremes Max extremes
  */
 void selectExtremesOnXAxis(
-        const cg3::EigenMesh& mesh,
+        const TransformedMeshView& mesh,
         const double heightFieldAngle,
-        const std::vector<std::vector<int>> ffAdj,
+        const std::vector<std::vector<int>>& ffAdj,
         std::vector<unsigned int>& minExtremes,
         std::vector<unsigned int>& maxExtremes)
 {
@@ -74,7 +74,7 @@ void selectExtremesOnXAxis(
         fIndices[i] = i;
 
     //Order the vector by x-coordinate
-    std::sort(fIndices.begin(), fIndices.end(), internal::XMinComparator(mesh));
+    mesh.sortFacesByMinCoordinate(0, fIndices);
 
 
     /* ----- MIN EXTREMES ----- */
@@ -4,6 +4,7 @@
 #include <cg3/meshes/eigenmesh/eigenmesh.h>
 
 #include "faf_data.h"
+#include "faf_meshview.h"
 
 namespace FourAxisFabrication {
 
@@ -15,9 +16,9 @@ void selectExtremesOnXAxis(
         Data& data);
 
 void selectExtremesOnXAxis(
-        const cg3::EigenMesh& mesh,
+        const TransformedMeshView& mesh,
         const double heightFieldAngle,
-        const std::vector<std::vector<int>> ffAdj,
+        const std::vector<std::vector<int>>& ffAdj,
         std::vector<unsigned int>& minExtremes,
         std::vector<unsigned int>& maxExtremes);
 
@@ -3,10 +3,14 @@
  * @author Alessandro Muntoni
  */
 #include "faf_frequencies.h"
+#include "includes/faf_kernels.h"
+#include "faf_metrics.h"
 
 #include <set>
 #include <unordered_set>
 #include <utility>
+#include <queue>
+#include <functional>
 
 #ifdef CG3_LIBIGL_DEFINED
 #include <cg3/libigl/mesh_adjacencies.h>
@@ -48,14 +52,6 @@ cg3::Point3d getTargetPoint(const cg3::EigenMesh& mesh,
         const unsigned int vId,
         const std::vector<std::vector<int>>& vertexVertexAdjacencies);
 
-bool isMoveValid(const cg3::EigenMesh& mesh,
-        const Data& data,
-        const unsigned int vId,
-        const cg3::Point3d& newPoint,
-        const std::vector<std::vector<int>>& vertexFaceAdjacencies,
-        const double heightfieldAngle,
-        const double normalAngle);
-
 }
 
 /* ----- RESTORE FREQUENCIES ----- */
@@ -180,8 +176,8 @@ void recheckVisibilityAfterRestore(
         newData.minExtremes = minExtremes;
         newData.maxExtremes = maxExtremes;
 
-        //Get new visibility
-        getVisibility(restoredMesh, nDirections, resolution, heightfieldAngle, includeXDirections, newData, checkMode);
+        //Get new visibility (all the rows are kept in the data, not only the used ones)
+        getVisibility(restoredMesh, nDirections, resolution, heightfieldAngle, includeXDirections, newData, checkMode, false);
         restoredMeshVisibility = newData.visibility;
 
         //Update association non-visible faces
@@ -202,14 +198,33 @@ void recheckVisibilityAfterRestore(
                     cg3::libigl::faceToFaceAdjacencies(restoredMesh);
 
 
-            bool done;
+            //Position of the non-visible faces in the list, -1 if the face is visible
+            const unsigned int nNonVisibleFaces = static_cast<unsigned int>(restoredMeshNonVisibleFaces.size());
+            std::vector<int> facePosition(restoredMesh.numberFaces(), -1);
+            for (unsigned int i = 0; i < nNonVisibleFaces; i++) {
+                facePosition[restoredMeshNonVisibleFaces[i]] = static_cast<int>(i);
+            }
+
+            //Faces to be checked in the current and in the next round, ordered by position.
+            //A face is checked again only if one of its adjacent faces has been reassigned,
+            //in the current round if it comes after it in the list, otherwise in the next.
+            std::priority_queue<unsigned int, std::vector<unsigned int>, std::greater<unsigned int>> currentRound;
+            std::priority_queue<unsigned int, std::vector<unsigned int>, std::greater<unsigned int>> nextRound;
+            std::vector<bool> isPendingCurrent(nNonVisibleFaces, true);
+            std::vector<bool> isPendingNext(nNonVisibleFaces, false);
 
-            do {
-                std::vector<unsigned int> newNonVisibleFaces;
+            for (unsigned int i = 0; i < nNonVisibleFaces; i++) {
+                currentRound.push(i);
+            }
 
-                done = true;
+            while (!currentRound.empty()) {
+                while (!currentRound.empty()) {
+                    const unsigned int position = currentRound.top();
+                    currentRound.pop();
+                    isPendingCurrent[position] = false;
+
+                    const unsigned int fId = restoredMeshNonVisibleFaces[position];
 
-                for (unsigned int fId : restoredMeshNonVisibleFaces) {
                     cg3::Vec3d normal = restoredMesh.faceNormal(fId);
                     const std::vector<int>& adjacentFaces = ffAdj.at(fId);
 
@@ -236,16 +251,41 @@ void recheckVisibilityAfterRestore(
                         restoredMeshAssociation[fId] = bestLabel;
                         facesReassigned++;
 
-                        done = false;
-                    }
-                    else {
-                        newNonVisibleFaces.push_back(fId);
+                        facePosition[fId] = -1;
+
+                        //Adjacent non-visible faces have to be checked again
+                        for (const unsigned int adjId : adjacentFaces) {
+                            const int adjPosition = facePosition[adjId];
+
+                            if (adjPosition > static_cast<int>(position)) {
+                                if (!isPendingCurrent[adjPosition]) {
+                                    isPendingCurrent[adjPosition] = true;
+                                    currentRound.push(static_cast<unsigned int>(adjPosition));
+                                }
+                            }
+                            else if (adjPosition >= 0) {
+                                if (!isPendingNext[adjPosition]) {
+                                    isPendingNext[adjPosition] = true;
+                                    nextRound.push(static_cast<unsigned int>(adjPosition));
+                                }
+                            }
+                        }
                     }
                 }
 
-                restoredMeshNonVisibleFaces = newNonVisibleFaces;
+                std::swap(currentRound, nextRound);
+                std::swap(isPendingCurrent, isPendingNext);
+            }
 
-            } while (!done);
+            //Faces still non-visible
+            std::vector<unsigned int> newNonVisibleFaces;
+            for (unsigned int fId : restoredMeshNonVisibleFaces) {
+                if (facePosition[fId] >= 0) {
+                    newNonVisibleFaces.push_back(fId);
+                }
+            }
+
+            restoredMeshNonVisibleFaces = newNonVisibleFaces;
 
             std::cout << "Faces reassigned: " << facesReassigned << std::endl;
         }
@@ -283,6 +323,8 @@ bool restoreFrequenciesValidHeightfields(
         const Data& data,
         const double heightfieldAngle)
 {
+    MetricsZone zone("Heightfield validation");
+
     bool aVertexHasMoved = false;
     for(unsigned int vId = 0; vId < targetMesh.numberVertices(); ++vId) {
         //Get current and target point
@@ -0,0 +1,124 @@
+#include "faf_heightmap.h"
+
+#include <algorithm>
+#include <cmath>
+
+#define HEIGHTMAP_BAND_ROWS 16
+
+namespace FourAxisFabrication {
+
+/**
+ * @brief Compute the heightmap of a mesh: for each cell of the grid, the max
+ * z-coordinate of the mesh (in the rotated frame) sampled in the cell center.
+ * The cells which are not covered by the mesh have -infinity height.
+ * The triangles are binned in bands of rows, which are rasterized in parallel.
+ * @param[in] mesh Input mesh
+ * @param[in] rotationMatrix Rotation from the mesh frame to the heightmap frame
+ * @param[in] minX Min x-coordinate of the grid
+ * @param[in] minY Min y-coordinate of the grid
+ * @param[in] cellSize Size of the cells
+ * @param[in] sizeX Number of cells along x
+ * @param[in] sizeY Number of cells along y
+ * @param[out] heightmap Resulting heightmap
+ */
+void computeHeightmap(
+        const cg3::SimpleEigenMesh& mesh,
+        const Eigen::Matrix3d& rotationMatrix,
+        const double minX,
+        const double minY,
+        const double cellSize,
+        const unsigned int sizeX,
+        const unsigned int sizeY,
+        Heightmap& heightmap)
+{
+    heightmap.minX = minX;
+    heightmap.minY = minY;
+    heightmap.cellSize = cellSize;
+    heightmap.sizeX = sizeX;
+    heightmap.sizeY = sizeY;
+    heightmap.heights.assign(static_cast<size_t>(sizeX) * sizeY, -std::numeric_limits<float>::infinity());
+
+    if (sizeX == 0 || sizeY == 0)
+        return;
+
+    //Rotated vertices
+    const int nVertices = static_cast<int>(mesh.numberVertices());
+    std::vector<Eigen::Vector3d> vertices(nVertices);
+
+    #pragma omp parallel for
+    for (int vId = 0; vId < nVertices; vId++) {
+        const cg3::Point3d& p = mesh.vertex(vId);
+        vertices[vId] = rotationMatrix * Eigen::Vector3d(p.x(), p.y(), p.z());
+    }
+
+    //Triangles binned by bands of rows
+    const unsigned int nBands = (sizeY + HEIGHTMAP_BAND_ROWS - 1) / HEIGHTMAP_BAND_ROWS;
+    std::vector<std::vector<unsigned int>> bandFaces(nBands);
+
+    for (unsigned int fId = 0; fId < mesh.numberFaces(); fId++) {
+        const cg3::Point3i face = mesh.face(fId);
+
+        const double faceMinY = std::min(std::min(vertices[face.x()].y(), vertices[face.y()].y()), vertices[face.z()].y());
+        const double faceMaxY = std::max(std::max(vertices[face.x()].y(), vertices[face.y()].y()), vertices[face.z()].y());
+
+        const int firstRow = std::max(0, static_cast<int>(std::ceil((faceMinY - minY) / cellSize - 0.5)));
+        const int lastRow = std::min(static_cast<int>(sizeY) - 1, static_cast<int>(std::floor((faceMaxY - minY) / cellSize - 0.5)));
+
+        if (firstRow > lastRow)
+            continue;
+
+        for (int band = firstRow / HEIGHTMAP_BAND_ROWS; band <= lastRow / HEIGHTMAP_BAND_ROWS; band++) {
+            bandFaces[band].push_back(fId);
+        }
+    }
+
+    #pragma omp parallel for schedule(dynamic)
+    for (int band = 0; band < static_cast<int>(nBands); band++) {
+        const int bandFirstRow = band * HEIGHTMAP_BAND_ROWS;
+        const int bandLastRow = std::min(static_cast<int>(sizeY) - 1, bandFirstRow + HEIGHTMAP_BAND_ROWS - 1);
+
+        for (const unsigned int fId : bandFaces[band]) {
+            const cg3::Point3i face = mesh.face(fId);
+            const Eigen::Vector3d& a = vertices[face.x()];
+            const Eigen::Vector3d& b = vertices[face.y()];
+            const Eigen::Vector3d& c = vertices[face.z()];
+
+            const double area = (b.x() - a.x()) * (c.y() - a.y()) - (b.y() - a.y()) * (c.x() - a.x());
+            if (area == 0)
+                continue;
+
+            const double faceMinX = std::min(std::min(a.x(), b.x()), c.x());
+            const double faceMaxX = std::max(std::max(a.x(), b.x()), c.x());
+            const double faceMinY = std::min(std::min(a.y(), b.y()), c.y());
+            const double faceMaxY = std::max(std::max(a.y(), b.y()), c.y());
+
+            const int firstColumn = std::max(0, static_cast<int>(std::ceil((faceMinX - minX) / cellSize - 0.5)));
+            const int lastColumn = std::min(static_cast<int>(sizeX) - 1, static_cast<int>(std::floor((faceMaxX - minX) / cellSize - 0.5)));
+            const int firstRow = std::max(bandFirstRow, static_cast<int>(std::ceil((faceMinY - minY) / cellSize - 0.5)));
+            const int lastRow = std::min(bandLastRow, static_cast<int>(std::floor((faceMaxY - minY) / cellSize - 0.5)));
+
+            for (int j = firstRow; j <= lastRow; j++) {
+                const double y = minY + (j + 0.5) * cellSize;
+
+                for (int i = firstColumn; i <= lastColumn; i++) {
+                    const double x = minX + (i + 0.5) * cellSize;
+
+                    //Barycentric coordinates
+                    const double w0 = ((b.x() - x) * (c.y() - y) - (b.y() - y) * (c.x() - x)) / area;
+                    const double w1 = ((c.x() - x) * (a.y() - y) - (c.y() - y) * (a.x() - x)) / area;
+                    const double w2 = 1 - w0 - w1;
+
+                    if (w0 < 0 || w1 < 0 || w2 < 0)
+                        continue;
+
+                    const float z = static_cast<float>(w0 * a.z() + w1 * b.z() + w2 * c.z());
+
+                    float& height = heightmap.heights[static_cast<size_t>(j) * sizeX + i];
+                    height = std::max(height, z);
+                }
+            }
+        }
+    }
+}
+
+}
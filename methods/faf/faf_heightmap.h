@@ -0,0 +1,43 @@
+#ifndef FAF_HEIGHTMAP_H
+#define FAF_HEIGHTMAP_H
+
+#include <vector>
+#include <limits>
+
+#include <Eigen/Core>
+
+#include <cg3/meshes/eigenmesh/eigenmesh.h>
+
+namespace FourAxisFabrication {
+
+/* Heightmap of a mesh on a regular grid */
+
+struct Heightmap {
+    double minX;
+    double minY;
+    double cellSize;
+    unsigned int sizeX;
+    unsigned int sizeY;
+    std::vector<float> heights;
+
+    inline bool isEmpty(const unsigned int i, const unsigned int j) const {
+        return heights[j * sizeX + i] == -std::numeric_limits<float>::infinity();
+    }
+    inline float height(const unsigned int i, const unsigned int j) const {
+        return heights[j * sizeX + i];
+    }
+};
+
+void computeHeightmap(
+        const cg3::SimpleEigenMesh& mesh,
+        const Eigen::Matrix3d& rotationMatrix,
+        const double minX,
+        const double minY,
+        const double cellSize,
+        const unsigned int sizeX,
+        const unsigned int sizeY,
+        Heightmap& heightmap);
+
+}
+
+#endif // FAF_HEIGHTMAP_H
@@ -0,0 +1,704 @@
+#include "faf_incremental.h"
+
+#include "faf_visibilitycheck.h"
+#include "faf_meshbuilder.h"
+
+#include <array>
+#include <map>
+#include <limits>
+#include <algorithm>
+#include <fstream>
+#include <stdexcept>
+
+#include <Eigen/Geometry>
+
+#include <cg3/libigl/mesh_adjacencies.h>
+
+namespace FourAxisFabrication {
+
+/* Useful function declaration */
+
+namespace internal {
+
+typedef std::array<double, 3> PositionKey;
+typedef std::array<PositionKey, 3> FacePositionKey;
+
+PositionKey getPositionKey(const cg3::Point3d& point);
+
+FacePositionKey getFacePositionKey(
+        const cg3::EigenMesh& mesh,
+        const unsigned int fId);
+
+void getFaceRange(
+        const cg3::EigenMesh& mesh,
+        const unsigned int fId,
+        const cg3::Vec3d& axis,
+        double& minValue,
+        double& maxValue);
+
+} //namespace internal
+
+
+
+/* ----- CHECKPOINT ----- */
+
+Checkpoint::Checkpoint()
+{
+    this->clear();
+}
+
+void Checkpoint::clear()
+{
+    data.clear();
+    smoothedMesh.clear();
+    visibility.clear();
+    associationVisibility.clear();
+    association.clear();
+    parameters.clear();
+}
+
+void Checkpoint::serialize(std::ofstream& binaryFile) const
+{
+    data.serialize(binaryFile);
+
+    cg3::serializeObjectAttributes(
+                "faf_checkpoint",
+                binaryFile,
+                smoothedMesh,
+                visibility,
+                associationVisibility,
+                association,
+                parameters,
+                data.chartSurfaces,
+                data.chartBoxes,
+                data.chartBoxesAssociation);
+}
+
+void Checkpoint::deserialize(std::ifstream& binaryFile)
+{
+    data.deserialize(binaryFile);
+
+    cg3::deserializeObjectAttributes(
+                "faf_checkpoint",
+                binaryFile,
+                smoothedMesh,
+                visibility,
+                associationVisibility,
+                association,
+                parameters,
+                data.chartSurfaces,
+                data.chartBoxes,
+                data.chartBoxesAssociation);
+}
+
+/**
+ * @brief Save a checkpoint on a binary file
+ * @param[in] checkpoint Checkpoint
+ * @param[in] filename Name of the file
+ * @returns True if the file has been saved
+ */
+bool saveCheckpoint(
+        const Checkpoint& checkpoint,
+        const std::string& filename)
+{
+    std::ofstream binaryFile(filename, std::ios::out | std::ios::binary);
+    if (!binaryFile.is_open())
+        return false;
+
+    checkpoint.serialize(binaryFile);
+
+    binaryFile.close();
+    return !binaryFile.fail();
+}
+
+/**
+ * @brief Load a checkpoint from a binary file
+ * @param[in] filename Name of the file
+ * @param[out] checkpoint Checkpoint
+ * @returns True if the file has been loaded
+ */
+bool loadCheckpoint(
+        const std::string& filename,
+        Checkpoint& checkpoint)
+{
+    std::ifstream binaryFile(filename, std::ios::in | std::ios::binary);
+    if (!binaryFile.is_open())
+        return false;
+
+    try {
+        checkpoint.deserialize(binaryFile);
+    }
+    catch (const std::ios_base::failure&) {
+        checkpoint.clear();
+        return false;
+    }
+
+    return true;
+}
+
+
+
+/* ----- MESH EDIT ----- */
+
+/**
+ * @brief Find the edit of the input mesh w.r.t. the input mesh of a checkpoint.
+ * The vertices are matched by their exact position, the faces by the positions
+ * of their vertices (in the same order, up to a rotation): the faces which are
+ * not matched are the changed faces of the mesh and the removed faces of the
+ * previous mesh.
+ * @param[in] previousMesh Input mesh of the checkpoint
+ * @param[in] mesh Edited input mesh
+ * @param[out] edit Edit of the mesh
+ * @returns True if the mesh has been changed
+ */
+bool findMeshEdit(
+        const cg3::EigenMesh& previousMesh,
+        const cg3::EigenMesh& mesh,
+        MeshEdit& edit)
+{
+    std::vector<int>& vertexMap = edit.vertexMap;
+    std::vector<int>& faceMap = edit.faceMap;
+    std::vector<bool>& isChanged = edit.isChanged;
+    std::vector<unsigned int>& changedFaces = edit.changedFaces;
+    std::vector<unsigned int>& previousChangedFaces = edit.previousChangedFaces;
+
+    //Match vertices
+    std::map<internal::PositionKey, unsigned int> previousVertices;
+    for (unsigned int vId = 0; vId < previousMesh.numberVertices(); vId++) {
+        previousVertices.insert(std::make_pair(internal::getPositionKey(previousMesh.vertex(vId)), vId));
+    }
+
+    vertexMap.assign(mesh.numberVertices(), -1);
+    for (unsigned int vId = 0; vId < mesh.numberVertices(); vId++) {
+        std::map<internal::PositionKey, unsigned int>::const_iterator it =
+                previousVertices.find(internal::getPositionKey(mesh.vertex(vId)));
+
+        if (it != previousVertices.end())
+            vertexMap[vId] = static_cast<int>(it->second);
+    }
+
+    //Match faces (a face can be matched only once)
+    std::map<internal::FacePositionKey, std::vector<unsigned int>> previousFaces;
+    for (unsigned int fId = 0; fId < previousMesh.numberFaces(); fId++) {
+        previousFaces[internal::getFacePositionKey(previousMesh, fId)].push_back(fId);
+    }
+
+    std::vector<bool> isPreviousMatched(previousMesh.numberFaces(), false);
+
+    faceMap.assign(mesh.numberFaces(), -1);
+    isChanged.assign(mesh.numberFaces(), true);
+    changedFaces.clear();
+    for (unsigned int fId = 0; fId < mesh.numberFaces(); fId++) {
+        std::map<internal::FacePositionKey, std::vector<unsigned int>>::iterator it =
+                previousFaces.find(internal::getFacePositionKey(mesh, fId));
+
+        if (it != previousFaces.end() && !it->second.empty()) {
+            faceMap[fId] = static_cast<int>(it->second.back());
+            isChanged[fId] = false;
+            isPreviousMatched[it->second.back()] = true;
+            it->second.pop_back();
+        }
+        else {
+            changedFaces.push_back(fId);
+        }
+    }
+
+    previousChangedFaces.clear();
+    for (unsigned int fId = 0; fId < previousMesh.numberFaces(); fId++) {
+        if (!isPreviousMatched[fId])
+            previousChangedFaces.push_back(fId);
+    }
+
+    return !changedFaces.empty() || !previousChangedFaces.empty();
+}
+
+/**
+ * @brief Place the edited input mesh in the frame of the processed mesh of the
+ * checkpoint (after the scale and the optimal orientation): the similarity between
+ * the input mesh and the processed mesh of the checkpoint is applied to the edited
+ * mesh, and the matched vertices are set to their previous position.
+ * @param[in] previous Checkpoint
+ * @param[in] edit Edit of the mesh
+ * @param[out] mesh Edited mesh, in the frame of the checkpoint
+ */
+void placeInCheckpointFrame(
+        const Checkpoint& previous,
+        const MeshEdit& edit,
+        cg3::EigenMesh& mesh)
+{
+    const cg3::EigenMesh& previousOriginalMesh = previous.data.originalMesh;
+    const cg3::EigenMesh& previousMesh = previous.data.mesh;
+
+    if (previousOriginalMesh.numberVertices() != previousMesh.numberVertices() || previousMesh.numberVertices() < 3) {
+        throw std::runtime_error("Error: the checkpoint does not contain a processed mesh!");
+    }
+
+    //Similarity between the input mesh and the processed mesh
+    const unsigned int nPreviousVertices = previousMesh.numberVertices();
+    Eigen::Matrix3Xd source(3, nPreviousVertices);
+    Eigen::Matrix3Xd target(3, nPreviousVertices);
+    for (unsigned int vId = 0; vId < nPreviousVertices; vId++) {
+        const cg3::Point3d p1 = previousOriginalMesh.vertex(vId);
+        const cg3::Point3d p2 = previousMesh.vertex(vId);
+        source.col(vId) = Eigen::Vector3d(p1.x(), p1.y(), p1.z());
+        target.col(vId) = Eigen::Vector3d(p2.x(), p2.y(), p2.z());
+    }
+    const Eigen::Matrix4d transformation = Eigen::umeyama(source, target, true);
+
+    //Transform the mesh
+    for (unsigned int vId = 0; vId < mesh.numberVertices(); vId++) {
+        if (edit.vertexMap[vId] >= 0) {
+            mesh.setVertex(vId, previousMesh.vertex(static_cast<unsigned int>(edit.vertexMap[vId])));
+        }
+        else {
+            const cg3::Point3d p = mesh.vertex(vId);
+            const Eigen::Vector4d transformed = transformation * Eigen::Vector4d(p.x(), p.y(), p.z(), 1.0);
+            mesh.setVertex(vId, cg3::Point3d(transformed.x(), transformed.y(), transformed.z()));
+        }
+    }
+
+    mesh.updateBoundingBox();
+    mesh.updateFacesAndVerticesNormals();
+}
+
+/**
+ * @brief Snap the smoothed mesh to the smoothed mesh of the checkpoint: the
+ * matched vertices within the tolerance take their previous position, the faces
+ * with a vertex farther than the tolerance are added to the changed faces (the
+ * smoothing spreads the edit), and the previous faces which are not matched
+ * anymore to an unchanged face are added to the removed ones.
+ * @param[in] previous Checkpoint
+ * @param[in] tolerance Maximum distance of a vertex from its previous position
+ * @param[out] smoothedMesh Smoothed mesh
+ * @param[out] edit Edit of the mesh
+ */
+void snapSmoothedMesh(
+        const Checkpoint& previous,
+        const double tolerance,
+        cg3::EigenMesh& smoothedMesh,
+        MeshEdit& edit)
+{
+    const cg3::EigenMesh& previousSmoothedMesh = previous.smoothedMesh;
+
+    const unsigned int nVertices = smoothedMesh.numberVertices();
+    const unsigned int nFaces = smoothedMesh.numberFaces();
+
+    //Snap the vertices
+    std::vector<bool> isMoved(nVertices, true);
+    for (unsigned int vId = 0; vId < nVertices; vId++) {
+        const int previousId = edit.vertexMap[vId];
+
+        if (previousId >= 0 && static_cast<unsigned int>(previousId) < previousSmoothedMesh.numberVertices()) {
+            const cg3::Point3d previousPoint = previousSmoothedMesh.vertex(static_cast<unsigned int>(previousId));
+
+            if ((smoothedMesh.vertex(vId) - previousPoint).length() <= tolerance) {
+                smoothedMesh.setVertex(vId, previousPoint);
+                isMoved[vId] = false;
+            }
+        }
+    }
+
+    smoothedMesh.updateBoundingBox();
+    smoothedMesh.updateFacesAndVerticesNormals();
+
+    //Changed faces
+    std::vector<bool> isPreviousMatched(previousSmoothedMesh.numberFaces(), false);
+
+    edit.changedFaces.clear();
+    for (unsigned int fId = 0; fId < nFaces; fId++) {
+        const cg3::Point3i face = smoothedMesh.face(fId);
+
+        if (isMoved[face.x()] || isMoved[face.y()] || isMoved[face.z()]) {
+            edit.isChanged[fId] = true;
+        }
+
+        if (edit.isChanged[fId]) {
+            edit.changedFaces.push_back(fId);
+        }
+        else {
+            isPreviousMatched[static_cast<unsigned int>(edit.faceMap[fId])] = true;
+        }
+    }
+
+    //Removed faces
+    edit.previousChangedFaces.clear();
+    for (unsigned int fId = 0; fId < previousSmoothedMesh.numberFaces(); fId++) {
+        if (!isPreviousMatched[fId])
+            edit.previousChangedFaces.push_back(fId);
+    }
+}
+
+
+
+/* ----- INCREMENTAL VISIBILITY ----- */
+
+/**
+ * @brief Get the visibility of the edited mesh from the visibility of the checkpoint.
+ * The lateral directions are orthogonal to the x-axis, so the faces which can occlude
+ * a face (or be occluded by it) overlap its slab on the x-axis: the visibility is
+ * recomputed only for the faces overlapping the slab of the changed faces (old and new),
+ * checked against the faces overlapping their slab. Moreover, from each direction the
+ * visibility of a face in the slab is recomputed only if its projection overlaps the
+ * projection of the changed faces, or if it is changed. The other entries are taken
+ * from the checkpoint. The directions are the ones of the checkpoint, the visibility
+ * of the extremes directions is set from the current extremes.
+ * @param[in] previous Checkpoint
+ * @param[in] smoothedMesh Smoothed mesh
+ * @param[in] edit Edit of the smoothed mesh
+ * @param[in] heightfieldAngle Limit angle with triangles normal in order to be a heightfield
+ * @param[in] checkMode Check mode for visibility
+ * @param[in] margin Margin added to the ranges of the changed faces
+ * @param[out] data Four axis fabrication data
+ * @param[out] report Report of the incremental run
+ */
+void getIncrementalVisibility(
+        const Checkpoint& previous,
+        const cg3::EigenMesh& smoothedMesh,
+        const MeshEdit& edit,
+        const double heightfieldAngle,
+        const CheckMode checkMode,
+        const double margin,
+        Data& data,
+        IncrementalReport& report)
+{
+    const cg3::EigenMesh& previousSmoothedMesh = previous.smoothedMesh;
+    const cg3::Array2D<int>& previousVisibility = previous.visibility;
+    const std::vector<cg3::Vec3d>& directions = previous.data.directions;
+
+    const unsigned int nFaces = smoothedMesh.numberFaces();
+    const unsigned int nDirections = directions.size();
+    const unsigned int nLateralDirections = nDirections - 2;
+
+    const cg3::Vec3d xAxis(1,0,0);
+
+    cg3::Array2D<int>& visibility = data.visibility;
+    visibility.clear();
+    visibility.resize(nDirections, nFaces);
+    visibility.fill(0);
+
+    //Vertices of the changed faces, old and new
+    std::vector<cg3::Point3d> editPoints;
+    for (unsigned int fId : edit.changedFaces) {
+        const cg3::Point3i face = smoothedMesh.face(fId);
+        for (unsigned int i = 0; i < 3; i++)
+            editPoints.push_back(smoothedMesh.vertex(face[i]));
+    }
+    for (unsigned int fId : edit.previousChangedFaces) {
+        const cg3::Point3i face = previousSmoothedMesh.face(fId);
+        for (unsigned int i = 0; i < 3; i++)
+            editPoints.push_back(previousSmoothedMesh.vertex(face[i]));
+    }
+
+    //Range of the edit on the x-axis
+    double editMinX = std::numeric_limits<double>::max();
+    double editMaxX = -std::numeric_limits<double>::max();
+    for (const cg3::Point3d& p : editPoints) {
+        editMinX = std::min(editMinX, p.x() - margin);
+        editMaxX = std::max(editMaxX, p.x() + margin);
+    }
+
+    //Faces in the slab of the edit, and range of their slab
+    std::vector<bool> isInSlab(nFaces, false);
+    std::vector<unsigned int> slabFaces;
+    double slabMinX = std::numeric_limits<double>::max();
+    double slabMaxX = -std::numeric_limits<double>::max();
+    for (unsigned int fId = 0; fId < nFaces; fId++) {
+        double minX, maxX;
+        internal::getFaceRange(smoothedMesh, fId, xAxis, minX, maxX);
+
+        if (maxX >= editMinX && minX <= editMaxX) {
+            isInSlab[fId] = true;
+            slabFaces.push_back(fId);
+            slabMinX = std::min(slabMinX, minX);
+            slabMaxX = std::max(slabMaxX, maxX);
+        }
+    }
+
+    //Faces which can occlude the faces in the slab
+    std::vector<int> faceToOccluder(nFaces, -1);
+    std::vector<int> vertexToOccluder(smoothedMesh.numberVertices(), -1);
+    MeshBuilder occluderBuilder;
+    for (unsigned int fId = 0; fId < nFaces; fId++) {
+        double minX, maxX;
+        internal::getFaceRange(smoothedMesh, fId, xAxis, minX, maxX);
+
+        if (!slabFaces.empty() && maxX >= slabMinX && minX <= slabMaxX) {
+            const cg3::Point3i face = smoothedMesh.face(fId);
+
+            unsigned int v[3];
+            for (unsigned int i = 0; i < 3; i++) {
+                if (vertexToOccluder[face[i]] < 0)
+                    vertexToOccluder[face[i]] = static_cast<int>(occluderBuilder.addVertex(smoothedMesh.vertex(face[i])));
+                v[i] = static_cast<unsigned int>(vertexToOccluder[face[i]]);
+            }
+
+            faceToOccluder[fId] = static_cast<int>(occluderBuilder.addFace(v[0], v[1], v[2]));
+        }
+    }
+
+    //Range of the edit on the axis of the projection orthogonal to the x-axis
+    std::vector<double> editMinU(nLateralDirections), editMaxU(nLateralDirections);
+    for (unsigned int dirIndex = 0; dirIndex < nLateralDirections; dirIndex++) {
+        const cg3::Vec3d uAxis(0, directions[dirIndex].z(), -directions[dirIndex].y());
+
+        editMinU[dirIndex] = std::numeric_limits<double>::max();
+        editMaxU[dirIndex] = -std::numeric_limits<double>::max();
+        for (const cg3::Point3d& p : editPoints) {
+            editMinU[dirIndex] = std::min(editMinU[dirIndex], p.dot(uAxis) - margin);
+            editMaxU[dirIndex] = std::max(editMaxU[dirIndex], p.dot(uAxis) + margin);
+        }
+    }
+
+    //Visibility of the faces of the slab (the changed faces are seen from all the directions)
+    cg3::Array2D<int> occluderVisibility;
+    if (!slabFaces.empty()) {
+        std::vector<unsigned int> lateralDirections(nLateralDirections);
+        for (unsigned int dirIndex = 0; dirIndex < nLateralDirections; dirIndex++) {
+            lateralDirections[dirIndex] = dirIndex;
+        }
+
+        const cg3::EigenMesh occluderMesh = occluderBuilder.build();
+
+        VisibilityProvider provider(occluderMesh, nLateralDirections, heightfieldAngle, false, std::vector<unsigned int>(), std::vector<unsigned int>(), checkMode);
+        if (provider.numberDirections() != nDirections) {
+            throw std::runtime_error("Error: the number of directions does not match the checkpoint!");
+        }
+
+        provider.fill(lateralDirections, occluderVisibility);
+    }
+
+    //Merge the visibility
+    size_t nRecomputed = 0;
+    #pragma omp parallel for reduction(+:nRecomputed)
+    for (int dirIndex = 0; dirIndex < static_cast<int>(nLateralDirections); dirIndex++) {
+        const cg3::Vec3d uAxis(0, directions[dirIndex].z(), -directions[dirIndex].y());
+
+        for (unsigned int fId = 0; fId < nFaces; fId++) {
+            bool recompute = false;
+            if (isInSlab[fId]) {
+                if (edit.isChanged[fId]) {
+                    recompute = true;
+                }
+                else {
+                    double minU, maxU;
+                    internal::getFaceRange(smoothedMesh, fId, uAxis, minU, maxU);
+                    recompute = maxU >= editMinU[dirIndex] && minU <= editMaxU[dirIndex];
+                }
+            }
+
+            if (recompute) {
+                visibility(dirIndex, fId) = occluderVisibility(dirIndex, static_cast<unsigned int>(faceToOccluder[fId]));
+                nRecomputed++;
+            }
+            else {
+                visibility(dirIndex, fId) = previousVisibility(dirIndex, static_cast<unsigned int>(edit.faceMap[fId]));
+            }
+        }
+    }
+
+    //Visibility of the extremes
+    for (unsigned int fId : data.minExtremes) {
+        visibility(nLateralDirections, fId) = 1;
+    }
+    for (unsigned int fId : data.maxExtremes) {
+        visibility(nLateralDirections + 1, fId) = 1;
+    }
+
+    data.directions = directions;
+    data.angles = previous.data.angles;
+    data.occluders.clear();
+    data.visibilityMargins.clear();
+
+    //Non-visible faces
+    data.nonVisibleFaces.clear();
+    for (unsigned int fId = 0; fId < nFaces; fId++) {
+        bool found = false;
+        for (unsigned int dirIndex = 0; dirIndex < nDirections && !found; dirIndex++) {
+            if (visibility(dirIndex, fId) == 1)
+                found = true;
+        }
+
+        if (!found)
+            data.nonVisibleFaces.push_back(fId);
+    }
+
+    report.slabMinX = slabFaces.empty() ? 0 : slabMinX;
+    report.slabMaxX = slabFaces.empty() ? 0 : slabMaxX;
+    report.nSlabFaces = slabFaces.size();
+    report.nOccluderFaces = occluderBuilder.numberFaces();
+    report.nRecomputedVisibility = nRecomputed;
+    report.nReusedVisibility = static_cast<size_t>(nLateralDirections) * nFaces - nRecomputed;
+}
+
+
+
+/* ----- ASSOCIATION BAND ----- */
+
+/**
+ * @brief Set the initial association of the edited mesh and select the band of
+ * faces to be associated again. The unchanged faces take the association of the
+ * checkpoint, the changed faces the visible direction closest to their normal.
+ * The band contains the changed faces, the faces whose visibility has changed
+ * (extremes included), and the faces within the given number of rings from them.
+ * The checked visibility is compared with the one of the checkpoint, and the
+ * visibility used by the graph-cut (after the accessibility check and the visibility
+ * angle) with the one used by the graph-cut of the checkpoint.
+ * @param[in] previous Checkpoint
+ * @param[in] smoothedMesh Smoothed mesh
+ * @param[in] edit Edit of the smoothed mesh
+ * @param[in] nRings Number of rings around the changed faces
+ * @param[in] checkedVisibility Visibility before the accessibility check
+ * @param[out] data Four axis fabrication data (visibility used by the graph-cut)
+ * @param[out] bandFaces Faces of the band
+ */
+void selectAssociationBand(
+        const Checkpoint& previous,
+        const cg3::EigenMesh& smoothedMesh,
+        const MeshEdit& edit,
+        const unsigned int nRings,
+        const cg3::Array2D<int>& checkedVisibility,
+        Data& data,
+        std::vector<unsigned int>& bandFaces)
+{
+    const cg3::Array2D<int>& previousCheckedVisibility = previous.visibility;
+    const cg3::Array2D<int>& previousVisibility = previous.associationVisibility;
+    const cg3::Array2D<int>& visibility = data.visibility;
+    const std::vector<cg3::Vec3d>& directions = data.directions;
+    std::vector<int>& association = data.association;
+
+    const unsigned int nFaces = smoothedMesh.numberFaces();
+    const unsigned int nDirections = directions.size();
+
+    association.assign(nFaces, -1);
+
+    std::vector<bool> isInBand(nFaces, false);
+    bandFaces.clear();
+
+    for (unsigned int fId = 0; fId < nFaces; fId++) {
+        bool isSeed = edit.isChanged[fId];
+
+        if (!isSeed) {
+            const unsigned int previousId = static_cast<unsigned int>(edit.faceMap[fId]);
+
+            association[fId] = previous.association[previousId];
+
+            for (unsigned int dirIndex = 0; dirIndex < nDirections && !isSeed; dirIndex++) {
+                if (checkedVisibility(dirIndex, fId) != previousCheckedVisibility(dirIndex, previousId) ||
+                        visibility(dirIndex, fId) != previousVisibility(dirIndex, previousId))
+                    isSeed = true;
+            }
+        }
+        else {
+            //Visible direction closest to the normal (any direction if it is not visible)
+            const cg3::Vec3d normal = smoothedMesh.faceNormal(fId);
+            double bestDot = -std::numeric_limits<double>::max();
+            bool bestVisible = false;
+            for (unsigned int dirIndex = 0; dirIndex < nDirections; dirIndex++) {
+                const bool visible = visibility(dirIndex, fId) == 1;
+                const double dot = normal.dot(directions[dirIndex]);
+
+                if ((visible && !bestVisible) || (visible == bestVisible && dot > bestDot)) {
+                    association[fId] = static_cast<int>(dirIndex);
+                    bestDot = dot;
+                    bestVisible = visible;
+                }
+            }
+        }
+
+        if (isSeed) {
+            isInBand[fId] = true;
+            bandFaces.push_back(fId);
+        }
+    }
+
+    //Rings around the seeds
+    const std::vector<std::vector<int>> ffAdj = cg3::libigl::faceToFaceAdjacencies(smoothedMesh);
+
+    size_t ringStart = 0;
+    for (unsigned int ring = 0; ring < nRings; ring++) {
+        const size_t ringEnd = bandFaces.size();
+
+        for (size_t i = ringStart; i < ringEnd; i++) {
+            for (const int adjId : ffAdj[bandFaces[i]]) {
+                if (!isInBand[adjId]) {
+                    isInBand[adjId] = true;
+                    bandFaces.push_back(static_cast<unsigned int>(adjId));
+                }
+            }
+        }
+
+        ringStart = ringEnd;
+    }
+
+    std::sort(bandFaces.begin(), bandFaces.end());
+}
+
+
+
+/* ----- INTERNAL FUNCTION DEFINITION ----- */
+
+namespace internal {
+
+/**
+ * @brief Get the key of a position
+ * @param[in] point Point
+ * @returns Key
+ */
+PositionKey getPositionKey(const cg3::Point3d& point)
+{
+    return PositionKey{{point.x(), point.y(), point.z()}};
+}
+
+/**
+ * @brief Get the key of a face: the positions of its vertices, starting
+ * from the smallest one and keeping the orientation
+ * @param[in] mesh Mesh
+ * @param[in] fId Face id
+ * @returns Key
+ */
+FacePositionKey getFacePositionKey(
+        const cg3::EigenMesh& mesh,
+        const unsigned int fId)
+{
+    const cg3::Point3i face = mesh.face(fId);
+
+    FacePositionKey key;
+    for (unsigned int i = 0; i < 3; i++) {
+        key[i] = getPositionKey(mesh.vertex(face[i]));
+    }
+
+    const size_t first = std::min_element(key.begin(), key.end()) - key.begin();
+    std::rotate(key.begin(), key.begin() + first, key.end());
+
+    return key;
+}
+
+/**
+ * @brief Get the range of the vertices of a face on an axis
+ * @param[in] mesh Mesh
+ * @param[in] fId Face id
+ * @param[in] axis Axis
+ * @param[out] minValue Min value
+ * @param[out] maxValue Max value
+ */
+void getFaceRange(
+        const cg3::EigenMesh& mesh,
+        const unsigned int fId,
+        const cg3::Vec3d& axis,
+        double& minValue,
+        double& maxValue)
+{
+    const cg3::Point3i face = mesh.face(fId);
+
+    minValue = std::numeric_limits<double>::max();
+    maxValue = -std::numeric_limits<double>::max();
+    for (unsigned int i = 0; i < 3; i++) {
+        const double value = mesh.vertex(face[i]).dot(axis);
+        minValue = std::min(minValue, value);
+        maxValue = std::max(maxValue, value);
+    }
+}
+
+} //namespace internal
+
+}
@@ -0,0 +1,127 @@
+#ifndef FAF_INCREMENTAL_H
+#define FAF_INCREMENTAL_H
+
+#include <vector>
+#include <string>
+#include <map>
+
+#include <cg3/data_structures/arrays/array2d.h>
+
+#include <cg3/meshes/eigenmesh/eigenmesh.h>
+
+#include "faf_data.h"
+
+namespace FourAxisFabrication {
+
+/* Checkpoint of a pipeline run: the final data and the outputs of the stages
+ * which are overwritten by the next ones */
+
+class Checkpoint : cg3::SerializableObject {
+
+public:
+
+    Checkpoint();
+
+    /* Final data */
+    Data data;
+
+    /* Smoothed mesh checked for visibility (before the boundary smoothing) */
+    cg3::EigenMesh smoothedMesh;
+
+    /* Visibility before the accessibility check */
+    cg3::Array2D<int> visibility;
+
+    /* Visibility used by the graph-cut (after the accessibility check and the visibility angle) */
+    cg3::Array2D<int> associationVisibility;
+
+    /* Association of the graph-cut (before the optimization) */
+    std::vector<int> association;
+
+    /* Parameters of the run which affect the stage outputs (name, value) */
+    std::map<std::string, std::string> parameters;
+
+
+    /* Methods */
+
+    void clear();
+
+
+    // SerializableObject interface
+    void serialize(std::ofstream &binaryFile) const;
+    void deserialize(std::ifstream &binaryFile);
+};
+
+bool saveCheckpoint(
+        const Checkpoint& checkpoint,
+        const std::string& filename);
+
+bool loadCheckpoint(
+        const std::string& filename,
+        Checkpoint& checkpoint);
+
+
+/* Edit of the input mesh w.r.t. a checkpoint */
+
+struct MeshEdit {
+    std::vector<int> vertexMap;
+    std::vector<int> faceMap;
+    std::vector<bool> isChanged;
+    std::vector<unsigned int> changedFaces;
+    std::vector<unsigned int> previousChangedFaces;
+};
+
+/* Report of the incremental run */
+
+struct IncrementalReport {
+    unsigned int nChangedFaces;
+    unsigned int nRemovedFaces;
+    unsigned int nSmoothedChangedFaces;
+    double slabMinX;
+    double slabMaxX;
+    unsigned int nSlabFaces;
+    unsigned int nOccluderFaces;
+    size_t nRecomputedVisibility;
+    size_t nReusedVisibility;
+    unsigned int nBandFaces;
+    unsigned int nReusedBoxes;
+    unsigned int nBoxes;
+};
+
+bool findMeshEdit(
+        const cg3::EigenMesh& previousMesh,
+        const cg3::EigenMesh& mesh,
+        MeshEdit& edit);
+
+void placeInCheckpointFrame(
+        const Checkpoint& previous,
+        const MeshEdit& edit,
+        cg3::EigenMesh& mesh);
+
+void snapSmoothedMesh(
+        const Checkpoint& previous,
+        const double tolerance,
+        cg3::EigenMesh& smoothedMesh,
+        MeshEdit& edit);
+
+void getIncrementalVisibility(
+        const Checkpoint& previous,
+        const cg3::EigenMesh& smoothedMesh,
+        const MeshEdit& edit,
+        const double heightfieldAngle,
+        const CheckMode checkMode,
+        const double margin,
+        Data& data,
+        IncrementalReport& report);
+
+void selectAssociationBand(
+        const Checkpoint& previous,
+        const cg3::EigenMesh& smoothedMesh,
+        const MeshEdit& edit,
+        const unsigned int nRings,
+        const cg3::Array2D<int>& checkedVisibility,
+        Data& data,
+        std::vector<unsigned int>& bandFaces);
+
+}
+
+#endif // FAF_INCREMENTAL_H
@@ -0,0 +1,665 @@
+#include "faf_maxflow.h"
+
+#include <limits>
+
+#define MAXFLOW_FREE -1
+#define MAXFLOW_TERMINAL -2
+#define MAXFLOW_ORPHAN -3
+#define MAXFLOW_INFINITE_DIST std::numeric_limits<int>::max()
+
+namespace FourAxisFabrication {
+
+/**
+ * @brief Max-flow graph, solved by the Boykov-Kolmogorov algorithm.
+ * After the first maxflow, the terminal capacities can be changed and
+ * the flow recomputed reusing the residual graph and the search trees:
+ * the nodes whose terminal capacities have been changed must be marked.
+ */
+MaxFlowGraph::MaxFlowGraph() :
+    flow(0),
+    time(0),
+    maxflowIteration(0)
+{
+
+}
+
+/**
+ * @brief Reserve memory for the graph
+ * @param[in] nNodes Number of nodes
+ * @param[in] nEdges Number of edges (each edge has two arcs)
+ */
+void MaxFlowGraph::reserve(const unsigned int nNodes, const unsigned int nEdges)
+{
+    nodes.reserve(nNodes);
+    arcs.reserve(nEdges * 2);
+}
+
+/**
+ * @brief Remove all the nodes and the edges
+ */
+void MaxFlowGraph::clear()
+{
+    nodes.clear();
+    arcs.clear();
+    activeQueues[0].clear();
+    activeQueues[1].clear();
+    orphans.clear();
+    markedNodes.clear();
+    flow = 0;
+    time = 0;
+    maxflowIteration = 0;
+}
+
+/**
+ * @brief Add nodes to the graph
+ * @param[in] nNodes Number of nodes to be added
+ * @returns Index of the first added node
+ */
+int MaxFlowGraph::addNodes(const unsigned int nNodes)
+{
+    const int firstNode = static_cast<int>(nodes.size());
+
+    Node node;
+    node.first = -1;
+    node.parent = MAXFLOW_FREE;
+    node.isActive = false;
+    node.isSink = false;
+    node.isMarked = false;
+    node.ts = 0;
+    node.dist = 0;
+    node.trCap = 0;
+
+    nodes.resize(nodes.size() + nNodes, node);
+
+    return firstNode;
+}
+
+/**
+ * @brief Add an edge between two nodes. The two arcs are stored consecutively,
+ * so the sister of an arc is obtained flipping the last bit of its index.
+ * @param[in] i First node
+ * @param[in] j Second node
+ * @param[in] cap Capacity from i to j
+ * @param[in] revCap Capacity from j to i
+ */
+void MaxFlowGraph::addEdge(const int i, const int j, const double cap, const double revCap)
+{
+    const int a = static_cast<int>(arcs.size());
+
+    Arc arc;
+    arc.head = j;
+    arc.next = nodes[i].first;
+    arc.rCap = cap;
+    arcs.push_back(arc);
+    nodes[i].first = a;
+
+    Arc revArc;
+    revArc.head = i;
+    revArc.next = nodes[j].first;
+    revArc.rCap = revCap;
+    arcs.push_back(revArc);
+    nodes[j].first = a + 1;
+}
+
+/**
+ * @brief Add capacities to the terminal edges of a node. The capacities
+ * can be negative: only their difference affects the cut.
+ * @param[in] i Node
+ * @param[in] capSource Capacity from the source
+ * @param[in] capSink Capacity to the sink
+ */
+void MaxFlowGraph::addTerminalWeights(const int i, const double capSource, const double capSink)
+{
+    double source = capSource;
+    double sink = capSink;
+
+    const double delta = nodes[i].trCap;
+    if (delta > 0)
+        source += delta;
+    else
+        sink -= delta;
+
+    flow += source < sink ? source : sink;
+    nodes[i].trCap = source - sink;
+}
+
+/**
+ * @brief Compute the max-flow
+ * @param[in] reuseTrees Reuse the flow and the search trees of the previous
+ * computation (only the marked nodes are updated)
+ * @returns Value of the flow
+ */
+double MaxFlowGraph::maxflow(const bool reuseTrees)
+{
+    if (reuseTrees && maxflowIteration > 0)
+        reuseTreesInitialize();
+    else
+        initialize();
+
+    int currentNode = -1;
+
+    while (true) {
+        int i = currentNode;
+        if (i >= 0) {
+            nodes[i].isActive = false;
+            if (nodes[i].parent == MAXFLOW_FREE)
+                i = -1;
+        }
+        if (i < 0) {
+            i = nextActive();
+            if (i < 0)
+                break;
+        }
+
+        //Growth
+        int a = -1;
+        if (!nodes[i].isSink) {
+            //Grow source tree
+            for (a = nodes[i].first; a >= 0; a = arcs[a].next) {
+                if (arcs[a].rCap > 0) {
+                    Node& j = nodes[arcs[a].head];
+                    if (j.parent == MAXFLOW_FREE) {
+                        j.isSink = false;
+                        j.parent = a ^ 1;
+                        j.ts = nodes[i].ts;
+                        j.dist = nodes[i].dist + 1;
+                        setActive(arcs[a].head);
+                    }
+                    else if (j.isSink) {
+                        break;
+                    }
+                    else if (j.ts <= nodes[i].ts && j.dist > nodes[i].dist) {
+                        //Trying to make the distance from j to the source shorter
+                        j.parent = a ^ 1;
+                        j.ts = nodes[i].ts;
+                        j.dist = nodes[i].dist + 1;
+                    }
+                }
+            }
+        }
+        else {
+            //Grow sink tree
+            for (a = nodes[i].first; a >= 0; a = arcs[a].next) {
+                if (arcs[a ^ 1].rCap > 0) {
+                    Node& j = nodes[arcs[a].head];
+                    if (j.parent == MAXFLOW_FREE) {
+                        j.isSink = true;
+                        j.parent = a ^ 1;
+                        j.ts = nodes[i].ts;
+                        j.dist = nodes[i].dist + 1;
+                        setActive(arcs[a].head);
+                    }
+                    else if (!j.isSink) {
+                        a = a ^ 1;
+                        break;
+                    }
+                    else if (j.ts <= nodes[i].ts && j.dist > nodes[i].dist) {
+                        //Trying to make the distance from j to the sink shorter
+                        j.parent = a ^ 1;
+                        j.ts = nodes[i].ts;
+                        j.dist = nodes[i].dist + 1;
+                    }
+                }
+            }
+        }
+
+        time++;
+
+        if (a >= 0) {
+            //The node stays active while it has paths to the other tree
+            nodes[i].isActive = true;
+            currentNode = i;
+
+            augment(a);
+            processOrphans();
+        }
+        else {
+            currentNode = -1;
+        }
+    }
+
+    maxflowIteration++;
+
+    return flow;
+}
+
+/**
+ * @brief Get the segment of a node after the max-flow. Nodes which are
+ * not in any tree are assigned to the source.
+ * @param[in] i Node
+ * @returns Segment of the node
+ */
+MaxFlowGraph::TermType MaxFlowGraph::segment(const int i) const
+{
+    if (nodes[i].parent != MAXFLOW_FREE)
+        return nodes[i].isSink ? SINK : SOURCE;
+    return SOURCE;
+}
+
+/**
+ * @brief Mark a node whose terminal capacities have been changed,
+ * before computing again the max-flow reusing the trees
+ * @param[in] i Node
+ */
+void MaxFlowGraph::markNode(const int i)
+{
+    if (!nodes[i].isMarked) {
+        nodes[i].isMarked = true;
+        markedNodes.push_back(i);
+    }
+}
+
+/**
+ * @brief Get the number of nodes
+ * @returns Number of nodes
+ */
+unsigned int MaxFlowGraph::numberNodes() const
+{
+    return static_cast<unsigned int>(nodes.size());
+}
+
+/**
+ * @brief Get the number of arcs (two for each edge)
+ * @returns Number of arcs
+ */
+unsigned int MaxFlowGraph::numberArcs() const
+{
+    return static_cast<unsigned int>(arcs.size());
+}
+
+/**
+ * @brief Get the memory used by the nodes and the arcs
+ * @returns Bytes used by the graph
+ */
+size_t MaxFlowGraph::memoryUsage() const
+{
+    return nodes.capacity() * sizeof(Node) + arcs.capacity() * sizeof(Arc) + markedNodes.capacity() * sizeof(int);
+}
+
+/**
+ * @brief Initialize the trees: nodes with capacity from the source
+ * are in the source tree, nodes with capacity to the sink in the sink tree
+ */
+void MaxFlowGraph::initialize()
+{
+    activeQueues[0].clear();
+    activeQueues[1].clear();
+    orphans.clear();
+    time = 0;
+
+    for (int i = 0; i < static_cast<int>(nodes.size()); i++) {
+        Node& node = nodes[i];
+        node.isActive = false;
+        node.isMarked = false;
+        node.ts = time;
+
+        if (node.trCap > 0) {
+            node.isSink = false;
+            node.parent = MAXFLOW_TERMINAL;
+            node.dist = 1;
+            setActive(i);
+        }
+        else if (node.trCap < 0) {
+            node.isSink = true;
+            node.parent = MAXFLOW_TERMINAL;
+            node.dist = 1;
+            setActive(i);
+        }
+        else {
+            node.parent = MAXFLOW_FREE;
+        }
+    }
+
+    markedNodes.clear();
+}
+
+/**
+ * @brief Update the trees of the previous max-flow on the marked nodes:
+ * the marked nodes are attached to the terminal of their new residual
+ * capacity, and the nodes which lose their parent become orphans
+ */
+void MaxFlowGraph::reuseTreesInitialize()
+{
+    activeQueues[0].clear();
+    activeQueues[1].clear();
+    orphans.clear();
+
+    time++;
+
+    for (const int i : markedNodes) {
+        Node& node = nodes[i];
+        node.isMarked = false;
+        setActive(i);
+
+        if (node.trCap == 0) {
+            if (node.parent != MAXFLOW_FREE)
+                setOrphanRear(i);
+            continue;
+        }
+
+        if (node.trCap > 0) {
+            if (node.parent == MAXFLOW_FREE || node.isSink) {
+                node.isSink = false;
+                for (int a = node.first; a >= 0; a = arcs[a].next) {
+                    Node& j = nodes[arcs[a].head];
+                    if (!j.isMarked) {
+                        if (j.parent == (a ^ 1))
+                            setOrphanRear(arcs[a].head);
+                        if (j.parent != MAXFLOW_FREE && j.isSink && arcs[a].rCap > 0)
+                            setActive(arcs[a].head);
+                    }
+                }
+            }
+        }
+        else {
+            if (node.parent == MAXFLOW_FREE || !node.isSink) {
+                node.isSink = true;
+                for (int a = node.first; a >= 0; a = arcs[a].next) {
+                    Node& j = nodes[arcs[a].head];
+                    if (!j.isMarked) {
+                        if (j.parent == (a ^ 1))
+                            setOrphanRear(arcs[a].head);
+                        if (j.parent != MAXFLOW_FREE && !j.isSink && arcs[a ^ 1].rCap > 0)
+                            setActive(arcs[a].head);
+                    }
+                }
+            }
+        }
+
+        node.parent = MAXFLOW_TERMINAL;
+        node.ts = time;
+        node.dist = 1;
+    }
+
+    markedNodes.clear();
+
+    processOrphans();
+}
+
+/**
+ * @brief Get the next active node: a node is active if it has a parent
+ * @returns Index of the node, -1 if there are no active nodes
+ */
+int MaxFlowGraph::nextActive()
+{
+    while (true) {
+        if (activeQueues[0].empty()) {
+            std::swap(activeQueues[0], activeQueues[1]);
+            if (activeQueues[0].empty())
+                return -1;
+        }
+
+        const int i = activeQueues[0].front();
+        activeQueues[0].pop_front();
+        nodes[i].isActive = false;
+
+        if (nodes[i].parent != MAXFLOW_FREE)
+            return i;
+    }
+}
+
+/**
+ * @brief Add a node to the active nodes, if it is not already active
+ * @param[in] i Node
+ */
+void MaxFlowGraph::setActive(const int i)
+{
+    if (!nodes[i].isActive) {
+        nodes[i].isActive = true;
+        activeQueues[1].push_back(i);
+    }
+}
+
+/**
+ * @brief Make a node orphan, to be processed before the others
+ * @param[in] i Node
+ */
+void MaxFlowGraph::setOrphanFront(const int i)
+{
+    nodes[i].parent = MAXFLOW_ORPHAN;
+    orphans.push_front(i);
+}
+
+/**
+ * @brief Make a node orphan, to be processed after the others
+ * @param[in] i Node
+ */
+void MaxFlowGraph::setOrphanRear(const int i)
+{
+    nodes[i].parent = MAXFLOW_ORPHAN;
+    orphans.push_back(i);
+}
+
+/**
+ * @brief Push the bottleneck flow on the path through an arc
+ * from the source tree to the sink tree
+ * @param[in] middleArc Arc connecting the two trees
+ */
+void MaxFlowGraph::augment(const int middleArc)
+{
+    int i;
+    int a;
+
+    //Bottleneck capacity: source tree
+    double bottleneck = arcs[middleArc].rCap;
+    for (i = arcs[middleArc ^ 1].head; ; i = arcs[a].head) {
+        a = nodes[i].parent;
+        if (a == MAXFLOW_TERMINAL)
+            break;
+        if (bottleneck > arcs[a ^ 1].rCap)
+            bottleneck = arcs[a ^ 1].rCap;
+    }
+    if (bottleneck > nodes[i].trCap)
+        bottleneck = nodes[i].trCap;
+
+    //Bottleneck capacity: sink tree
+    for (i = arcs[middleArc].head; ; i = arcs[a].head) {
+        a = nodes[i].parent;
+        if (a == MAXFLOW_TERMINAL)
+            break;
+        if (bottleneck > arcs[a].rCap)
+            bottleneck = arcs[a].rCap;
+    }
+    if (bottleneck > -nodes[i].trCap)
+        bottleneck = -nodes[i].trCap;
+
+    //Augmenting: source tree
+    arcs[middleArc ^ 1].rCap += bottleneck;
+    arcs[middleArc].rCap -= bottleneck;
+    for (i = arcs[middleArc ^ 1].head; ; i = arcs[a].head) {
+        a = nodes[i].parent;
+        if (a == MAXFLOW_TERMINAL)
+            break;
+        arcs[a].rCap += bottleneck;
+        arcs[a ^ 1].rCap -= bottleneck;
+        if (arcs[a ^ 1].rCap == 0)
+            setOrphanFront(i);
+    }
+    nodes[i].trCap -= bottleneck;
+    if (nodes[i].trCap == 0)
+        setOrphanFront(i);
+
+    //Augmenting: sink tree
+    for (i = arcs[middleArc].head; ; i = arcs[a].head) {
+        a = nodes[i].parent;
+        if (a == MAXFLOW_TERMINAL)
+            break;
+        arcs[a ^ 1].rCap += bottleneck;
+        arcs[a].rCap -= bottleneck;
+        if (arcs[a].rCap == 0)
+            setOrphanFront(i);
+    }
+    nodes[i].trCap += bottleneck;
+    if (nodes[i].trCap == 0)
+        setOrphanFront(i);
+
+    flow += bottleneck;
+}
+
+/**
+ * @brief Find a new parent in the source tree for an orphan,
+ * or make it free
+ * @param[in] i Orphan node
+ */
+void MaxFlowGraph::processSourceOrphan(const int i)
+{
+    int minArc = -1;
+    int minDist = MAXFLOW_INFINITE_DIST;
+
+    //Trying to find a new parent
+    for (int a0 = nodes[i].first; a0 >= 0; a0 = arcs[a0].next) {
+        if (arcs[a0 ^ 1].rCap > 0) {
+            int j = arcs[a0].head;
+            if (!nodes[j].isSink && nodes[j].parent != MAXFLOW_FREE) {
+                //Checking the origin of j
+                int d = 0;
+                while (true) {
+                    if (nodes[j].ts == time) {
+                        d += nodes[j].dist;
+                        break;
+                    }
+                    const int a = nodes[j].parent;
+                    d++;
+                    if (a == MAXFLOW_TERMINAL) {
+                        nodes[j].ts = time;
+                        nodes[j].dist = 1;
+                        break;
+                    }
+                    if (a == MAXFLOW_ORPHAN) {
+                        d = MAXFLOW_INFINITE_DIST;
+                        break;
+                    }
+                    j = arcs[a].head;
+                }
+
+                //j originates from the source
+                if (d < MAXFLOW_INFINITE_DIST) {
+                    if (d < minDist) {
+                        minArc = a0;
+                        minDist = d;
+                    }
+                    //Set marks along the path
+                    for (j = arcs[a0].head; nodes[j].ts != time; j = arcs[nodes[j].parent].head) {
+                        nodes[j].ts = time;
+                        nodes[j].dist = d--;
+                    }
+                }
+            }
+        }
+    }
+
+    if (minArc >= 0) {
+        nodes[i].parent = minArc;
+        nodes[i].ts = time;
+        nodes[i].dist = minDist + 1;
+    }
+    else {
+        //No parent has been found
+        nodes[i].parent = MAXFLOW_FREE;
+
+        //Process neighbors
+        for (int a0 = nodes[i].first; a0 >= 0; a0 = arcs[a0].next) {
+            const int j = arcs[a0].head;
+            const int a = nodes[j].parent;
+            if (!nodes[j].isSink && a != MAXFLOW_FREE) {
+                if (arcs[a0 ^ 1].rCap > 0)
+                    setActive(j);
+                if (a != MAXFLOW_TERMINAL && a != MAXFLOW_ORPHAN && arcs[a].head == i)
+                    setOrphanRear(j);
+            }
+        }
+    }
+}
+
+/**
+ * @brief Find a new parent in the sink tree for an orphan,
+ * or make it free
+ * @param[in] i Orphan node
+ */
+void MaxFlowGraph::processSinkOrphan(const int i)
+{
+    int minArc = -1;
+    int minDist = MAXFLOW_INFINITE_DIST;
+
+    //Trying to find a new parent
+    for (int a0 = nodes[i].first; a0 >= 0; a0 = arcs[a0].next) {
+        if (arcs[a0].rCap > 0) {
+            int j = arcs[a0].head;
+            if (nodes[j].isSink && nodes[j].parent != MAXFLOW_FREE) {
+                //Checking the origin of j
+                int d = 0;
+                while (true) {
+                    if (nodes[j].ts == time) {
+                        d += nodes[j].dist;
+                        break;
+                    }
+                    const int a = nodes[j].parent;
+                    d++;
+                    if (a == MAXFLOW_TERMINAL) {
+                        nodes[j].ts = time;
+                        nodes[j].dist = 1;
+                        break;
+                    }
+                    if (a == MAXFLOW_ORPHAN) {
+                        d = MAXFLOW_INFINITE_DIST;
+                        break;
+                    }
+                    j = arcs[a].head;
+                }
+
+                //j originates from the sink
+                if (d < MAXFLOW_INFINITE_DIST) {
+                    if (d < minDist) {
+                        minArc = a0;
+                        minDist = d;
+                    }
+                    //Set marks along the path
+                    for (j = arcs[a0].head; nodes[j].ts != time; j = arcs[nodes[j].parent].head) {
+                        nodes[j].ts = time;
+                        nodes[j].dist = d--;
+                    }
+                }
+            }
+        }
+    }
+
+    if (minArc >= 0) {
+        nodes[i].parent = minArc;
+        nodes[i].ts = time;
+        nodes[i].dist = minDist + 1;
+    }
+    else {
+        //No parent has been found
+        nodes[i].parent = MAXFLOW_FREE;
+
+        //Process neighbors
+        for (int a0 = nodes[i].first; a0 >= 0; a0 = arcs[a0].next) {
+            const int j = arcs[a0].head;
+            const int a = nodes[j].parent;
+            if (nodes[j].isSink && a != MAXFLOW_FREE) {
+                if (arcs[a0].rCap > 0)
+                    setActive(j);
+                if (a != MAXFLOW_TERMINAL && a != MAXFLOW_ORPHAN && arcs[a].head == i)
+                    setOrphanRear(j);
+            }
+        }
+    }
+}
+
+/**
+ * @brief Adoption: process the orphans until there are none
+ */
+void MaxFlowGraph::processOrphans()
+{
+    while (!orphans.empty()) {
+        const int i = orphans.front();
+        orphans.pop_front();
+
+        if (nodes[i].isSink)
+            processSinkOrphan(i);
+        else
+            processSourceOrphan(i);
+    }
+}
+
+}
@@ -0,0 +1,80 @@
+#ifndef FAF_MAXFLOW_H
+#define FAF_MAXFLOW_H
+
+#include <vector>
+#include <deque>
+#include <cstddef>
+
+namespace FourAxisFabrication {
+
+/* Boykov-Kolmogorov max-flow graph, with reuse of flow and search trees */
+
+class MaxFlowGraph {
+
+public:
+
+    enum TermType { SOURCE = 0, SINK = 1 };
+
+    MaxFlowGraph();
+
+    void reserve(const unsigned int nNodes, const unsigned int nEdges);
+    void clear();
+
+    int addNodes(const unsigned int nNodes);
+    void addEdge(const int i, const int j, const double cap, const double revCap);
+    void addTerminalWeights(const int i, const double capSource, const double capSink);
+
+    double maxflow(const bool reuseTrees);
+
+    TermType segment(const int i) const;
+    void markNode(const int i);
+
+    unsigned int numberNodes() const;
+    unsigned int numberArcs() const;
+    size_t memoryUsage() const;
+
+private:
+
+    struct Node {
+        int first;
+        int parent;
+        bool isActive;
+        bool isSink;
+        bool isMarked;
+        int ts;
+        int dist;
+        double trCap;
+    };
+
+    struct Arc {
+        int head;
+        int next;
+        double rCap;
+    };
+
+    void initialize();
+    void reuseTreesInitialize();
+    int nextActive();
+    void setActive(const int i);
+    void setOrphanFront(const int i);
+    void setOrphanRear(const int i);
+    void augment(const int middleArc);
+    void processSourceOrphan(const int i);
+    void processSinkOrphan(const int i);
+    void processOrphans();
+
+    std::vector<Node> nodes;
+    std::vector<Arc> arcs;
+
+    std::deque<int> activeQueues[2];
+    std::deque<int> orphans;
+    std::vector<int> markedNodes;
+
+    double flow;
+    int time;
+    unsigned int maxflowIteration;
+};
+
+}
+
+#endif // FAF_MAXFLOW_H
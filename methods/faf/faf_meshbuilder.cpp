@@ -0,0 +1,121 @@
+#include "faf_meshbuilder.h"
+
+namespace FourAxisFabrication {
+
+/**
+ * @brief Reserve the buffers for a number of vertices and faces
+ * (the buffers grow geometrically anyway)
+ * @param[in] nVertices Number of vertices
+ * @param[in] nFaces Number of faces
+ */
+void MeshBuilder::reserve(const unsigned int nVertices, const unsigned int nFaces)
+{
+    vertices.reserve(3 * static_cast<size_t>(nVertices));
+    faces.reserve(3 * static_cast<size_t>(nFaces));
+}
+
+/**
+ * @brief Remove all the vertices and faces, releasing the buffers
+ */
+void MeshBuilder::clear()
+{
+    std::vector<double>().swap(vertices);
+    std::vector<int>().swap(faces);
+}
+
+/**
+ * @brief Add a vertex
+ * @param[in] point Coordinates of the vertex
+ * @returns Id of the vertex
+ */
+unsigned int MeshBuilder::addVertex(const cg3::Point3d& point)
+{
+    const unsigned int vId = numberVertices();
+
+    vertices.push_back(point.x());
+    vertices.push_back(point.y());
+    vertices.push_back(point.z());
+
+    return vId;
+}
+
+/**
+ * @brief Add a face
+ * @param[in] v1 First vertex
+ * @param[in] v2 Second vertex
+ * @param[in] v3 Third vertex
+ * @returns Id of the face
+ */
+unsigned int MeshBuilder::addFace(const unsigned int v1, const unsigned int v2, const unsigned int v3)
+{
+    const unsigned int fId = numberFaces();
+
+    faces.push_back(static_cast<int>(v1));
+    faces.push_back(static_cast<int>(v2));
+    faces.push_back(static_cast<int>(v3));
+
+    return fId;
+}
+
+/**
+ * @brief Get the coordinates of a vertex
+ * @param[in] vId Id of the vertex
+ * @returns Coordinates of the vertex
+ */
+cg3::Point3d MeshBuilder::vertex(const unsigned int vId) const
+{
+    const size_t i = 3 * static_cast<size_t>(vId);
+    return cg3::Point3d(vertices[i], vertices[i + 1], vertices[i + 2]);
+}
+
+/**
+ * @brief Set the coordinates of a vertex
+ * @param[in] vId Id of the vertex
+ * @param[in] point Coordinates of the vertex
+ */
+void MeshBuilder::setVertex(const unsigned int vId, const cg3::Point3d& point)
+{
+    const size_t i = 3 * static_cast<size_t>(vId);
+    vertices[i] = point.x();
+    vertices[i + 1] = point.y();
+    vertices[i + 2] = point.z();
+}
+
+/**
+ * @brief Get the number of vertices
+ * @returns Number of vertices
+ */
+unsigned int MeshBuilder::numberVertices() const
+{
+    return static_cast<unsigned int>(vertices.size() / 3);
+}
+
+/**
+ * @brief Get the number of faces
+ * @returns Number of faces
+ */
+unsigned int MeshBuilder::numberFaces() const
+{
+    return static_cast<unsigned int>(faces.size() / 3);
+}
+
+/**
+ * @brief Build the mesh from the buffers in a single step
+ * @returns Resulting mesh, with normals and bounding box
+ */
+cg3::EigenMesh MeshBuilder::build() const
+{
+    typedef Eigen::Matrix<double, Eigen::Dynamic, 3, Eigen::RowMajor> RowMatrixXd;
+    typedef Eigen::Matrix<int, Eigen::Dynamic, 3, Eigen::RowMajor> RowMatrixXi;
+
+    const Eigen::MatrixXd V = Eigen::Map<const RowMatrixXd>(vertices.data(), numberVertices(), 3);
+    const Eigen::MatrixXi F = Eigen::Map<const RowMatrixXi>(faces.data(), numberFaces(), 3);
+
+    cg3::EigenMesh mesh(V, F);
+    mesh.updateFacesAndVerticesNormals();
+    mesh.updateBoundingBox();
+
+    return mesh;
+}
+
+}
@@ -0,0 +1,38 @@
+#ifndef FAF_MESHBUILDER_H
+#define FAF_MESHBUILDER_H
+
+#include <vector>
+
+#include <cg3/meshes/eigenmesh/eigenmesh.h>
+
+namespace FourAxisFabrication {
+
+/* Mesh built on flat buffers, converted to an EigenMesh in a single step */
+
+class MeshBuilder {
+
+public:
+
+    void reserve(const unsigned int nVertices, const unsigned int nFaces);
+    void clear();
+
+    unsigned int addVertex(const cg3::Point3d& point);
+    unsigned int addFace(const unsigned int v1, const unsigned int v2, const unsigned int v3);
+
+    cg3::Point3d vertex(const unsigned int vId) const;
+    void setVertex(const unsigned int vId, const cg3::Point3d& point);
+
+    unsigned int numberVertices() const;
+    unsigned int numberFaces() const;
+
+    cg3::EigenMesh build() const;
+
+private:
+
+    std::vector<double> vertices;
+    std::vector<int> faces;
+};
+
+}
+
+#endif // FAF_MESHBUILDER_H
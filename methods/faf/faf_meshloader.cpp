@@ -0,0 +1,979 @@
+#include "faf_meshloader.h"
+
+#include "faf_meshbuilder.h"
+
+#include <algorithm>
+#include <cctype>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <iostream>
+#include <mutex>
+#include <sstream>
+#include <thread>
+#include <vector>
+
+#ifdef FAF_WITH_ZLIB
+#include <zlib.h>
+#endif
+#ifdef FAF_WITH_ZSTD
+#include <zstd.h>
+#endif
+
+#define MESHLOADER_CHUNK_SIZE (1024 * 1024)
+#define MESHLOADER_N_CHUNKS 4
+
+namespace FourAxisFabrication {
+
+namespace internal {
+
+enum class Compression { NONE, GZIP, ZSTD };
+
+enum class PlyFormat { ASCII, BINARY_LITTLE_ENDIAN, BINARY_BIG_ENDIAN };
+enum class PlyType { INT8, UINT8, INT16, UINT16, INT32, UINT32, FLOAT32, FLOAT64 };
+
+struct PlyProperty {
+    std::string name;
+    PlyType type;
+    bool isList;
+    PlyType countType;
+};
+
+struct PlyElement {
+    std::string name;
+    size_t count;
+    std::vector<PlyProperty> properties;
+};
+
+/* Bounded queue of the decompressed chunks, between the decompression and the parsing threads */
+
+class ChunkQueue {
+
+public:
+
+    ChunkQueue();
+
+    std::vector<char>* acquire();
+    void push(std::vector<char>* chunk);
+    void finish(const bool success);
+
+    std::vector<char>* pop();
+    void release(std::vector<char>* chunk);
+    void cancel();
+
+    bool succeeded();
+
+private:
+
+    std::vector<std::vector<char>> buffers;
+    std::deque<std::vector<char>*> freeChunks;
+    std::deque<std::vector<char>*> filledChunks;
+
+    std::mutex mutex;
+    std::condition_variable condition;
+
+    bool finished;
+    bool success;
+    bool cancelled;
+};
+
+/* Sequential reading of the chunks by the parser */
+
+class ChunkReader {
+
+public:
+
+    ChunkReader(ChunkQueue& queue);
+    ~ChunkReader();
+
+    ChunkReader(const ChunkReader& other) = delete;
+    ChunkReader& operator=(const ChunkReader& other) = delete;
+
+    bool getLine(std::string& line);
+    bool read(char* buffer, size_t bytes);
+    void drain();
+
+private:
+
+    bool nextChunk();
+
+    ChunkQueue& queue;
+    std::vector<char>* chunk;
+    size_t position;
+};
+
+Compression detectCompression(const std::string& filename);
+std::string getUncompressedExtension(const std::string& filename);
+
+void decompressFile(
+        const std::string& filename,
+        const Compression compression,
+        ChunkQueue& queue);
+
+#ifdef FAF_WITH_ZLIB
+bool inflateGzip(FILE* file, ChunkQueue& queue);
+#endif
+#ifdef FAF_WITH_ZSTD
+bool decompressZstd(FILE* file, ChunkQueue& queue);
+#endif
+
+bool parseObj(ChunkReader& reader, MeshBuilder& builder);
+bool parsePly(ChunkReader& reader, MeshBuilder& builder);
+
+bool parsePlyType(const std::string& name, PlyType& type);
+bool readPlyValue(
+        ChunkReader& reader,
+        const PlyFormat format,
+        const PlyType type,
+        const char*& asciiCursor,
+        double& value);
+
+bool addPolygon(
+        const std::vector<long>& polygon,
+        long& maxIndex,
+        MeshBuilder& builder);
+
+}
+
+
+/* ----- MESH LOADER ----- */
+
+/**
+ * @brief Load a mesh from an OBJ or PLY file. Files compressed with gzip or zstd
+ * (detected by their magic number, e.g. .obj.gz, .ply.zst) are decompressed in
+ * streaming: a thread decodes the file in chunks of fixed size into a bounded queue,
+ * while the calling thread parses the chunks, so decompression and parsing overlap
+ * and no intermediate file is written. Only the geometry (vertices and faces,
+ * polygons are triangulated as fans) is read from the compressed files.
+ * The uncompressed files are loaded by EigenMesh::loadFromFile.
+ * The gzip and zstd support is enabled by FAF_WITH_ZLIB and FAF_WITH_ZSTD.
+ * @param[in] filename Name of the file
+ * @param[out] mesh Loaded mesh
+ * @returns True if the mesh has been loaded
+ */
+bool loadMesh(
+        const std::string& filename,
+        cg3::EigenMesh& mesh)
+{
+    const internal::Compression compression = internal::detectCompression(filename);
+
+    if (compression == internal::Compression::NONE)
+        return mesh.loadFromFile(filename);
+
+    #ifndef FAF_WITH_ZLIB
+    if (compression == internal::Compression::GZIP) {
+        std::cerr << "Gzip compressed meshes are not supported (FAF_WITH_ZLIB is not enabled)." << std::endl;
+        return false;
+    }
+    #endif
+    #ifndef FAF_WITH_ZSTD
+    if (compression == internal::Compression::ZSTD) {
+        std::cerr << "Zstd compressed meshes are not supported (FAF_WITH_ZSTD is not enabled)." << std::endl;
+        return false;
+    }
+    #endif
+
+    const std::string extension = internal::getUncompressedExtension(filename);
+    if (extension != "obj" && extension != "ply")
+        return false;
+
+    internal::ChunkQueue queue;
+    std::thread decompressionThread(internal::decompressFile, std::cref(filename), compression, std::ref(queue));
+
+    MeshBuilder builder;
+    bool parsed;
+    {
+        internal::ChunkReader reader(queue);
+        if (extension == "obj")
+            parsed = internal::parseObj(reader, builder);
+        else
+            parsed = internal::parsePly(reader, builder);
+
+        //Decompress the remaining data, to detect truncated or corrupted files
+        if (parsed)
+            reader.drain();
+        else
+            queue.cancel();
+    }
+
+    decompressionThread.join();
+
+    if (!parsed || !queue.succeeded() || builder.numberFaces() == 0)
+        return false;
+
+    mesh = builder.build();
+
+    return true;
+}
+
+/**
+ * @brief Check if a file is compressed with gzip or zstd
+ * @param[in] filename Name of the file
+ * @returns True if the file is compressed
+ */
+bool isCompressedMeshFile(const std::string& filename)
+{
+    return internal::detectCompression(filename) != internal::Compression::NONE;
+}
+
+
+
+/* ----- INTERNAL FUNCTION DEFINITION ----- */
+
+namespace internal {
+
+ChunkQueue::ChunkQueue() :
+    buffers(MESHLOADER_N_CHUNKS),
+    finished(false),
+    success(false),
+    cancelled(false)
+{
+    for (std::vector<char>& buffer : buffers) {
+        freeChunks.push_back(&buffer);
+    }
+}
+
+/**
+ * @brief Get a free chunk to be filled by the decompression, waiting until
+ * the parser releases one
+ * @returns Free chunk, nullptr if the parsing has been cancelled
+ */
+std::vector<char>* ChunkQueue::acquire()
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    condition.wait(lock, [this] { return !freeChunks.empty() || cancelled; });
+
+    if (cancelled)
+        return nullptr;
+
+    std::vector<char>* chunk = freeChunks.front();
+    freeChunks.pop_front();
+    return chunk;
+}
+
+/**
+ * @brief Queue a filled chunk
+ * @param[in] chunk Filled chunk
+ */
+void ChunkQueue::push(std::vector<char>* chunk)
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        filledChunks.push_back(chunk);
+    }
+    condition.notify_all();
+}
+
+/**
+ * @brief End of the decompression
+ * @param[in] success True if the whole file has been decompressed
+ */
+void ChunkQueue::finish(const bool success)
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        this->finished = true;
+        this->success = success;
+    }
+    condition.notify_all();
+}
+
+/**
+ * @brief Get the next filled chunk, waiting for the decompression
+ * @returns Filled chunk, nullptr at the end of the decompression
+ */
+std::vector<char>* ChunkQueue::pop()
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    condition.wait(lock, [this] { return !filledChunks.empty() || finished; });
+
+    if (filledChunks.empty())
+        return nullptr;
+
+    std::vector<char>* chunk = filledChunks.front();
+    filledChunks.pop_front();
+    return chunk;
+}
+
+/**
+ * @brief Give back a parsed chunk to the decompression
+ * @param[in] chunk Parsed chunk
+ */
+void ChunkQueue::release(std::vector<char>* chunk)
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        freeChunks.push_back(chunk);
+    }
+    condition.notify_all();
+}
+
+/**
+ * @brief Stop the decompression, after a parsing error
+ */
+void ChunkQueue::cancel()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        cancelled = true;
+    }
+    condition.notify_all();
+}
+
+/**
+ * @brief Check the result of the decompression, once it is finished
+ * @returns True if the whole file has been decompressed
+ */
+bool ChunkQueue::succeeded()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return finished && success;
+}
+
+
+ChunkReader::ChunkReader(ChunkQueue& queue) :
+    queue(queue),
+    chunk(nullptr),
+    position(0)
+{
+
+}
+
+ChunkReader::~ChunkReader()
+{
+    if (chunk != nullptr)
+        queue.release(chunk);
+}
+
+/**
+ * @brief Read a line, without the line terminator
+ * @param[out] line Line
+ * @returns False at the end of the data
+ */
+bool ChunkReader::getLine(std::string& line)
+{
+    line.clear();
+
+    while (true) {
+        if (chunk == nullptr || position == chunk->size()) {
+            if (!nextChunk())
+                return !line.empty();
+            continue;
+        }
+
+        const char* begin = chunk->data() + position;
+        const size_t available = chunk->size() - position;
+        const char* newline = static_cast<const char*>(std::memchr(begin, '\n', available));
+
+        if (newline == nullptr) {
+            line.append(begin, available);
+            position = chunk->size();
+        }
+        else {
+            line.append(begin, newline - begin);
+            position += (newline - begin) + 1;
+
+            if (!line.empty() && line.back() == '\r')
+                line.pop_back();
+            return true;
+        }
+    }
+}
+
+/**
+ * @brief Read binary data
+ * @param[out] buffer Destination of the data
+ * @param[in] bytes Number of bytes
+ * @returns False if the data ended before
+ */
+bool ChunkReader::read(char* buffer, size_t bytes)
+{
+    while (bytes > 0) {
+        if (chunk == nullptr || position == chunk->size()) {
+            if (!nextChunk())
+                return false;
+            continue;
+        }
+
+        const size_t n = std::min(bytes, chunk->size() - position);
+        std::memcpy(buffer, chunk->data() + position, n);
+        position += n;
+        buffer += n;
+        bytes -= n;
+    }
+
+    return true;
+}
+
+/**
+ * @brief Skip the remaining data
+ */
+void ChunkReader::drain()
+{
+    while (nextChunk());
+}
+
+/**
+ * @brief Release the current chunk and get the next one
+ * @returns False at the end of the data
+ */
+bool ChunkReader::nextChunk()
+{
+    if (chunk != nullptr)
+        queue.release(chunk);
+
+    chunk = queue.pop();
+    position = 0;
+
+    return chunk != nullptr;
+}
+
+
+/**
+ * @brief Detect the compression of a file by its magic number
+ * @param[in] filename Name of the file
+ * @returns Compression of the file
+ */
+Compression detectCompression(const std::string& filename)
+{
+    FILE* file = std::fopen(filename.c_str(), "rb");
+    if (file == nullptr)
+        return Compression::NONE;
+
+    unsigned char magic[4] = {0, 0, 0, 0};
+    const size_t nRead = std::fread(magic, 1, 4, file);
+    std::fclose(file);
+
+    if (nRead >= 2 && magic[0] == 0x1F && magic[1] == 0x8B)
+        return Compression::GZIP;
+    if (nRead == 4 && magic[0] == 0x28 && magic[1] == 0xB5 && magic[2] == 0x2F && magic[3] == 0xFD)
+        return Compression::ZSTD;
+
+    return Compression::NONE;
+}
+
+/**
+ * @brief Get the extension of a compressed file, without the extension
+ * of the compression (e.g. "obj" for "mesh.obj.gz")
+ * @param[in] filename Name of the file
+ * @returns Lowercase extension
+ */
+std::string getUncompressedExtension(const std::string& filename)
+{
+    std::string name = filename;
+    std::transform(name.begin(), name.end(), name.begin(), [] (unsigned char c) { return std::tolower(c); });
+
+    const std::string compressedExtensions[] = {".gz", ".zst", ".zstd"};
+    for (const std::string& compressedExtension : compressedExtensions) {
+        if (name.size() > compressedExtension.size() &&
+                name.compare(name.size() - compressedExtension.size(), compressedExtension.size(), compressedExtension) == 0)
+        {
+            name.resize(name.size() - compressedExtension.size());
+            break;
+        }
+    }
+
+    const size_t dot = name.find_last_of('.');
+    const size_t slash = name.find_last_of("/\\");
+    if (dot == std::string::npos || (slash != std::string::npos && dot < slash))
+        return "";
+
+    return name.substr(dot + 1);
+}
+
+/**
+ * @brief Decompress a file into the chunks of the queue (decompression thread)
+ * @param[in] filename Name of the file
+ * @param[in] compression Compression of the file
+ * @param[out] queue Queue of the chunks
+ */
+void decompressFile(
+        const std::string& filename,
+        const Compression compression,
+        ChunkQueue& queue)
+{
+    bool success = false;
+
+    FILE* file = std::fopen(filename.c_str(), "rb");
+    if (file != nullptr) {
+        #ifdef FAF_WITH_ZLIB
+        if (compression == Compression::GZIP)
+            success = inflateGzip(file, queue);
+        #endif
+        #ifdef FAF_WITH_ZSTD
+        if (compression == Compression::ZSTD)
+            success = decompressZstd(file, queue);
+        #endif
+
+        std::fclose(file);
+    }
+
+    queue.finish(success);
+}
+
+#ifdef FAF_WITH_ZLIB
+/**
+ * @brief Decompress a gzip file (also made of concatenated members)
+ * @param[in] file Input file
+ * @param[out] queue Queue of the chunks
+ * @returns True if the whole file has been decompressed
+ */
+bool inflateGzip(FILE* file, ChunkQueue& queue)
+{
+    z_stream stream;
+    std::memset(&stream, 0, sizeof(stream));
+
+    //Automatic detection of the gzip header
+    if (inflateInit2(&stream, 15 + 32) != Z_OK)
+        return false;
+
+    std::vector<unsigned char> input(MESHLOADER_CHUNK_SIZE);
+
+    std::vector<char>* chunk = nullptr;
+    size_t filled = 0;
+    bool success = true;
+    bool streamEnded = false;
+    bool outputFull = false;
+
+    while (success) {
+        //Read input only when zlib has no pending output
+        if (stream.avail_in == 0 && !outputFull) {
+            stream.avail_in = static_cast<uInt>(std::fread(input.data(), 1, input.size(), file));
+            stream.next_in = input.data();
+            if (stream.avail_in == 0) {
+                success = !std::ferror(file);
+                break;
+            }
+        }
+
+        if (chunk == nullptr) {
+            chunk = queue.acquire();
+            if (chunk == nullptr) {
+                success = false;
+                break;
+            }
+            chunk->resize(MESHLOADER_CHUNK_SIZE);
+            filled = 0;
+        }
+
+        stream.next_out = reinterpret_cast<Bytef*>(chunk->data() + filled);
+        stream.avail_out = static_cast<uInt>(MESHLOADER_CHUNK_SIZE - filled);
+
+        const int status = inflate(&stream, Z_NO_FLUSH);
+        if (status == Z_STREAM_END) {
+            streamEnded = true;
+            if (inflateReset(&stream) != Z_OK)
+                success = false;
+        }
+        else if (status == Z_OK) {
+            streamEnded = false;
+        }
+        else if (status != Z_BUF_ERROR) {
+            success = false;
+        }
+
+        filled = MESHLOADER_CHUNK_SIZE - stream.avail_out;
+        outputFull = stream.avail_out == 0;
+
+        if (filled == MESHLOADER_CHUNK_SIZE) {
+            queue.push(chunk);
+            chunk = nullptr;
+        }
+    }
+
+    if (chunk != nullptr) {
+        chunk->resize(filled);
+        queue.push(chunk);
+    }
+
+    inflateEnd(&stream);
+
+    return success && streamEnded;
+}
+#endif
+
+#ifdef FAF_WITH_ZSTD
+/**
+ * @brief Decompress a zstd file (also made of several frames)
+ * @param[in] file Input file
+ * @param[out] queue Queue of the chunks
+ * @returns True if the whole file has been decompressed
+ */
+bool decompressZstd(FILE* file, ChunkQueue& queue)
+{
+    ZSTD_DStream* stream = ZSTD_createDStream();
+    if (stream == nullptr)
+        return false;
+    ZSTD_initDStream(stream);
+
+    std::vector<char> input(ZSTD_DStreamInSize());
+    ZSTD_inBuffer inBuffer = {input.data(), 0, 0};
+
+    std::vector<char>* chunk = nullptr;
+    size_t filled = 0;
+    bool success = true;
+    bool frameEnded = false;
+    bool outputFull = false;
+
+    while (success) {
+        //Read input only when zstd has no pending output
+        if (inBuffer.pos == inBuffer.size && !outputFull) {
+            inBuffer.size = std::fread(input.data(), 1, input.size(), file);
+            inBuffer.pos = 0;
+            if (inBuffer.size == 0) {
+                success = !std::ferror(file);
+                break;
+            }
+        }
+
+        if (chunk == nullptr) {
+            chunk = queue.acquire();
+            if (chunk == nullptr) {
+                success = false;
+                break;
+            }
+            chunk->resize(MESHLOADER_CHUNK_SIZE);
+            filled = 0;
+        }
+
+        ZSTD_outBuffer outBuffer = {chunk->data(), MESHLOADER_CHUNK_SIZE, filled};
+
+        const size_t result = ZSTD_decompressStream(stream, &outBuffer, &inBuffer);
+        if (ZSTD_isError(result)) {
+            success = false;
+        }
+        frameEnded = result == 0;
+
+        filled = outBuffer.pos;
+        outputFull = outBuffer.pos == outBuffer.size;
+
+        if (filled == MESHLOADER_CHUNK_SIZE) {
+            queue.push(chunk);
+            chunk = nullptr;
+        }
+    }
+
+    if (chunk != nullptr) {
+        chunk->resize(filled);
+        queue.push(chunk);
+    }
+
+    ZSTD_freeDStream(stream);
+
+    return success && frameEnded;
+}
+#endif
+
+
+/**
+ * @brief Parse the vertices and the faces of an OBJ file
+ * @param[in] reader Reader of the decompressed data
+ * @param[out] builder Mesh builder
+ * @returns True if the file is valid
+ */
+bool parseObj(ChunkReader& reader, MeshBuilder& builder)
+{
+    std::string line;
+    std::vector<long> polygon;
+    long maxIndex = -1;
+
+    while (reader.getLine(line)) {
+        const char* c = line.c_str();
+        while (*c == ' ' || *c == '\t')
+            c++;
+
+        if (c[0] == 'v' && (c[1] == ' ' || c[1] == '\t')) {
+            const char* start = c + 2;
+            char* end;
+
+            const double x = std::strtod(start, &end);
+            if (end == start)
+                return false;
+            start = end;
+            const double y = std::strtod(start, &end);
+            if (end == start)
+                return false;
+            start = end;
+            const double z = std::strtod(start, &end);
+            if (end == start)
+                return false;
+
+            builder.addVertex(cg3::Point3d(x, y, z));
+        }
+        else if (c[0] == 'f' && (c[1] == ' ' || c[1] == '\t')) {
+            polygon.clear();
+
+            const char* start = c + 2;
+            while (true) {
+                char* end;
+                long index = std::strtol(start, &end, 10);
+                if (end == start)
+                    break;
+
+                //Negative indices are relative to the last vertex
+                if (index < 0)
+                    index += builder.numberVertices();
+                else
+                    index -= 1;
+                polygon.push_back(index);
+
+                //Skip texture and normal indices
+                start = end;
+                while (*start != '\0' && *start != ' ' && *start != '\t')
+                    start++;
+            }
+
+            if (!addPolygon(polygon, maxIndex, builder))
+                return false;
+        }
+    }
+
+    return maxIndex < static_cast<long>(builder.numberVertices());
+}
+
+/**
+ * @brief Parse the vertices and the faces of a PLY file (ascii or binary)
+ * @param[in] reader Reader of the decompressed data
+ * @param[out] builder Mesh builder
+ * @returns True if the file is valid
+ */
+bool parsePly(ChunkReader& reader, MeshBuilder& builder)
+{
+    std::string line;
+
+    if (!reader.getLine(line) || line != "ply")
+        return false;
+
+    //Header
+    PlyFormat format = PlyFormat::ASCII;
+    std::vector<PlyElement> elements;
+    bool headerEnded = false;
+
+    while (!headerEnded && reader.getLine(line)) {
+        std::istringstream stream(line);
+        std::string keyword;
+        stream >> keyword;
+
+        if (keyword == "format") {
+            std::string formatName;
+            stream >> formatName;
+            if (formatName == "ascii")
+                format = PlyFormat::ASCII;
+            else if (formatName == "binary_little_endian")
+                format = PlyFormat::BINARY_LITTLE_ENDIAN;
+            else if (formatName == "binary_big_endian")
+                format = PlyFormat::BINARY_BIG_ENDIAN;
+            else
+                return false;
+        }
+        else if (keyword == "element") {
+            PlyElement element;
+            if (!(stream >> element.name >> element.count))
+                return false;
+            elements.push_back(element);
+        }
+        else if (keyword == "property") {
+            if (elements.empty())
+                return false;
+
+            PlyProperty property;
+            std::string typeName;
+            stream >> typeName;
+
+            if (typeName == "list") {
+                std::string countTypeName;
+                property.isList = true;
+                stream >> countTypeName >> typeName;
+                if (!parsePlyType(countTypeName, property.countType))
+                    return false;
+            }
+            else {
+                property.isList = false;
+            }
+            if (!parsePlyType(typeName, property.type) || !(stream >> property.name))
+                return false;
+
+            elements.back().properties.push_back(property);
+        }
+        else if (keyword == "end_header") {
+            headerEnded = true;
+        }
+    }
+
+    if (!headerEnded)
+        return false;
+
+    //Elements
+    std::vector<long> polygon;
+    long maxIndex = -1;
+
+    for (const PlyElement& element : elements) {
+        const bool isVertex = element.name == "vertex";
+        const bool isFace = element.name == "face";
+
+        for (size_t i = 0; i < element.count; i++) {
+            const char* asciiCursor = nullptr;
+            if (format == PlyFormat::ASCII) {
+                if (!reader.getLine(line))
+                    return false;
+                asciiCursor = line.c_str();
+            }
+
+            double coordinates[3] = {0, 0, 0};
+            polygon.clear();
+
+            for (const PlyProperty& property : element.properties) {
+                double value;
+
+                if (property.isList) {
+                    if (!readPlyValue(reader, format, property.countType, asciiCursor, value) || value < 0)
+                        return false;
+
+                    const bool isIndices = isFace && (property.name == "vertex_indices" || property.name == "vertex_index");
+                    const size_t nValues = static_cast<size_t>(value);
+                    for (size_t k = 0; k < nValues; k++) {
+                        if (!readPlyValue(reader, format, property.type, asciiCursor, value))
+                            return false;
+                        if (isIndices)
+                            polygon.push_back(static_cast<long>(value));
+                    }
+                }
+                else {
+                    if (!readPlyValue(reader, format, property.type, asciiCursor, value))
+                        return false;
+
+                    if (isVertex && property.name.size() == 1 && property.name[0] >= 'x' && property.name[0] <= 'z')
+                        coordinates[property.name[0] - 'x'] = value;
+                }
+            }
+
+            if (isVertex) {
+                builder.addVertex(cg3::Point3d(coordinates[0], coordinates[1], coordinates[2]));
+            }
+            else if (isFace) {
+                if (!addPolygon(polygon, maxIndex, builder))
+                    return false;
+            }
+        }
+    }
+
+    return maxIndex < static_cast<long>(builder.numberVertices());
+}
+
+/**
+ * @brief Get a type of the PLY properties from its name
+ * @param[in] name Name of the type
+ * @param[out] type Type
+ * @returns False if the name is not valid
+ */
+bool parsePlyType(const std::string& name, PlyType& type)
+{
+    if (name == "char" || name == "int8")
+        type = PlyType::INT8;
+    else if (name == "uchar" || name == "uint8")
+        type = PlyType::UINT8;
+    else if (name == "short" || name == "int16")
+        type = PlyType::INT16;
+    else if (name == "ushort" || name == "uint16")
+        type = PlyType::UINT16;
+    else if (name == "int" || name == "int32")
+        type = PlyType::INT32;
+    else if (name == "uint" || name == "uint32")
+        type = PlyType::UINT32;
+    else if (name == "float" || name == "float32")
+        type = PlyType::FLOAT32;
+    else if (name == "double" || name == "float64")
+        type = PlyType::FLOAT64;
+    else
+        return false;
+
+    return true;
+}
+
+/**
+ * @brief Read a value of a PLY property
+ * @param[in] reader Reader of the decompressed data (binary formats)
+ * @param[in] format Format of the file
+ * @param[in] type Type of the value
+ * @param asciiCursor Position in the current line (ascii format)
+ * @param[out] value Value
+ * @returns False if the value is missing
+ */
+bool readPlyValue(
+        ChunkReader& reader,
+        const PlyFormat format,
+        const PlyType type,
+        const char*& asciiCursor,
+        double& value)
+{
+    if (format == PlyFormat::ASCII) {
+        char* end;
+        value = std::strtod(asciiCursor, &end);
+        if (end == asciiCursor)
+            return false;
+        asciiCursor = end;
+        return true;
+    }
+
+    static const size_t sizes[] = {1, 1, 2, 2, 4, 4, 4, 8};
+    const size_t size = sizes[static_cast<int>(type)];
+
+    char bytes[8];
+    if (!reader.read(bytes, size))
+        return false;
+
+    //The values are read on a little endian machine
+    if (format == PlyFormat::BINARY_BIG_ENDIAN)
+        std::reverse(bytes, bytes + size);
+
+    switch (type) {
+    case PlyType::INT8: { int8_t v; std::memcpy(&v, bytes, size); value = v; break; }
+    case PlyType::UINT8: { uint8_t v; std::memcpy(&v, bytes, size); value = v; break; }
+    case PlyType::INT16: { int16_t v; std::memcpy(&v, bytes, size); value = v; break; }
+    case PlyType::UINT16: { uint16_t v; std::memcpy(&v, bytes, size); value = v; break; }
+    case PlyType::INT32: { int32_t v; std::memcpy(&v, bytes, size); value = v; break; }
+    case PlyType::UINT32: { uint32_t v; std::memcpy(&v, bytes, size); value = v; break; }
+    case PlyType::FLOAT32: { float v; std::memcpy(&v, bytes, size); value = v; break; }
+    case PlyType::FLOAT64: { double v; std::memcpy(&v, bytes, size); value = v; break; }
+    }
+
+    return true;
+}
+
+/**
+ * @brief Add a polygon to the mesh, triangulated as a fan
+ * @param[in] polygon Indices of the vertices of the polygon
+ * @param maxIndex Max vertex index of the faces
+ * @param[out] builder Mesh builder
+ * @returns False if the polygon is not valid
+ */
+bool addPolygon(
+        const std::vector<long>& polygon,
+        long& maxIndex,
+        MeshBuilder& builder)
+{
+    if (polygon.size() < 3)
+        return false;
+
+    for (const long index : polygon) {
+        if (index < 0)
+            return false;
+        maxIndex = std::max(maxIndex, index);
+    }
+
+    for (size_t k = 1; k + 1 < polygon.size(); k++) {
+        builder.addFace(
+                    static_cast<unsigned int>(polygon[0]),
+                    static_cast<unsigned int>(polygon[k]),
+                    static_cast<unsigned int>(polygon[k + 1]));
+    }
+
+    return true;
+}
+
+}
+
+}
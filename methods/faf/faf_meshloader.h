@@ -0,0 +1,20 @@
+#ifndef FAF_MESHLOADER_H
+#define FAF_MESHLOADER_H
+
+#include <string>
+
+#include <cg3/meshes/eigenmesh/eigenmesh.h>
+
+namespace FourAxisFabrication {
+
+/* Loading of the meshes, also from gzip/zstd compressed files */
+
+bool loadMesh(
+        const std::string& filename,
+        cg3::EigenMesh& mesh);
+
+bool isCompressedMeshFile(const std::string& filename);
+
+}
+
+#endif // FAF_MESHLOADER_H
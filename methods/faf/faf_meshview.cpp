@@ -0,0 +1,120 @@
+#include "faf_meshview.h"
+
+#include <algorithm>
+#include <limits>
+
+namespace FourAxisFabrication {
+
+/**
+ * @brief View of a mesh in its own frame
+ * @param[in] mesh Mesh, it must outlive the view
+ */
+TransformedMeshView::TransformedMeshView(const cg3::EigenMesh& mesh) :
+    m(mesh),
+    r(Eigen::Matrix3d::Identity()),
+    t(0,0,0)
+{
+
+}
+
+/**
+ * @brief View of a rotated mesh
+ * @param[in] mesh Mesh, it must outlive the view
+ * @param[in] rotation Rotation matrix
+ */
+TransformedMeshView::TransformedMeshView(const cg3::EigenMesh& mesh, const Eigen::Matrix3d& rotation) :
+    m(mesh),
+    r(rotation),
+    t(0,0,0)
+{
+
+}
+
+/**
+ * @brief View of a rotated and translated mesh (the rotation is applied first)
+ * @param[in] mesh Mesh, it must outlive the view
+ * @param[in] rotation Rotation matrix
+ * @param[in] translation Translation
+ */
+TransformedMeshView::TransformedMeshView(const cg3::EigenMesh& mesh, const Eigen::Matrix3d& rotation, const cg3::Vec3d& translation) :
+    m(mesh),
+    r(rotation),
+    t(translation)
+{
+
+}
+
+/**
+ * @brief Compute the bounding box of the transformed vertices
+ * @returns Bounding box
+ */
+cg3::BoundingBox3 TransformedMeshView::boundingBox() const
+{
+    const double maxValue = std::numeric_limits<double>::max();
+
+    cg3::Point3d minCoord(maxValue, maxValue, maxValue);
+    cg3::Point3d maxCoord(-maxValue, -maxValue, -maxValue);
+
+    for (unsigned int vId = 0; vId < numberVertices(); vId++) {
+        const cg3::Point3d p = vertex(vId);
+
+        minCoord.setX(std::min(minCoord.x(), p.x()));
+        minCoord.setY(std::min(minCoord.y(), p.y()));
+        minCoord.setZ(std::min(minCoord.z(), p.z()));
+        maxCoord.setX(std::max(maxCoord.x(), p.x()));
+        maxCoord.setY(std::max(maxCoord.y(), p.y()));
+        maxCoord.setZ(std::max(maxCoord.z(), p.z()));
+    }
+
+    return cg3::BoundingBox3(minCoord, maxCoord);
+}
+
+/**
+ * @brief Sort faces by the min transformed coordinate of their vertices.
+ * The keys are computed once for each face, instead of in each comparison.
+ * @param[in] dim Coordinate (0 for x, 1 for y, 2 for z)
+ * @param[out] faces Faces to be sorted
+ */
+void TransformedMeshView::sortFacesByMinCoordinate(
+        const unsigned int dim,
+        std::vector<unsigned int>& faces) const
+{
+    //Row of the rotation for the coordinate (the translation does not change the order)
+    const double rx = r(dim, 0);
+    const double ry = r(dim, 1);
+    const double rz = r(dim, 2);
+
+    std::vector<double> keys(numberFaces());
+    for (unsigned int fId : faces) {
+        const cg3::Point3i f = m.face(fId);
+        const cg3::Point3d v1 = m.vertex(f.x());
+        const cg3::Point3d v2 = m.vertex(f.y());
+        const cg3::Point3d v3 = m.vertex(f.z());
+
+        keys[fId] = std::min(std::min(
+                    rx * v1.x() + ry * v1.y() + rz * v1.z(),
+                    rx * v2.x() + ry * v2.y() + rz * v2.z()),
+                    rx * v3.x() + ry * v3.y() + rz * v3.z());
+    }
+
+    std::sort(faces.begin(), faces.end(), [&keys] (const unsigned int f1, const unsigned int f2) {
+        return keys[f1] < keys[f2];
+    });
+}
+
+/**
+ * @brief Build the transformed mesh (for the export)
+ * @returns Transformed mesh, with normals and bounding box
+ */
+cg3::EigenMesh TransformedMeshView::materialize() const
+{
+    cg3::EigenMesh result = m;
+    result.rotate(r);
+    result.translate(t);
+    result.updateFacesAndVerticesNormals();
+    result.updateBoundingBox();
+
+    return result;
+}
+
+}
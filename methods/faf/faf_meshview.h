@@ -0,0 +1,67 @@
+#ifndef FAF_MESHVIEW_H
+#define FAF_MESHVIEW_H
+
+#include <vector>
+
+#include <cg3/meshes/eigenmesh/eigenmesh.h>
+
+namespace FourAxisFabrication {
+
+/* Mesh seen from another frame: the transform is applied when the vertices and normals are read */
+
+class TransformedMeshView {
+
+public:
+
+    TransformedMeshView(const cg3::EigenMesh& mesh);
+    TransformedMeshView(const cg3::EigenMesh& mesh, const Eigen::Matrix3d& rotation);
+    TransformedMeshView(const cg3::EigenMesh& mesh, const Eigen::Matrix3d& rotation, const cg3::Vec3d& translation);
+
+    inline const cg3::EigenMesh& mesh() const {
+        return m;
+    }
+    inline unsigned int numberVertices() const {
+        return m.numberVertices();
+    }
+    inline unsigned int numberFaces() const {
+        return m.numberFaces();
+    }
+    inline cg3::Point3i face(const unsigned int fId) const {
+        return m.face(fId);
+    }
+    inline cg3::Point3d vertex(const unsigned int vId) const {
+        const cg3::Point3d p = m.vertex(vId);
+        return cg3::Point3d(
+                    r(0,0) * p.x() + r(0,1) * p.y() + r(0,2) * p.z() + t.x(),
+                    r(1,0) * p.x() + r(1,1) * p.y() + r(1,2) * p.z() + t.y(),
+                    r(2,0) * p.x() + r(2,1) * p.y() + r(2,2) * p.z() + t.z());
+    }
+    inline cg3::Vec3d faceNormal(const unsigned int fId) const {
+        const cg3::Vec3d n = m.faceNormal(fId);
+        return cg3::Vec3d(
+                    r(0,0) * n.x() + r(0,1) * n.y() + r(0,2) * n.z(),
+                    r(1,0) * n.x() + r(1,1) * n.y() + r(1,2) * n.z(),
+                    r(2,0) * n.x() + r(2,1) * n.y() + r(2,2) * n.z());
+    }
+    inline double faceArea(const unsigned int fId) const {
+        return m.faceArea(fId);
+    }
+
+    cg3::BoundingBox3 boundingBox() const;
+
+    void sortFacesByMinCoordinate(
+            const unsigned int dim,
+            std::vector<unsigned int>& faces) const;
+
+    cg3::EigenMesh materialize() const;
+
+private:
+
+    const cg3::EigenMesh& m;
+    Eigen::Matrix3d r;
+    cg3::Vec3d t;
+};
+
+}
+
+#endif // FAF_MESHVIEW_H
@@ -0,0 +1,616 @@
+#include "faf_metrics.h"
+
+#include <iostream>
+#include <sstream>
+#include <iomanip>
+#include <vector>
+#include <map>
+#include <algorithm>
+#include <mutex>
+#include <atomic>
+#include <cstring>
+#include <cerrno>
+#include <cstdint>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+#ifdef __linux__
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+#define FAF_PERF_EVENTS
+#endif
+
+namespace FourAxisFabrication {
+
+namespace internal {
+
+/* Metrics collected for each zone */
+
+struct ZoneMetrics {
+    size_t order = 0;
+    unsigned int calls = 0;
+    double seconds = 0;
+    bool hasCounters = true;
+    CounterValues counters = {};
+    bool hasAllocations = true;
+    bool hasAllocationSites = true;
+    AllocationCounters allocations = {0, 0};
+    size_t peakLiveBytes = 0;
+    std::map<const void*, AllocationSite> sites;
+};
+
+/* Counters opened by each thread */
+
+struct ThreadCounters {
+    std::array<int, NUMBER_METRICS_COUNTERS> fds;
+    bool isOpened;
+
+    ThreadCounters();
+    ~ThreadCounters();
+};
+
+const char* counterNames[NUMBER_METRICS_COUNTERS] = {
+    "cycles", "instructions", "LLC misses", "branch misses", "page faults"
+};
+
+std::atomic<bool> countersEnabled(false);
+std::array<bool, NUMBER_METRICS_COUNTERS> counterAvailable = {{false, false, false, false, false}};
+
+std::mutex metricsMutex;
+std::map<std::string, ZoneMetrics> zoneMetrics;
+std::string sequentialPath;
+
+thread_local std::vector<std::string> zoneStack;
+thread_local ThreadCounters threadCounters;
+
+int openCounter(const MetricsCounter counter);
+
+void readThreadCounters(CounterValues& values);
+
+void readCounters(
+        const bool acrossThreads,
+        CounterValues& values);
+
+std::string formatCounters(const CounterValues& values);
+
+std::string formatAllocations(
+        const AllocationCounters& allocations,
+        const bool hasPeak,
+        const size_t peakLiveBytes);
+
+std::string formatBytes(const double bytes);
+
+void printTopAllocationSites(std::vector<AllocationSite> sites);
+
+}
+
+//Number of call sites printed for each zone
+#define NUMBER_TOP_ALLOCATION_SITES 5
+
+
+/* ----- HARDWARE COUNTERS ----- */
+
+/**
+ * @brief Enable the hardware counters (Linux perf events) in the metrics zones.
+ * The counters which cannot be opened (not supported, or not permitted by
+ * perf_event_paranoid) are reported as not available, and the zones
+ * keep collecting the timings.
+ * @param[in] enable Enable or disable the counters
+ * @returns True if at least a counter is available
+ */
+bool enableHardwareCounters(const bool enable)
+{
+    if (!enable) {
+        internal::countersEnabled = false;
+        return false;
+    }
+
+    bool anyAvailable = false;
+    int firstError = 0;
+
+    std::string availableCounters, notAvailableCounters;
+    for (unsigned int c = 0; c < NUMBER_METRICS_COUNTERS; c++) {
+        const int fd = internal::openCounter(static_cast<MetricsCounter>(c));
+
+        internal::counterAvailable[c] = fd >= 0;
+        std::string& list = fd >= 0 ? availableCounters : notAvailableCounters;
+        list += (list.empty() ? "" : ", ") + std::string(internal::counterNames[c]);
+
+        if (fd >= 0) {
+            anyAvailable = true;
+#ifdef FAF_PERF_EVENTS
+            close(fd);
+#endif
+        }
+        else if (firstError == 0) {
+            firstError = errno;
+        }
+    }
+
+    internal::countersEnabled = anyAvailable;
+
+    if (anyAvailable) {
+        std::cout << "Hardware counters: " << availableCounters;
+        if (!notAvailableCounters.empty())
+            std::cout << " (not available: " << notAvailableCounters << ")";
+        std::cout << std::endl;
+    }
+    else {
+#ifdef FAF_PERF_EVENTS
+        std::cout << "Hardware counters not available: " << std::strerror(firstError) <<
+                     " (check /proc/sys/kernel/perf_event_paranoid). Only the timings will be reported." << std::endl;
+#else
+        std::cout << "Hardware counters are supported only on Linux. Only the timings will be reported." << std::endl;
+#endif
+    }
+
+    return anyAvailable;
+}
+
+/**
+ * @brief Check if the hardware counters are enabled
+ * @returns True if the counters are enabled
+ */
+bool areHardwareCountersEnabled()
+{
+    return internal::countersEnabled;
+}
+
+/**
+ * @brief Check if a hardware counter has been opened
+ * @param[in] counter Counter
+ * @returns True if the counter is available
+ */
+bool isHardwareCounterAvailable(const MetricsCounter counter)
+{
+    return internal::countersEnabled && internal::counterAvailable[counter];
+}
+
+
+
+/* ----- METRICS ZONES ----- */
+
+/**
+ * @brief Start a metrics zone: the time and, if enabled, the hardware counters
+ * and the allocations are collected until the zone is stopped. A zone started
+ * in a sequential part counts the events of all the OpenMP threads, a zone
+ * started in a parallel region only the events of its thread (without the
+ * peak of the live bytes and the call sites of the allocations). The zones started while another zone
+ * is running are named after it (parent/child).
+ * @param[in] name Name of the zone
+ */
+MetricsZone::MetricsZone(const std::string& name) :
+    isRunning(true),
+    seconds(0)
+{
+#ifdef _OPENMP
+    isAcrossThreads = !omp_in_parallel();
+#else
+    isAcrossThreads = true;
+#endif
+
+    //Register the zone, so the zones are printed in the order they have been started
+    {
+        std::lock_guard<std::mutex> lock(internal::metricsMutex);
+
+        //The zones of the worker threads are named after the zone of the sequential part
+        std::string parent;
+        if (!internal::zoneStack.empty())
+            parent = internal::zoneStack.back();
+        else if (!isAcrossThreads)
+            parent = internal::sequentialPath;
+
+        path = parent.empty() ? name : parent + "/" + name;
+
+        if (internal::zoneMetrics.find(path) == internal::zoneMetrics.end()) {
+            const size_t order = internal::zoneMetrics.size();
+            internal::zoneMetrics[path].order = order;
+        }
+
+        if (isAcrossThreads)
+            internal::sequentialPath = path;
+    }
+    internal::zoneStack.push_back(path);
+
+    hasCounters = internal::countersEnabled;
+    if (hasCounters) {
+        internal::readCounters(isAcrossThreads, startValues);
+    }
+    values.fill(0);
+
+    hasAllocations = isAllocationTrackingEnabled();
+    allocations = {0, 0};
+    previousPeakLiveBytes = 0;
+    peakLiveBytes = 0;
+    if (hasAllocations) {
+        if (isAcrossThreads) {
+            getAllocationSites(startSites);
+            previousPeakLiveBytes = beginPeakLiveBytes();
+        }
+        getAllocationCounters(isAcrossThreads, startAllocations);
+    }
+
+    startTime = std::chrono::steady_clock::now();
+}
+
+/**
+ * @brief Stop the zone, if it is running
+ */
+MetricsZone::~MetricsZone()
+{
+    stop();
+}
+
+/**
+ * @brief Stop the zone and add its metrics to the ones of the zones with the same name
+ */
+void MetricsZone::stop()
+{
+    if (!isRunning)
+        return;
+
+    seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+
+    if (hasAllocations) {
+        AllocationCounters endAllocations;
+        getAllocationCounters(isAcrossThreads, endAllocations);
+        allocations.allocations = endAllocations.allocations - startAllocations.allocations;
+        allocations.bytes = endAllocations.bytes - startAllocations.bytes;
+
+        if (isAcrossThreads) {
+            peakLiveBytes = endPeakLiveBytes(previousPeakLiveBytes);
+
+            //Call sites of the allocations of the zone
+            std::vector<AllocationSite> endSites;
+            getAllocationSites(endSites);
+
+            sites.clear();
+            size_t s = 0;
+            for (const AllocationSite& endSite : endSites) {
+                while (s < startSites.size() && startSites[s].address < endSite.address)
+                    s++;
+
+                AllocationSite site = endSite;
+                if (s < startSites.size() && startSites[s].address == endSite.address) {
+                    site.allocations -= startSites[s].allocations;
+                    site.bytes -= startSites[s].bytes;
+                }
+                if (site.allocations > 0)
+                    sites.push_back(site);
+            }
+            startSites.clear();
+        }
+    }
+
+    if (hasCounters) {
+        CounterValues endValues;
+        internal::readCounters(isAcrossThreads, endValues);
+        for (unsigned int c = 0; c < NUMBER_METRICS_COUNTERS; c++)
+            values[c] = endValues[c] - startValues[c];
+    }
+
+    isRunning = false;
+    if (!internal::zoneStack.empty() && internal::zoneStack.back() == path)
+        internal::zoneStack.pop_back();
+
+    std::lock_guard<std::mutex> lock(internal::metricsMutex);
+
+    if (isAcrossThreads)
+        internal::sequentialPath = internal::zoneStack.empty() ? "" : internal::zoneStack.back();
+
+    internal::ZoneMetrics& zone = internal::zoneMetrics[path];
+    zone.calls++;
+    zone.seconds += seconds;
+    zone.hasCounters = zone.hasCounters && hasCounters;
+    for (unsigned int c = 0; c < NUMBER_METRICS_COUNTERS; c++)
+        zone.counters[c] += values[c];
+
+    zone.hasAllocations = zone.hasAllocations && hasAllocations;
+    zone.hasAllocationSites = zone.hasAllocationSites && hasAllocations && isAcrossThreads;
+    zone.allocations.allocations += allocations.allocations;
+    zone.allocations.bytes += allocations.bytes;
+    zone.peakLiveBytes = std::max(zone.peakLiveBytes, peakLiveBytes);
+    for (const AllocationSite& site : sites) {
+        std::map<const void*, AllocationSite>::iterator it = zone.sites.find(site.address);
+        if (it == zone.sites.end()) {
+            zone.sites.insert(std::make_pair(site.address, site));
+        }
+        else {
+            it->second.allocations += site.allocations;
+            it->second.bytes += site.bytes;
+        }
+    }
+}
+
+/**
+ * @brief Stop the zone and print its time, hardware counters and allocations
+ */
+void MetricsZone::stopAndPrint()
+{
+    stop();
+
+    std::cout << "[" << seconds << " secs]\t" << path << std::endl;
+
+    if (hasCounters) {
+        std::cout << "[" << path << "] " << internal::formatCounters(values) << std::endl;
+    }
+    if (hasAllocations) {
+        std::cout << "[" << path << "] " << internal::formatAllocations(allocations, isAcrossThreads, peakLiveBytes) << std::endl;
+        internal::printTopAllocationSites(sites);
+    }
+}
+
+/**
+ * @brief Print the metrics of all the zones, in the order they have been started
+ */
+void printMetrics()
+{
+    std::lock_guard<std::mutex> lock(internal::metricsMutex);
+
+    std::vector<std::pair<size_t, const std::pair<const std::string, internal::ZoneMetrics>*>> zones;
+    for (const std::pair<const std::string, internal::ZoneMetrics>& zone : internal::zoneMetrics)
+        zones.push_back(std::make_pair(zone.second.order, &zone));
+    std::sort(zones.begin(), zones.end());
+
+    std::cout << "\n--- Metrics: ---\n\n";
+    for (const std::pair<size_t, const std::pair<const std::string, internal::ZoneMetrics>*>& zone : zones) {
+        const internal::ZoneMetrics& metrics = zone.second->second;
+
+        std::cout << zone.second->first << ": " << metrics.calls << (metrics.calls == 1 ? " call, " : " calls, ") <<
+                     std::fixed << std::setprecision(3) << metrics.seconds << " s" << std::defaultfloat;
+        if (metrics.hasCounters)
+            std::cout << "; " << internal::formatCounters(metrics.counters);
+        if (metrics.hasAllocations)
+            std::cout << "; " << internal::formatAllocations(metrics.allocations, metrics.hasAllocationSites, metrics.peakLiveBytes);
+        std::cout << "\n";
+
+        if (metrics.hasAllocationSites) {
+            std::vector<AllocationSite> sites;
+            for (const std::pair<const void* const, AllocationSite>& site : metrics.sites)
+                sites.push_back(site.second);
+            internal::printTopAllocationSites(sites);
+        }
+    }
+    std::cout << std::endl;
+}
+
+/**
+ * @brief Remove the metrics of all the zones
+ */
+void resetMetrics()
+{
+    std::lock_guard<std::mutex> lock(internal::metricsMutex);
+    internal::zoneMetrics.clear();
+}
+
+
+namespace internal {
+
+/**
+ * @brief Counters of a thread, opened the first time they are read
+ */
+ThreadCounters::ThreadCounters() :
+    isOpened(false)
+{
+    fds.fill(-1);
+}
+
+/**
+ * @brief Close the counters of the thread
+ */
+ThreadCounters::~ThreadCounters()
+{
+#ifdef FAF_PERF_EVENTS
+    for (const int fd : fds) {
+        if (fd >= 0)
+            close(fd);
+    }
+#endif
+}
+
+/**
+ * @brief Open a counter of the calling thread, counting the user-space events only
+ * @param[in] counter Counter
+ * @returns File descriptor of the counter, -1 if it cannot be opened
+ */
+int openCounter(const MetricsCounter counter)
+{
+#ifdef FAF_PERF_EVENTS
+    perf_event_attr attr;
+    std::memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+
+    switch (counter) {
+    case CYCLES:
+        attr.type = PERF_TYPE_HARDWARE;
+        attr.config = PERF_COUNT_HW_CPU_CYCLES;
+        break;
+    case INSTRUCTIONS:
+        attr.type = PERF_TYPE_HARDWARE;
+        attr.config = PERF_COUNT_HW_INSTRUCTIONS;
+        break;
+    case LLC_MISSES:
+        attr.type = PERF_TYPE_HARDWARE;
+        attr.config = PERF_COUNT_HW_CACHE_MISSES;
+        break;
+    case BRANCH_MISSES:
+        attr.type = PERF_TYPE_HARDWARE;
+        attr.config = PERF_COUNT_HW_BRANCH_MISSES;
+        break;
+    default:
+        attr.type = PERF_TYPE_SOFTWARE;
+        attr.config = PERF_COUNT_SW_PAGE_FAULTS;
+        break;
+    }
+
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+
+    return static_cast<int>(syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0));
+#else
+    (void) counter;
+    errno = ENOSYS;
+    return -1;
+#endif
+}
+
+/**
+ * @brief Read the counters of the calling thread, scaled if they have been multiplexed
+ * @param[out] values Values of the counters
+ */
+void readThreadCounters(CounterValues& values)
+{
+    values.fill(0);
+
+    if (!threadCounters.isOpened) {
+        for (unsigned int c = 0; c < NUMBER_METRICS_COUNTERS; c++) {
+            if (counterAvailable[c])
+                threadCounters.fds[c] = openCounter(static_cast<MetricsCounter>(c));
+        }
+        threadCounters.isOpened = true;
+    }
+
+#ifdef FAF_PERF_EVENTS
+    for (unsigned int c = 0; c < NUMBER_METRICS_COUNTERS; c++) {
+        const int fd = threadCounters.fds[c];
+        if (fd < 0)
+            continue;
+
+        //Value, time enabled and time running
+        uint64_t data[3];
+        if (read(fd, data, sizeof(data)) == static_cast<ssize_t>(sizeof(data)) && data[2] > 0) {
+            values[c] = static_cast<double>(data[0]) * static_cast<double>(data[1]) / static_cast<double>(data[2]);
+        }
+    }
+#endif
+}
+
+/**
+ * @brief Read the counters of the calling thread, or the sum of the counters
+ * of all the OpenMP threads
+ * @param[in] acrossThreads Sum the counters of all the OpenMP threads
+ * @param[out] values Values of the counters
+ */
+void readCounters(
+        const bool acrossThreads,
+        CounterValues& values)
+{
+#ifdef _OPENMP
+    if (acrossThreads) {
+        const int nThreads = omp_get_max_threads();
+        std::vector<CounterValues> threadValues(nThreads);
+
+        #pragma omp parallel num_threads(nThreads)
+        {
+            readThreadCounters(threadValues[omp_get_thread_num()]);
+        }
+
+        values.fill(0);
+        for (const CounterValues& threadValue : threadValues) {
+            for (unsigned int c = 0; c < NUMBER_METRICS_COUNTERS; c++)
+                values[c] += threadValue[c];
+        }
+        return;
+    }
+#else
+    (void) acrossThreads;
+#endif
+
+    readThreadCounters(values);
+}
+
+/**
+ * @brief Format the values of the available counters
+ * @param[in] values Values of the counters
+ * @returns Formatted values
+ */
+std::string formatCounters(const CounterValues& values)
+{
+    std::ostringstream ss;
+    ss << std::setprecision(3);
+
+    for (unsigned int c = 0; c < NUMBER_METRICS_COUNTERS; c++) {
+        if (c > 0)
+            ss << ", ";
+        ss << counterNames[c] << ": ";
+        if (counterAvailable[c])
+            ss << values[c];
+        else
+            ss << "n/a";
+
+        //Instructions per cycle
+        if (c == INSTRUCTIONS && counterAvailable[CYCLES] && counterAvailable[INSTRUCTIONS] && values[CYCLES] > 0) {
+            ss << " (IPC " << values[INSTRUCTIONS] / values[CYCLES] << ")";
+        }
+    }
+
+    return ss.str();
+}
+
+/**
+ * @brief Format the allocations of a zone
+ * @param[in] allocations Allocation counters
+ * @param[in] hasPeak The peak of the live bytes has been measured
+ * @param[in] peakLiveBytes Peak of the live bytes
+ * @returns Formatted allocations
+ */
+std::string formatAllocations(
+        const AllocationCounters& allocations,
+        const bool hasPeak,
+        const size_t peakLiveBytes)
+{
+    std::ostringstream ss;
+    ss << "allocations: " << allocations.allocations << ", allocated: " << formatBytes(static_cast<double>(allocations.bytes));
+    if (hasPeak)
+        ss << ", peak live: " << formatBytes(static_cast<double>(peakLiveBytes));
+
+    return ss.str();
+}
+
+/**
+ * @brief Format a number of bytes
+ * @param[in] bytes Number of bytes
+ * @returns Formatted bytes
+ */
+std::string formatBytes(const double bytes)
+{
+    const char* units[4] = {"B", "KB", "MB", "GB"};
+
+    double value = bytes;
+    unsigned int u = 0;
+    while (value >= 1024 && u < 3) {
+        value /= 1024;
+        u++;
+    }
+
+    std::ostringstream ss;
+    ss << std::fixed << std::setprecision(u == 0 ? 0 : 1) << value << " " << units[u];
+
+    return ss.str();
+}
+
+/**
+ * @brief Print the call sites with the highest number of allocations
+ * @param[in] sites Call sites
+ */
+void printTopAllocationSites(std::vector<AllocationSite> sites)
+{
+    const size_t nSites = std::min(sites.size(), static_cast<size_t>(NUMBER_TOP_ALLOCATION_SITES));
+
+    std::partial_sort(sites.begin(), sites.begin() + nSites, sites.end(), [] (const AllocationSite& a, const AllocationSite& b) {
+        return a.allocations > b.allocations;
+    });
+
+    for (size_t i = 0; i < nSites; i++) {
+        std::cout << "    " << sites[i].allocations << " allocations, " << formatBytes(static_cast<double>(sites[i].bytes)) <<
+                     ": " << getAllocationSiteName(sites[i].address) << "\n";
+    }
+}
+
+}
+
+}
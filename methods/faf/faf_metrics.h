@@ -0,0 +1,64 @@
+#ifndef FAF_METRICS_H
+#define FAF_METRICS_H
+
+#include <string>
+#include <array>
+#include <vector>
+#include <chrono>
+
+#include "faf_allocations.h"
+
+namespace FourAxisFabrication {
+
+/* Hardware counters */
+
+enum MetricsCounter { CYCLES = 0, INSTRUCTIONS, LLC_MISSES, BRANCH_MISSES, PAGE_FAULTS, NUMBER_METRICS_COUNTERS };
+
+typedef std::array<double, NUMBER_METRICS_COUNTERS> CounterValues;
+
+bool enableHardwareCounters(const bool enable);
+bool areHardwareCountersEnabled();
+bool isHardwareCounterAvailable(const MetricsCounter counter);
+
+
+/* Metrics of the zones */
+
+class MetricsZone {
+
+public:
+
+    MetricsZone(const std::string& name);
+    ~MetricsZone();
+
+    MetricsZone(const MetricsZone& other) = delete;
+    MetricsZone& operator=(const MetricsZone& other) = delete;
+
+    void stop();
+    void stopAndPrint();
+
+private:
+
+    std::string path;
+    bool isRunning;
+    bool isAcrossThreads;
+    bool hasCounters;
+    std::chrono::steady_clock::time_point startTime;
+    CounterValues startValues;
+    double seconds;
+    CounterValues values;
+
+    bool hasAllocations;
+    AllocationCounters startAllocations;
+    AllocationCounters allocations;
+    size_t previousPeakLiveBytes;
+    size_t peakLiveBytes;
+    std::vector<AllocationSite> startSites;
+    std::vector<AllocationSite> sites;
+};
+
+void printMetrics();
+void resetMetrics();
+
+}
+
+#endif // FAF_METRICS_H
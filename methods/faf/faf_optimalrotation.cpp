@@ -1,6 +1,8 @@
 #include "faf_optimalrotation.h"
 
 #include "faf_extremes.h"
+#include "faf_metrics.h"
+#include "faf_meshview.h"
 
 #include <cg3/geometry/transformations3.h>
 #include <cg3/algorithms/sphere_coverage.h>
@@ -137,6 +139,10 @@ bool rotateToOptimalOrientation(
     double maxBBScore = -std::numeric_limits<double>::max();
     double maxExtremeScore = -std::numeric_limits<double>::max();
 
+    //The candidates read the rotated normals of the smoothed mesh
+    smoothedMesh.updateFaceNormals();
+
+    MetricsZone candidatesZone("Orientation candidates");
     for (size_t i = 0; i < candidateDirs.size(); i++) {
         const cg3::Vec3d& dir = candidateDirs[i];
         cg3::Vec3d rotationAxis;
@@ -149,16 +155,14 @@ bool rotateToOptimalOrientation(
         assert(!std::isnan(angle));
         Eigen::Matrix3d rot = cg3::rotationMatrix(rotationAxis, angle);
 
-        //Rotate mesh
-        cg3::EigenMesh copyOriginalMesh = mesh;
-        copyOriginalMesh.rotate(rot);
-        copyOriginalMesh.updateBoundingBox();
-        cg3::Point3d meshCenter = copyOriginalMesh.boundingBox().center();
+        //Rotated mesh
+        const TransformedMeshView rotatedMesh(mesh, rot);
+        cg3::Point3d meshCenter = rotatedMesh.boundingBox().center();
 
         //Check if it fits
         isFitting[i] = true;
-        for(unsigned int vId = 0; vId < copyOriginalMesh.numberVertices(); vId++) {
-            cg3::Point3d p = copyOriginalMesh.vertex(vId);
+        for(unsigned int vId = 0; vId < rotatedMesh.numberVertices(); vId++) {
+            cg3::Point3d p = rotatedMesh.vertex(vId);
             cg3::Vec3d vec = p - meshCenter;
 
             double length = vec.x();
@@ -171,12 +175,9 @@ bool rotateToOptimalOrientation(
 
         //If it fits in the stock
         if (isFitting[i]) {
-            //Rotate smoothed mesh
-            cg3::EigenMesh copySmoothedMesh = smoothedMesh;
-            copySmoothedMesh.rotate(rot);
-            copySmoothedMesh.updateBoundingBox();
-            copySmoothedMesh.updateFaceNormals();
-            cg3::BoundingBox3 copyBB = copySmoothedMesh.boundingBox();
+            //Rotated smoothed mesh
+            const TransformedMeshView rotatedSmoothedMesh(smoothedMesh, rot);
+            cg3::BoundingBox3 copyBB = rotatedSmoothedMesh.boundingBox();
 
             //Length of the x dimension
             BBScores[i] = copyBB.lengthX();
@@ -184,7 +185,7 @@ bool rotateToOptimalOrientation(
             //Get extremes
             std::vector<unsigned int> minExtremes;
             std::vector<unsigned int> maxExtremes;
-            selectExtremesOnXAxis(copySmoothedMesh, heightFieldAngle, ffAdj, minExtremes, maxExtremes);
+            selectExtremesOnXAxis(rotatedSmoothedMesh, heightFieldAngle, ffAdj, minExtremes, maxExtremes);
 
             std::set<unsigned int> extremesSet;
             extremesSet.insert(minExtremes.begin(), minExtremes.end());
@@ -196,25 +197,25 @@ bool rotateToOptimalOrientation(
 
             //Get normal scores
             for (size_t fId = 0; fId < minExtremes.size(); fId++) {
-                cg3::Vec3d n = copySmoothedMesh.faceNormal(minExtremes[fId]);
-                double a = copySmoothedMesh.faceArea(fId);
+                cg3::Vec3d n = rotatedSmoothedMesh.faceNormal(minExtremes[fId]);
+                double a = rotatedSmoothedMesh.faceArea(fId);
                 normalScores[i] += a * n.dot(-xAxis);
 
                 minArea += a;
                 totalArea += a;
             }
             for (size_t fId = 0; fId < maxExtremes.size(); fId++) {
-                cg3::Vec3d n = copySmoothedMesh.faceNormal(maxExtremes[fId]);
-                double a = copySmoothedMesh.faceArea(fId);
+                cg3::Vec3d n = rotatedSmoothedMesh.faceNormal(maxExtremes[fId]);
+                double a = rotatedSmoothedMesh.faceArea(fId);
                 normalScores[i] += a * n.dot(xAxis);
 
                 maxArea += a;
                 totalArea += a;
             }
-            for(unsigned int fId = 0; fId < copySmoothedMesh.numberFaces(); fId++) {
+            for(unsigned int fId = 0; fId < rotatedSmoothedMesh.numberFaces(); fId++) {
                 if (extremesSet.find(fId) == extremesSet.end()) {
-                    cg3::Vec3d n = copySmoothedMesh.faceNormal(fId);
-                    double a = copySmoothedMesh.faceArea(fId);
+                    cg3::Vec3d n = rotatedSmoothedMesh.faceNormal(fId);
+                    double a = rotatedSmoothedMesh.faceArea(fId);
                     normalScores[i] += a * (1 - std::fabs(n.dot(xAxis)));
 
                     totalArea += a;
@@ -231,6 +232,7 @@ bool rotateToOptimalOrientation(
 
         }
     }
+    candidatesZone.stop();
 
     //Normalize scores
     for (size_t i = 0; i < candidateDirs.size(); i++) {
@@ -50,6 +50,11 @@ void optimization(
     if (relaxHoles) {
         unsigned int facesAffected = 0;
         unsigned int chartAffected = 0;
+
+        //Faces of the current hole chart still to be relaxed, and faces in the frontier
+        std::vector<bool> isRemaining(nFaces, false);
+        std::vector<bool> isPending(nFaces, false);
+
         for (const Chart& surroundingChart : chartData.charts) {
             const int surroundingChartLabel = surroundingChart.label;
 
@@ -58,32 +63,45 @@ void optimization(
                     const Chart& holeChart = chartData.charts.at(holeChartId);
 
                     if (!chartData.isExtreme.at(holeChart.id)) {
-                        std::set<unsigned int> remainingHoleChartFaces(holeChart.faces.begin(), holeChart.faces.end());
-
-                        std::vector<unsigned int> facesToBeRelaxed;
-                        do {
-                            facesToBeRelaxed.clear();
+                        for (const unsigned int fId : holeChart.faces) {
+                            isRemaining[fId] = true;
+                        }
 
-                            for (const unsigned int fId : remainingHoleChartFaces) {
-                                bool isOnBorder = false;
+                        //The frontier is initialized with the visible faces on the border
+                        std::queue<unsigned int> frontier;
+                        for (const unsigned int fId : holeChart.faces) {
+                            if (visibility(surroundingChartLabel, fId) > 0) {
                                 for (const int adjF : ffAdj[fId]) {
                                     if (association[adjF] == surroundingChartLabel) {
-                                        isOnBorder = true;
+                                        isPending[fId] = true;
+                                        frontier.push(fId);
+                                        break;
                                     }
                                 }
-
-                                if (isOnBorder && visibility(surroundingChartLabel, fId) > 0)
-                                    facesToBeRelaxed.push_back(fId);
                             }
+                        }
 
-                            for (const unsigned int fId : facesToBeRelaxed) {
-                                association[fId] = surroundingChartLabel;
-                                facesAffected++;
+                        //Only the faces adjacent to a relaxed face can be relaxed
+                        while (!frontier.empty()) {
+                            const unsigned int fId = frontier.front();
+                            frontier.pop();
 
-                                remainingHoleChartFaces.erase(fId);
+                            association[fId] = surroundingChartLabel;
+                            isRemaining[fId] = false;
+                            facesAffected++;
+
+                            for (const int adjF : ffAdj[fId]) {
+                                if (isRemaining[adjF] && !isPending[adjF] && visibility(surroundingChartLabel, adjF) > 0) {
+                                    isPending[adjF] = true;
+                                    frontier.push(adjF);
+                                }
                             }
                         }
-                        while (!facesToBeRelaxed.empty());
+
+                        for (const unsigned int fId : holeChart.faces) {
+                            isRemaining[fId] = false;
+                            isPending[fId] = false;
+                        }
 
                         chartAffected++;
                     }
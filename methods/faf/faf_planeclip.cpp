@@ -0,0 +1,1267 @@
+#include "faf_planeclip.h"
+
+#include "faf_arena.h"
+
+#include <array>
+#include <map>
+#include <unordered_map>
+#include <unordered_set>
+#include <algorithm>
+#include <cmath>
+
+#include <cg3/geometry/point2.h>
+
+#include <cg3/cgal/triangulation2.h>
+
+namespace FourAxisFabrication {
+
+
+/* Useful function declaration */
+
+namespace internal {
+
+struct PlaneSplit {
+    std::vector<cg3::Point3d> vertices;
+    std::vector<std::array<int, 3>> faces;
+    std::vector<int> birthFaces;
+    std::vector<std::vector<int>> sectionLoops;
+};
+
+bool splitWithPlane(
+        const cg3::EigenMesh& mesh,
+        const cg3::Vec3d& normal,
+        const double offset,
+        PlaneSplit& split);
+
+bool triangulatePlanarLoops(
+        const std::vector<std::vector<int>>& loops,
+        const std::vector<cg3::Point3d>& vertices,
+        const cg3::Vec3d& normal,
+        std::vector<std::array<int, 3>>& triangles);
+
+bool isClosed(
+        const std::vector<std::array<int, 3>>& faces);
+
+cg3::EigenMesh buildMesh(
+        const std::vector<cg3::Point3d>& vertices,
+        const std::vector<std::array<int, 3>>& faces);
+
+bool isPointInsidePolygon(
+        const cg3::Point2d& point,
+        const std::vector<cg3::Point2d>& polygon);
+
+struct ClipVertex {
+    cg3::Point3d point;
+    int type; //0: input vertex (a), 1: input edge (a,b) and plane c, 2: planes (a,b) in the triangle
+    int a, b, c;
+    int support; //Plane of the outgoing edge, -1 if it lies on the input edge (edgeA,edgeB)
+    int edgeA, edgeB;
+};
+
+bool clipPolygonWithPlane(
+        const std::vector<ClipVertex>& polygon,
+        const int plane,
+        const std::vector<cg3::Vec3d>& planeNormals,
+        const std::vector<double>& planeOffsets,
+        const cg3::EigenMesh& mesh,
+        const cg3::Vec3d& triangleNormal,
+        const double triangleOffset,
+        const double eps,
+        std::vector<ClipVertex>& result);
+
+bool isPointInsideMesh(
+        const cg3::Point3d& point,
+        const cg3::EigenMesh& mesh);
+
+}
+
+
+/* ----- PLANE CLIPPING ----- */
+
+/**
+ * @brief Clip a closed mesh with a plane, keeping the part of the mesh
+ * in the half-space normal.dot(p) <= offset. The cross-section is closed
+ * with a planar cap, computed by triangulating the section loops.
+ * It gives the same result of the intersection between the mesh and a box
+ * which differs from the mesh bounds only on the clipping plane, in linear time.
+ * @param[in] mesh Input mesh
+ * @param[in] planeNormal Normal of the plane (pointing to the removed part)
+ * @param[in] planeOffset Offset of the plane
+ * @param[out] result Resulting mesh
+ * @returns True if the clipping succeeded and the result is closed, false in case
+ * of degenerate configurations (faces lying on the plane, non-manifold sections).
+ * In that case the general booleans should be used.
+ */
+bool clipWithPlane(
+        const cg3::EigenMesh& mesh,
+        const cg3::Vec3d& planeNormal,
+        const double planeOffset,
+        cg3::EigenMesh& result)
+{
+    std::vector<int> birthFaces;
+    return clipWithPlane(mesh, planeNormal, planeOffset, result, birthFaces);
+}
+
+/**
+ * @brief Clip a closed mesh with a plane, keeping the part of the mesh
+ * in the half-space normal.dot(p) <= offset. The cross-section is closed
+ * with a planar cap, computed by triangulating the section loops.
+ * It gives the same result of the intersection between the mesh and a box
+ * which differs from the mesh bounds only on the clipping plane, in linear time.
+ * @param[in] mesh Input mesh
+ * @param[in] planeNormal Normal of the plane (pointing to the removed part)
+ * @param[in] planeOffset Offset of the plane
+ * @param[out] result Resulting mesh
+ * @param[out] birthFaces For each face of the result, the face of the input
+ * mesh it comes from, -1 if it is a face of the cap
+ * @returns True if the clipping succeeded and the result is closed, false in case
+ * of degenerate configurations (faces lying on the plane, non-manifold sections).
+ * In that case the general booleans should be used.
+ */
+bool clipWithPlane(
+        const cg3::EigenMesh& mesh,
+        const cg3::Vec3d& planeNormal,
+        const double planeOffset,
+        cg3::EigenMesh& result,
+        std::vector<int>& birthFaces)
+{
+    const double normalLength = planeNormal.norm();
+    if (normalLength <= 0)
+        return false;
+
+    const cg3::Vec3d normal = planeNormal / normalLength;
+    const double offset = planeOffset / normalLength;
+
+    internal::PlaneSplit split;
+    if (!internal::splitWithPlane(mesh, normal, offset, split))
+        return false;
+
+    //Cap of the section
+    std::vector<std::array<int, 3>> capTriangles;
+    if (!internal::triangulatePlanarLoops(split.sectionLoops, split.vertices, normal, capTriangles))
+        return false;
+
+    for (const std::array<int, 3>& triangle : capTriangles) {
+        split.faces.push_back(triangle);
+        split.birthFaces.push_back(-1);
+    }
+
+    if (!internal::isClosed(split.faces))
+        return false;
+
+    result = internal::buildMesh(split.vertices, split.faces);
+    birthFaces = split.birthFaces;
+
+    return true;
+}
+
+/**
+ * @brief Difference between a box and a closed mesh, where the box contains
+ * the mesh in y and z and one of its x-faces (the clipping plane) cuts the mesh.
+ * The result is the box in which the x-face on the plane is replaced by
+ * the square minus the mesh section, and the part of the mesh inside the box
+ * with inverted orientation.
+ * @param[in] box Box
+ * @param[in] mesh Input mesh
+ * @param[out] result Resulting mesh
+ * @returns True if the difference has been computed, false if the configuration
+ * is not supported or degenerate. In that case the general booleans should be used.
+ */
+bool boxDifferenceOnXPlane(
+        const cg3::BoundingBox3& box,
+        const cg3::EigenMesh& mesh,
+        cg3::EigenMesh& result)
+{
+    //Bounds of the mesh (the stored bounding box may not be updated)
+    cg3::BoundingBox3 meshBB;
+    if (mesh.numberVertices() == 0)
+        return false;
+    meshBB.setMin(mesh.vertex(0));
+    meshBB.setMax(mesh.vertex(0));
+    for (unsigned int vId = 1; vId < mesh.numberVertices(); vId++) {
+        const cg3::Point3d p = mesh.vertex(vId);
+        meshBB.setMin(cg3::Point3d(std::min(meshBB.minX(), p.x()), std::min(meshBB.minY(), p.y()), std::min(meshBB.minZ(), p.z())));
+        meshBB.setMax(cg3::Point3d(std::max(meshBB.maxX(), p.x()), std::max(meshBB.maxY(), p.y()), std::max(meshBB.maxZ(), p.z())));
+    }
+
+    //The box must strictly contain the mesh in y and z
+    if (box.minY() >= meshBB.minY() || box.maxY() <= meshBB.maxY() ||
+            box.minZ() >= meshBB.minZ() || box.maxZ() <= meshBB.maxZ())
+    {
+        return false;
+    }
+
+    //Select the x-face of the box which cuts the mesh
+    cg3::Vec3d normal;
+    double offset;
+    double planeX, farX;
+    if (box.minX() < meshBB.minX()) {
+        normal = cg3::Vec3d(1,0,0);
+        offset = box.maxX();
+        planeX = box.maxX();
+        farX = box.minX();
+    }
+    else if (box.maxX() > meshBB.maxX()) {
+        normal = cg3::Vec3d(-1,0,0);
+        offset = -box.minX();
+        planeX = box.minX();
+        farX = box.maxX();
+    }
+    else {
+        return false;
+    }
+
+    internal::PlaneSplit split;
+    if (!internal::splitWithPlane(mesh, normal, offset, split))
+        return false;
+
+    //Inverting orientation of the part of the mesh inside the box
+    for (std::array<int, 3>& face : split.faces) {
+        std::swap(face[1], face[2]);
+    }
+
+    //Box vertices
+    const int firstBoxVertex = static_cast<int>(split.vertices.size());
+    split.vertices.push_back(cg3::Point3d(planeX, box.minY(), box.minZ()));
+    split.vertices.push_back(cg3::Point3d(planeX, box.maxY(), box.minZ()));
+    split.vertices.push_back(cg3::Point3d(planeX, box.maxY(), box.maxZ()));
+    split.vertices.push_back(cg3::Point3d(planeX, box.minY(), box.maxZ()));
+    split.vertices.push_back(cg3::Point3d(farX, box.minY(), box.minZ()));
+    split.vertices.push_back(cg3::Point3d(farX, box.maxY(), box.minZ()));
+    split.vertices.push_back(cg3::Point3d(farX, box.maxY(), box.maxZ()));
+    split.vertices.push_back(cg3::Point3d(farX, box.minY(), box.maxZ()));
+
+    //Box faces (except the one on the plane), oriented outwards
+    const cg3::Point3d boxCenter((planeX + farX) / 2, box.center().y(), box.center().z());
+    const std::array<std::array<int, 4>, 5> quads = {{
+        {{4, 5, 6, 7}},
+        {{0, 1, 5, 4}},
+        {{1, 2, 6, 5}},
+        {{2, 3, 7, 6}},
+        {{3, 0, 4, 7}}
+    }};
+    for (const std::array<int, 4>& quad : quads) {
+        const std::array<std::array<int, 3>, 2> quadTriangles = {{
+            {{firstBoxVertex + quad[0], firstBoxVertex + quad[1], firstBoxVertex + quad[2]}},
+            {{firstBoxVertex + quad[0], firstBoxVertex + quad[2], firstBoxVertex + quad[3]}}
+        }};
+        for (std::array<int, 3> triangle : quadTriangles) {
+            const cg3::Point3d& p0 = split.vertices[triangle[0]];
+            const cg3::Point3d& p1 = split.vertices[triangle[1]];
+            const cg3::Point3d& p2 = split.vertices[triangle[2]];
+
+            cg3::Vec3d triangleNormal = (p1 - p0).cross(p2 - p0);
+            cg3::Point3d barycenter = (p0 + p1 + p2) / 3;
+            if (triangleNormal.dot(barycenter - boxCenter) < 0) {
+                std::swap(triangle[1], triangle[2]);
+            }
+
+            split.faces.push_back(triangle);
+        }
+    }
+
+    //Face on the plane: the square minus the section
+    std::vector<std::vector<int>> capLoops;
+    capLoops.push_back({firstBoxVertex, firstBoxVertex + 1, firstBoxVertex + 2, firstBoxVertex + 3});
+    capLoops.insert(capLoops.end(), split.sectionLoops.begin(), split.sectionLoops.end());
+
+    std::vector<std::array<int, 3>> capTriangles;
+    if (!internal::triangulatePlanarLoops(capLoops, split.vertices, normal, capTriangles))
+        return false;
+
+    split.faces.insert(split.faces.end(), capTriangles.begin(), capTriangles.end());
+
+    if (!internal::isClosed(split.faces))
+        return false;
+
+    result = internal::buildMesh(split.vertices, split.faces);
+
+    return true;
+}
+
+/* ----- CYLINDER CLIPPING ----- */
+
+/**
+ * @brief Clip a closed mesh with a cylinder centered in the origin, having the
+ * x-axis as axis. The lateral surface is tessellated at the given subdivision
+ * and phase (the vertices of the tessellation lie on the analytic cylinder, the
+ * first one at the angle phase from the y-axis). Each triangle
+ * is clipped only against the facets it crosses, and the caps on the facets are
+ * generated directly, by closing the section chains along the facet boundaries.
+ * It gives the same result of the intersection with the tessellated cylinder.
+ * @param[in] mesh Input mesh
+ * @param[in] radius Radius of the cylinder
+ * @param[in] halfLength Half of the length of the cylinder
+ * @param[in] subdivisions Number of subdivisions of the lateral surface
+ * @param[in] phase Angle of the first vertex of the tessellation
+ * @param[out] result Resulting mesh
+ * @returns True if the clipping succeeded and the result is closed, false otherwise.
+ * In that case the general booleans should be used.
+ */
+bool clipWithCylinder(
+        const cg3::EigenMesh& mesh,
+        const double radius,
+        const double halfLength,
+        const unsigned int subdivisions,
+        const double phase,
+        cg3::EigenMesh& result)
+{
+    if (subdivisions < 3 || mesh.numberFaces() == 0)
+        return false;
+
+    const int n = static_cast<int>(subdivisions);
+    const int maxPlane = n;
+    const int minPlane = n + 1;
+    const double step = 2 * M_PI / n;
+    const double facetOffset = radius * std::cos(step / 2);
+    const double eps = 1e-9 * (radius + halfLength);
+
+    //Planes: the facet k lies between the angles of the corners k and k+1, then the two bases
+    std::vector<cg3::Vec3d> planeNormals(n + 2);
+    std::vector<double> planeOffsets(n + 2);
+    for (int k = 0; k < n; k++) {
+        const double angle = k * step + phase + step / 2;
+        planeNormals[k] = cg3::Vec3d(0, std::cos(angle), std::sin(angle));
+        planeOffsets[k] = facetOffset;
+    }
+    planeNormals[maxPlane] = cg3::Vec3d(1,0,0);
+    planeOffsets[maxPlane] = halfLength;
+    planeNormals[minPlane] = cg3::Vec3d(-1,0,0);
+    planeOffsets[minPlane] = halfLength;
+
+    //Corners: k is at the angle k*step + phase on the max base, n + k on the min base
+    auto cornerPosition = [&] (const int cornerId) {
+        const double angle = (cornerId % n) * step + phase;
+        const double x = cornerId < n ? halfLength : -halfLength;
+        return cg3::Point3d(x, radius * std::cos(angle), radius * std::sin(angle));
+    };
+
+    const unsigned int nVertices = mesh.numberVertices();
+    const unsigned int nFaces = mesh.numberFaces();
+
+    //Planes violated by each vertex: a cyclic interval of facets and the bases
+    std::vector<int> firstFacet(nVertices, 0);
+    std::vector<int> nFacets(nVertices, 0);
+    std::vector<bool> isOutMax(nVertices, false);
+    std::vector<bool> isOutMin(nVertices, false);
+    bool isCut = false;
+    for (unsigned int vId = 0; vId < nVertices; vId++) {
+        const cg3::Point3d p = mesh.vertex(vId);
+
+        isOutMax[vId] = p.x() - halfLength > eps;
+        isOutMin[vId] = -p.x() - halfLength > eps;
+
+        auto isOutFacet = [&] (const int k) {
+            return planeNormals[(k % n + n) % n].dot(p) - facetOffset > eps;
+        };
+
+        //The facet containing the angle of the vertex is the first to be violated
+        double angle = std::atan2(p.z(), p.y()) - phase;
+        if (angle < 0)
+            angle += 2 * M_PI;
+        const int k = static_cast<int>(std::floor(angle / step)) % n;
+
+        if (isOutFacet(k)) {
+            int left = k;
+            int count = 1;
+            while (count < n && isOutFacet(left - 1)) {
+                left--;
+                count++;
+            }
+            int right = k;
+            while (count < n && isOutFacet(right + 1)) {
+                right++;
+                count++;
+            }
+            firstFacet[vId] = (left % n + n) % n;
+            nFacets[vId] = count;
+        }
+
+        isCut |= isOutMax[vId] || isOutMin[vId] || nFacets[vId] > 0;
+    }
+
+    if (!isCut) {
+        result = mesh;
+        return true;
+    }
+
+    std::vector<cg3::Point3d> vertices;
+    std::vector<std::array<int, 3>> faces;
+    vertices.reserve(nVertices);
+    faces.reserve(nFaces);
+
+    std::vector<int> vertexMap(nVertices, -1);
+    std::map<std::array<int, 3>, int> edgeVertexMap;
+
+    //Vertices on the edges of the prism (with the other plane) and section edges on each plane
+    std::vector<std::vector<std::pair<int, int>>> planeHits(n + 2);
+    std::vector<std::unordered_set<unsigned long long>> sectionEdges(n + 2);
+
+    std::vector<int> planes;
+    std::vector<internal::ClipVertex> polygon;
+    std::vector<internal::ClipVertex> clippedPolygon;
+    std::vector<int> polygonIds;
+
+    for (unsigned int fId = 0; fId < nFaces; fId++) {
+        const cg3::Point3i face = mesh.face(fId);
+        const int v[3] = {face.x(), face.y(), face.z()};
+
+        auto inputVertex = [&] (const int vId) {
+            if (vertexMap[vId] < 0) {
+                vertexMap[vId] = static_cast<int>(vertices.size());
+                vertices.push_back(mesh.vertex(vId));
+            }
+            return vertexMap[vId];
+        };
+
+        //Planes crossed by the triangle
+        planes.clear();
+        for (int i = 0; i < 3; i++) {
+            if (isOutMax[v[i]])
+                planes.push_back(maxPlane);
+            if (isOutMin[v[i]])
+                planes.push_back(minPlane);
+            for (int j = 0; j < nFacets[v[i]]; j++) {
+                planes.push_back((firstFacet[v[i]] + j) % n);
+            }
+        }
+
+        if (planes.empty()) {
+            faces.push_back({{inputVertex(v[0]), inputVertex(v[1]), inputVertex(v[2])}});
+            continue;
+        }
+
+        std::sort(planes.begin(), planes.end());
+        planes.erase(std::unique(planes.begin(), planes.end()), planes.end());
+
+        const cg3::Point3d p0 = mesh.vertex(v[0]);
+        const cg3::Vec3d triangleNormal = (mesh.vertex(v[1]) - p0).cross(mesh.vertex(v[2]) - p0);
+        const double triangleOffset = triangleNormal.dot(p0);
+
+        polygon.resize(3);
+        for (int i = 0; i < 3; i++) {
+            internal::ClipVertex& clipVertex = polygon[i];
+            clipVertex.point = mesh.vertex(v[i]);
+            clipVertex.type = 0;
+            clipVertex.a = v[i];
+            clipVertex.b = clipVertex.c = -1;
+            clipVertex.support = -1;
+            clipVertex.edgeA = v[i];
+            clipVertex.edgeB = v[(i+1)%3];
+        }
+
+        for (const int plane : planes) {
+            if (!internal::clipPolygonWithPlane(
+                        polygon, plane, planeNormals, planeOffsets, mesh,
+                        triangleNormal, triangleOffset, eps, clippedPolygon))
+            {
+                return false;
+            }
+            polygon.swap(clippedPolygon);
+
+            if (polygon.size() < 3)
+                break;
+        }
+
+        if (polygon.size() < 3)
+            continue;
+
+        //Vertex indices
+        polygonIds.resize(polygon.size());
+        for (size_t i = 0; i < polygon.size(); i++) {
+            const internal::ClipVertex& clipVertex = polygon[i];
+
+            if (clipVertex.type == 0) {
+                polygonIds[i] = inputVertex(clipVertex.a);
+            }
+            else if (clipVertex.type == 1) {
+                std::pair<std::map<std::array<int, 3>, int>::iterator, bool> inserted =
+                        edgeVertexMap.insert(std::make_pair(
+                            std::array<int, 3>{{clipVertex.a, clipVertex.b, clipVertex.c}},
+                            static_cast<int>(vertices.size())));
+                if (inserted.second)
+                    vertices.push_back(clipVertex.point);
+                polygonIds[i] = inserted.first->second;
+            }
+            else {
+                polygonIds[i] = static_cast<int>(vertices.size());
+                vertices.push_back(clipVertex.point);
+
+                planeHits[clipVertex.a].push_back(std::make_pair(polygonIds[i], clipVertex.b));
+                planeHits[clipVertex.b].push_back(std::make_pair(polygonIds[i], clipVertex.a));
+            }
+        }
+
+        //Convex polygon
+        for (size_t i = 1; i + 1 < polygon.size(); i++) {
+            faces.push_back({{polygonIds[0], polygonIds[i], polygonIds[i+1]}});
+        }
+
+        //Section edges (opposite edges cancel each other)
+        for (size_t i = 0; i < polygon.size(); i++) {
+            const int plane = polygon[i].support;
+            const int a = polygonIds[i];
+            const int b = polygonIds[(i+1)%polygon.size()];
+
+            if (plane < 0 || a == b)
+                continue;
+
+            const unsigned long long key = (static_cast<unsigned long long>(a) << 32) | static_cast<unsigned long long>(b);
+            const unsigned long long oppositeKey = (static_cast<unsigned long long>(b) << 32) | static_cast<unsigned long long>(a);
+            if (sectionEdges[plane].erase(oppositeKey) == 0) {
+                sectionEdges[plane].insert(key);
+            }
+        }
+    }
+
+    //Inside status of the corners, propagated along the edges of the prism
+    //with the parity of the hits: it is needed for the facets without hits
+    std::vector<int> isCornerInside;
+    auto computeCornerStatus = [&] () {
+        std::map<std::pair<int, int>, int> lineHits;
+        for (int p = 0; p < n + 2; p++) {
+            for (const std::pair<int, int>& hit : planeHits[p]) {
+                if (p < hit.second)
+                    lineHits[std::make_pair(p, hit.second)]++;
+            }
+        }
+        auto hitParity = [&] (const int p, const int q) {
+            std::map<std::pair<int, int>, int>::const_iterator it =
+                    lineHits.find(std::make_pair(std::min(p, q), std::max(p, q)));
+            return it == lineHits.end() ? 0 : it->second % 2;
+        };
+
+        isCornerInside.assign(2 * n, -1);
+        isCornerInside[0] = internal::isPointInsideMesh(cornerPosition(0), mesh) ? 1 : 0;
+
+        std::vector<int> stack(1, 0);
+        while (!stack.empty()) {
+            const int cornerId = stack.back();
+            stack.pop_back();
+
+            const int k = cornerId % n;
+            const int base = cornerId < n ? maxPlane : minPlane;
+            const int offset = cornerId < n ? 0 : n;
+
+            const std::array<std::pair<int, int>, 3> adjacent = {{
+                std::make_pair(offset + (k + 1) % n, hitParity(k, base)),
+                std::make_pair(offset + (k - 1 + n) % n, hitParity((k - 1 + n) % n, base)),
+                std::make_pair((cornerId + n) % (2 * n), hitParity((k - 1 + n) % n, k))
+            }};
+
+            for (const std::pair<int, int>& adj : adjacent) {
+                if (isCornerInside[adj.first] < 0) {
+                    isCornerInside[adj.first] = isCornerInside[cornerId] ^ adj.second;
+                    stack.push_back(adj.first);
+                }
+            }
+        }
+    };
+
+    std::vector<int> cornerVertex(2 * n, -1);
+    auto cornerId = [&] (const int corner) {
+        if (cornerVertex[corner] < 0) {
+            cornerVertex[corner] = static_cast<int>(vertices.size());
+            vertices.push_back(cornerPosition(corner));
+        }
+        return cornerVertex[corner];
+    };
+
+    //Caps on the facets
+    for (int p = 0; p < n + 2; p++) {
+        //Corners of the facet (counterclockwise with respect to the normal) and the
+        //planes adjacent to each edge of the facet
+        std::vector<int> corners;
+        std::vector<int> adjacentPlanes;
+        if (p < n) {
+            corners = {n + p, n + (p + 1) % n, (p + 1) % n, p};
+            adjacentPlanes = {minPlane, (p + 1) % n, maxPlane, (p - 1 + n) % n};
+        }
+        else if (p == maxPlane) {
+            for (int k = 0; k < n; k++) {
+                corners.push_back(k);
+                adjacentPlanes.push_back(k);
+            }
+        }
+        else {
+            for (int i = 0; i < n; i++) {
+                corners.push_back(n + (n - i) % n);
+                adjacentPlanes.push_back((2 * n - i - 1) % n);
+            }
+        }
+
+        //Edges of the cap: opposite to the section edges
+        std::unordered_map<int, int> next;
+        std::unordered_set<int> hasPrevious;
+        for (const unsigned long long& key : sectionEdges[p]) {
+            const int a = static_cast<int>(key >> 32);
+            const int b = static_cast<int>(key & 0xFFFFFFFF);
+
+            if (!next.insert(std::make_pair(b, a)).second || !hasPrevious.insert(a).second)
+                return false;
+        }
+
+        std::vector<std::vector<int>> loops;
+
+        if (planeHits[p].empty()) {
+            //The boundary of the facet is entirely inside or outside the mesh
+            if (isCornerInside.empty())
+                computeCornerStatus();
+
+            if (isCornerInside[corners[0]] == 1) {
+                std::vector<int> loop;
+                for (const int corner : corners) {
+                    loop.push_back(cornerId(corner));
+                }
+                loops.push_back(loop);
+            }
+        }
+        else {
+            //Boundary of the facet: the corners and the hits sorted along the edges
+            std::vector<std::vector<std::pair<double, int>>> edgeHits(corners.size());
+            for (const std::pair<int, int>& hit : planeHits[p]) {
+                std::vector<int>::const_iterator it = std::find(adjacentPlanes.begin(), adjacentPlanes.end(), hit.second);
+                if (it == adjacentPlanes.end())
+                    return false;
+
+                const size_t edgeId = it - adjacentPlanes.begin();
+                const cg3::Point3d start = cornerPosition(corners[edgeId]);
+                const cg3::Point3d end = cornerPosition(corners[(edgeId + 1) % corners.size()]);
+
+                edgeHits[edgeId].push_back(std::make_pair((vertices[hit.first] - start).dot(end - start), hit.first));
+            }
+
+            std::vector<int> boundary;
+            std::vector<bool> isCorner;
+            std::unordered_map<int, size_t> boundaryPosition;
+            for (size_t i = 0; i < corners.size(); i++) {
+                boundary.push_back(cornerId(corners[i]));
+                isCorner.push_back(true);
+
+                std::sort(edgeHits[i].begin(), edgeHits[i].end());
+                for (const std::pair<double, int>& hit : edgeHits[i]) {
+                    boundaryPosition[hit.second] = boundary.size();
+                    boundary.push_back(hit.second);
+                    isCorner.push_back(false);
+                }
+            }
+
+            auto isChainStart = [&] (const int vId) {
+                return next.find(vId) != next.end() && hasPrevious.find(vId) == hasPrevious.end();
+            };
+            auto isChainEnd = [&] (const int vId) {
+                return next.find(vId) == next.end() && hasPrevious.find(vId) != hasPrevious.end();
+            };
+
+            for (size_t i = 0; i < boundary.size(); i++) {
+                if (!isCorner[i] && !isChainStart(boundary[i]) && !isChainEnd(boundary[i]))
+                    return false;
+            }
+
+            //Chains are connected walking counterclockwise along the boundary
+            for (size_t i = 0; i < boundary.size(); i++) {
+                if (isCorner[i] || !isChainStart(boundary[i]))
+                    continue;
+
+                const int loopStart = boundary[i];
+                std::vector<int> loop;
+
+                int chainStart = loopStart;
+                do {
+                    int current = chainStart;
+                    loop.push_back(current);
+
+                    std::unordered_map<int, int>::iterator it = next.find(current);
+                    while (it != next.end()) {
+                        current = it->second;
+                        next.erase(it);
+                        loop.push_back(current);
+                        it = next.find(current);
+                    }
+
+                    std::unordered_map<int, size_t>::const_iterator posIt = boundaryPosition.find(current);
+                    if (posIt == boundaryPosition.end())
+                        return false;
+
+                    size_t pos = (posIt->second + 1) % boundary.size();
+                    while (isCorner[pos]) {
+                        loop.push_back(boundary[pos]);
+                        pos = (pos + 1) % boundary.size();
+                    }
+
+                    chainStart = boundary[pos];
+                    if (chainStart != loopStart && !isChainStart(chainStart))
+                        return false;
+                } while (chainStart != loopStart);
+
+                loops.push_back(loop);
+            }
+        }
+
+        //Closed loops inside the facet
+        while (!next.empty()) {
+            const int start = next.begin()->first;
+
+            std::vector<int> loop;
+            int current = start;
+            do {
+                loop.push_back(current);
+
+                std::unordered_map<int, int>::iterator it = next.find(current);
+                if (it == next.end())
+                    return false;
+
+                current = it->second;
+                next.erase(it);
+            } while (current != start);
+
+            if (loop.size() < 3)
+                return false;
+
+            loops.push_back(loop);
+        }
+
+        std::vector<std::array<int, 3>> capTriangles;
+        if (!internal::triangulatePlanarLoops(loops, vertices, planeNormals[p], capTriangles))
+            return false;
+
+        faces.insert(faces.end(), capTriangles.begin(), capTriangles.end());
+    }
+
+    if (faces.empty() || !internal::isClosed(faces))
+        return false;
+
+    result = internal::buildMesh(vertices, faces);
+
+    return true;
+}
+
+
+/**
+ * @brief Check if a mesh is closed: each edge is shared by exactly
+ * two faces with opposite orientation.
+ * @param[in] mesh Input mesh
+ * @returns True if the mesh is closed
+ */
+bool isClosedMesh(
+        const cg3::SimpleEigenMesh& mesh)
+{
+    std::vector<std::array<int, 3>> faces(mesh.numberFaces());
+    for (unsigned int fId = 0; fId < mesh.numberFaces(); fId++) {
+        cg3::Point3i face = mesh.face(fId);
+        faces[fId] = {{face.x(), face.y(), face.z()}};
+    }
+    return internal::isClosed(faces);
+}
+
+
+namespace internal {
+
+/**
+ * @brief Split the faces of a mesh with a plane. The faces (or the parts of the
+ * faces) in the half-space normal.dot(p) <= offset are kept, and the loops of
+ * the section are extracted. The loops are oriented as the boundary of the cap
+ * which closes the kept part.
+ * @param[in] mesh Input mesh
+ * @param[in] normal Unit normal of the plane
+ * @param[in] offset Offset of the plane
+ * @param[out] split Kept vertices, faces (with birth faces) and section loops
+ * @returns False if the configuration is degenerate
+ */
+bool splitWithPlane(
+        const cg3::EigenMesh& mesh,
+        const cg3::Vec3d& normal,
+        const double offset,
+        PlaneSplit& split)
+{
+    const unsigned int nVertices = mesh.numberVertices();
+
+    //Signed distances from the plane
+    std::vector<double> distance(nVertices);
+    double maxDistance = 0;
+    for (unsigned int vId = 0; vId < nVertices; vId++) {
+        distance[vId] = normal.dot(mesh.vertex(vId)) - offset;
+        maxDistance = std::max(maxDistance, std::fabs(distance[vId]));
+    }
+
+    const double eps = 1e-9 * std::max(maxDistance, 1.0);
+
+    std::vector<int> side(nVertices);
+    for (unsigned int vId = 0; vId < nVertices; vId++) {
+        side[vId] = distance[vId] < -eps ? -1 : (distance[vId] > eps ? 1 : 0);
+    }
+
+    std::vector<bool> isOnPlane;
+    split.vertices.reserve(nVertices);
+    split.faces.reserve(mesh.numberFaces());
+    split.birthFaces.reserve(mesh.numberFaces());
+
+    //Kept vertices
+    std::vector<int> vertexMap(nVertices, -1);
+    auto keptVertex = [&] (const int vId) {
+        if (vertexMap[vId] < 0) {
+            vertexMap[vId] = static_cast<int>(split.vertices.size());
+            split.vertices.push_back(mesh.vertex(vId));
+            isOnPlane.push_back(side[vId] == 0);
+        }
+        return vertexMap[vId];
+    };
+
+    //Vertices on the split edges
+    std::unordered_map<unsigned long long, int> edgeMap;
+    auto edgeVertex = [&] (const int v1, const int v2) {
+        const int a = std::min(v1, v2);
+        const int b = std::max(v1, v2);
+        const unsigned long long key = (static_cast<unsigned long long>(a) << 32) | static_cast<unsigned long long>(b);
+
+        std::unordered_map<unsigned long long, int>::iterator it = edgeMap.find(key);
+        if (it != edgeMap.end())
+            return it->second;
+
+        const double t = distance[a] / (distance[a] - distance[b]);
+        const cg3::Point3d p = mesh.vertex(a) + (mesh.vertex(b) - mesh.vertex(a)) * t;
+
+        int newId = static_cast<int>(split.vertices.size());
+        split.vertices.push_back(p);
+        isOnPlane.push_back(true);
+        edgeMap.insert(std::make_pair(key, newId));
+
+        return newId;
+    };
+
+    //Directed section edges (opposite edges cancel each other)
+    std::unordered_set<unsigned long long> sectionEdges;
+    auto addSectionEdge = [&] (const int a, const int b) {
+        const unsigned long long key = (static_cast<unsigned long long>(a) << 32) | static_cast<unsigned long long>(b);
+        const unsigned long long oppositeKey = (static_cast<unsigned long long>(b) << 32) | static_cast<unsigned long long>(a);
+
+        if (sectionEdges.erase(oppositeKey) == 0) {
+            sectionEdges.insert(key);
+        }
+    };
+
+    for (unsigned int fId = 0; fId < mesh.numberFaces(); fId++) {
+        cg3::Point3i face = mesh.face(fId);
+        const int v[3] = {face.x(), face.y(), face.z()};
+
+        //Faces on the plane are not supported
+        if (side[v[0]] == 0 && side[v[1]] == 0 && side[v[2]] == 0)
+            return false;
+
+        //Clip the triangle
+        int polygon[4];
+        int polygonSize = 0;
+        for (int i = 0; i < 3; i++) {
+            const int a = v[i];
+            const int b = v[(i+1)%3];
+
+            if (side[a] <= 0) {
+                polygon[polygonSize++] = keptVertex(a);
+            }
+            if (side[a] * side[b] < 0) {
+                polygon[polygonSize++] = edgeVertex(a, b);
+            }
+        }
+
+        if (polygonSize < 3)
+            continue;
+
+        split.faces.push_back({{polygon[0], polygon[1], polygon[2]}});
+        split.birthFaces.push_back(static_cast<int>(fId));
+        if (polygonSize == 4) {
+            split.faces.push_back({{polygon[0], polygon[2], polygon[3]}});
+            split.birthFaces.push_back(static_cast<int>(fId));
+        }
+
+        for (int i = 0; i < polygonSize; i++) {
+            const int a = polygon[i];
+            const int b = polygon[(i+1)%polygonSize];
+            if (isOnPlane[a] && isOnPlane[b]) {
+                addSectionEdge(a, b);
+            }
+        }
+    }
+
+    //The cap uses the section edges with opposite orientation
+    std::unordered_map<int, int> next;
+    for (const unsigned long long& key : sectionEdges) {
+        const int a = static_cast<int>(key >> 32);
+        const int b = static_cast<int>(key & 0xFFFFFFFF);
+
+        if (!next.insert(std::make_pair(b, a)).second)
+            return false;
+    }
+
+    //Chain the edges in loops
+    split.sectionLoops.clear();
+    while (!next.empty()) {
+        const int start = next.begin()->first;
+
+        std::vector<int> loop;
+        int current = start;
+        do {
+            loop.push_back(current);
+
+            std::unordered_map<int, int>::iterator it = next.find(current);
+            if (it == next.end())
+                return false;
+
+            current = it->second;
+            next.erase(it);
+        } while (current != start);
+
+        if (loop.size() < 3)
+            return false;
+
+        split.sectionLoops.push_back(loop);
+    }
+
+    return true;
+}
+
+/**
+ * @brief Triangulate a set of planar loops, with any nesting. The region is
+ * given by the even-odd rule: loops at even depth are outer boundaries,
+ * loops at odd depth are holes. The triangles are oriented along the normal.
+ * @param[in] loops Loops of vertex indices
+ * @param[in] vertices Vertices
+ * @param[in] normal Normal of the plane
+ * @param[out] triangles Resulting triangles
+ * @returns False if the triangulation failed
+ */
+bool triangulatePlanarLoops(
+        const std::vector<std::vector<int>>& loops,
+        const std::vector<cg3::Point3d>& vertices,
+        const cg3::Vec3d& normal,
+        std::vector<std::array<int, 3>>& triangles)
+{
+    triangles.clear();
+
+    if (loops.empty())
+        return true;
+
+    //Basis of the plane (u x v = normal)
+    cg3::Vec3d axis = std::fabs(normal.x()) < 0.9 ? cg3::Vec3d(1,0,0) : cg3::Vec3d(0,1,0);
+    cg3::Vec3d u = axis.cross(normal);
+    u /= u.norm();
+    cg3::Vec3d v = normal.cross(u);
+
+    //Projected loops
+    std::vector<std::vector<cg3::Point2d>> loops2D(loops.size());
+    StageArena arena;
+    const ArenaAllocator<std::pair<const cg3::Point2d, int>> allocator(arena);
+    ArenaMap<cg3::Point2d, int> pointMap(allocator);
+    for (size_t i = 0; i < loops.size(); i++) {
+        loops2D[i].resize(loops[i].size());
+        for (size_t j = 0; j < loops[i].size(); j++) {
+            const cg3::Point3d& p = vertices[loops[i][j]];
+            loops2D[i][j] = cg3::Point2d(u.dot(p), v.dot(p));
+
+            std::pair<ArenaMap<cg3::Point2d, int>::iterator, bool> inserted =
+                    pointMap.insert(std::make_pair(loops2D[i][j], loops[i][j]));
+            if (!inserted.second && inserted.first->second != loops[i][j])
+                return false;
+        }
+    }
+
+    //Nesting depth of each loop
+    std::vector<unsigned int> depth(loops.size(), 0);
+    for (size_t i = 0; i < loops.size(); i++) {
+        for (size_t j = 0; j < loops.size(); j++) {
+            if (i != j && isPointInsidePolygon(loops2D[i][0], loops2D[j])) {
+                depth[i]++;
+            }
+        }
+    }
+
+    for (size_t i = 0; i < loops.size(); i++) {
+        if (depth[i] % 2 != 0)
+            continue;
+
+        std::vector<std::vector<cg3::Point2d>> holes;
+        for (size_t j = 0; j < loops.size(); j++) {
+            if (depth[j] == depth[i] + 1 && isPointInsidePolygon(loops2D[j][0], loops2D[i])) {
+                holes.push_back(loops2D[j]);
+            }
+        }
+
+        std::vector<std::array<cg3::Point2d, 3>> triangulation = cg3::cgal::triangulate2(loops2D[i], holes);
+
+        for (const std::array<cg3::Point2d, 3>& triangle : triangulation) {
+            std::array<int, 3> t;
+            bool isThereNewVertex = false;
+
+            for (unsigned int k = 0; k < 3 && !isThereNewVertex; k++) {
+                ArenaMap<cg3::Point2d, int>::const_iterator it = pointMap.find(triangle[k]);
+                if (it != pointMap.end()) {
+                    t[k] = it->second;
+                }
+                else {
+                    isThereNewVertex = true;
+                }
+            }
+            if (isThereNewVertex)
+                return false;
+
+            const double area =
+                    (triangle[1].x() - triangle[0].x()) * (triangle[2].y() - triangle[0].y()) -
+                    (triangle[1].y() - triangle[0].y()) * (triangle[2].x() - triangle[0].x());
+
+            if (area < 0) {
+                std::swap(t[1], t[2]);
+            }
+
+            triangles.push_back(t);
+        }
+    }
+
+    return true;
+}
+
+/**
+ * @brief Check if a set of faces is closed: each directed edge has
+ * exactly one opposite edge.
+ * @param[in] faces Faces
+ * @returns True if closed
+ */
+bool isClosed(
+        const std::vector<std::array<int, 3>>& faces)
+{
+    std::unordered_map<unsigned long long, int> edgeCount;
+    edgeCount.reserve(faces.size() * 3);
+
+    for (const std::array<int, 3>& face : faces) {
+        for (int i = 0; i < 3; i++) {
+            const unsigned long long key =
+                    (static_cast<unsigned long long>(face[i]) << 32) | static_cast<unsigned long long>(face[(i+1)%3]);
+            if (++edgeCount[key] > 1)
+                return false;
+        }
+    }
+
+    for (const std::array<int, 3>& face : faces) {
+        for (int i = 0; i < 3; i++) {
+            const unsigned long long oppositeKey =
+                    (static_cast<unsigned long long>(face[(i+1)%3]) << 32) | static_cast<unsigned long long>(face[i]);
+            if (edgeCount.find(oppositeKey) == edgeCount.end())
+                return false;
+        }
+    }
+
+    return true;
+}
+
+/**
+ * @brief Build a mesh from vertices and faces in a single step
+ * @param[in] vertices Vertices
+ * @param[in] faces Faces
+ * @returns Resulting mesh
+ */
+cg3::EigenMesh buildMesh(
+        const std::vector<cg3::Point3d>& vertices,
+        const std::vector<std::array<int, 3>>& faces)
+{
+    Eigen::MatrixXd V(vertices.size(), 3);
+    for (size_t i = 0; i < vertices.size(); i++) {
+        V(i, 0) = vertices[i].x();
+        V(i, 1) = vertices[i].y();
+        V(i, 2) = vertices[i].z();
+    }
+
+    Eigen::MatrixXi F(faces.size(), 3);
+    for (size_t i = 0; i < faces.size(); i++) {
+        F(i, 0) = faces[i][0];
+        F(i, 1) = faces[i][1];
+        F(i, 2) = faces[i][2];
+    }
+
+    cg3::EigenMesh mesh(V, F);
+    mesh.updateFacesAndVerticesNormals();
+    mesh.updateBoundingBox();
+
+    return mesh;
+}
+
+/**
+ * @brief Check if a point is inside a polygon (crossing number)
+ * @param[in] point Point
+ * @param[in] polygon Polygon
+ * @returns True if the point is inside
+ */
+bool isPointInsidePolygon(
+        const cg3::Point2d& point,
+        const std::vector<cg3::Point2d>& polygon)
+{
+    bool inside = false;
+    for (size_t i = 0, j = polygon.size() - 1; i < polygon.size(); j = i++) {
+        const cg3::Point2d& a = polygon[i];
+        const cg3::Point2d& b = polygon[j];
+
+        if ((a.y() > point.y()) != (b.y() > point.y()) &&
+                point.x() < (b.x() - a.x()) * (point.y() - a.y()) / (b.y() - a.y()) + a.x())
+        {
+            inside = !inside;
+        }
+    }
+    return inside;
+}
+
+/**
+ * @brief Clip a convex polygon, lying in a triangle of the mesh, with a plane.
+ * The part in the half-space normal.dot(p) <= offset is kept. The new vertices
+ * are computed from the input edges or from the planes which generated them,
+ * so that they are identical in the adjacent triangles.
+ * @param[in] polygon Input polygon
+ * @param[in] plane Index of the plane
+ * @param[in] planeNormals Normals of the planes
+ * @param[in] planeOffsets Offsets of the planes
+ * @param[in] mesh Input mesh
+ * @param[in] triangleNormal Normal (not normalized) of the triangle
+ * @param[in] triangleOffset Offset of the plane of the triangle
+ * @param[in] eps Tolerance of the sides
+ * @param[out] result Clipped polygon
+ * @returns False if the configuration is degenerate
+ */
+bool clipPolygonWithPlane(
+        const std::vector<ClipVertex>& polygon,
+        const int plane,
+        const std::vector<cg3::Vec3d>& planeNormals,
+        const std::vector<double>& planeOffsets,
+        const cg3::EigenMesh& mesh,
+        const cg3::Vec3d& triangleNormal,
+        const double triangleOffset,
+        const double eps,
+        std::vector<ClipVertex>& result)
+{
+    const cg3::Vec3d& normal = planeNormals[plane];
+    const double offset = planeOffsets[plane];
+
+    result.clear();
+
+    std::vector<int> side(polygon.size());
+    bool isOnPlane = true;
+    for (size_t i = 0; i < polygon.size(); i++) {
+        const double distance = normal.dot(polygon[i].point) - offset;
+        side[i] = distance < -eps ? -1 : (distance > eps ? 1 : 0);
+        isOnPlane &= side[i] == 0;
+    }
+
+    //Faces on the plane are not supported
+    if (isOnPlane)
+        return false;
+
+    auto intersection = [&] (const ClipVertex& from, ClipVertex& vertex) {
+        if (from.support < 0) {
+            const int a = std::min(from.edgeA, from.edgeB);
+            const int b = std::max(from.edgeA, from.edgeB);
+            const cg3::Point3d pa = mesh.vertex(a);
+            const cg3::Point3d pb = mesh.vertex(b);
+            const double da = normal.dot(pa) - offset;
+            const double db = normal.dot(pb) - offset;
+
+            vertex.point = pa + (pb - pa) * (da / (da - db));
+            vertex.type = 1;
+            vertex.a = a;
+            vertex.b = b;
+            vertex.c = plane;
+        }
+        else {
+            //Intersection of the triangle plane with the two planes
+            const cg3::Vec3d& n1 = triangleNormal;
+            const cg3::Vec3d& n2 = planeNormals[from.support];
+            const cg3::Vec3d& n3 = normal;
+            const double det = n1.dot(n2.cross(n3));
+            if (std::fabs(det) <= 1e-12 * n1.norm())
+                return false;
+
+            vertex.point = (n2.cross(n3) * triangleOffset + n3.cross(n1) * planeOffsets[from.support] + n1.cross(n2) * offset) / det;
+            vertex.type = 2;
+            vertex.a = std::min(from.support, plane);
+            vertex.b = std::max(from.support, plane);
+            vertex.c = -1;
+        }
+        return true;
+    };
+
+    for (size_t i = 0; i < polygon.size(); i++) {
+        const ClipVertex& current = polygon[i];
+        const size_t nextId = (i + 1) % polygon.size();
+
+        if (side[i] <= 0) {
+            result.push_back(current);
+        }
+
+        if (side[i] * side[nextId] < 0) {
+            ClipVertex vertex;
+            if (!intersection(current, vertex))
+                return false;
+
+            if (side[i] < 0) {
+                //Leaving: the outgoing edge lies on the plane
+                vertex.support = plane;
+                vertex.edgeA = vertex.edgeB = -1;
+            }
+            else {
+                //Entering: the outgoing edge is the rest of the current edge
+                vertex.support = current.support;
+                vertex.edgeA = current.edgeA;
+                vertex.edgeB = current.edgeB;
+            }
+            result.push_back(vertex);
+        }
+        else if (side[i] == 0 && side[nextId] > 0) {
+            result.back().support = plane;
+            result.back().edgeA = result.back().edgeB = -1;
+        }
+    }
+
+    return true;
+}
+
+/**
+ * @brief Check if a point is inside a closed mesh, counting the intersections
+ * of a ray with the faces
+ * @param[in] point Input point
+ * @param[in] mesh Input mesh
+ * @returns True if the point is inside
+ */
+bool isPointInsideMesh(
+        const cg3::Point3d& point,
+        const cg3::EigenMesh& mesh)
+{
+    //Direction not aligned with the axes
+    cg3::Vec3d direction(0.3197, 0.5541, 0.7687);
+    direction /= direction.norm();
+
+    unsigned int nIntersections = 0;
+    for (unsigned int fId = 0; fId < mesh.numberFaces(); fId++) {
+        const cg3::Point3i face = mesh.face(fId);
+        const cg3::Point3d p0 = mesh.vertex(face.x());
+        const cg3::Vec3d e1 = mesh.vertex(face.y()) - p0;
+        const cg3::Vec3d e2 = mesh.vertex(face.z()) - p0;
+
+        const cg3::Vec3d h = direction.cross(e2);
+        const double a = e1.dot(h);
+        if (std::fabs(a) < 1e-15)
+            continue;
+
+        const cg3::Vec3d s = point - p0;
+        const double u = s.dot(h) / a;
+        if (u < 0 || u > 1)
+            continue;
+
+        const cg3::Vec3d q = s.cross(e1);
+        const double v = direction.dot(q) / a;
+        if (v < 0 || u + v > 1)
+            continue;
+
+        if (e2.dot(q) / a > 0)
+            nIntersections++;
+    }
+
+    return nIntersections % 2 == 1;
+}
+
+}
+
+}
@@ -0,0 +1,47 @@
+#ifndef FAF_PLANECLIP_H
+#define FAF_PLANECLIP_H
+
+#include <vector>
+
+#include <cg3/meshes/eigenmesh/eigenmesh.h>
+
+namespace FourAxisFabrication {
+
+/* Plane clipping */
+
+bool clipWithPlane(
+        const cg3::EigenMesh& mesh,
+        const cg3::Vec3d& planeNormal,
+        const double planeOffset,
+        cg3::EigenMesh& result);
+
+bool clipWithPlane(
+        const cg3::EigenMesh& mesh,
+        const cg3::Vec3d& planeNormal,
+        const double planeOffset,
+        cg3::EigenMesh& result,
+        std::vector<int>& birthFaces);
+
+bool boxDifferenceOnXPlane(
+        const cg3::BoundingBox3& box,
+        const cg3::EigenMesh& mesh,
+        cg3::EigenMesh& result);
+
+/* Cylinder clipping */
+
+bool clipWithCylinder(
+        const cg3::EigenMesh& mesh,
+        const double radius,
+        const double halfLength,
+        const unsigned int subdivisions,
+        const double phase,
+        cg3::EigenMesh& result);
+
+/* Mesh utilities */
+
+bool isClosedMesh(
+        const cg3::SimpleEigenMesh& mesh);
+
+}
+
+#endif // FAF_PLANECLIP_H
@@ -0,0 +1,386 @@
+#include "faf_simulation.h"
+
+#include "faf_various.h"
+#include "faf_heightmap.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#define SIMULATION_BAND_ROWS 16
+
+namespace FourAxisFabrication {
+
+namespace internal {
+
+void computeDexelIntervals(
+        const cg3::SimpleEigenMesh& mesh,
+        const double minCoord,
+        const double resolution,
+        const unsigned int gridSize,
+        std::vector<std::vector<float>>& intervals);
+
+void subtractRuns(
+        const std::vector<float>& runs,
+        const std::vector<float>& removed,
+        std::vector<float>& result);
+
+double runsLength(
+        const std::vector<float>& runs);
+
+}
+
+
+/* ----- MATERIAL REMOVAL SIMULATION ----- */
+
+/**
+ * @brief Simulate the material removal of the fabrication sequence. The stock
+ * is discretized in dexels (rays along the x-axis on a regular grid of the yz-plane),
+ * each one stored as a sorted list of material runs. The results are replayed
+ * in fabrication order: each direction removes the material which lies above
+ * the heightfield of its result, in the frame in which the direction is the z-axis.
+ * The final material is compared with the X-ray intervals of the target mesh.
+ * @param[in] data Four axis fabrication data
+ * @param[in] stockLength Length of the stock
+ * @param[in] stockDiameter Diameter of the stock
+ * @param[in] resolution Size of the dexel grid cells
+ * @param[in] resultsRotated True if the results have been rotated in the frame of their direction
+ * @param[out] report Simulation report
+ */
+void simulateFabrication(
+        const Data& data,
+        const double stockLength,
+        const double stockDiameter,
+        const double resolution,
+        const bool resultsRotated,
+        SimulationReport& report)
+{
+    const double radius = stockDiameter / 2;
+    const double halfLength = stockLength / 2;
+    const double dexelArea = resolution * resolution;
+
+    const unsigned int gridSize = static_cast<unsigned int>(std::ceil(stockDiameter / resolution));
+    const double minCoord = -radius;
+
+    //Dexels inside the stock disk
+    std::vector<unsigned int> dexelCells;
+    for (unsigned int j = 0; j < gridSize; j++) {
+        const double z = minCoord + (j + 0.5) * resolution;
+        for (unsigned int i = 0; i < gridSize; i++) {
+            const double y = minCoord + (i + 0.5) * resolution;
+            if (y*y + z*z <= radius*radius) {
+                dexelCells.push_back(j * gridSize + i);
+            }
+        }
+    }
+
+    const int nDexels = static_cast<int>(dexelCells.size());
+
+    std::vector<std::vector<float>> dexels(nDexels, std::vector<float>{static_cast<float>(-halfLength), static_cast<float>(halfLength)});
+
+    report.resolution = resolution;
+    report.nDexels = static_cast<unsigned int>(nDexels);
+    report.stockVolume = nDexels * stockLength * dexelArea;
+    report.removedVolumes.assign(data.results.size(), 0.0);
+
+    //Number of samples along the dexels
+    const unsigned int nSamples = static_cast<unsigned int>(std::ceil(stockLength / resolution));
+    const double sampleLength = stockLength / nSamples;
+
+    //Replay the fabrication sequence
+    for (size_t rId = 0; rId < data.results.size(); rId++) {
+        Eigen::Matrix3d rotationMatrix;
+        getDirectionRotationMatrix(data, data.resultsAssociation[rId], rotationMatrix);
+
+        //Extents of the stock in the frame of the direction
+        double minX = std::numeric_limits<double>::max(), maxX = -std::numeric_limits<double>::max();
+        double minY = std::numeric_limits<double>::max(), maxY = -std::numeric_limits<double>::max();
+        for (unsigned int c = 0; c < 8; c++) {
+            const Eigen::Vector3d corner(
+                        c & 1 ? halfLength : -halfLength,
+                        c & 2 ? radius : -radius,
+                        c & 4 ? radius : -radius);
+            const Eigen::Vector3d rotatedCorner = rotationMatrix * corner;
+            minX = std::min(minX, rotatedCorner.x());
+            maxX = std::max(maxX, rotatedCorner.x());
+            minY = std::min(minY, rotatedCorner.y());
+            maxY = std::max(maxY, rotatedCorner.y());
+        }
+
+        const unsigned int sizeX = static_cast<unsigned int>(std::ceil((maxX - minX) / resolution));
+        const unsigned int sizeY = static_cast<unsigned int>(std::ceil((maxY - minY) / resolution));
+
+        Heightmap heightmap;
+        computeHeightmap(
+                    data.results[rId],
+                    resultsRotated ? Eigen::Matrix3d::Identity() : rotationMatrix,
+                    minX, minY, resolution, sizeX, sizeY,
+                    heightmap);
+
+        const Eigen::Vector3d direction = rotationMatrix.col(0);
+
+        double removedVolume = 0;
+
+        #pragma omp parallel for schedule(dynamic, 64) reduction(+:removedVolume)
+        for (int dId = 0; dId < nDexels; dId++) {
+            std::vector<float>& runs = dexels[dId];
+            if (runs.empty())
+                continue;
+
+            const unsigned int cell = dexelCells[dId];
+            const double y = minCoord + (cell % gridSize + 0.5) * resolution;
+            const double z = minCoord + (cell / gridSize + 0.5) * resolution;
+            const Eigen::Vector3d origin = rotationMatrix * Eigen::Vector3d(0, y, z);
+
+            //Samples which contain material
+            const int firstSample = std::max(0, static_cast<int>(std::floor((runs.front() + halfLength) / sampleLength)));
+            const int lastSample = std::min(static_cast<int>(nSamples) - 1, static_cast<int>(std::ceil((runs.back() + halfLength) / sampleLength)) - 1);
+
+            std::vector<float> removed;
+            for (int s = firstSample; s <= lastSample; s++) {
+                const double x0 = -halfLength + s * sampleLength;
+                const double x1 = x0 + sampleLength;
+                const Eigen::Vector3d midPoint = origin + (x0 + x1) / 2 * direction;
+
+                const int i = static_cast<int>(std::floor((midPoint.x() - minX) / resolution));
+                const int j = static_cast<int>(std::floor((midPoint.y() - minY) / resolution));
+
+                double removedStart = x0, removedEnd = x1;
+
+                //The tool reaches all the segment if the result does not cover the cell
+                if (i >= 0 && j >= 0 && i < static_cast<int>(sizeX) && j < static_cast<int>(sizeY) && !heightmap.isEmpty(i, j)) {
+                    const double height = heightmap.height(i, j);
+                    const double z0 = origin.z() + x0 * direction.z();
+                    const double z1 = origin.z() + x1 * direction.z();
+
+                    if (z0 <= height && z1 <= height) {
+                        continue;
+                    }
+                    else if (z0 < height) {
+                        removedStart = x0 + (height - z0) / (z1 - z0) * (x1 - x0);
+                    }
+                    else if (z1 < height) {
+                        removedEnd = x0 + (height - z0) / (z1 - z0) * (x1 - x0);
+                    }
+                }
+
+                //Merge with the last removed interval if contiguous
+                if (!removed.empty() && removed.back() >= static_cast<float>(removedStart)) {
+                    removed.back() = std::max(removed.back(), static_cast<float>(removedEnd));
+                }
+                else {
+                    removed.push_back(static_cast<float>(removedStart));
+                    removed.push_back(static_cast<float>(removedEnd));
+                }
+            }
+
+            if (removed.empty())
+                continue;
+
+            const double previousLength = internal::runsLength(runs);
+
+            std::vector<float> newRuns;
+            internal::subtractRuns(runs, removed, newRuns);
+            runs.swap(newRuns);
+
+            removedVolume += (previousLength - internal::runsLength(runs)) * dexelArea;
+        }
+
+        report.removedVolumes[rId] = removedVolume;
+    }
+
+    //X-ray intervals of the target mesh
+    std::vector<std::vector<float>> targetIntervals;
+    internal::computeDexelIntervals(data.mesh, minCoord, resolution, gridSize, targetIntervals);
+
+    double targetVolume = 0, finalVolume = 0, leftoverVolume = 0, gougedVolume = 0;
+
+    #pragma omp parallel for reduction(+:targetVolume,finalVolume,leftoverVolume,gougedVolume)
+    for (int dId = 0; dId < nDexels; dId++) {
+        const std::vector<float>& runs = dexels[dId];
+        const std::vector<float>& target = targetIntervals[dexelCells[dId]];
+
+        std::vector<float> difference;
+
+        internal::subtractRuns(runs, target, difference);
+        leftoverVolume += internal::runsLength(difference) * dexelArea;
+
+        internal::subtractRuns(target, runs, difference);
+        gougedVolume += internal::runsLength(difference) * dexelArea;
+
+        targetVolume += internal::runsLength(target) * dexelArea;
+        finalVolume += internal::runsLength(runs) * dexelArea;
+    }
+
+    report.targetVolume = targetVolume;
+    report.finalVolume = finalVolume;
+    report.leftoverVolume = leftoverVolume;
+    report.gougedVolume = gougedVolume;
+}
+
+
+namespace internal {
+
+/**
+ * @brief Compute, for each dexel of the grid, the sorted intervals along the x-axis
+ * which are inside the mesh. The dexels are the rays along the x-axis
+ * passing through the centers of the cells of a regular grid of the yz-plane.
+ * The triangles are binned in bands of rows, which are processed in parallel.
+ * @param[in] mesh Input closed mesh
+ * @param[in] minCoord Min y and z coordinate of the grid
+ * @param[in] resolution Size of the cells
+ * @param[in] gridSize Number of cells for each side of the grid
+ * @param[out] intervals Intervals for each cell (pairs of x-coordinates)
+ */
+void computeDexelIntervals(
+        const cg3::SimpleEigenMesh& mesh,
+        const double minCoord,
+        const double resolution,
+        const unsigned int gridSize,
+        std::vector<std::vector<float>>& intervals)
+{
+    intervals.assign(static_cast<size_t>(gridSize) * gridSize, std::vector<float>());
+
+    //Small offset of the ray centers to avoid hitting edges and vertices
+    const double perturbation = resolution * 1e-4;
+
+    //Triangles binned by bands of rows
+    const unsigned int nBands = (gridSize + SIMULATION_BAND_ROWS - 1) / SIMULATION_BAND_ROWS;
+    std::vector<std::vector<unsigned int>> bandFaces(nBands);
+
+    for (unsigned int fId = 0; fId < mesh.numberFaces(); fId++) {
+        const cg3::Point3i face = mesh.face(fId);
+
+        const double faceMinZ = std::min(std::min(mesh.vertex(face.x()).z(), mesh.vertex(face.y()).z()), mesh.vertex(face.z()).z());
+        const double faceMaxZ = std::max(std::max(mesh.vertex(face.x()).z(), mesh.vertex(face.y()).z()), mesh.vertex(face.z()).z());
+
+        const int firstRow = std::max(0, static_cast<int>(std::floor((faceMinZ - minCoord) / resolution - 0.5)));
+        const int lastRow = std::min(static_cast<int>(gridSize) - 1, static_cast<int>(std::ceil((faceMaxZ - minCoord) / resolution - 0.5)));
+
+        if (firstRow > lastRow)
+            continue;
+
+        for (int band = firstRow / SIMULATION_BAND_ROWS; band <= lastRow / SIMULATION_BAND_ROWS; band++) {
+            bandFaces[band].push_back(fId);
+        }
+    }
+
+    #pragma omp parallel for schedule(dynamic)
+    for (int band = 0; band < static_cast<int>(nBands); band++) {
+        const int bandFirstRow = band * SIMULATION_BAND_ROWS;
+        const int bandLastRow = std::min(static_cast<int>(gridSize) - 1, bandFirstRow + SIMULATION_BAND_ROWS - 1);
+
+        for (const unsigned int fId : bandFaces[band]) {
+            const cg3::Point3i face = mesh.face(fId);
+            const cg3::Point3d& a = mesh.vertex(face.x());
+            const cg3::Point3d& b = mesh.vertex(face.y());
+            const cg3::Point3d& c = mesh.vertex(face.z());
+
+            const double area = (b.y() - a.y()) * (c.z() - a.z()) - (b.z() - a.z()) * (c.y() - a.y());
+            if (area == 0)
+                continue;
+
+            const double faceMinY = std::min(std::min(a.y(), b.y()), c.y());
+            const double faceMaxY = std::max(std::max(a.y(), b.y()), c.y());
+            const double faceMinZ = std::min(std::min(a.z(), b.z()), c.z());
+            const double faceMaxZ = std::max(std::max(a.z(), b.z()), c.z());
+
+            const int firstColumn = std::max(0, static_cast<int>(std::floor((faceMinY - minCoord) / resolution - 0.5)));
+            const int lastColumn = std::min(static_cast<int>(gridSize) - 1, static_cast<int>(std::ceil((faceMaxY - minCoord) / resolution - 0.5)));
+            const int firstRow = std::max(bandFirstRow, static_cast<int>(std::floor((faceMinZ - minCoord) / resolution - 0.5)));
+            const int lastRow = std::min(bandLastRow, static_cast<int>(std::ceil((faceMaxZ - minCoord) / resolution - 0.5)));
+
+            for (int j = firstRow; j <= lastRow; j++) {
+                const double z = minCoord + (j + 0.5) * resolution + perturbation;
+
+                for (int i = firstColumn; i <= lastColumn; i++) {
+                    const double y = minCoord + (i + 0.5) * resolution + 0.5 * perturbation;
+
+                    //Barycentric coordinates
+                    const double w0 = ((b.y() - y) * (c.z() - z) - (b.z() - z) * (c.y() - y)) / area;
+                    const double w1 = ((c.y() - y) * (a.z() - z) - (c.z() - z) * (a.y() - y)) / area;
+                    const double w2 = 1 - w0 - w1;
+
+                    if (w0 < 0 || w1 < 0 || w2 < 0)
+                        continue;
+
+                    const float x = static_cast<float>(w0 * a.x() + w1 * b.x() + w2 * c.x());
+
+                    intervals[static_cast<size_t>(j) * gridSize + i].push_back(x);
+                }
+            }
+        }
+
+        //Sort the hits: consecutive pairs are the intervals inside the mesh
+        for (int j = bandFirstRow; j <= bandLastRow; j++) {
+            for (unsigned int i = 0; i < gridSize; i++) {
+                std::vector<float>& hits = intervals[static_cast<size_t>(j) * gridSize + i];
+                std::sort(hits.begin(), hits.end());
+
+                //Odd number of hits for numerical issues
+                if (hits.size() % 2 == 1) {
+                    hits.pop_back();
+                }
+            }
+        }
+    }
+}
+
+/**
+ * @brief Subtract two sorted lists of disjoint runs
+ * @param[in] runs Runs (pairs of coordinates)
+ * @param[in] removed Runs to be subtracted (pairs of coordinates)
+ * @param[out] result Resulting runs
+ */
+void subtractRuns(
+        const std::vector<float>& runs,
+        const std::vector<float>& removed,
+        std::vector<float>& result)
+{
+    result.clear();
+
+    size_t k = 0;
+    for (size_t r = 0; r < runs.size(); r += 2) {
+        float start = runs[r];
+        const float end = runs[r+1];
+
+        //Skip the removed runs before the current one
+        while (k < removed.size() && removed[k+1] <= start) {
+            k += 2;
+        }
+
+        size_t l = k;
+        while (l < removed.size() && removed[l] < end) {
+            if (removed[l] > start) {
+                result.push_back(start);
+                result.push_back(removed[l]);
+            }
+            start = std::max(start, removed[l+1]);
+            l += 2;
+        }
+
+        if (start < end) {
+            result.push_back(start);
+            result.push_back(end);
+        }
+    }
+}
+
+/**
+ * @brief Total length of a list of runs
+ * @param[in] runs Runs (pairs of coordinates)
+ * @returns Total length
+ */
+double runsLength(
+        const std::vector<float>& runs)
+{
+    double length = 0;
+    for (size_t r = 0; r < runs.size(); r += 2) {
+        length += runs[r+1] - runs[r];
+    }
+    return length;
+}
+
+}
+
+}
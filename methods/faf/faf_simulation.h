@@ -0,0 +1,35 @@
+#ifndef FAF_SIMULATION_H
+#define FAF_SIMULATION_H
+
+#include <vector>
+
+#include "faf_data.h"
+
+namespace FourAxisFabrication {
+
+/* Report of the material removal simulation */
+
+struct SimulationReport {
+    double resolution;
+    unsigned int nDexels;
+    double stockVolume;
+    double targetVolume;
+    double finalVolume;
+    double leftoverVolume;
+    double gougedVolume;
+    std::vector<double> removedVolumes;
+};
+
+/* Material removal simulation */
+
+void simulateFabrication(
+        const Data& data,
+        const double stockLength,
+        const double stockDiameter,
+        const double resolution,
+        const bool resultsRotated,
+        SimulationReport& report);
+
+}
+
+#endif // FAF_SIMULATION_H
@@ -3,9 +3,12 @@
  * @author Alessandro Muntoni
  */
 #include "faf_various.h"
+#include "faf_planeclip.h"
 
 #include <cg3/libigl/booleans.h>
 
+#include <cg3/geometry/transformations3.h>
+
 #include <cg3/meshes/eigenmesh/algorithms/eigenmesh_algorithms.h>
 
 #define CYLINDER_SUBD 100
@@ -25,6 +28,14 @@ void resetDataAfterCutting(
         const cg3::Array2D<int>& meshVisibility,
         cg3::Array2D<int>& resultVisibility,
         const int secondMeshLabel);
+
+void resetDataAfterCutting(
+        const std::vector<int>& birthFaces,
+        const std::vector<int>& meshAssociation,
+        std::vector<int>& resultAssociation,
+        const cg3::Array2D<int>& meshVisibility,
+        cg3::Array2D<int>& resultVisibility,
+        const int secondMeshLabel);
 }
 
 
@@ -158,6 +169,39 @@ void centerAndScale(
     centerAndScale(mesh, scaleModel, modelLength);
 }
 
+/**
+ * @brief Get the rotation matrix which brings a fabrication direction on the z-axis,
+ * the same used to project the results in the extraction. Before the association
+ * (no target directions yet) the min and max extremes are the last two directions.
+ * @param[in] data Four axis fabrication data
+ * @param[in] label Label of the direction
+ * @param[out] rotationMatrix Rotation matrix
+ */
+void getDirectionRotationMatrix(
+        const Data& data,
+        const unsigned int label,
+        Eigen::Matrix3d& rotationMatrix)
+{
+    const std::vector<unsigned int>& targetDirections = data.targetDirections;
+    const unsigned int nAngles = data.angles.size();
+
+    const unsigned int minLabel = targetDirections.size() >= 2 ? targetDirections[targetDirections.size()-2] : nAngles;
+    const unsigned int maxLabel = targetDirections.size() >= 2 ? targetDirections[targetDirections.size()-1] : nAngles + 1;
+
+    const cg3::Vec3d xAxis(1,0,0);
+    const cg3::Vec3d yAxis(0,1,0);
+
+    if (label == minLabel) {
+        cg3::rotationMatrix(yAxis, M_PI/2, rotationMatrix);
+    }
+    else if (label == maxLabel) {
+        cg3::rotationMatrix(yAxis, -M_PI/2, rotationMatrix);
+    }
+    else {
+        cg3::rotationMatrix(xAxis, -data.angles[label], rotationMatrix);
+    }
+}
+
 void generateStock(
         Data& data,
         const double stockLength,
@@ -245,42 +289,64 @@ void cutComponents(
 
 
 
-        //Get CSGTrees
-        CSGTree csgMesh = cg3::libigl::eigenMeshToCSGTree(restoredMesh);
-        CSGTree csgMaxBB = cg3::libigl::eigenMeshToCSGTree(cg3::EigenMeshAlgorithms::makeBox(maxBB));
-        CSGTree csgMinBB = cg3::libigl::eigenMeshToCSGTree(cg3::EigenMeshAlgorithms::makeBox(minBB));
+        //Cut four axis resulting mesh
+        std::vector<int> currentAssociation = restoredMeshAssociation;
+        cg3::Array2D<int> currentVisibility = restoredMeshVisibility;
 
+        //The boxes differ from the mesh bounds only in x: try to cut by clipping with planes
+        cg3::EigenMesh minCutMesh;
+        std::vector<int> minCutBirthFaces;
+        std::vector<int> fourAxisBirthFaces;
+        bool isClipped =
+                clipWithPlane(restoredMesh, cg3::Vec3d(1,0,0), minLevelSetX, minComponent) &&
+                clipWithPlane(restoredMesh, cg3::Vec3d(-1,0,0), -maxLevelSetX, maxComponent) &&
+                clipWithPlane(restoredMesh, cg3::Vec3d(-1,0,0), -minLevelSetX, minCutMesh, minCutBirthFaces) &&
+                clipWithPlane(minCutMesh, cg3::Vec3d(1,0,0), maxLevelSetX, fourAxisComponent, fourAxisBirthFaces);
+
+        if (isClipped) {
+            //Min cut
+            internal::resetDataAfterCutting(minCutBirthFaces, currentAssociation, fourAxisAssociation, currentVisibility, fourAxisVisibility, minLabel);
+
+            //Max cut
+            currentAssociation = fourAxisAssociation;
+            currentVisibility = fourAxisVisibility;
+            internal::resetDataAfterCutting(fourAxisBirthFaces, currentAssociation, fourAxisAssociation, currentVisibility, fourAxisVisibility, maxLabel);
+        }
+        else {
+            //Get CSGTrees
+            CSGTree csgMesh = cg3::libigl::eigenMeshToCSGTree(restoredMesh);
+            CSGTree csgMaxBB = cg3::libigl::eigenMeshToCSGTree(cg3::EigenMeshAlgorithms::makeBox(maxBB));
+            CSGTree csgMinBB = cg3::libigl::eigenMeshToCSGTree(cg3::EigenMeshAlgorithms::makeBox(minBB));
 
-        //Cut min extreme
-        CSGTree csgMinResult = cg3::libigl::intersection(csgMesh, csgMinBB);
 
-        //Cut max extreme
-        CSGTree csgMaxResult = cg3::libigl::intersection(csgMesh, csgMaxBB);
+            //Cut min extreme
+            CSGTree csgMinResult = cg3::libigl::intersection(csgMesh, csgMinBB);
 
+            //Cut max extreme
+            CSGTree csgMaxResult = cg3::libigl::intersection(csgMesh, csgMaxBB);
 
-        //Cut four axis resulting mesh
-        CSGTree csgFourAxisResult;
-        std::vector<int> currentAssociation = restoredMeshAssociation;
-        cg3::Array2D<int> currentVisibility = restoredMeshVisibility;
 
-        //Min difference
-        csgFourAxisResult = cg3::libigl::difference(csgMesh, csgMinBB);
-        internal::resetDataAfterCutting(csgMesh, csgFourAxisResult, currentAssociation, fourAxisAssociation, currentVisibility, fourAxisVisibility, minLabel);
+            //Cut four axis resulting mesh
+            CSGTree csgFourAxisResult;
 
-        //Max difference
-        csgMesh = cg3::libigl::eigenMeshToCSGTree(cg3::libigl::CSGTreeToEigenMesh(csgFourAxisResult));
-        currentAssociation = fourAxisAssociation;
-        currentVisibility = fourAxisVisibility;
+            //Min difference
+            csgFourAxisResult = cg3::libigl::difference(csgMesh, csgMinBB);
+            internal::resetDataAfterCutting(csgMesh, csgFourAxisResult, currentAssociation, fourAxisAssociation, currentVisibility, fourAxisVisibility, minLabel);
 
-        csgFourAxisResult = cg3::libigl::difference(csgMesh, csgMaxBB);
-        internal::resetDataAfterCutting(csgMesh, csgFourAxisResult, currentAssociation, fourAxisAssociation, currentVisibility, fourAxisVisibility, maxLabel);
+            //Max difference
+            csgMesh = cg3::libigl::eigenMeshToCSGTree(cg3::libigl::CSGTreeToEigenMesh(csgFourAxisResult));
+            currentAssociation = fourAxisAssociation;
+            currentVisibility = fourAxisVisibility;
 
+            csgFourAxisResult = cg3::libigl::difference(csgMesh, csgMaxBB);
+            internal::resetDataAfterCutting(csgMesh, csgFourAxisResult, currentAssociation, fourAxisAssociation, currentVisibility, fourAxisVisibility, maxLabel);
 
 
-        //Get meshes
-        minComponent = cg3::libigl::CSGTreeToEigenMesh(csgMinResult);
-        maxComponent = cg3::libigl::CSGTreeToEigenMesh(csgMaxResult);
-        fourAxisComponent = cg3::libigl::CSGTreeToEigenMesh(csgFourAxisResult);
+            //Get meshes
+            minComponent = cg3::libigl::CSGTreeToEigenMesh(csgMinResult);
+            maxComponent = cg3::libigl::CSGTreeToEigenMesh(csgMaxResult);
+            fourAxisComponent = cg3::libigl::CSGTreeToEigenMesh(csgFourAxisResult);
+        }
 
 
         //Update mesh data
@@ -339,11 +405,41 @@ void resetDataAfterCutting(
 {
     typedef cg3::libigl::CSGTree CSGTree;
 
-    CSGTree::VectorJ birthFaces = csgResult.J();
+    const CSGTree::VectorJ& resultBirthFaces = csgResult.J();
 
     unsigned int nResultFaces = csgResult.F().rows();
     unsigned int nFirstMeshFaces = csgMesh.F().rows();
 
+    //Faces coming from the second mesh have no birth face
+    std::vector<int> birthFaces(nResultFaces);
+    for (unsigned int i = 0; i < nResultFaces; i++) {
+        unsigned int birthFace = resultBirthFaces[i];
+        birthFaces[i] = birthFace < nFirstMeshFaces ? static_cast<int>(birthFace) : -1;
+    }
+
+    resetDataAfterCutting(birthFaces, meshAssociation, resultAssociation, meshVisibility, resultVisibility, secondMeshLabel);
+}
+
+/**
+ * @brief Reassociate association data of the first mesh after cutting the extremes
+ * @param[in] birthFaces For each face of the result, the face of the initial mesh
+ * it comes from (-1 if it does not come from the initial mesh)
+ * @param[in] meshAssociation Association of the initial mesh
+ * @param[out] resultAssociation Resulting association
+ * @param[in] meshVisibility Visibility of the initial mesh
+ * @param[out] resultVisibility Resulting visibility
+ * @param[in] secondMeshLabel Label to be assigned if the face does not come from the initial mesh
+ */
+void resetDataAfterCutting(
+        const std::vector<int>& birthFaces,
+        const std::vector<int>& meshAssociation,
+        std::vector<int>& resultAssociation,
+        const cg3::Array2D<int>& meshVisibility,
+        cg3::Array2D<int>& resultVisibility,
+        const int secondMeshLabel)
+{
+    unsigned int nResultFaces = birthFaces.size();
+
     resultAssociation.clear();
     resultAssociation.resize(nResultFaces);
 
@@ -352,10 +448,10 @@ void resetDataAfterCutting(
     resultVisibility.fill(0);
 
     for (unsigned int i = 0; i < nResultFaces; i++) {
-        unsigned int birthFace = birthFaces[i];
+        int birthFace = birthFaces[i];
 
         //If the birth face is in the first mesh
-        if (birthFace < nFirstMeshFaces) {
+        if (birthFace >= 0) {
             resultAssociation[i] = meshAssociation[birthFace];
             for (unsigned int l = 0; l < meshVisibility.sizeX(); l++) {
                 resultVisibility(l, i) = meshVisibility(l, birthFace);
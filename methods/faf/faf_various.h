@@ -53,6 +53,11 @@ void centerAndScale(
         const bool scaleModel,
         const double modelLength);
 
+void getDirectionRotationMatrix(
+        const Data& data,
+        const unsigned int label,
+        Eigen::Matrix3d& rotationMatrix);
+
 /* Stock */
 
 void generateStock(
@@ -3,6 +3,16 @@
  * @author Alessandro Muntoni
  */
 #include "faf_visibilitycheck.h"
+#include "includes/faf_kernels.h"
+
+#include "faf_metrics.h"
+#include "faf_meshview.h"
+#include "faf_arena.h"
+
+#include <algorithm>
+#include <limits>
+#include <map>
+#include <cmath>
 
 #include <cg3/geometry/transformations3.h>
 #include <cg3/geometry/point2.h>
@@ -18,7 +28,8 @@
 #include "includes/view_renderer.h"
 #endif
 
-
+#define OCCLUDEDMARGIN -128
+#define MARGINSCALE 127.0
 
 namespace FourAxisFabrication {
 
@@ -27,6 +38,14 @@ namespace FourAxisFabrication {
 
 namespace internal {
 
+/* Projected triangles of the faces, allocated on the arena of the check */
+
+typedef ArenaMap<cg3::Triangle2d, unsigned int, bool(*)(const cg3::Triangle2d&, const cg3::Triangle2d&)> TriangleFaceMap;
+
+/* Last overlapping pair found by the recording overlap check of each thread */
+
+thread_local std::pair<cg3::Triangle2d, cg3::Triangle2d> lastOverlap;
+
 #ifndef FAF_NO_GL_VISIBILITY
 /* Methods for computing visibility (GL) */
 
@@ -51,21 +70,6 @@ void computeVisibilityGL(
         cg3::Array2D<int>& visibility);
 #endif
 
-/* Methods for computing visibility (Projection and RAY) */
-
-void computeVisibilityProjectionRay(
-        const cg3::EigenMesh& mesh,
-        const unsigned int nDirections,
-        const double heightfieldAngle,
-        const bool includeXDirections,
-        const std::vector<unsigned int>& minExtremes,
-        const std::vector<unsigned int>& maxExtremes,
-        std::vector<cg3::Vec3d>& directions,
-        std::vector<double>& directionsAngle,
-        cg3::Array2D<int>& visibility,
-        const CheckMode checkMode);
-
-
 /* Check visibility (ray shooting) */
 
 void getVisibilityRayShootingOnZ(
@@ -74,7 +78,9 @@ void getVisibilityRayShootingOnZ(
         const unsigned int directionIndex,
         const int oppositeDirectionIndex,
         cg3::Array2D<int>& visibility,
-        const double heightfieldAngle);
+        const double heightfieldAngle,
+        OccluderList* directionOccluders,
+        OccluderList* oppositeOccluders);
 
 void getVisibilityRayShootingOnZ(
         const cg3::EigenMesh& mesh,
@@ -90,39 +96,36 @@ void getVisibilityRayShootingOnZ(
 /* Check visibility (projection) */
 
 void getVisibilityProjectionOnZ(
-        const cg3::EigenMesh& mesh,
+        const TransformedMeshView& mesh,
         const std::vector<unsigned int>& faces,
         const unsigned int directionIndex,
         const int oppositeDirectionIndex,
         cg3::Array2D<int>& visibility,
-        const double heightfieldAngle);
+        const double heightfieldAngle,
+        OccluderList* directionOccluders,
+        OccluderList* oppositeOccluders);
 
 void getVisibilityProjectionOnZ(
-        const cg3::EigenMesh& mesh,
+        const TransformedMeshView& mesh,
         const unsigned int faceId,
         const unsigned int directionIndex,
         const cg3::Vec3d& direction,
         cg3::AABBTree<2, cg3::Triangle2d>& aabbTree,
         cg3::Array2D<int>& visibility,
-        const double heightfieldAngle);
+        const double heightfieldAngle,
+        TriangleFaceMap* triangleFaces,
+        OccluderList* occluders);
 
 
-/* Comparators */
+/* Occluders */
 
-struct TriangleZComparator {
-    const cg3::SimpleEigenMesh& m;
-    TriangleZComparator(const cg3::SimpleEigenMesh& m);
-    bool operator()(unsigned int f1, unsigned int f2);
-};
-bool triangle2DComparator(const cg3::Triangle2d& t1, const cg3::Triangle2d& t2);
+bool recordingTriangleOverlap(const cg3::Triangle2d& t1, const cg3::Triangle2d& t2);
 
+void removeVisibleOccluded(
+        const cg3::Array2D<int>& visibility,
+        const unsigned int directionIndex,
+        OccluderList& occluders);
 
-/* AABB extractor functions */
-
-double triangle2DAABBExtractor(
-        const cg3::Triangle2d& triangle,
-        const cg3::AABBValueType& valueType,
-        const int& dim);
 
 /* Detection of non-visible faces */
 void detectNonVisibleFaces(
@@ -130,6 +133,11 @@ void detectNonVisibleFaces(
         std::vector<unsigned int>& nonVisibleFaces);
 
 
+/* Visibility margins */
+
+signed char quantizeMargin(const double dot);
+
+
 } //namespace internal
 
 
@@ -149,6 +157,8 @@ void detectNonVisibleFaces(
  * @param[in] includeXDirections Compute visibility for +x and -x directions
  * @param[out] data Four axis fabrication data
  * @param[in] checkMode Check mode for visibility
+ * @param[in] recordOccluders Record, for each direction, the first face found
+ * occluding each non-visible face (not available in OpenGL check mode)
  */
 void getVisibility(
         const cg3::EigenMesh& mesh,
@@ -157,8 +167,12 @@ void getVisibility(
         const double heightfieldAngle,
         const bool includeXDirections,
         Data& data,
-        const CheckMode checkMode)
+        const CheckMode checkMode,
+        const bool recordOccluders)
 {
+    data.occluders.clear();
+    data.visibilityMargins.clear();
+
     if (checkMode == OPENGL) {
 #ifndef FAF_NO_GL_VISIBILITY
         internal::computeVisibilityGL(mesh, nDirections, resolution, heightfieldAngle, includeXDirections, data.minExtremes, data.maxExtremes, data.directions, data.angles, data.visibility);
@@ -168,11 +182,446 @@ void getVisibility(
 #endif
     }
     else {
-        internal::computeVisibilityProjectionRay(mesh, nDirections, heightfieldAngle, includeXDirections, data.minExtremes, data.maxExtremes, data.directions, data.angles, data.visibility, checkMode);
+        VisibilityProvider provider(mesh, nDirections, heightfieldAngle, includeXDirections, data.minExtremes, data.maxExtremes, checkMode);
+        provider.fill(data.visibility, recordOccluders ? &data.occluders : nullptr);
+        data.directions = provider.directions();
+        data.angles = provider.angles();
     }
     internal::detectNonVisibleFaces(data.visibility, data.nonVisibleFaces);
 }
 
+/**
+ * @brief Find the first occluder found for a non-visible face from a direction
+ * @param[in] occluders Occluders of each direction
+ * @param[in] directionIndex Index of the direction
+ * @param[in] faceId Id of the face
+ * @returns Id of the occluder, -1 if it has not been recorded
+ */
+int findOccluder(
+        const std::vector<OccluderList>& occluders,
+        const unsigned int directionIndex,
+        const unsigned int faceId)
+{
+    if (directionIndex >= occluders.size())
+        return -1;
+
+    const OccluderList& directionOccluders = occluders[directionIndex];
+
+    OccluderList::const_iterator it = std::lower_bound(
+                directionOccluders.begin(),
+                directionOccluders.end(),
+                std::make_pair(faceId, 0u));
+
+    if (it == directionOccluders.end() || it->first != faceId)
+        return -1;
+
+    return static_cast<int>(it->second);
+}
+
+
+
+/* ----- VISIBILITY MARGINS ----- */
+
+/**
+ * @brief Compute the visibility margins: for each direction, the dot product
+ * between the normal of the visible faces and the direction, quantized in a byte.
+ * The visibility for a stricter heightfield angle can be derived from the margins
+ * without checking the occlusions again: the faces beyond the new limit are
+ * discarded, while the occluders are still the ones found by the check.
+ * The margins are cleared when the visibility is checked again.
+ * @param[in] mesh Input mesh. Normals must be updated before.
+ * @param[out] data Four axis fabrication data
+ */
+void computeVisibilityMargins(
+        const cg3::EigenMesh& mesh,
+        Data& data)
+{
+    const std::vector<cg3::Vec3d>& directions = data.directions;
+    const cg3::Array2D<int>& visibility = data.visibility;
+    cg3::Array2D<signed char>& visibilityMargins = data.visibilityMargins;
+
+    const unsigned int nFaces = mesh.numberFaces();
+    const unsigned int nDirections = directions.size();
+
+    visibilityMargins.clear();
+    visibilityMargins.resize(nDirections, nFaces);
+
+    #pragma omp parallel for
+    for (int dirIndex = 0; dirIndex < static_cast<int>(nDirections); dirIndex++) {
+        const cg3::Vec3d& direction = directions[dirIndex];
+
+        for (unsigned int fId = 0; fId < nFaces; fId++) {
+            if (visibility(dirIndex, fId) == 1) {
+                visibilityMargins(dirIndex, fId) = internal::quantizeMargin(direction.dot(mesh.faceNormal(fId)));
+            }
+            else {
+                visibilityMargins(dirIndex, fId) = OCCLUDEDMARGIN;
+            }
+        }
+    }
+}
+
+/**
+ * @brief Check if the visibility margins have been computed for the current
+ * mesh and visibility: they must have the size of the visibility, the faces
+ * visible from a direction must not have an occluded margin, and the other
+ * margins must be the quantized dot product of the face normal and the direction.
+ * The visibility can have less visible faces than the margins, if it has
+ * been derived for a stricter heightfield angle.
+ * @param[in] mesh Input mesh. Normals must be updated before.
+ * @param[in] data Four axis fabrication data
+ * @returns True if the margins match the mesh and the visibility
+ */
+bool areVisibilityMarginsValid(
+        const cg3::EigenMesh& mesh,
+        const Data& data)
+{
+    const std::vector<cg3::Vec3d>& directions = data.directions;
+    const cg3::Array2D<int>& visibility = data.visibility;
+    const cg3::Array2D<signed char>& visibilityMargins = data.visibilityMargins;
+
+    if (visibilityMargins.sizeX() != visibility.sizeX() || visibilityMargins.sizeY() != visibility.sizeY() ||
+            visibility.sizeX() != directions.size() || visibility.sizeY() != mesh.numberFaces())
+        return false;
+
+    for (unsigned int dirIndex = 0; dirIndex < visibility.sizeX(); dirIndex++) {
+        const cg3::Vec3d& direction = directions[dirIndex];
+
+        for (unsigned int fId = 0; fId < visibility.sizeY(); fId++) {
+            const signed char margin = visibilityMargins(dirIndex, fId);
+
+            if (isOccludedMargin(margin)) {
+                if (visibility(dirIndex, fId) == 1)
+                    return false;
+            }
+            else if (margin != internal::quantizeMargin(direction.dot(mesh.faceNormal(fId)))) {
+                return false;
+            }
+        }
+    }
+
+    return true;
+}
+
+/**
+ * @brief Derive the visibility for a heightfield angle from the visibility margins,
+ * and update the non-visible faces. The angle must not be greater than the one used
+ * for checking the visibility. The limit is compared with the quantized margins, so
+ * the faces within half a quantization step from the limit are considered visible.
+ * The margins are kept, so the visibility can be derived again for another angle.
+ * @param[in] mesh Input mesh, the one of the margins
+ * @param[in] heightfieldAngle Limit angle with triangles normal in order to be a heightfield
+ * @param[out] data Four axis fabrication data
+ * @returns False if the margins do not match the mesh and the visibility (the data is not changed)
+ */
+bool getVisibilityFromMargins(
+        const cg3::EigenMesh& mesh,
+        const double heightfieldAngle,
+        Data& data)
+{
+    if (!areVisibilityMarginsValid(mesh, data))
+        return false;
+
+    const cg3::Array2D<signed char>& visibilityMargins = data.visibilityMargins;
+    cg3::Array2D<int>& visibility = data.visibility;
+
+    const signed char limitMargin = internal::quantizeMargin(cos(heightfieldAngle));
+
+    const unsigned int nDirections = visibilityMargins.sizeX();
+    const unsigned int nFaces = visibilityMargins.sizeY();
+
+    #pragma omp parallel for
+    for (int dirIndex = 0; dirIndex < static_cast<int>(nDirections); dirIndex++) {
+        for (unsigned int fId = 0; fId < nFaces; fId++) {
+            visibility(dirIndex, fId) = visibilityMargins(dirIndex, fId) >= limitMargin ? 1 : 0;
+        }
+    }
+
+    internal::detectNonVisibleFaces(visibility, data.nonVisibleFaces);
+
+    return true;
+}
+
+/**
+ * @brief Check if a visibility margin is the one of a non-visible face
+ * @param[in] margin Visibility margin
+ * @returns True if the face is not visible
+ */
+bool isOccludedMargin(const signed char margin)
+{
+    return margin == OCCLUDEDMARGIN;
+}
+
+
+
+/* ----- VISIBILITY PROVIDER ----- */
+
+/**
+ * @brief Visibility provider: the rows of the visibility are computed in parallel
+ * batches (projection and ray shooting check modes). Opposite directions
+ * are computed together, as well as the min and max extremes.
+ * The mesh is not copied: it must outlive the provider.
+ * @param[in] mesh Input mesh
+ * @param[in] nDirections Number of directions to be checked
+ * @param[in] heightfieldAngle Limit angle with triangles normal in order to be a heightfield
+ * @param[in] includeXDirections Compute visibility for +x and -x directions
+ * @param[in] minExtremes Min extremes
+ * @param[in] maxExtremes Max extremes
+ * @param[in] checkMode Check mode for visibility
+ */
+VisibilityProvider::VisibilityProvider(
+        const cg3::EigenMesh& mesh,
+        const unsigned int nDirections,
+        const double heightfieldAngle,
+        const bool includeXDirections,
+        const std::vector<unsigned int>& minExtremes,
+        const std::vector<unsigned int>& maxExtremes,
+        const CheckMode checkMode) :
+    mesh(mesh),
+    heightfieldAngle(heightfieldAngle),
+    includeXDirections(includeXDirections),
+    minExtremes(minExtremes),
+    maxExtremes(maxExtremes),
+    checkMode(checkMode),
+    halfNDirections(nDirections/2),
+    stepAngle(M_PI / (nDirections/2))
+{
+    if (checkMode == OPENGL) {
+        throw std::runtime_error("OpenGL visibility cannot be computed by the provider. Use another check mode.");
+    }
+
+    //Initialize directions and angles
+    directionVectors.resize(halfNDirections*2 + 2);
+    directionAngles.resize(halfNDirections*2);
+
+    const cg3::Vec3d xAxis(1,0,0);
+
+    Eigen::Matrix3d rotationMatrix;
+    cg3::rotationMatrix(xAxis, stepAngle, rotationMatrix);
+
+    //Vector that is opposite to the milling direction
+    cg3::Vec3d dir(0,0,1);
+
+    double sum = 0;
+    for (unsigned int i = 0; i < halfNDirections*2; i++) {
+        directionAngles[i] = sum;
+        sum += stepAngle;
+    }
+    for (unsigned int dirIndex = 0; dirIndex < halfNDirections; dirIndex++) {
+        directionVectors[dirIndex] = dir;
+        directionVectors[halfNDirections + dirIndex] = -dir;
+
+        dir.rotate(rotationMatrix);
+    }
+
+    //Add min and max extremes directions
+    directionVectors[halfNDirections*2] = cg3::Vec3d(-1,0,0);
+    directionVectors[halfNDirections*2 + 1] = cg3::Vec3d(1,0,0);
+}
+
+/**
+ * @brief Get the number of directions (min and max extremes included)
+ * @returns Number of directions
+ */
+unsigned int VisibilityProvider::numberDirections() const
+{
+    return static_cast<unsigned int>(directionVectors.size());
+}
+
+/**
+ * @brief Get the number of faces of the mesh
+ * @returns Number of faces
+ */
+unsigned int VisibilityProvider::numberFaces() const
+{
+    return mesh.numberFaces();
+}
+
+/**
+ * @brief Get the directions
+ * @returns Directions
+ */
+const std::vector<cg3::Vec3d>& VisibilityProvider::directions() const
+{
+    return directionVectors;
+}
+
+/**
+ * @brief Get the angles of the directions (respect to z-axis)
+ * @returns Angles
+ */
+const std::vector<double>& VisibilityProvider::angles() const
+{
+    return directionAngles;
+}
+
+/**
+ * @brief Fill a visibility array with all the directions
+ * @param[out] visibility Output visibility
+ * @param[out] occluders Occluders of each direction, recorded if not null
+ * (the first occluder found for the non-visible faces)
+ */
+void VisibilityProvider::fill(
+        cg3::Array2D<int>& visibility,
+        std::vector<OccluderList>* occluders) const
+{
+    std::vector<unsigned int> directionIndices(numberDirections());
+    for (unsigned int i = 0; i < directionIndices.size(); i++) {
+        directionIndices[i] = i;
+    }
+
+    fill(directionIndices, visibility, occluders);
+}
+
+/**
+ * @brief Fill a visibility array with the given directions. The rows
+ * of the other directions are set to zero. The slots of the directions
+ * are computed in parallel.
+ * @param[in] directionIndices Indices of the directions
+ * @param[out] visibility Output visibility
+ * @param[out] occluders Occluders of each direction, recorded if not null
+ * (the first occluder found for the non-visible faces)
+ */
+void VisibilityProvider::fill(
+        const std::vector<unsigned int>& directionIndices,
+        cg3::Array2D<int>& visibility,
+        std::vector<OccluderList>* occluders) const
+{
+    const unsigned int nFaces = numberFaces();
+
+    visibility.clear();
+    visibility.resize(numberDirections(), nFaces);
+    visibility.fill(0);
+
+    if (occluders != nullptr) {
+        occluders->clear();
+        occluders->resize(numberDirections());
+    }
+
+    //Directions to be filled, grouped by slot
+    std::vector<std::vector<unsigned int>> slotDirections(halfNDirections + 1);
+    for (unsigned int directionIndex : directionIndices) {
+        std::vector<unsigned int>& currentDirections = slotDirections[slotIndex(directionIndex)];
+        if (std::find(currentDirections.begin(), currentDirections.end(), directionIndex) == currentDirections.end())
+            currentDirections.push_back(directionIndex);
+    }
+
+    #pragma omp parallel for schedule(dynamic)
+    for (int slotId = 0; slotId < static_cast<int>(slotDirections.size()); slotId++) {
+        if (slotDirections[slotId].empty())
+            continue;
+
+        cg3::Array2D<int> slotVisibility;
+        OccluderList slotOccluders[2];
+        computeSlot(
+                    static_cast<unsigned int>(slotId),
+                    slotVisibility,
+                    occluders != nullptr ? &slotOccluders[0] : nullptr,
+                    occluders != nullptr ? &slotOccluders[1] : nullptr);
+
+        for (unsigned int directionIndex : slotDirections[slotId]) {
+            const unsigned int rId = rowIndex(directionIndex);
+
+            for (unsigned int fId = 0; fId < nFaces; fId++) {
+                visibility(directionIndex, fId) = slotVisibility(rId, fId);
+            }
+            if (occluders != nullptr) {
+                (*occluders)[directionIndex] = slotOccluders[rId];
+            }
+        }
+    }
+}
+
+/**
+ * @brief Get the slot of a direction
+ * @param[in] directionIndex Index of the direction
+ * @returns Index of the slot
+ */
+unsigned int VisibilityProvider::slotIndex(const unsigned int directionIndex) const
+{
+    if (directionIndex >= halfNDirections*2)
+        return halfNDirections;
+
+    return directionIndex % halfNDirections;
+}
+
+/**
+ * @brief Get the row of a direction in its slot
+ * @param[in] directionIndex Index of the direction
+ * @returns 0 for the first row, 1 for the second (opposite or max extremes)
+ */
+unsigned int VisibilityProvider::rowIndex(const unsigned int directionIndex) const
+{
+    if (directionIndex >= halfNDirections*2)
+        return directionIndex - halfNDirections*2;
+
+    return directionIndex / halfNDirections;
+}
+
+/**
+ * @brief Compute the visibility of a slot: a pair of opposite directions,
+ * or the min and max extremes
+ * @param[in] slotId Index of the slot
+ * @param[out] slotVisibility Visibility from the direction (or the min extremes) in the
+ * first row, from the opposite direction (or the max extremes) in the second row
+ * @param[out] firstOccluders Occluders from the direction, recorded if not null
+ * @param[out] secondOccluders Occluders from the opposite direction, recorded if not null
+ */
+void VisibilityProvider::computeSlot(
+        const unsigned int slotId,
+        cg3::Array2D<int>& slotVisibility,
+        OccluderList* firstOccluders,
+        OccluderList* secondOccluders) const
+{
+    MetricsZone zone("Visibility slot");
+
+    const unsigned int nFaces = mesh.numberFaces();
+
+    slotVisibility.clear();
+    slotVisibility.resize(2, nFaces);
+    slotVisibility.fill(0);
+
+    if (slotId < halfNDirections || includeXDirections) {
+        //Set target faces to be checked
+        std::vector<unsigned int> targetFaces(nFaces);
+        for (unsigned int i = 0; i < nFaces; i++) {
+            targetFaces[i] = i;
+        }
+
+        //View of the mesh rotated to check the visibility on z
+        Eigen::Matrix3d rotationMatrix;
+        if (slotId < halfNDirections) {
+            cg3::rotationMatrix(cg3::Vec3d(1,0,0), -stepAngle * slotId, rotationMatrix);
+        }
+        else {
+            cg3::rotationMatrix(cg3::Vec3d(0,1,0), M_PI/2, rotationMatrix);
+        }
+        const TransformedMeshView rotatedMesh(mesh, rotationMatrix);
+
+        if (checkMode == RAYSHOOTING) {
+            //Check visibility ray shooting
+            //The AABB tree needs the rotated mesh
+            internal::getVisibilityRayShootingOnZ(rotatedMesh.materialize(), targetFaces, 0, 1, slotVisibility, heightfieldAngle, firstOccluders, secondOccluders);
+        }
+        else {
+            //Check visibility with projection
+            internal::getVisibilityProjectionOnZ(rotatedMesh, targetFaces, 0, 1, slotVisibility, heightfieldAngle, firstOccluders, secondOccluders);
+        }
+    }
+    else {
+        //Set visibility of the min extremes
+        for (size_t i = 0; i < minExtremes.size(); i++){
+            slotVisibility(0, minExtremes[i]) = 1;
+        }
+
+        //Set visibility of the max extremes
+        for (size_t i = 0; i < maxExtremes.size(); i++){
+            slotVisibility(1, maxExtremes[i]) = 1;
+        }
+    }
+}
+
+
 
 
 
@@ -364,144 +813,6 @@ void detectNonVisibleFaces(
 
 
 
-/* ----- CHECK VISIBILITY (PROJECTION AND RAY) ----- */
-
-
-/**
- * @brief Get visibility of each face of the mesh from a given number of
- * different directions.
- * It is implemented by a ray casting algorithm or checking the intersections
- * in a 2D projection from a given direction.
- * @param[in] mesh Input mesh
- * @param[in] numberDirections Number of directions to be checked
- * @param[out] directions Vector of directions
- * @param[out] angles Vector of angle (respect to z-axis)
- * @param[out] visibility Output visibility
- * @param[in] heightfieldAngle Limit angle with triangles normal in order to be a heightfield
- * @param[in] checkMode Visibility check mode. Default is projection mode.
- */
-void computeVisibilityProjectionRay(
-        const cg3::EigenMesh& mesh,
-        const unsigned int nDirections,
-        const double heightfieldAngle,
-        const bool includeXDirections,
-        const std::vector<unsigned int>& minExtremes,
-        const std::vector<unsigned int>& maxExtremes,
-        std::vector<cg3::Vec3d>& directions,
-        std::vector<double>& angles,
-        cg3::Array2D<int>& visibility,
-        const CheckMode checkMode)
-{
-    const unsigned int halfNDirections = nDirections/2;
-
-    //Initialize visibility (number of directions, two for extremes)
-    visibility.clear();
-    visibility.resize(halfNDirections*2 + 2, mesh.numberFaces());
-    visibility.fill(0);
-
-    //Initialize direction vector
-    directions.clear();
-    directions.resize(halfNDirections*2 + 2);
-
-    //Initialize angles
-    angles.clear();
-    angles.resize(halfNDirections*2);
-
-    //Set target faces to be checked
-    std::vector<unsigned int> targetFaces;
-
-    for (unsigned int i = 0; i < mesh.numberFaces(); i++) {
-        targetFaces.push_back(i);
-    }
-
-    //Copy the mesh
-    cg3::EigenMesh rotatingMesh = mesh;
-
-    //Step angle for getting all the directions (on 180 degrees)
-    double stepAngle = M_PI / halfNDirections;
-
-    const cg3::Vec3d xAxis(1,0,0);
-    const cg3::Vec3d yAxis(0,1,0);
-
-    //Get rotation matrix
-    Eigen::Matrix3d rotationMatrix;
-    Eigen::Matrix3d inverseRotationMatrix;
-    cg3::rotationMatrix(xAxis, stepAngle, rotationMatrix);
-    cg3::rotationMatrix(xAxis, -stepAngle, inverseRotationMatrix);
-
-    //Vector that is opposite to the milling direction
-    cg3::Vec3d dir(0,0,1);
-
-    //Set angles
-    angles.resize(halfNDirections*2);
-    double sum = 0;
-    for(unsigned int i = 0; i < halfNDirections*2; i++) {
-        angles[i] = sum;
-        sum += stepAngle;
-    }
-
-    //For each direction
-    for(unsigned int dirIndex = 0; dirIndex < halfNDirections; dirIndex++){
-        if (checkMode == RAYSHOOTING) {
-            //Check visibility ray shooting
-            internal::getVisibilityRayShootingOnZ(rotatingMesh, targetFaces, dirIndex, halfNDirections + dirIndex, visibility, heightfieldAngle);
-        }
-        else {
-            //Check visibility with projection
-            internal::getVisibilityProjectionOnZ(rotatingMesh, targetFaces, dirIndex, halfNDirections + dirIndex, visibility, heightfieldAngle);
-        }
-
-        //Add the current directions
-        directions[dirIndex] = dir;
-        directions[halfNDirections + dirIndex] = -dir;
-
-        //Rotate the direction and the mesh
-        rotatingMesh.rotate(inverseRotationMatrix);
-        dir.rotate(rotationMatrix);
-    }
-
-    //Index for min, max extremes
-    unsigned int minIndex = halfNDirections*2;
-    unsigned int maxIndex = halfNDirections*2 + 1;
-
-    //Add min and max extremes directions
-    directions[minIndex] = cg3::Vec3d(-1,0,0);
-    directions[maxIndex] = cg3::Vec3d(1,0,0);
-
-    if (includeXDirections) {
-        //Compute -x and +x visibility
-        rotatingMesh = mesh;
-        cg3::rotationMatrix(yAxis, M_PI/2, rotationMatrix);
-        rotatingMesh.rotate(rotationMatrix);
-        if (checkMode == RAYSHOOTING) {
-            //Check visibility ray shooting
-            internal::getVisibilityRayShootingOnZ(rotatingMesh, targetFaces, minIndex, maxIndex, visibility, heightfieldAngle);
-        }
-        else {
-            //Check visibility with projection
-            internal::getVisibilityProjectionOnZ(rotatingMesh, targetFaces, minIndex, maxIndex, visibility, heightfieldAngle);
-        }
-    }
-    else {
-        //Set visibility of the min extremes
-        #pragma omp parallel for
-        for (size_t i = 0; i < minExtremes.size(); i++){
-            unsigned int faceId = minExtremes[i];
-            visibility(minIndex, faceId) = 1;
-        }
-
-        //Set visibility of the max extremes
-        #pragma omp parallel for
-        for (size_t i = 0; i < maxExtremes.size(); i++){
-            unsigned int faceId = maxExtremes[i];
-            visibility(maxIndex, faceId) = 1;
-        }
-    }
-}
-
-
-
-
 /* ----- CHECK VISIBILITY (PROJECTION) ----- */
 
 /**
@@ -517,21 +828,29 @@ void computeVisibilityProjectionRay(
  * @param[in] heightfieldAngle Limit angle with triangles normal in order to be a heightfield
  */
 void getVisibilityProjectionOnZ(
-        const cg3::EigenMesh& mesh,
+        const TransformedMeshView& mesh,
         const std::vector<unsigned int>& faces,
         const unsigned int directionIndex,
         const int oppositeDirectionIndex,
         cg3::Array2D<int>& visibility,
-        const double heightfieldAngle)
+        const double heightfieldAngle,
+        OccluderList* directionOccluders,
+        OccluderList* oppositeOccluders)
 {
     cg3::AABBTree<2, cg3::Triangle2d> aabbTreeMax(
                 &internal::triangle2DAABBExtractor, &internal::triangle2DComparator);
     cg3::AABBTree<2, cg3::Triangle2d> aabbTreeMin(
                 &internal::triangle2DAABBExtractor, &internal::triangle2DComparator);
 
-    //Order the face by z-coordinate of the barycenter
+    //Faces of the projected triangles in the trees, for recording the occluders
+    StageArena arena;
+    const ArenaAllocator<TriangleFaceMap::value_type> allocator(arena);
+    TriangleFaceMap triangleFacesMax(&internal::triangle2DComparator, allocator);
+    TriangleFaceMap triangleFacesMin(&internal::triangle2DComparator, allocator);
+
+    //Order the face by min z-coordinate
     std::vector<unsigned int> orderedZFaces(faces);
-    std::sort(orderedZFaces.begin(), orderedZFaces.end(), internal::TriangleZComparator(mesh));
+    mesh.sortFacesByMinCoordinate(2, orderedZFaces);
 
     //Directions to be checked
     cg3::Vec3d zDirMax(0,0,1);
@@ -542,7 +861,12 @@ void getVisibilityProjectionOnZ(
         unsigned int faceId = orderedZFaces[i];
 
         internal::getVisibilityProjectionOnZ(
-                    mesh, faceId, directionIndex, zDirMax, aabbTreeMax, visibility, heightfieldAngle);
+                    mesh, faceId, directionIndex, zDirMax, aabbTreeMax, visibility, heightfieldAngle,
+                    directionOccluders != nullptr ? &triangleFacesMax : nullptr, directionOccluders);
+    }
+
+    if (directionOccluders != nullptr) {
+        std::sort(directionOccluders->begin(), directionOccluders->end());
     }
 
     if (oppositeDirectionIndex >= 0) {
@@ -551,7 +875,12 @@ void getVisibilityProjectionOnZ(
             unsigned int faceId = orderedZFaces[i];
 
             internal::getVisibilityProjectionOnZ(
-                        mesh, faceId, oppositeDirectionIndex, zDirMin, aabbTreeMin, visibility, heightfieldAngle);
+                        mesh, faceId, oppositeDirectionIndex, zDirMin, aabbTreeMin, visibility, heightfieldAngle,
+                        oppositeOccluders != nullptr ? &triangleFacesMin : nullptr, oppositeOccluders);
+        }
+
+        if (oppositeOccluders != nullptr) {
+            std::sort(oppositeOccluders->begin(), oppositeOccluders->end());
         }
     }
 }
@@ -568,24 +897,28 @@ void getVisibilityProjectionOnZ(
  * @param[out] visibility Map the visibility from the given directions
  * to each face.
  * @param[in] heightfieldAngle Limit angle with triangles normal in order to be a heightfield
+ * @param[out] triangleFaces Faces of the triangles in the AABB tree, nullptr if occluders are not recorded
+ * @param[out] occluders Occluders of the non-visible faces, nullptr if they are not recorded
  */
 void getVisibilityProjectionOnZ(
-        const cg3::EigenMesh& mesh,
+        const TransformedMeshView& mesh,
         const unsigned int faceId,
         const unsigned int directionIndex,
         const cg3::Vec3d& direction,
         cg3::AABBTree<2, cg3::Triangle2d>& aabbTree,
         cg3::Array2D<int>& visibility,
-        const double heightfieldAngle)
+        const double heightfieldAngle,
+        TriangleFaceMap* triangleFaces,
+        OccluderList* occluders)
 {
     const double heightFieldLimit = cos(heightfieldAngle);
 
     //If it is visible (checking the angle between normal and the target direction)
     if (direction.dot(mesh.faceNormal(faceId)) >= heightFieldLimit) {
-        const cg3::Point3i& faceData = mesh.face(faceId);
-        const cg3::Point3d& v1 = mesh.vertex(faceData.x());
-        const cg3::Point3d& v2 = mesh.vertex(faceData.y());
-        const cg3::Point3d& v3 = mesh.vertex(faceData.z());
+        const cg3::Point3i faceData = mesh.face(faceId);
+        const cg3::Point3d v1 = mesh.vertex(faceData.x());
+        const cg3::Point3d v2 = mesh.vertex(faceData.y());
+        const cg3::Point3d v3 = mesh.vertex(faceData.z());
 
         //Project on the z plane
         cg3::Point2d v1Projected(v1.x(), v1.y());
@@ -597,8 +930,26 @@ void getVisibilityProjectionOnZ(
         cg3::sortTriangle2DPointsAndReorderCounterClockwise(triangle);
 
         //Check for intersections
-        bool intersectionFound =
-                aabbTree.aabbOverlapCheck(triangle, &cg3::triangleOverlap);
+        bool intersectionFound;
+        if (occluders == nullptr) {
+            intersectionFound = aabbTree.aabbOverlapCheck(triangle, &cg3::triangleOverlap);
+        }
+        else {
+            intersectionFound = aabbTree.aabbOverlapCheck(triangle, &internal::recordingTriangleOverlap);
+
+            //The occluder is the triangle of the overlapping pair which is in the tree
+            if (intersectionFound) {
+                const bool isFirstQuery =
+                        !internal::triangle2DComparator(lastOverlap.first, triangle) &&
+                        !internal::triangle2DComparator(triangle, lastOverlap.first);
+                const cg3::Triangle2d& occluderTriangle = isFirstQuery ? lastOverlap.second : lastOverlap.first;
+
+                TriangleFaceMap::const_iterator it = triangleFaces->find(occluderTriangle);
+                if (it != triangleFaces->end()) {
+                    occluders->push_back(std::make_pair(faceId, it->second));
+                }
+            }
+        }
 
         //If no intersections have been found
         if (!intersectionFound) {
@@ -606,27 +957,61 @@ void getVisibilityProjectionOnZ(
             visibility(directionIndex, faceId) = 1;
 
             aabbTree.insert(triangle);
+
+            if (triangleFaces != nullptr) {
+                triangleFaces->insert(std::make_pair(triangle, faceId));
+            }
         }
     }
 
 }
 
 
-/* ----- COMPARATORS ----- */
+/* ----- OCCLUDERS ----- */
 
 /**
- * @brief Comparator for barycenter on z values
- * @param m Input mesh
+ * @brief Overlap check of two triangles which records the last overlapping pair
+ * found by the current thread
+ * @param[in] t1 Triangle 1
+ * @param[in] t2 Triangle 2
+ * @return True if the triangles overlap
  */
-TriangleZComparator::TriangleZComparator(const cg3::SimpleEigenMesh& m) : m(m) {}
-bool TriangleZComparator::operator()(unsigned int f1, unsigned int f2){
-    const cg3::Point3i& ff1 = m.face(f1);
-    const cg3::Point3i& ff2 = m.face(f2);
-    double minZ1 = std::min(std::min(m.vertex(ff1.x()).z(), m.vertex(ff1.y()).z()),m.vertex(ff1.z()).z());
-    double minZ2 = std::min(std::min(m.vertex(ff2.x()).z(), m.vertex(ff2.y()).z()),m.vertex(ff2.z()).z());
-    return minZ1 < minZ2;
+bool recordingTriangleOverlap(const cg3::Triangle2d& t1, const cg3::Triangle2d& t2)
+{
+    if (cg3::triangleOverlap(t1, t2)) {
+        lastOverlap.first = t1;
+        lastOverlap.second = t2;
+        return true;
+    }
+    return false;
 }
 
+/**
+ * @brief Remove the occluded faces which turned out to be visible from
+ * the direction, and sort the occluders by face
+ * @param[in] visibility Visibility
+ * @param[in] directionIndex Index of the direction
+ * @param[out] occluders Occluders from the direction
+ */
+void removeVisibleOccluded(
+        const cg3::Array2D<int>& visibility,
+        const unsigned int directionIndex,
+        OccluderList& occluders)
+{
+    OccluderList::iterator last = std::remove_if(
+                occluders.begin(), occluders.end(),
+                [&] (const std::pair<unsigned int, unsigned int>& o) {
+        return visibility(directionIndex, o.first) == 1;
+    });
+
+    occluders.erase(last, occluders.end());
+
+    std::sort(occluders.begin(), occluders.end());
+}
+
+
+/* ----- COMPARATORS ----- */
+
 /**
  * @brief Comparator for triangles
  * @param t1 Triangle 1
@@ -696,6 +1081,8 @@ double triangle2DAABBExtractor(
  * @param[out] visibility Map the visibility from the given directions
  * to each face.
  * @param[in] heightfieldAngle Limit angle with triangles normal in order to be a heightfield
+ * @param[out] directionOccluders Occluders from the direction, nullptr if they are not recorded
+ * @param[out] oppositeOccluders Occluders from the opposite direction, nullptr if they are not recorded
  */
 void getVisibilityRayShootingOnZ(
         const cg3::EigenMesh& mesh,
@@ -703,7 +1090,9 @@ void getVisibilityRayShootingOnZ(
         const unsigned int directionIndex,
         const int oppositeDirectionIndex,
         cg3::Array2D<int>& visibility,
-        const double heightfieldAngle)
+        const double heightfieldAngle,
+        OccluderList* directionOccluders,
+        OccluderList* oppositeOccluders)
 {
     const double heightFieldLimit = cos(heightfieldAngle);
 
@@ -795,6 +1184,18 @@ void getVisibilityRayShootingOnZ(
             visibility(oppositeDirectionIndex, minZFace) = 1;
         }
 
+        //The face is occluded by the one found on its barycenter ray
+        if (directionOccluders != nullptr && maxZFace >= 0 && maxZFace != static_cast<int>(faceIndex) &&
+                zDirMax.dot(mesh.faceNormal(faceIndex)) >= heightFieldLimit)
+        {
+            directionOccluders->push_back(std::make_pair(faceIndex, static_cast<unsigned int>(maxZFace)));
+        }
+        if (oppositeOccluders != nullptr && oppositeDirectionIndex >= 0 && minZFace >= 0 && minZFace != static_cast<int>(faceIndex) &&
+                zDirMin.dot(mesh.faceNormal(faceIndex)) >= heightFieldLimit)
+        {
+            oppositeOccluders->push_back(std::make_pair(faceIndex, static_cast<unsigned int>(minZFace)));
+        }
+
 
         assert(zDirMax.dot(mesh.faceNormal(maxZFace)) >= heightFieldLimit);
 #ifdef RELEASECHECK
@@ -835,10 +1236,31 @@ void getVisibilityRayShootingOnZ(
 #endif
         }
     }
+
+    //Faces found visible from another ray are not occluded
+    if (directionOccluders != nullptr) {
+        internal::removeVisibleOccluded(visibility, directionIndex, *directionOccluders);
+    }
+    if (oppositeOccluders != nullptr && oppositeDirectionIndex >= 0) {
+        internal::removeVisibleOccluded(visibility, static_cast<unsigned int>(oppositeDirectionIndex), *oppositeOccluders);
+    }
 }
 
 
 
+/* ----- VISIBILITY MARGINS ----- */
+
+/**
+ * @brief Quantize a dot product in a visibility margin
+ * @param[in] dot Dot product between normal and direction
+ * @returns Visibility margin
+ */
+signed char quantizeMargin(const double dot)
+{
+    const double clampedDot = std::max(-1.0, std::min(1.0, dot));
+    return static_cast<signed char>(std::lround(clampedDot * MARGINSCALE));
+}
+
 }
 
 }
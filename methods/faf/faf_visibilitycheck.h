@@ -22,7 +22,83 @@ void getVisibility(
         const double heightfieldAngle,
         const bool includeXDirections,
         Data& data,
-        const CheckMode checkMode);
+        const CheckMode checkMode,
+        const bool recordOccluders);
+
+int findOccluder(
+        const std::vector<OccluderList>& occluders,
+        const unsigned int directionIndex,
+        const unsigned int faceId);
+
+
+/* Visibility margins */
+
+void computeVisibilityMargins(
+        const cg3::EigenMesh& mesh,
+        Data& data);
+
+bool areVisibilityMarginsValid(
+        const cg3::EigenMesh& mesh,
+        const Data& data);
+
+bool getVisibilityFromMargins(
+        const cg3::EigenMesh& mesh,
+        const double heightfieldAngle,
+        Data& data);
+
+bool isOccludedMargin(const signed char margin);
+
+
+/* Visibility provider */
+
+class VisibilityProvider {
+
+public:
+
+    VisibilityProvider(
+            const cg3::EigenMesh& mesh,
+            const unsigned int nDirections,
+            const double heightfieldAngle,
+            const bool includeXDirections,
+            const std::vector<unsigned int>& minExtremes,
+            const std::vector<unsigned int>& maxExtremes,
+            const CheckMode checkMode);
+
+    unsigned int numberDirections() const;
+    unsigned int numberFaces() const;
+    const std::vector<cg3::Vec3d>& directions() const;
+    const std::vector<double>& angles() const;
+
+    void fill(
+            cg3::Array2D<int>& visibility,
+            std::vector<OccluderList>* occluders = nullptr) const;
+    void fill(
+            const std::vector<unsigned int>& directionIndices,
+            cg3::Array2D<int>& visibility,
+            std::vector<OccluderList>* occluders = nullptr) const;
+
+private:
+
+    unsigned int slotIndex(const unsigned int directionIndex) const;
+    unsigned int rowIndex(const unsigned int directionIndex) const;
+    void computeSlot(
+            const unsigned int slotId,
+            cg3::Array2D<int>& slotVisibility,
+            OccluderList* firstOccluders,
+            OccluderList* secondOccluders) const;
+
+    const cg3::EigenMesh& mesh;
+    const double heightfieldAngle;
+    const bool includeXDirections;
+    const std::vector<unsigned int> minExtremes;
+    const std::vector<unsigned int> maxExtremes;
+    const CheckMode checkMode;
+
+    unsigned int halfNDirections;
+    double stepAngle;
+    std::vector<cg3::Vec3d> directionVectors;
+    std::vector<double> directionAngles;
+};
 
 }
 
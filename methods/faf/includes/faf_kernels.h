@@ -0,0 +1,70 @@
+/**
+ * @author Stefano Nuvoli
+ * @author Alessandro Muntoni
+ */
+#ifndef FAF_KERNELS_H
+#define FAF_KERNELS_H
+
+/*
+ * Internal kernels of the pipeline, shared with the benchmark tool.
+ * They are not part of the public interface of the methods.
+ */
+
+#include <vector>
+
+#include <cg3/meshes/eigenmesh/eigenmesh.h>
+#include <cg3/geometry/point2.h>
+#include <cg3/geometry/triangle2.h>
+#include <cg3/data_structures/trees/aabbtree.h>
+
+#include "../faf_data.h"
+
+namespace FourAxisFabrication {
+
+namespace internal {
+
+/* Projection check (faf_visibilitycheck.cpp) */
+
+bool triangle2DComparator(const cg3::Triangle2d& t1, const cg3::Triangle2d& t2);
+
+double triangle2DAABBExtractor(
+        const cg3::Triangle2d& triangle,
+        const cg3::AABBValueType& valueType,
+        const int& dim);
+
+
+/* Validation of the moves (faf_frequencies.cpp) */
+
+bool isMoveValid(const cg3::EigenMesh& mesh,
+        const Data& data,
+        const unsigned int vId,
+        const cg3::Point3d& newPoint,
+        const std::vector<std::vector<int>>& vertexFaceAdjacencies,
+        const double heightfieldAngle,
+        const double normalAngle);
+
+
+/* Smooth term of the graph-cut (faf_association.cpp) */
+
+struct SmoothData {
+    const cg3::EigenMesh& mesh;
+    std::vector<double>& faceSaliency;
+    double detailMultiplier;
+    double compactness;
+};
+
+float getSmoothTerm(
+        int f1, int f2,
+        int l1, int l2,
+        void *extra_data);
+
+
+/* Offset of the first layer (faf_extraction.cpp) */
+
+std::vector<cg3::Point2d> offsetPolygon(std::vector<cg3::Point2d>& polygon, const double offset);
+
+}
+
+}
+
+#endif // FAF_KERNELS_H
@@ -17,5 +17,19 @@
 #include "faf/faf_extraction.h"
 #include "faf/faf_optimization.h"
 #include "faf/faf_details.h"
+#include "faf/faf_planeclip.h"
+#include "faf/faf_heightmap.h"
+#include "faf/faf_simulation.h"
+#include "faf/faf_maxflow.h"
+#include "faf/faf_dynamicgraphcut.h"
+#include "faf/faf_metrics.h"
+#include "faf/faf_allocations.h"
+#include "faf/faf_meshbuilder.h"
+#include "faf/faf_meshview.h"
+#include "faf/faf_depthraster.h"
+#include "faf/faf_accessibility.h"
+#include "faf/faf_arena.h"
+#include "faf/faf_meshloader.h"
+#include "faf/faf_incremental.h"
 
 #endif // FOURAXISFABRICATION_H
@@ -0,0 +1,814 @@
+/*
+ * Microbenchmarks of the geometric kernels of the pipeline.
+ * The inputs are captured, with a fixed seed, from the stages which
+ * use the kernels on the given mesh: for each kernel the time per call
+ * and the throughput of the implementation used by the pipeline are
+ * reported. Some kernels also have a prototype variant on
+ * structure-of-arrays inputs, written in this tool: the pipeline does
+ * not use them, they only estimate the gain of such a rewrite.
+ */
+
+#include <iostream>
+#include <iomanip>
+#include <sstream>
+#include <chrono>
+#include <random>
+#include <string>
+#include <vector>
+#include <array>
+#include <algorithm>
+#include <numeric>
+#include <iterator>
+#include <cmath>
+
+#include <cg3/utilities/command_line_argument_manager.h>
+#include <cg3/geometry/transformations3.h>
+#include <cg3/geometry/triangle2_utils.h>
+#include <cg3/libigl/mesh_adjacencies.h>
+
+#include "../methods/faf/faf_data.h"
+#include "../methods/faf/faf_various.h"
+#include "../methods/faf/faf_visibilitycheck.h"
+#include "../methods/faf/faf_frequencies.h"
+#include "../methods/faf/faf_association.h"
+#include "../methods/faf/faf_extraction.h"
+#include "../methods/faf/faf_meshloader.h"
+#include "../methods/faf/faf_meshview.h"
+#include "../methods/faf/includes/faf_kernels.h"
+
+#define SAT_EPSILON 1e-12
+
+//strings used for intro and help
+const std::string intro =
+"Microbenchmarks of the geometric kernels of the 4-axis milling pipeline.\n";
+
+const std::string help =
+"Usage: \n"
+"./fafBenchmark --input=file.obj [--model_height=60] [--n_visibility_dirs=120]\n"
+"    [--sampled_dirs=8] [--n_samples=20000] [--seed=42] [--min_time=200]\n";
+
+//pipeline values used by the kernels
+const double heightfieldAngle = 90.0 / 180.0 * M_PI;
+const double normalAngle = M_PI / 4;
+const double firstLayerOffset = 3.0;
+const double compactness = 30.0;
+const double detailMultiplier = 25.0;
+
+struct TrianglePairs {
+	std::vector<std::pair<cg3::Triangle2d, cg3::Triangle2d>> pairs;
+	std::array<std::vector<double>, 12> coords;
+};
+
+struct MoveQueries {
+	std::vector<unsigned int> vertices;
+	std::vector<cg3::Point3d> points;
+
+	//Neighbourhoods of the moved vertices, flattened
+	std::vector<unsigned int> offsets;
+	std::vector<unsigned int> entryQuery;
+	std::array<std::vector<double>, 12> entryCoords;
+};
+
+struct SmoothQueries {
+	std::vector<int> f1, f2, l1, l2;
+	std::array<std::vector<double>, 3> normals;
+	std::vector<double> saliency;
+};
+
+struct BenchmarkInputs {
+	std::vector<cg3::EigenMesh> rotatedMeshes;
+	std::vector<Eigen::Matrix3d> rotations;
+	std::vector<std::vector<cg3::Triangle2d>> triangleStreams;
+	std::vector<std::vector<cg3::Triangle2d>> insertedTriangles;
+	TrianglePairs overlapPairs;
+	MoveQueries moveQueries;
+	SmoothQueries smoothQueries;
+	std::vector<std::vector<cg3::Point2d>> polygons;
+};
+
+struct BenchmarkResult {
+	std::string kernel;
+	std::string variant;
+	size_t itemsPerRun;
+	size_t runs;
+	double seconds;
+	unsigned long long int checksum;
+};
+
+void captureInputs(
+		cg3::EigenMesh& mesh,
+		FourAxisFabrication::Data& data,
+		const unsigned int nDirections,
+		const unsigned int sampledDirections,
+		const unsigned int nSamples,
+		const unsigned int seed,
+		BenchmarkInputs& inputs);
+
+template<class Kernel>
+BenchmarkResult runBenchmark(
+		const std::string& kernel,
+		const std::string& variant,
+		const size_t itemsPerRun,
+		const double minTime,
+		Kernel run);
+
+void printResults(const std::vector<BenchmarkResult>& results);
+
+/**
+ * Prototype of the separating axis test on the normal of the edge (p0, p1) of a
+ * triangle (p0, p1, p2), against the triangle (q0, q1, q2). Touching triangles
+ * are separated. Not used by the pipeline, which calls cg3::triangleOverlap.
+ */
+inline int separatedOnEdge(
+		const double p0x, const double p0y, const double p1x, const double p1y, const double p2x, const double p2y,
+		const double q0x, const double q0y, const double q1x, const double q1y, const double q2x, const double q2y)
+{
+	const double nx = p0y - p1y;
+	const double ny = p1x - p0x;
+
+	const double projP0 = nx * p0x + ny * p0y;
+	const double projP2 = nx * p2x + ny * p2y;
+	const double projQ0 = nx * q0x + ny * q0y;
+	const double projQ1 = nx * q1x + ny * q1y;
+	const double projQ2 = nx * q2x + ny * q2y;
+
+	const double minP = std::min(projP0, projP2);
+	const double maxP = std::max(projP0, projP2);
+	const double minQ = std::min(std::min(projQ0, projQ1), projQ2);
+	const double maxQ = std::max(std::max(projQ0, projQ1), projQ2);
+
+	return (maxP <= minQ + SAT_EPSILON) | (maxQ <= minP + SAT_EPSILON);
+}
+
+int main(int argc, char *argv[]) {
+	cg3::CommandLineArgumentManager clArguments(argc, argv);
+
+	if (clArguments.size() == 0 || clArguments.exists("h") || clArguments.exists("help")) {
+		std::cout << intro << help;
+		return 0;
+	}
+
+	std::string inputFile;
+	if (clArguments.exists("i")){
+		inputFile = clArguments["i"];
+	}
+	if (clArguments.exists("input")){
+		inputFile = clArguments["input"];
+	}
+	if (inputFile.empty()){
+		std::cerr << "Error: Input file not specified.\n" << help;
+		return -1;
+	}
+
+	double modelLength = 60.0;
+	unsigned int nDirections = 120;
+	unsigned int sampledDirections = 8;
+	unsigned int nSamples = 20000;
+	unsigned int seed = 42;
+	double minTime = 0.2;
+	if (clArguments.exists("model_height")){
+		modelLength = std::stod(clArguments["model_height"]);
+	}
+	if (clArguments.exists("n_visibility_dirs")){
+		nDirections = std::stoi(clArguments["n_visibility_dirs"]);
+	}
+	if (clArguments.exists("sampled_dirs")){
+		sampledDirections = std::stoi(clArguments["sampled_dirs"]);
+	}
+	if (clArguments.exists("n_samples")){
+		nSamples = std::stoi(clArguments["n_samples"]);
+	}
+	if (clArguments.exists("seed")){
+		seed = std::stoi(clArguments["seed"]);
+	}
+	if (clArguments.exists("min_time")){
+		minTime = std::stod(clArguments["min_time"]) / 1000.0;
+	}
+
+	cg3::EigenMesh mesh;
+	if (!FourAxisFabrication::loadMesh(inputFile, mesh)) {
+		std::cerr << "Error: impossible to load input file.\nKnown input formats: OBJ, PLY.\n";
+		return -1;
+	}
+	FourAxisFabrication::centerAndScale(mesh, true, modelLength);
+
+	std::cout << "Capturing inputs from " << inputFile << " (" << mesh.numberFaces() << " faces, seed " << seed << ")...\n";
+
+	FourAxisFabrication::Data data;
+	BenchmarkInputs inputs;
+	captureInputs(mesh, data, nDirections, sampledDirections, nSamples, seed, inputs);
+
+	std::vector<BenchmarkResult> results;
+
+	/* ----- TRIANGLE OVERLAP ----- */
+
+	const TrianglePairs& overlapPairs = inputs.overlapPairs;
+	const size_t nPairs = overlapPairs.pairs.size();
+
+	results.push_back(runBenchmark("triangleOverlap", "pipeline", nPairs, minTime, [&] () {
+		unsigned long long int count = 0;
+		for (const std::pair<cg3::Triangle2d, cg3::Triangle2d>& pair : overlapPairs.pairs) {
+			count += cg3::triangleOverlap(pair.first, pair.second) ? 1 : 0;
+		}
+		return count;
+	}));
+
+	std::vector<unsigned char> overlapResults(nPairs);
+	results.push_back(runBenchmark("triangleOverlap", "prototype", nPairs, minTime, [&] () {
+		const std::array<std::vector<double>, 12>& c = overlapPairs.coords;
+		const double* ax0 = c[0].data(); const double* ay0 = c[1].data();
+		const double* ax1 = c[2].data(); const double* ay1 = c[3].data();
+		const double* ax2 = c[4].data(); const double* ay2 = c[5].data();
+		const double* bx0 = c[6].data(); const double* by0 = c[7].data();
+		const double* bx1 = c[8].data(); const double* by1 = c[9].data();
+		const double* bx2 = c[10].data(); const double* by2 = c[11].data();
+		unsigned char* out = overlapResults.data();
+
+		#pragma omp simd
+		for (size_t i = 0; i < nPairs; i++) {
+			//Separating axis test on the normals of the six edges
+			const int separated =
+					separatedOnEdge(ax0[i], ay0[i], ax1[i], ay1[i], ax2[i], ay2[i], bx0[i], by0[i], bx1[i], by1[i], bx2[i], by2[i]) |
+					separatedOnEdge(ax1[i], ay1[i], ax2[i], ay2[i], ax0[i], ay0[i], bx0[i], by0[i], bx1[i], by1[i], bx2[i], by2[i]) |
+					separatedOnEdge(ax2[i], ay2[i], ax0[i], ay0[i], ax1[i], ay1[i], bx0[i], by0[i], bx1[i], by1[i], bx2[i], by2[i]) |
+					separatedOnEdge(bx0[i], by0[i], bx1[i], by1[i], bx2[i], by2[i], ax0[i], ay0[i], ax1[i], ay1[i], ax2[i], ay2[i]) |
+					separatedOnEdge(bx1[i], by1[i], bx2[i], by2[i], bx0[i], by0[i], ax0[i], ay0[i], ax1[i], ay1[i], ax2[i], ay2[i]) |
+					separatedOnEdge(bx2[i], by2[i], bx0[i], by0[i], bx1[i], by1[i], ax0[i], ay0[i], ax1[i], ay1[i], ax2[i], ay2[i]);
+			out[i] = separated ? 0 : 1;
+		}
+
+		return static_cast<unsigned long long int>(std::accumulate(overlapResults.begin(), overlapResults.end(), 0ULL));
+	}));
+
+
+	/* ----- 2D AABB TREE ----- */
+
+	size_t nInserted = 0;
+	size_t nStreamed = 0;
+	for (size_t d = 0; d < inputs.triangleStreams.size(); d++) {
+		nInserted += inputs.insertedTriangles[d].size();
+		nStreamed += inputs.triangleStreams[d].size();
+	}
+
+	results.push_back(runBenchmark("aabbInsert", "pipeline", nInserted, minTime, [&] () {
+		unsigned long long int count = 0;
+		for (const std::vector<cg3::Triangle2d>& triangles : inputs.insertedTriangles) {
+			cg3::AABBTree<2, cg3::Triangle2d> aabbTree(
+						&FourAxisFabrication::internal::triangle2DAABBExtractor,
+						&FourAxisFabrication::internal::triangle2DComparator);
+			for (const cg3::Triangle2d& triangle : triangles) {
+				aabbTree.insert(triangle);
+				count++;
+			}
+		}
+		return count;
+	}));
+
+	results.push_back(runBenchmark("aabbProjection", "pipeline", nStreamed, minTime, [&] () {
+		unsigned long long int count = 0;
+		for (const std::vector<cg3::Triangle2d>& triangles : inputs.triangleStreams) {
+			cg3::AABBTree<2, cg3::Triangle2d> aabbTree(
+						&FourAxisFabrication::internal::triangle2DAABBExtractor,
+						&FourAxisFabrication::internal::triangle2DComparator);
+			for (const cg3::Triangle2d& triangle : triangles) {
+				if (!aabbTree.aabbOverlapCheck(triangle, &cg3::triangleOverlap)) {
+					aabbTree.insert(triangle);
+					count++;
+				}
+			}
+		}
+		return count;
+	}));
+
+
+	/* ----- TRIANGLE Z SORT ----- */
+
+	size_t nSortedFaces = 0;
+	std::vector<std::vector<double>> vertexZ(inputs.rotatedMeshes.size());
+	std::vector<std::array<std::vector<unsigned int>, 3>> faceVertices(inputs.rotatedMeshes.size());
+	for (size_t d = 0; d < inputs.rotatedMeshes.size(); d++) {
+		const cg3::EigenMesh& rotatedMesh = inputs.rotatedMeshes[d];
+		nSortedFaces += rotatedMesh.numberFaces();
+
+		vertexZ[d].resize(rotatedMesh.numberVertices());
+		for (unsigned int vId = 0; vId < rotatedMesh.numberVertices(); vId++)
+			vertexZ[d][vId] = rotatedMesh.vertex(vId).z();
+
+		for (unsigned int k = 0; k < 3; k++)
+			faceVertices[d][k].resize(rotatedMesh.numberFaces());
+		for (unsigned int fId = 0; fId < rotatedMesh.numberFaces(); fId++) {
+			const cg3::Point3i& face = rotatedMesh.face(fId);
+			faceVertices[d][0][fId] = face.x();
+			faceVertices[d][1][fId] = face.y();
+			faceVertices[d][2][fId] = face.z();
+		}
+	}
+
+	results.push_back(runBenchmark("triangleZSort", "pipeline", nSortedFaces, minTime, [&] () {
+		unsigned long long int count = 0;
+		for (const Eigen::Matrix3d& rotation : inputs.rotations) {
+			const FourAxisFabrication::TransformedMeshView rotatedMesh(mesh, rotation);
+			std::vector<unsigned int> orderedZFaces(rotatedMesh.numberFaces());
+			std::iota(orderedZFaces.begin(), orderedZFaces.end(), 0);
+			rotatedMesh.sortFacesByMinCoordinate(2, orderedZFaces);
+			count += orderedZFaces.size();
+		}
+		return count;
+	}));
+
+	results.push_back(runBenchmark("triangleZSort", "prototype", nSortedFaces, minTime, [&] () {
+		unsigned long long int count = 0;
+		for (size_t d = 0; d < vertexZ.size(); d++) {
+			const double* z = vertexZ[d].data();
+			const unsigned int* v0 = faceVertices[d][0].data();
+			const unsigned int* v1 = faceVertices[d][1].data();
+			const unsigned int* v2 = faceVertices[d][2].data();
+			const size_t nFaces = faceVertices[d][0].size();
+
+			//Sort keys computed in a single pass
+			std::vector<std::pair<double, unsigned int>> keys(nFaces);
+			std::vector<double> minZ(nFaces);
+			double* minZData = minZ.data();
+
+			#pragma omp simd
+			for (size_t fId = 0; fId < nFaces; fId++) {
+				minZData[fId] = std::min(std::min(z[v0[fId]], z[v1[fId]]), z[v2[fId]]);
+			}
+
+			for (size_t fId = 0; fId < nFaces; fId++) {
+				keys[fId] = std::make_pair(minZData[fId], static_cast<unsigned int>(fId));
+			}
+			std::sort(keys.begin(), keys.end());
+			count += keys.size();
+		}
+		return count;
+	}));
+
+
+	/* ----- MOVE VALIDATION ----- */
+
+	const MoveQueries& moveQueries = inputs.moveQueries;
+	const size_t nMoves = moveQueries.vertices.size();
+	std::vector<std::vector<int>> vertexFaceAdjacencies = cg3::libigl::vertexToFaceIncidences(mesh);
+
+	results.push_back(runBenchmark("isMoveValid", "pipeline", nMoves, minTime, [&] () {
+		unsigned long long int count = 0;
+		for (size_t i = 0; i < nMoves; i++) {
+			if (FourAxisFabrication::internal::isMoveValid(
+						mesh, data, moveQueries.vertices[i], moveQueries.points[i],
+						vertexFaceAdjacencies, heightfieldAngle, normalAngle))
+			{
+				count++;
+			}
+		}
+		return count;
+	}));
+
+	const size_t nEntries = moveQueries.entryQuery.size();
+	std::array<std::vector<double>, 3> movePoints;
+	for (unsigned int k = 0; k < 3; k++) {
+		movePoints[k].resize(nMoves);
+		for (size_t i = 0; i < nMoves; i++)
+			movePoints[k][i] = k == 0 ? moveQueries.points[i].x() : (k == 1 ? moveQueries.points[i].y() : moveQueries.points[i].z());
+	}
+	std::vector<unsigned char> entryValid(nEntries);
+
+	results.push_back(runBenchmark("isMoveValid", "prototype", nMoves, minTime, [&] () {
+		const double heightfieldLimit = cos(heightfieldAngle);
+		const double normalAngleLimit = cos(normalAngle);
+
+		const std::array<std::vector<double>, 12>& c = moveQueries.entryCoords;
+		const unsigned int* query = moveQueries.entryQuery.data();
+		const double* px = movePoints[0].data();
+		const double* py = movePoints[1].data();
+		const double* pz = movePoints[2].data();
+		unsigned char* valid = entryValid.data();
+
+		//Faces of all the neighbourhoods, with the moved vertex as first vertex
+		#pragma omp simd
+		for (size_t i = 0; i < nEntries; i++) {
+			const unsigned int q = query[i];
+			const double ux = c[0][i] - px[q], uy = c[1][i] - py[q], uz = c[2][i] - pz[q];
+			const double vx = c[3][i] - px[q], vy = c[4][i] - py[q], vz = c[5][i] - pz[q];
+			double nx = uy * vz - uz * vy;
+			double ny = uz * vx - ux * vz;
+			double nz = ux * vy - uy * vx;
+			const double norm = std::sqrt(nx * nx + ny * ny + nz * nz);
+			nx /= norm; ny /= norm; nz /= norm;
+
+			const double normalDot = nx * c[6][i] + ny * c[7][i] + nz * c[8][i];
+			const double directionDot = nx * c[9][i] + ny * c[10][i] + nz * c[11][i];
+			valid[i] = (normalDot >= normalAngleLimit) & (directionDot > heightfieldLimit);
+		}
+
+		unsigned long long int count = 0;
+		for (size_t i = 0; i < nMoves; i++) {
+			bool isValid = true;
+			for (unsigned int j = moveQueries.offsets[i]; j < moveQueries.offsets[i+1] && isValid; j++)
+				isValid = entryValid[j] != 0;
+			if (isValid)
+				count++;
+		}
+		return count;
+	}));
+
+
+	/* ----- SMOOTH TERM ----- */
+
+	const SmoothQueries& smoothQueries = inputs.smoothQueries;
+	const size_t nSmooth = smoothQueries.f1.size();
+	std::vector<double> faceSaliency = smoothQueries.saliency;
+	FourAxisFabrication::internal::SmoothData smoothData = {mesh, faceSaliency, detailMultiplier, compactness};
+
+	results.push_back(runBenchmark("getSmoothTerm", "pipeline", nSmooth, minTime, [&] () {
+		unsigned long long int count = 0;
+		for (size_t i = 0; i < nSmooth; i++) {
+			if (FourAxisFabrication::internal::getSmoothTerm(
+						smoothQueries.f1[i], smoothQueries.f2[i], smoothQueries.l1[i], smoothQueries.l2[i], (void*) &smoothData) > 0.f)
+			{
+				count++;
+			}
+		}
+		return count;
+	}));
+
+	std::vector<float> smoothResults(nSmooth);
+	results.push_back(runBenchmark("getSmoothTerm", "prototype", nSmooth, minTime, [&] () {
+		const int* f1 = smoothQueries.f1.data();
+		const int* f2 = smoothQueries.f2.data();
+		const int* l1 = smoothQueries.l1.data();
+		const int* l2 = smoothQueries.l2.data();
+		const double* nx = smoothQueries.normals[0].data();
+		const double* ny = smoothQueries.normals[1].data();
+		const double* nz = smoothQueries.normals[2].data();
+		const double* saliency = smoothQueries.saliency.data();
+		const float compactnessTerm = static_cast<float>(compactness);
+		const float detailTerm = static_cast<float>(detailMultiplier);
+		float* out = smoothResults.data();
+
+		#pragma omp simd
+		for (size_t i = 0; i < nSmooth; i++) {
+			const float dot = static_cast<float>(nx[f1[i]] * nx[f2[i]] + ny[f1[i]] * ny[f2[i]] + nz[f1[i]] * nz[f2[i]]);
+			const double saliencyCost = (saliency[f1[i]] + saliency[f2[i]]) / 2.0 * detailTerm;
+			const float cost = static_cast<float>(compactnessTerm + saliencyCost);
+			out[i] = (l1[i] != l2[i] && dot >= 0) ? cost : 0.f;
+		}
+
+		unsigned long long int count = 0;
+		for (size_t i = 0; i < nSmooth; i++) {
+			if (smoothResults[i] > 0.f)
+				count++;
+		}
+		return count;
+	}));
+
+
+	/* ----- POLYGON OFFSET ----- */
+
+	size_t nPolygonVertices = 0;
+	for (const std::vector<cg3::Point2d>& polygon : inputs.polygons)
+		nPolygonVertices += polygon.size();
+
+	std::vector<std::vector<cg3::Point2d>> polygons = inputs.polygons;
+	results.push_back(runBenchmark("offsetPolygon", "pipeline", nPolygonVertices, minTime, [&] () {
+		unsigned long long int count = 0;
+		for (std::vector<cg3::Point2d>& polygon : polygons) {
+			count += FourAxisFabrication::internal::offsetPolygon(polygon, firstLayerOffset).size();
+		}
+		return count;
+	}));
+
+	printResults(results);
+
+	return 0;
+}
+
+/**
+ * Captures the inputs of the kernels from the stages of the pipeline which use them:
+ * the triangles projected and inserted in the AABB trees of the visibility check,
+ * with the pairs tested for overlap, for a sample of the directions; the moves
+ * of the vertices tested in the detail recovery; the adjacent faces and labels
+ * evaluated by the graph-cut; the sections offset for the first layer of the stocks.
+ * The association of the faces is the direction most aligned with their normal.
+ */
+void captureInputs(
+		cg3::EigenMesh& mesh,
+		FourAxisFabrication::Data& data,
+		const unsigned int nDirections,
+		const unsigned int sampledDirections,
+		const unsigned int nSamples,
+		const unsigned int seed,
+		BenchmarkInputs& inputs)
+{
+	std::mt19937 rng(seed);
+
+	const unsigned int halfNDirections = nDirections / 2;
+	const double stepAngle = M_PI / halfNDirections;
+	const double heightfieldLimit = cos(heightfieldAngle);
+
+	//Directions, as in the visibility check
+	data.directions.resize(halfNDirections * 2 + 2);
+	cg3::Vec3d dir(0,0,1);
+	Eigen::Matrix3d stepRotation;
+	cg3::rotationMatrix(cg3::Vec3d(1,0,0), stepAngle, stepRotation);
+	for (unsigned int dirIndex = 0; dirIndex < halfNDirections; dirIndex++) {
+		data.directions[dirIndex] = dir;
+		data.directions[halfNDirections + dirIndex] = -dir;
+		dir.rotate(stepRotation);
+	}
+	data.directions[halfNDirections * 2] = cg3::Vec3d(-1,0,0);
+	data.directions[halfNDirections * 2 + 1] = cg3::Vec3d(1,0,0);
+
+	data.association.resize(mesh.numberFaces());
+	for (unsigned int fId = 0; fId < mesh.numberFaces(); fId++) {
+		const cg3::Vec3d normal = mesh.faceNormal(fId);
+		int bestLabel = 0;
+		for (unsigned int l = 1; l < halfNDirections * 2; l++) {
+			if (normal.dot(data.directions[l]) > normal.dot(data.directions[bestLabel]))
+				bestLabel = l;
+		}
+		data.association[fId] = bestLabel;
+	}
+
+	//Triangle streams of the projection check
+	typedef cg3::AABBTree<2, cg3::Triangle2d> AABBTree2D;
+
+	std::vector<std::pair<cg3::Triangle2d, cg3::Triangle2d>>& capturedPairs = inputs.overlapPairs.pairs;
+	const size_t maxCapturedPairs = nSamples * 10;
+
+	for (unsigned int s = 0; s < sampledDirections && s < halfNDirections; s++) {
+		const unsigned int dirIndex = s * halfNDirections / sampledDirections;
+
+		cg3::EigenMesh rotatedMesh = mesh;
+		Eigen::Matrix3d rotationMatrix;
+		cg3::rotationMatrix(cg3::Vec3d(1,0,0), -stepAngle * dirIndex, rotationMatrix);
+		rotatedMesh.rotate(rotationMatrix);
+
+		std::vector<unsigned int> orderedZFaces(rotatedMesh.numberFaces());
+		std::iota(orderedZFaces.begin(), orderedZFaces.end(), 0);
+		FourAxisFabrication::TransformedMeshView(mesh, rotationMatrix).sortFacesByMinCoordinate(2, orderedZFaces);
+
+		std::vector<cg3::Triangle2d> stream;
+		std::vector<cg3::Triangle2d> inserted;
+
+		AABBTree2D aabbTree(
+					&FourAxisFabrication::internal::triangle2DAABBExtractor,
+					&FourAxisFabrication::internal::triangle2DComparator);
+
+		std::vector<AABBTree2D::iterator> candidates;
+		for (int i = orderedZFaces.size() - 1; i >= 0; i--) {
+			const unsigned int faceId = orderedZFaces[i];
+			if (rotatedMesh.faceNormal(faceId).z() < heightfieldLimit)
+				continue;
+
+			const cg3::Point3i& face = rotatedMesh.face(faceId);
+			const cg3::Point3d& v1 = rotatedMesh.vertex(face.x());
+			const cg3::Point3d& v2 = rotatedMesh.vertex(face.y());
+			const cg3::Point3d& v3 = rotatedMesh.vertex(face.z());
+
+			cg3::Triangle2d triangle(cg3::Point2d(v1.x(), v1.y()), cg3::Point2d(v2.x(), v2.y()), cg3::Point2d(v3.x(), v3.y()));
+			cg3::sortTriangle2DPointsAndReorderCounterClockwise(triangle);
+
+			stream.push_back(triangle);
+
+			//The checker of the tree has no extra data: the candidates with an
+			//overlapping box are queried, and tested here in the same order
+			candidates.clear();
+			aabbTree.aabbOverlapQuery(triangle, std::back_inserter(candidates));
+
+			bool intersectionFound = false;
+			for (size_t c = 0; c < candidates.size() && !intersectionFound; c++) {
+				const cg3::Triangle2d& candidate = *candidates[c];
+				if (capturedPairs.size() < maxCapturedPairs)
+					capturedPairs.push_back(std::make_pair(triangle, candidate));
+				intersectionFound = cg3::triangleOverlap(triangle, candidate);
+			}
+
+			if (!intersectionFound) {
+				aabbTree.insert(triangle);
+				inserted.push_back(triangle);
+			}
+		}
+
+		inputs.rotatedMeshes.push_back(rotatedMesh);
+		inputs.rotations.push_back(rotationMatrix);
+		inputs.triangleStreams.push_back(stream);
+		inputs.insertedTriangles.push_back(inserted);
+	}
+
+	TrianglePairs& overlapPairs = inputs.overlapPairs;
+	for (std::vector<double>& c : overlapPairs.coords)
+		c.resize(overlapPairs.pairs.size());
+	for (size_t i = 0; i < overlapPairs.pairs.size(); i++) {
+		const cg3::Triangle2d* triangles[2] = {&overlapPairs.pairs[i].first, &overlapPairs.pairs[i].second};
+		for (unsigned int t = 0; t < 2; t++) {
+			const cg3::Point2d vertices[3] = {triangles[t]->v1(), triangles[t]->v2(), triangles[t]->v3()};
+			for (unsigned int k = 0; k < 3; k++) {
+				overlapPairs.coords[t*6 + k*2][i] = vertices[k].x();
+				overlapPairs.coords[t*6 + k*2 + 1][i] = vertices[k].y();
+			}
+		}
+	}
+
+	//Moves of the detail recovery: towards the mean of the adjacent vertices, with noise
+	std::vector<std::vector<int>> vertexVertexAdjacencies = cg3::libigl::vertexToVertexAdjacencies(mesh);
+	std::vector<std::vector<int>> vertexFaceAdjacencies = cg3::libigl::vertexToFaceIncidences(mesh);
+	std::uniform_int_distribution<unsigned int> vertexDistribution(0, mesh.numberVertices() - 1);
+	std::uniform_real_distribution<double> noiseDistribution(-0.5, 0.5);
+
+	MoveQueries& moveQueries = inputs.moveQueries;
+	moveQueries.offsets.push_back(0);
+	for (unsigned int i = 0; i < nSamples; i++) {
+		const unsigned int vId = vertexDistribution(rng);
+		const cg3::Point3d currentPoint = mesh.vertex(vId);
+		if (vertexVertexAdjacencies[vId].empty())
+			continue;
+
+		cg3::Point3d meanPoint(0,0,0);
+		double meanLength = 0;
+		for (const int adjId : vertexVertexAdjacencies[vId]) {
+			meanPoint += mesh.vertex(adjId);
+			meanLength += (mesh.vertex(adjId) - currentPoint).norm();
+		}
+		meanPoint /= vertexVertexAdjacencies[vId].size();
+		meanLength /= vertexVertexAdjacencies[vId].size();
+
+		const cg3::Point3d newPoint = meanPoint + meanLength * cg3::Point3d(noiseDistribution(rng), noiseDistribution(rng), noiseDistribution(rng));
+		const unsigned int query = moveQueries.vertices.size();
+		moveQueries.vertices.push_back(vId);
+		moveQueries.points.push_back(newPoint);
+
+		for (const int fId : vertexFaceAdjacencies[vId]) {
+			//The other vertices, in the order of the face after the moved one
+			const cg3::Point3i face = mesh.face(fId);
+			cg3::Point3d b, c;
+			if (face.x() == static_cast<int>(vId)) {
+				b = mesh.vertex(face.y());
+				c = mesh.vertex(face.z());
+			}
+			else if (face.y() == static_cast<int>(vId)) {
+				b = mesh.vertex(face.z());
+				c = mesh.vertex(face.x());
+			}
+			else {
+				b = mesh.vertex(face.x());
+				c = mesh.vertex(face.y());
+			}
+			const cg3::Vec3d faceNormal = mesh.faceNormal(fId);
+			const cg3::Vec3d& direction = data.directions[data.association[fId]];
+
+			const double coords[12] = {
+				b.x(), b.y(), b.z(), c.x(), c.y(), c.z(),
+				faceNormal.x(), faceNormal.y(), faceNormal.z(),
+				direction.x(), direction.y(), direction.z()
+			};
+			for (unsigned int k = 0; k < 12; k++)
+				moveQueries.entryCoords[k].push_back(coords[k]);
+			moveQueries.entryQuery.push_back(query);
+		}
+		moveQueries.offsets.push_back(moveQueries.entryQuery.size());
+	}
+
+	//Smooth terms of the graph-cut: adjacent faces with their labels, and with two random labels
+	std::vector<std::vector<int>> ffAdj = cg3::libigl::faceToFaceAdjacencies(mesh);
+	std::uniform_int_distribution<int> labelDistribution(0, halfNDirections * 2 + 1);
+	std::uniform_real_distribution<double> saliencyDistribution(0.0, 1.0);
+
+	SmoothQueries& smoothQueries = inputs.smoothQueries;
+	for (unsigned int fId = 0; fId < mesh.numberFaces(); fId++) {
+		for (const int adjId : ffAdj[fId]) {
+			if (adjId < static_cast<int>(fId))
+				continue;
+
+			smoothQueries.f1.push_back(fId);
+			smoothQueries.f2.push_back(adjId);
+			smoothQueries.l1.push_back(data.association[fId]);
+			smoothQueries.l2.push_back(data.association[adjId]);
+
+			smoothQueries.f1.push_back(fId);
+			smoothQueries.f2.push_back(adjId);
+			smoothQueries.l1.push_back(labelDistribution(rng));
+			smoothQueries.l2.push_back(labelDistribution(rng));
+		}
+	}
+	for (unsigned int k = 0; k < 3; k++)
+		smoothQueries.normals[k].resize(mesh.numberFaces());
+	smoothQueries.saliency.resize(mesh.numberFaces());
+	for (unsigned int fId = 0; fId < mesh.numberFaces(); fId++) {
+		const cg3::Vec3d normal = mesh.faceNormal(fId);
+		smoothQueries.normals[0][fId] = normal.x();
+		smoothQueries.normals[1][fId] = normal.y();
+		smoothQueries.normals[2][fId] = normal.z();
+		smoothQueries.saliency[fId] = saliencyDistribution(rng);
+	}
+
+	//Sections of the mesh along the rotation axis, offset for the first layer
+	const cg3::BoundingBox3 boundingBox = mesh.boundingBox();
+	const double slabWidth = boundingBox.lengthX() * 0.02;
+	for (unsigned int s = 0; s < sampledDirections; s++) {
+		const double x = boundingBox.minX() + boundingBox.lengthX() * (s + 1) / (sampledDirections + 1);
+
+		std::vector<cg3::Point2d> section;
+		for (unsigned int vId = 0; vId < mesh.numberVertices(); vId++) {
+			const cg3::Point3d& p = mesh.vertex(vId);
+			if (std::fabs(p.x() - x) <= slabWidth)
+				section.push_back(cg3::Point2d(p.y(), p.z()));
+		}
+		if (section.size() < 3)
+			continue;
+
+		cg3::Point2d center(0,0);
+		for (const cg3::Point2d& p : section)
+			center += p;
+		center /= section.size();
+
+		std::sort(section.begin(), section.end(), [&] (const cg3::Point2d& p1, const cg3::Point2d& p2) {
+			return std::atan2(p1.y() - center.y(), p1.x() - center.x()) < std::atan2(p2.y() - center.y(), p2.x() - center.x());
+		});
+		inputs.polygons.push_back(section);
+	}
+
+	std::cout << "Triangle streams: " << inputs.triangleStreams.size() << " directions, " <<
+				 overlapPairs.pairs.size() << " overlap tests; moves: " << moveQueries.vertices.size() <<
+				 "; smooth terms: " << smoothQueries.f1.size() << "; sections: " << inputs.polygons.size() << ".\n";
+}
+
+/**
+ * Runs a kernel until the minimum time has elapsed, after a warm-up run.
+ * The kernel returns a checksum of its results, which is kept to compare
+ * the variants and to avoid the elimination of the computation.
+ */
+template<class Kernel>
+BenchmarkResult runBenchmark(
+		const std::string& kernel,
+		const std::string& variant,
+		const size_t itemsPerRun,
+		const double minTime,
+		Kernel run)
+{
+	BenchmarkResult result;
+	result.kernel = kernel;
+	result.variant = variant;
+	result.itemsPerRun = itemsPerRun;
+	result.runs = 0;
+	result.seconds = 0;
+	result.checksum = run();
+
+	const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	do {
+		volatile unsigned long long int checksum = run();
+		(void) checksum;
+		result.runs++;
+		result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	} while (result.seconds < minTime);
+
+	return result;
+}
+
+/**
+ * Prints the time per call and the throughput of each kernel.
+ * The prototype variants are compared with the pipeline one by their checksum.
+ */
+void printResults(const std::vector<BenchmarkResult>& results)
+{
+	std::cout << "\n" <<
+				 std::left << std::setw(18) << "kernel" <<
+				 std::setw(12) << "variant" <<
+				 std::right << std::setw(12) << "items" <<
+				 std::setw(12) << "ns/call" <<
+				 std::setw(14) << "Mcalls/s" <<
+				 std::setw(12) << "speedup" <<
+				 "  checksum\n";
+
+	for (size_t i = 0; i < results.size(); i++) {
+		const BenchmarkResult& result = results[i];
+		const double totalCalls = static_cast<double>(result.itemsPerRun) * result.runs;
+		const double nsPerCall = totalCalls > 0 ? result.seconds * 1e9 / totalCalls : 0;
+
+		//Pipeline variant of the same kernel
+		const BenchmarkResult* pipeline = nullptr;
+		for (size_t j = 0; j < results.size(); j++) {
+			if (results[j].kernel == result.kernel && results[j].variant == "pipeline")
+				pipeline = &results[j];
+		}
+
+		std::string speedup = "-";
+		std::string agreement;
+		if (pipeline != nullptr && pipeline != &result) {
+			const double pipelineNs = pipeline->seconds * 1e9 / (static_cast<double>(pipeline->itemsPerRun) * pipeline->runs);
+			std::ostringstream ss;
+			ss << std::fixed << std::setprecision(2) << pipelineNs / nsPerCall << "x";
+			speedup = ss.str();
+			agreement = pipeline->checksum == result.checksum ? " (match)" : " (MISMATCH)";
+		}
+
+		std::cout << std::left << std::setw(18) << result.kernel <<
+					 std::setw(12) << result.variant <<
+					 std::right << std::setw(12) << result.itemsPerRun <<
+					 std::setw(12) << std::fixed << std::setprecision(1) << nsPerCall <<
+					 std::setw(14) << std::setprecision(2) << (nsPerCall > 0 ? 1e3 / nsPerCall : 0) <<
+					 std::setw(12) << speedup <<
+					 "  " << result.checksum << agreement << "\n";
+	}
+	std::cout << std::endl;
+}
@@ -0,0 +1,373 @@
+/*
+ * Equivalence harness of the pipeline configurations.
+ * The reference configuration and a candidate configuration (the same
+ * parameters, overridden by the ones given with the "candidate_" prefix)
+ * are run on the given meshes, and the outputs of the stages are compared
+ * within tolerances: visibility, association, charts, restored mesh and
+ * volumes of the results. The timings of the stages are reported side by side.
+ */
+
+#include <iostream>
+#include <iomanip>
+#include <sstream>
+#include <chrono>
+#include <string>
+#include <vector>
+#include <stdexcept>
+#include <algorithm>
+#include <cmath>
+
+#include <cg3/utilities/command_line_argument_manager.h>
+#include <cg3/libigl/mesh_distance.h>
+
+#include "../methods/faf/faf_data.h"
+#include "../methods/faf/faf_charts.h"
+#include "../methods/faf/faf_meshloader.h"
+#include "../faf_parameters.h"
+#include "../faf_pipeline.h"
+
+//strings used for intro and help
+const std::string intro =
+"Equivalence harness of the 4-axis milling pipeline: runs a reference and a\n"
+"candidate configuration and compares the outputs of the stages.\n";
+
+const std::string help =
+"Usage: \n"
+"./fafEquivalence --input=file1.obj[,file2.obj...] [reference parameters]\n"
+"    [--candidate_<parameter>[=value]...] [--visibility_tolerance=0]\n"
+"    [--association_tolerance=0] [--hausdorff_tolerance=0.001] [--volume_tolerance=0.001]\n"
+"The parameters are the ones of the command line tool.\n";
+
+struct RunOutputs {
+	std::vector<std::pair<std::string, double>> stageSeconds;
+	double totalSeconds;
+
+	cg3::Array2D<int> visibility;
+	std::vector<int> association;
+	std::vector<int> restoredAssociation;
+	size_t nCharts;
+	cg3::EigenMesh restoredMesh;
+	std::vector<double> resultVolumes;
+};
+
+struct Divergence {
+	std::string name;
+	double value;
+	double tolerance;
+	bool passed;
+};
+
+bool runPipeline(
+		const std::string& inputFile,
+		const FAFParameters& params,
+		RunOutputs& outputs);
+
+void compareOutputs(
+		const RunOutputs& reference,
+		const RunOutputs& candidate,
+		const bool compareResults,
+		const double visibilityTolerance,
+		const double associationTolerance,
+		const double hausdorffTolerance,
+		const double volumeTolerance,
+		std::vector<Divergence>& divergences);
+
+void printReport(
+		const std::string& inputFile,
+		const RunOutputs& reference,
+		const RunOutputs& candidate,
+		const std::vector<Divergence>& divergences);
+
+double meshVolume(const cg3::EigenMesh& mesh);
+
+int main(int argc, char *argv[]) {
+	cg3::CommandLineArgumentManager clArguments(argc, argv);
+
+	if (clArguments.size() == 0 || clArguments.exists("h") || clArguments.exists("help")) {
+		std::cout << intro << help;
+		return 0;
+	}
+
+	std::string inputFiles;
+	if (clArguments.exists("i")){
+		inputFiles = clArguments["i"];
+	}
+	if (clArguments.exists("input")){
+		inputFiles = clArguments["input"];
+	}
+	if (inputFiles.empty()){
+		std::cerr << "Error: Input file not specified.\n" << help;
+		return -1;
+	}
+
+	double visibilityTolerance = 0.0;
+	double associationTolerance = 0.0;
+	double hausdorffTolerance = 0.001;
+	double volumeTolerance = 0.001;
+	if (clArguments.exists("visibility_tolerance")){
+		visibilityTolerance = std::stod(clArguments["visibility_tolerance"]);
+	}
+	if (clArguments.exists("association_tolerance")){
+		associationTolerance = std::stod(clArguments["association_tolerance"]);
+	}
+	if (clArguments.exists("hausdorff_tolerance")){
+		hausdorffTolerance = std::stod(clArguments["hausdorff_tolerance"]);
+	}
+	if (clArguments.exists("volume_tolerance")){
+		volumeTolerance = std::stod(clArguments["volume_tolerance"]);
+	}
+
+	FAFParameters reference;
+	FAFParameters candidate;
+	try {
+		parseParameters(clArguments, reference);
+		candidate = reference;
+		parseParameters(clArguments, candidate, "candidate_");
+	}
+	catch (const std::runtime_error& e) {
+		std::cerr << e.what();
+		return -1;
+	}
+
+	std::vector<std::string> meshes;
+	std::stringstream inputStream(inputFiles);
+	std::string inputFile;
+	while (std::getline(inputStream, inputFile, ',')) {
+		if (!inputFile.empty())
+			meshes.push_back(inputFile);
+	}
+
+	bool allPassed = true;
+	for (const std::string& mesh : meshes) {
+		RunOutputs referenceOutputs, candidateOutputs;
+
+		try {
+			std::cout << "\n--- Reference run on " << mesh << " ---\n\n";
+			if (!runPipeline(mesh, reference, referenceOutputs)) {
+				std::cerr << "Error: impossible to load " << mesh << ".\nKnown input formats: OBJ, PLY (also gzip/zstd compressed).\n";
+				return -1;
+			}
+
+			std::cout << "\n--- Candidate run on " << mesh << " ---\n\n";
+			runPipeline(mesh, candidate, candidateOutputs);
+		}
+		catch (const std::runtime_error& e) {
+			std::cerr << e.what();
+			return -1;
+		}
+
+		const bool compareResults = !reference.justSegmentation && !candidate.justSegmentation;
+
+		std::vector<Divergence> divergences;
+		compareOutputs(
+					referenceOutputs, candidateOutputs, compareResults,
+					visibilityTolerance, associationTolerance, hausdorffTolerance, volumeTolerance,
+					divergences);
+
+		printReport(mesh, referenceOutputs, candidateOutputs, divergences);
+
+		for (const Divergence& divergence : divergences) {
+			allPassed &= divergence.passed;
+		}
+	}
+
+	std::cout << "\n" << (allPassed ? "Equivalent" : "Not equivalent") << " within the tolerances.\n";
+
+	return allPassed ? 0 : 1;
+}
+
+/**
+ * Runs the stages of the pipeline (the ones of FAFPipeline::pipeline), timing each one
+ * and keeping the outputs to be compared. Returns false if the mesh cannot be loaded.
+ * Throws a std::runtime_error if the stages of the outputs are not in the pipeline.
+ */
+bool runPipeline(
+		const std::string& inputFile,
+		const FAFParameters& params,
+		RunOutputs& outputs)
+{
+	FourAxisFabrication::Data data;
+	data.isMeshLoaded = FourAxisFabrication::loadMesh(inputFile, data.originalMesh);
+	if (!data.isMeshLoaded)
+		return false;
+	data.mesh = data.originalMesh;
+
+	outputs.stageSeconds.clear();
+	outputs.totalSeconds = 0;
+	outputs.resultVolumes.clear();
+
+	//outputs overwritten by the next stages
+	bool isVisibilityCaptured = false, isAssociationCaptured = false;
+	for (const FAFPipeline::Stage& stage : FAFPipeline::pipelineStages(data, params)) {
+		const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		stage.run();
+		const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+		outputs.stageSeconds.push_back(std::make_pair(stage.name, seconds));
+		outputs.totalSeconds += seconds;
+
+		if (stage.name == "Visibility") {
+			outputs.visibility = data.visibility;
+			isVisibilityCaptured = true;
+		}
+		else if (stage.name == "Association") {
+			outputs.association = data.association;
+			isAssociationCaptured = true;
+		}
+	}
+	if (!isVisibilityCaptured || !isAssociationCaptured) {
+		throw std::runtime_error("Error: the visibility and association stages are not in the pipeline.\n");
+	}
+
+	outputs.restoredMesh = data.restoredMesh;
+	outputs.restoredAssociation = data.restoredMeshAssociation;
+	outputs.nCharts = FourAxisFabrication::getChartData(
+				data.restoredMesh, data.restoredMeshAssociation, data.minExtremes, data.maxExtremes).charts.size();
+
+	for (const cg3::EigenMesh& result : data.results) {
+		outputs.resultVolumes.push_back(meshVolume(result));
+	}
+
+	return true;
+}
+
+/**
+ * Compares the outputs of the candidate with the ones of the reference:
+ * fraction of different visibility entries, fraction of faces with a different
+ * association (after the graph-cut and on the restored mesh), chart count,
+ * Hausdorff distance of the restored meshes (relative to the bounding box diagonal)
+ * and max relative volume difference of the results.
+ */
+void compareOutputs(
+		const RunOutputs& reference,
+		const RunOutputs& candidate,
+		const bool compareResults,
+		const double visibilityTolerance,
+		const double associationTolerance,
+		const double hausdorffTolerance,
+		const double volumeTolerance,
+		std::vector<Divergence>& divergences)
+{
+	divergences.clear();
+
+	//Visibility
+	double visibilityDifference = 1.0;
+	if (reference.visibility.sizeX() == candidate.visibility.sizeX() &&
+			reference.visibility.sizeY() == candidate.visibility.sizeY())
+	{
+		size_t nDifferent = 0;
+		for (size_t i = 0; i < reference.visibility.sizeX(); i++) {
+			for (size_t j = 0; j < reference.visibility.sizeY(); j++) {
+				if (reference.visibility(i, j) != candidate.visibility(i, j))
+					nDifferent++;
+			}
+		}
+		const size_t nEntries = reference.visibility.sizeX() * reference.visibility.sizeY();
+		visibilityDifference = nEntries > 0 ? static_cast<double>(nDifferent) / nEntries : 0.0;
+	}
+	divergences.push_back({"Visibility difference", visibilityDifference, visibilityTolerance, visibilityDifference <= visibilityTolerance});
+
+	//Association
+	auto associationDifference = [] (const std::vector<int>& a, const std::vector<int>& b) {
+		if (a.size() != b.size())
+			return 1.0;
+		size_t nDifferent = 0;
+		for (size_t i = 0; i < a.size(); i++) {
+			if (a[i] != b[i])
+				nDifferent++;
+		}
+		return a.empty() ? 0.0 : static_cast<double>(nDifferent) / a.size();
+	};
+
+	const double graphCutDifference = associationDifference(reference.association, candidate.association);
+	divergences.push_back({"Association difference", graphCutDifference, associationTolerance, graphCutDifference <= associationTolerance});
+
+	const double restoredDifference = associationDifference(reference.restoredAssociation, candidate.restoredAssociation);
+	divergences.push_back({"Restored association difference", restoredDifference, associationTolerance, restoredDifference <= associationTolerance});
+
+	//Charts
+	const double chartDifference = std::fabs(static_cast<double>(reference.nCharts) - static_cast<double>(candidate.nCharts));
+	divergences.push_back({"Chart count difference", chartDifference, 0.0, chartDifference == 0.0});
+
+	//Restored mesh
+	const double diagonal = reference.restoredMesh.boundingBox().diag();
+	const double hausdorff = cg3::libigl::hausdorffDistance(reference.restoredMesh, candidate.restoredMesh) / diagonal;
+	divergences.push_back({"Restored mesh Hausdorff", hausdorff, hausdorffTolerance, hausdorff <= hausdorffTolerance});
+
+	//Results
+	if (compareResults) {
+		double volumeDifference = 1.0;
+		if (reference.resultVolumes.size() == candidate.resultVolumes.size()) {
+			volumeDifference = 0.0;
+			for (size_t i = 0; i < reference.resultVolumes.size(); i++) {
+				const double difference = std::fabs(reference.resultVolumes[i] - candidate.resultVolumes[i]) / std::fabs(reference.resultVolumes[i]);
+				volumeDifference = std::max(volumeDifference, difference);
+			}
+		}
+		divergences.push_back({"Results volume difference", volumeDifference, volumeTolerance, volumeDifference <= volumeTolerance});
+	}
+}
+
+/**
+ * Prints the timings of the stages (with the speedup of the candidate)
+ * and the divergences (with their tolerances).
+ */
+void printReport(
+		const std::string& inputFile,
+		const RunOutputs& reference,
+		const RunOutputs& candidate,
+		const std::vector<Divergence>& divergences)
+{
+	std::cout << "\n--- Equivalence report for " << inputFile << " ---\n\n";
+
+	std::cout << std::left << std::setw(34) << "Stage"
+			  << std::right << std::setw(14) << "Reference (s)"
+			  << std::setw(14) << "Candidate (s)"
+			  << std::setw(10) << "Speedup" << "\n";
+
+	for (const std::pair<std::string, double>& stage : reference.stageSeconds) {
+		std::vector<std::pair<std::string, double>>::const_iterator it = std::find_if(
+					candidate.stageSeconds.begin(), candidate.stageSeconds.end(),
+					[&] (const std::pair<std::string, double>& s) { return s.first == stage.first; });
+		if (it == candidate.stageSeconds.end())
+			continue;
+
+		std::cout << std::left << std::setw(34) << stage.first
+				  << std::right << std::fixed << std::setprecision(3)
+				  << std::setw(14) << stage.second
+				  << std::setw(14) << it->second
+				  << std::setw(9) << stage.second / it->second << "x\n";
+	}
+	std::cout << std::left << std::setw(34) << "Total"
+			  << std::right << std::setw(14) << reference.totalSeconds
+			  << std::setw(14) << candidate.totalSeconds
+			  << std::setw(9) << reference.totalSeconds / candidate.totalSeconds << "x\n\n";
+
+	std::cout << std::left << std::setw(34) << "Divergence"
+			  << std::right << std::setw(14) << "Value"
+			  << std::setw(14) << "Tolerance"
+			  << std::setw(10) << "Status" << "\n";
+	for (const Divergence& divergence : divergences) {
+		std::cout << std::left << std::setw(34) << divergence.name
+				  << std::right << std::scientific << std::setprecision(3)
+				  << std::setw(14) << divergence.value
+				  << std::setw(14) << divergence.tolerance
+				  << std::setw(10) << (divergence.passed ? "ok" : "FAILED") << "\n";
+	}
+	std::cout << std::defaultfloat;
+}
+
+/**
+ * Volume of a closed mesh (divergence theorem on the signed tetrahedra).
+ */
+double meshVolume(const cg3::EigenMesh& mesh)
+{
+	double volume = 0;
+	for (unsigned int fId = 0; fId < mesh.numberFaces(); fId++) {
+		const cg3::Point3i f = mesh.face(fId);
+		const cg3::Point3d& a = mesh.vertex(f.x());
+		const cg3::Point3d& b = mesh.vertex(f.y());
+		const cg3::Point3d& c = mesh.vertex(f.z());
+		volume += a.dot(b.cross(c)) / 6.0;
+	}
+	return std::fabs(volume);
+}